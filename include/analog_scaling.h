@@ -0,0 +1,72 @@
+#ifndef ANALOG_SCALING_H
+#define ANALOG_SCALING_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct AnalogChannel;
+
+/**
+ * @brief Per-channel conversion from raw .dat values to primary units
+ *
+ * value = (a * raw + b) * ratio, evaluated in that order (no fused
+ * multiply-add) so every kernel gives the same bits as the scalar formula.
+ * Folding the three into a single gain/offset would save one multiply but
+ * can change the last bit.
+ */
+struct AnalogScale {
+    double a = 1.0;       // Channel multiplier
+    double b = 0.0;       // Channel offset
+    double ratio = 1.0;   // primary / secondary (1.0 when secondary is 0)
+
+    /**
+     * @brief Coefficients of a .cfg analog channel
+     */
+    static AnalogScale forChannel(const AnalogChannel& channel);
+
+    double apply(double raw) const { return (a * raw + b) * ratio; }
+};
+
+/**
+ * @brief Instruction set used by the scaling kernels
+ */
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2
+};
+
+/**
+ * @brief Best level supported by this CPU (and OS), detected once
+ */
+SimdLevel detectSimdLevel();
+
+/**
+ * @brief Level used by scaleAnalog() (detected level unless overridden)
+ */
+SimdLevel activeSimdLevel();
+
+/**
+ * @brief Force a level (clamped to what the CPU supports)
+ *
+ * For benchmarks and validation; not thread-safe against running kernels.
+ */
+void setSimdLevel(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
+
+/**
+ * @brief Scale a contiguous block of raw values
+ * @param raw Raw values (int16 for BINARY, int32 for BINARY32, float for FLOAT32)
+ * @param count Number of values
+ * @param scale Channel coefficients
+ * @param out Output, count entries (float output is rounded from the double result)
+ */
+void scaleAnalog(const int16_t* raw, size_t count, const AnalogScale& scale, double* out);
+void scaleAnalog(const int32_t* raw, size_t count, const AnalogScale& scale, double* out);
+void scaleAnalog(const int16_t* raw, size_t count, const AnalogScale& scale, float* out);
+void scaleAnalog(const int32_t* raw, size_t count, const AnalogScale& scale, float* out);
+void scaleAnalog(const float* raw, size_t count, const AnalogScale& scale, double* out);
+void scaleAnalog(const float* raw, size_t count, const AnalogScale& scale, float* out);
+
+#endif // ANALOG_SCALING_H
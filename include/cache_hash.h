@@ -0,0 +1,101 @@
+#ifndef CACHE_HASH_H
+#define CACHE_HASH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief FNV-1a, 64-bit: ties cache entries to their sources and settings
+ */
+class Fnv1a {
+public:
+    void add(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash_ = (hash_ ^ bytes[i]) * 0x100000001b3ULL;
+        }
+    }
+
+    void add(uint64_t value) { add(&value, sizeof(value)); }
+    void add(const std::string& text) { add(text.size()); add(text.data(), text.size()); }
+
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+/**
+ * @brief Hash of whole source files, fed in pieces of any size
+ *
+ * Four lanes of 64-bit words, each mixed FNV-style and folded down, so a
+ * recording of gigabytes hashes at close to memory speed rather than the
+ * byte at a time of Fnv1a. Not cryptographic: it tells an edited file
+ * from the one an entry was written for.
+ */
+class ContentHash {
+public:
+    void add(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        length_ += size;
+        if (pending_ > 0) {
+            size_t take = std::min(size, sizeof(block_) - pending_);
+            std::memcpy(block_ + pending_, bytes, take);
+            pending_ += take;
+            bytes += take;
+            size -= take;
+            if (pending_ < sizeof(block_)) {
+                return;
+            }
+            mix(block_);
+            pending_ = 0;
+        }
+        for (; size >= sizeof(block_); bytes += sizeof(block_), size -= sizeof(block_)) {
+            mix(bytes);
+        }
+        std::memcpy(block_, bytes, size);
+        pending_ = size;
+    }
+
+    uint64_t value() const {
+        Fnv1a hash;
+        hash.add(lanes_, sizeof(lanes_));
+        hash.add(block_, pending_);
+        hash.add(length_);
+        return hash.value();
+    }
+
+private:
+    void mix(const uint8_t* block) {
+        for (size_t lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            std::memcpy(&word, block + lane * sizeof(word), sizeof(word));
+            uint64_t hash = (lanes_[lane] ^ word) * 0x100000001b3ULL;
+            lanes_[lane] = hash ^ (hash >> 32);  // High bits reach the low ones too
+        }
+    }
+
+    uint64_t lanes_[4] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL, 0xcbf29ce4cbf29ce4ULL,
+                          0x8422232584222325ULL};
+    uint8_t block_[32] = {};  // Bytes short of a whole block
+    size_t pending_ = 0;
+    uint64_t length_ = 0;
+};
+
+/**
+ * @brief Hash as 16 hex digits (for cache file names)
+ */
+inline std::string toHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        text[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+    return text;
+}
+
+#endif // CACHE_HASH_H
@@ -0,0 +1,199 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+    #include <cerrno>
+#endif
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * @brief Time domain a clock reading refers to
+ */
+enum class ClockDomain {
+    Monotonic,  // CLOCK_MONOTONIC (steady_clock on Windows)
+    Realtime,   // CLOCK_REALTIME (UTC)
+    TAI         // CLOCK_TAI (Linux), Realtime elsewhere
+};
+
+/**
+ * @brief Injectable time source for Timer and the transmission loops
+ *
+ * All readings are nanoseconds. Sleeping is always on the Monotonic domain.
+ */
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    /**
+     * @brief Current time in nanoseconds
+     * @param domain Time domain to read
+     */
+    virtual int64_t now(ClockDomain domain) = 0;
+
+    /**
+     * @brief Block until an absolute Monotonic time
+     * @param deadlineNs Absolute deadline in nanoseconds
+     */
+    virtual void sleepUntil(int64_t deadlineNs) = 0;
+
+    /**
+     * @brief Check if time is simulated (no real waiting)
+     */
+    virtual bool isVirtual() const { return false; }
+};
+
+/**
+ * @brief Operating system clocks
+ *
+ * Linux: clock_nanosleep with TIMER_ABSTIME on CLOCK_MONOTONIC
+ * macOS: Relative nanosleep fallback
+ * Windows: Sleep for coarse delays, busy-wait for the last millisecond
+ */
+class SystemClock : public Clock {
+public:
+    int64_t now(ClockDomain domain) override {
+#ifdef _WIN32
+        if (domain == ClockDomain::Monotonic) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+#else
+        clockid_t id = CLOCK_MONOTONIC;
+        if (domain == ClockDomain::Realtime) {
+            id = CLOCK_REALTIME;
+        } else if (domain == ClockDomain::TAI) {
+#ifdef CLOCK_TAI
+            id = CLOCK_TAI;
+#else
+            id = CLOCK_REALTIME;
+#endif
+        }
+        struct timespec ts;
+        clock_gettime(id, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+    }
+
+    void sleepUntil(int64_t deadlineNs) override {
+#ifdef _WIN32
+        while (true) {
+            int64_t diff_us = (deadlineNs - now(ClockDomain::Monotonic)) / 1000;
+            if (diff_us <= 0) break;
+
+            // If more than 1ms away, use Sleep to avoid busy-waiting
+            if (diff_us > 1000) {
+                Sleep(static_cast<DWORD>((diff_us - 500) / 1000));
+            }
+            // Otherwise busy-wait for precision
+        }
+#elif defined(__linux__)
+        struct timespec deadline;
+        deadline.tv_sec = static_cast<time_t>(deadlineNs / 1000000000LL);
+        deadline.tv_nsec = static_cast<long>(deadlineNs % 1000000000LL);
+
+        int ret;
+        do {
+            ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+        } while (ret == EINTR);
+
+        if (ret != 0) {
+            std::cerr << "Error in clock_nanosleep: " << ret << std::endl;
+        }
+#else
+        // macOS: Use relative nanosleep as fallback
+        int64_t remaining = deadlineNs - now(ClockDomain::Monotonic);
+        if (remaining > 0) {
+            struct timespec sleep_time;
+            sleep_time.tv_sec = static_cast<time_t>(remaining / 1000000000LL);
+            sleep_time.tv_nsec = static_cast<long>(remaining % 1000000000LL);
+            nanosleep(&sleep_time, nullptr);
+        }
+#endif
+    }
+};
+
+// TAI - UTC: 37 leap seconds since 2017-01-01
+const int64_t kTaiUtcOffsetNs = 37LL * 1000000000LL;
+
+/**
+ * @brief Simulated clock that jumps straight to every deadline
+ *
+ * Starts at the current system time so UTC/TAI alignment behaves as in a
+ * real run, then advances only when sleepUntil() is called. A run paced by
+ * this clock finishes as fast as frames can be built, and every timestamp
+ * is exactly on the ideal schedule.
+ */
+class VirtualClock : public Clock {
+public:
+    VirtualClock() {
+        SystemClock system;
+        monotonicNs_ = system.now(ClockDomain::Monotonic);
+        realtimeOffsetNs_ = system.now(ClockDomain::Realtime) - monotonicNs_;
+        taiOffsetNs_ = system.now(ClockDomain::TAI) - monotonicNs_;
+    }
+
+    /**
+     * @brief Start at an explicit time
+     * @param monotonicNs Initial Monotonic time
+     * @param realtimeNs Initial Realtime (UTC) time
+     * @param taiUtcNs TAI ahead of UTC (leap seconds)
+     */
+    VirtualClock(int64_t monotonicNs, int64_t realtimeNs, int64_t taiUtcNs = kTaiUtcOffsetNs)
+        : monotonicNs_(monotonicNs),
+          realtimeOffsetNs_(realtimeNs - monotonicNs),
+          taiOffsetNs_(realtimeNs - monotonicNs + taiUtcNs) {}
+
+    int64_t now(ClockDomain domain) override {
+        switch (domain) {
+            case ClockDomain::Realtime: return monotonicNs_ + realtimeOffsetNs_;
+            case ClockDomain::TAI: return monotonicNs_ + taiOffsetNs_;
+            case ClockDomain::Monotonic:
+            default: return monotonicNs_;
+        }
+    }
+
+    void sleepUntil(int64_t deadlineNs) override {
+        if (deadlineNs > monotonicNs_) {
+            monotonicNs_ = deadlineNs;
+        }
+    }
+
+    bool isVirtual() const override { return true; }
+
+    /**
+     * @brief Advance time without a deadline
+     * @param ns Nanoseconds to add
+     */
+    void advance(int64_t ns) { monotonicNs_ += ns; }
+
+    /**
+     * @brief Step the Realtime domain, as a PTP/NTP correction would
+     * @param ns Nanoseconds to add to Realtime and TAI
+     */
+    void stepRealtime(int64_t ns) {
+        realtimeOffsetNs_ += ns;
+        taiOffsetNs_ += ns;
+    }
+
+private:
+    int64_t monotonicNs_;
+    int64_t realtimeOffsetNs_;
+    int64_t taiOffsetNs_;
+};
+
+/**
+ * @brief Process-wide system clock
+ */
+inline SystemClock& systemClock() {
+    static SystemClock clock;
+    return clock;
+}
+
+#endif // CLOCK_H
@@ -0,0 +1,181 @@
+#ifndef COMTRADE_BINARY_READER_H
+#define COMTRADE_BINARY_READER_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include "comtrade_parser.h"
+#include "mapped_file.h"
+
+/**
+ * @brief Byte layout of one BINARY/BINARY32/FLOAT32 .dat record
+ *
+ * Record: 4 bytes sample#, 4 bytes timestamp, one value per analog channel
+ * (int16, int32 or IEEE float), then the digital channels bit-packed in
+ * 2-byte words (4-byte words for BINARY32). All fields little-endian.
+ */
+struct BinaryRecordLayout {
+    size_t analogBytes = 2;        // 2 (BINARY) or 4 (BINARY32, FLOAT32)
+    size_t digitalWordBytes = 2;   // 2 (BINARY, FLOAT32) or 4 (BINARY32)
+    bool floatAnalog = false;      // Analog values are IEEE floats (FLOAT32)
+    int numAnalog = 0;
+    int numDigital = 0;
+    int numDigitalWords = 0;
+    size_t digitalOffset = 8;      // Offset of the first digital word
+    size_t recordSize = 8;
+
+    /**
+     * @brief Compute the layout from a parsed .cfg
+     */
+    static BinaryRecordLayout forConfig(const ComtradeConfig& config) {
+        BinaryRecordLayout layout;
+        bool wide = config.dataFormat == DataFormat::BINARY32;
+        layout.floatAnalog = config.dataFormat == DataFormat::FLOAT32;
+        layout.analogBytes = (wide || layout.floatAnalog) ? 4 : 2;
+        layout.digitalWordBytes = wide ? 4 : 2;
+        layout.numAnalog = config.numAnalogChannels;
+        layout.numDigital = config.numDigitalChannels;
+        int bitsPerWord = static_cast<int>(layout.digitalWordBytes * 8);
+        layout.numDigitalWords = (config.numDigitalChannels + bitsPerWord - 1) / bitsPerWord;
+        layout.digitalOffset = 8 + layout.numAnalog * layout.analogBytes;
+        layout.recordSize = layout.digitalOffset + layout.numDigitalWords * layout.digitalWordBytes;
+        return layout;
+    }
+};
+
+/**
+ * @brief Zero-copy view of one record inside the mapped .dat file
+ */
+class BinaryRecordView {
+public:
+    BinaryRecordView(const uint8_t* data, const BinaryRecordLayout& layout)
+        : data_(data), layout_(&layout) {}
+
+    uint32_t sampleNumber() const { return load<uint32_t>(0); }
+    uint32_t timestamp() const { return load<uint32_t>(4); }
+
+    /**
+     * @brief Raw (unscaled) analog value, sign-extended to 32 bits (BINARY, BINARY32)
+     * @param channel Analog channel index (0-based)
+     */
+    int32_t analogRaw(int channel) const {
+        size_t offset = 8 + channel * layout_->analogBytes;
+        if (layout_->analogBytes == 2) {
+            return load<int16_t>(offset);
+        }
+        return load<int32_t>(offset);
+    }
+
+    /**
+     * @brief Raw (unscaled) analog value (FLOAT32)
+     * @param channel Analog channel index (0-based)
+     */
+    float analogFloat(int channel) const {
+        return load<float>(8 + channel * layout_->analogBytes);
+    }
+
+    /**
+     * @brief Packed digital word (16 or 32 channels)
+     * @param word Word index (0-based)
+     */
+    uint32_t digitalWord(int word) const {
+        size_t offset = layout_->digitalOffset + word * layout_->digitalWordBytes;
+        if (layout_->digitalWordBytes == 2) {
+            return load<uint16_t>(offset);
+        }
+        return load<uint32_t>(offset);
+    }
+
+    /**
+     * @brief State of one digital channel
+     * @param channel Digital channel index (0-based)
+     */
+    bool digital(int channel) const {
+        int bitsPerWord = static_cast<int>(layout_->digitalWordBytes * 8);
+        return (digitalWord(channel / bitsPerWord) >> (channel % bitsPerWord)) & 1u;
+    }
+
+    const uint8_t* data() const { return data_; }
+
+private:
+    template <typename T>
+    T load(size_t offset) const {
+        // Records are not aligned; memcpy compiles to a plain load
+        T value;
+        std::memcpy(&value, data_ + offset, sizeof(T));
+        return value;
+    }
+
+    const uint8_t* data_;
+    const BinaryRecordLayout* layout_;
+};
+
+/**
+ * @brief Memory-mapped reader for BINARY/BINARY32/FLOAT32 .dat files
+ *
+ * Maps the whole file and exposes records in place, so loading is bounded by
+ * page-cache bandwidth rather than by read() copies. The file size is checked
+ * against the record size from the .cfg: a trailing partial record or fewer
+ * records than the sample rate table declares is an error.
+ *
+ * Example usage:
+ * @code
+ * ComtradeBinaryReader reader;
+ * if (reader.open("fault.dat", parser.getConfig())) {
+ *     for (size_t i = 0; i < reader.recordCount(); i++) {
+ *         int32_t ia = reader.record(i).analogRaw(0);
+ *     }
+ * }
+ * @endcode
+ */
+class ComtradeBinaryReader {
+public:
+    /**
+     * @brief Map and validate a binary .dat file
+     * @param datPath Path to .dat file
+     * @param config Parsed .cfg (dataFormat must be BINARY, BINARY32 or FLOAT32)
+     * @return true on success, false on failure
+     */
+    bool open(const std::string& datPath, const ComtradeConfig& config);
+
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+
+    /**
+     * @brief Number of complete records (capped at the declared sample count)
+     */
+    size_t recordCount() const { return recordCount_; }
+
+    /**
+     * @brief View of record i (no bounds check)
+     */
+    BinaryRecordView record(size_t i) const {
+        return BinaryRecordView(file_.data() + i * layout_.recordSize, layout_);
+    }
+
+    /**
+     * @brief Validate a binary .dat size and derive its record count
+     * @param fileSize File size in bytes
+     * @param layout Record layout
+     * @param config Parsed .cfg (sample rate table gives the declared count)
+     * @param count Output record count
+     * @param error Output error message
+     * @return false on a partial record or fewer records than declared
+     */
+    static bool countRecords(uint64_t fileSize, const BinaryRecordLayout& layout,
+                             const ComtradeConfig& config, size_t& count, std::string& error);
+
+    const BinaryRecordLayout& layout() const { return layout_; }
+    const MappedFile& file() const { return file_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    MappedFile file_;
+    BinaryRecordLayout layout_;
+    size_t recordCount_ = 0;
+    std::string lastError_;
+};
+
+#endif // COMTRADE_BINARY_READER_H
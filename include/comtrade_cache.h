@@ -0,0 +1,147 @@
+#ifndef COMTRADE_CACHE_H
+#define COMTRADE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "comtrade_parser.h"
+
+/**
+ * @brief Identity of the source files of a cache entry
+ *
+ * Taken without reading the files whole, so a cache hit costs a few stats
+ * and reads however large the recording is:
+ *   - key: absolute path, size and modification time of every file, plus
+ *     inode and status-change time where the platform has them
+ *   - probe: files of up to 1 MiB whole (the .cfg), and for larger ones the
+ *     first and last 64 KiB and 16 pages spread between them
+ * The content hash of every byte is only computed when asked for, once per
+ * instance (an entry stores it when written; a paranoid load checks it).
+ * Safe to share between the caches of one source, so the parse cache and
+ * the output cache of a replay identify and hash it once between them.
+ */
+class CacheSource {
+public:
+    /**
+     * @param cfgPath .cfg or .cff file
+     * @param datPath .dat file (ignored for .cff)
+     */
+    CacheSource(const std::string& cfgPath, const std::string& datPath);
+
+    /**
+     * @brief Key and probe hashes taken at construction
+     * @param error Output reason when the source could not be identified
+     * @return false if a file is missing or unreadable
+     */
+    bool identity(uint64_t& keyHash, uint64_t& probeHash, std::string& error) const;
+
+    /**
+     * @brief Hash of every byte of every file (read whole on the first call)
+     * @param error Output reason when a file cannot be read
+     */
+    bool contentHash(uint64_t& hash, std::string& error) const;
+
+    /**
+     * @brief Take the key and probe again and compare with construction
+     * @param error Output reason when the source changed or cannot be read
+     * @return true if the source looks as it did at construction
+     */
+    bool unchanged(std::string& error) const;
+
+    const std::vector<std::string>& files() const { return files_; }  // .cfg and .dat, or the .cff
+    bool cff() const { return cff_; }
+
+private:
+    bool computeIdentity(uint64_t& keyHash, uint64_t& probeHash, std::string& error) const;
+
+    std::vector<std::string> files_;
+    bool cff_;
+    uint64_t keyHash_;
+    uint64_t probeHash_;
+    bool ok_;                        // Files exist and were identified
+    std::string error_;
+
+    mutable std::mutex contentMutex_;
+    mutable bool contentDone_;
+    mutable uint64_t contentHash_;
+};
+
+/**
+ * @brief On-disk cache of a parsed COMTRADE recording
+ *
+ * The cache file holds the .cfg text and every column of the parsed
+ * recording (in its analog storage) as flat arrays, each 64-byte aligned
+ * behind a fixed header, so a hit is one mapping and a memcpy per column
+ * instead of a full .dat parse.
+ *
+ * An entry is tied to its source by the key and probe of a CacheSource,
+ * checked on every load, and by the hash of the whole content, computed
+ * when the entry is written and checked on load only in paranoid mode.
+ * Any difference makes the entry stale; the caller parses the source again
+ * and writes a fresh entry. Entries are written to a temporary file and
+ * renamed into place, so a reader never sees a partial file.
+ *
+ * Cache files live next to the source ("fault.cfg.cache") or, when a cache
+ * directory is given, in that directory under the source name plus a hash of
+ * its full path ("fault.cfg-1a2b3c4d5e6f7a8b.cache").
+ */
+class ComtradeCache {
+public:
+    /**
+     * @brief Identify the source files and the cache file
+     * @param cfgPath .cfg or .cff file
+     * @param datPath .dat file (ignored for .cff)
+     * @param cacheDir Cache directory (empty = next to cfgPath)
+     * @param variant Load settings that shape the stored data (an entry
+     *                written with other settings is stale)
+     * @param paranoid Check the whole content on load, not only key and probe
+     * @param source Identity of the source already taken (nullptr = take it here)
+     */
+    ComtradeCache(const std::string& cfgPath, const std::string& datPath, const std::string& cacheDir,
+                  const std::string& variant = "", bool paranoid = false,
+                  std::shared_ptr<const CacheSource> source = nullptr);
+
+    /**
+     * @brief Cache file of a source (see the class description)
+     */
+    static std::string pathFor(const std::string& cfgPath, const std::string& cacheDir);
+
+    /**
+     * @brief Read the entry for the source
+     * @param cfgText Output .cfg text
+     * @param recording Output recording
+     * @param skippedLines Output count of .dat lines skipped by the original parse
+     * @param detail Reason when the result is Stale
+     * @return Hit, Miss (no entry) or Stale (entry does not match the source)
+     */
+    CacheResult load(std::string& cfgText, ComtradeRecording& recording,
+                     uint64_t& skippedLines, std::string& detail) const;
+
+    /**
+     * @brief Write the entry for a recording parsed from the source
+     *
+     * Nothing is written if the source changed since construction. Reads
+     * the source whole once, for the content hash.
+     *
+     * @param recording Parsed recording
+     * @param skippedLines Count of skipped .dat lines
+     * @param error Output error message
+     * @return true if the cache file was written
+     */
+    bool store(const ComtradeRecording& recording, uint64_t skippedLines, std::string& error) const;
+
+    const CacheSource& source() const { return *source_; }
+    const std::string& path() const { return path_; }
+
+private:
+    bool readCfgText(std::string& text, std::string& error) const;
+
+    std::shared_ptr<const CacheSource> source_;
+    std::string path_;
+    uint64_t variantHash_;
+    bool paranoid_;
+};
+
+#endif // COMTRADE_CACHE_H
@@ -0,0 +1,124 @@
+#ifndef COMTRADE_CAMPAIGN_H
+#define COMTRADE_CAMPAIGN_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "comtrade_parser.h"
+
+class ThreadPool;
+
+/**
+ * @brief Options for ComtradeCampaignLoader
+ */
+struct ComtradeCampaignOptions {
+    unsigned numThreads = 0;    // Files loaded at once (0 = hardware concurrency)
+    uint64_t memoryBudget = 0;  // Max bytes for the columns of all loaded recordings together
+                                // (0 = unlimited; see ComtradeLoadOptions::memoryBudget)
+
+    // Per-file options; memoryBudget is replaced by the budget left for the
+    // file, and numThreads = 0 shares the workers left over between files
+    ComtradeLoadOptions load;
+};
+
+/**
+ * @brief Outcome of loading one file of a campaign
+ */
+struct ComtradeCampaignResult {
+    size_t index = 0;           // Position in the list passed to start()
+    std::string cfgPath;
+    bool ok = false;
+    std::string error;          // Why the file failed (empty if ok)
+    std::unique_ptr<ComtradeParser> parser;  // Loaded file (also set on failure, for its state)
+    uint64_t memoryBytes = 0;   // Bytes charged to the campaign budget
+    double loadMs = 0.0;        // Wall time of the load
+};
+
+/**
+ * @brief Loads the COMTRADE files of a test campaign concurrently
+ *
+ * Each file is loaded by its own ComtradeParser on a thread pool; results
+ * are handed out as the files complete. All recordings draw on one memory
+ * budget: start() reads every .cfg and holds back each file's smallest
+ * layout; a file about to load reserves its estimated size and gets the
+ * budget that is neither used nor held back for the others. With
+ * SampleStorage::PreferDouble, files take doubles while the rest still fit raw,
+ * then drop to raw storage, instead of later files failing. A file that
+ * does not fit waits for the loads in flight, then fails if it still does
+ * not fit. Recordings stay charged until reset().
+ *
+ * Example usage:
+ * @code
+ * ComtradeCampaignOptions options;
+ * options.memoryBudget = 4ull << 30;
+ * options.load.storage = SampleStorage::Auto;  // Smallest lossless layout for every file
+ * ComtradeCampaignLoader loader(options);
+ * loader.start({"fault1.cfg", "fault2.cfg", "fault3.cfg"});
+ * ComtradeCampaignResult result;
+ * while (loader.next(result)) {
+ *     if (!result.ok) { std::cerr << result.cfgPath << ": " << result.error; continue; }
+ *     use(std::move(result.parser));
+ * }
+ * @endcode
+ */
+class ComtradeCampaignLoader {
+public:
+    explicit ComtradeCampaignLoader(const ComtradeCampaignOptions& options = ComtradeCampaignOptions());
+    ~ComtradeCampaignLoader();
+
+    ComtradeCampaignLoader(const ComtradeCampaignLoader&) = delete;
+    ComtradeCampaignLoader& operator=(const ComtradeCampaignLoader&) = delete;
+
+    /**
+     * @brief Start loading files (added to any still loading)
+     * @param cfgPaths .cfg or .cff paths; each .dat is found as by ComtradeParser::load()
+     */
+    void start(const std::vector<std::string>& cfgPaths);
+
+    /**
+     * @brief Wait for the next file to complete
+     * @param result Output, in completion order
+     * @return false once every started file has been returned
+     */
+    bool next(ComtradeCampaignResult& result);
+
+    /**
+     * @brief Load files and wait for all of them
+     * @return Results in the order of cfgPaths
+     */
+    std::vector<ComtradeCampaignResult> loadAll(const std::vector<std::string>& cfgPaths);
+
+    /**
+     * @brief Wait for the loads in flight, discard unreturned results and free the budget
+     */
+    void reset();
+
+    /**
+     * @brief Bytes charged to the budget (loaded recordings and reservations)
+     */
+    uint64_t bytesInUse() const;
+
+    const ComtradeCampaignOptions& getOptions() const { return options_; }
+
+private:
+    void loadFile(size_t index, const std::string& cfgPath, unsigned threadsPerFile, uint64_t minimumBytes);
+
+    ComtradeCampaignOptions options_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable completed_;   // A result was queued
+    std::condition_variable released_;    // A load in flight finished (budget may be free)
+    std::deque<ComtradeCampaignResult> results_;
+    size_t started_;        // Files passed to start()
+    size_t returned_;       // Results handed out by next()
+    size_t inFlight_;       // Loads holding a reservation
+    uint64_t bytesInUse_;
+    uint64_t heldBack_;     // Smallest sizes of the files not started yet
+};
+
+#endif // COMTRADE_CAMPAIGN_H
@@ -0,0 +1,91 @@
+#ifndef COMTRADE_CFF_H
+#define COMTRADE_CFF_H
+
+#include <string>
+#include <cstdint>
+#include "mapped_file.h"
+
+/**
+ * @brief One section of a .cff file, in place inside the mapping
+ */
+struct CffSection {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool present = false;
+
+    /**
+     * @brief Byte offset of the section body from the start of the file
+     */
+    uint64_t offset(const MappedFile& file) const {
+        return present ? static_cast<uint64_t>(data - reinterpret_cast<const char*>(file.data())) : 0;
+    }
+};
+
+/**
+ * @brief Reader for C37.111-2013 single-file COMTRADE (.cff) containers
+ *
+ * A .cff holds the cfg, inf, hdr and dat files one after another, each
+ * introduced by a line such as
+ *
+ *   --- file type: CFG ---
+ *   --- file type: DAT ASCII ---
+ *   --- file type: DAT BINARY: 1234567 ---
+ *
+ * Text sections run to the next section line; a binary dat section is the
+ * given number of bytes. The whole file is mapped once and every section is
+ * a view into the mapping, so nothing is copied however large the data is.
+ *
+ * Example usage:
+ * @code
+ * ComtradeCffFile cff;
+ * if (cff.open("fault.cff")) {
+ *     const CffSection& dat = cff.dat();
+ *     decode(dat.data, dat.size);
+ * }
+ * @endcode
+ */
+class ComtradeCffFile {
+public:
+    /**
+     * @brief Map a .cff file and locate its sections
+     * @param path Path to .cff file
+     * @return true if the cfg and dat sections were found, false otherwise
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+
+    const CffSection& cfg() const { return cfg_; }
+    const CffSection& inf() const { return inf_; }  // Not present in every file
+    const CffSection& hdr() const { return hdr_; }  // Not present in every file
+    const CffSection& dat() const { return dat_; }
+
+    /**
+     * @brief True for a "DAT BINARY" section (BINARY, BINARY32 or FLOAT32)
+     */
+    bool datIsBinary() const { return datIsBinary_; }
+
+    const MappedFile& file() const { return file_; }
+    std::string getLastError() const { return lastError_; }
+
+    /**
+     * @brief Check for a .cff extension (case-insensitive)
+     */
+    static bool isCffPath(const std::string& path);
+
+private:
+    bool parseSections();
+
+    MappedFile file_;
+    CffSection cfg_;
+    CffSection inf_;
+    CffSection hdr_;
+    CffSection dat_;
+    bool datIsBinary_ = false;
+    std::string lastError_;
+};
+
+#endif // COMTRADE_CFF_H
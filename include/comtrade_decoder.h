@@ -0,0 +1,172 @@
+#ifndef COMTRADE_DECODER_H
+#define COMTRADE_DECODER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "comtrade_parser.h"
+#include "comtrade_binary_reader.h"
+#include "analog_scaling.h"
+
+/**
+ * @brief Outcome of parsing one ASCII .dat line
+ */
+enum class AsciiLineStatus {
+    Ok,          // Sample appended
+    Blank,       // Empty or whitespace-only line
+    Incomplete,  // Fewer fields than the .cfg channel count
+    Invalid      // A field is not a number
+};
+
+/**
+ * @brief Result of parsing a range of ASCII .dat lines
+ */
+struct AsciiBlockResult {
+    uint64_t lines = 0;                       // Lines in the range
+    uint64_t skipped = 0;                     // Incomplete or invalid lines
+    std::vector<ComtradeParseIssue> issues;   // First few, line numbers relative to the range (1-based)
+    bool rawOverflow = false;                 // A value did not fit the raw storage; parsing stopped
+};
+
+/**
+ * @brief Sample indices [first, last) between two time offsets
+ *
+ * Offsets are seconds from the first sample; sample k is at the time given
+ * by the .cfg rate table (each rate segment starts where the previous one
+ * ended). The result is clamped to the samples the table declares.
+ *
+ * @param config Parsed .cfg
+ * @param startSeconds First offset (inclusive)
+ * @param endSeconds Last offset (exclusive, 0 = end of recording)
+ * @param first Output first sample
+ * @param last Output end sample
+ * @return false if the rate table has no usable rates (timestamps only)
+ */
+bool sampleWindowFromRates(const ComtradeConfig& config, double startSeconds, double endSeconds,
+                           uint64_t& first, uint64_t& last);
+
+/**
+ * @brief Sparse index of line starts in ASCII .dat text
+ *
+ * Keeps the offset of every kStride-th line and scans forward (memchr) only
+ * as far as the lines asked for, so finding a window near the start of a
+ * long file touches only its beginning, and later lookups reuse the scan.
+ */
+class AsciiLineIndex {
+public:
+    static constexpr uint64_t kStride = 1024;
+
+    AsciiLineIndex(const char* text, size_t size) : text_(text), size_(size), scanned_(0), lines_(0) {
+        starts_.push_back(0);
+    }
+
+    /**
+     * @brief Offset of the first character of a line
+     * @param line 0-based line number
+     * @return Offset, or the text size if the text has fewer lines
+     */
+    size_t lineStart(uint64_t line);
+
+private:
+    const char* text_;
+    size_t size_;
+    std::vector<size_t> starts_;  // starts_[i] = offset of line i * kStride
+    size_t scanned_;              // Text before this offset is indexed
+    uint64_t lines_;              // Lines started before scanned_
+};
+
+/**
+ * @brief Decodes .dat records into a ComtradeRecording
+ *
+ * Shared by the whole-file loader and the streaming reader so both produce
+ * identical values. Analog values are scaled as
+ * engPrimary = (a * raw + b) * (primary / secondary); binary records are
+ * decoded in blocks so the scaling runs through the SIMD kernels
+ * (see analog_scaling.h).
+ *
+ * ASCII fields are parsed with std::from_chars straight from the text, with
+ * the prefix semantics of std::stod/std::stoi. Holds a row buffer for ASCII
+ * parsing: use one decoder per thread.
+ *
+ * Values are written in the output recording's analog storage: scaled
+ * (double or float), or raw with the scale applied on access.
+ */
+class ComtradeDecoder {
+public:
+    explicit ComtradeDecoder(const ComtradeConfig& config);
+
+    /**
+     * @brief Decode consecutive binary records into existing rows
+     * @param records First record (layout from the config)
+     * @param count Number of records
+     * @param out Recording already sized to at least first + count samples
+     * @param first Row index for the first record
+     *
+     * Raw storage must be able to hold the record's field type exactly.
+     * Digital states are packed 64 rows per word and the partial words at
+     * either end are read and rewritten: concurrent calls on one recording
+     * must start on multiples of 64 rows.
+     */
+    void decodeBinary(const uint8_t* records, size_t count, ComtradeRecording& out, size_t first) const;
+
+    /**
+     * @brief Parse one ASCII .dat line and append it
+     * @param begin First character of the line
+     * @param end One past the last character (newline excluded)
+     * @param out Recording to append to (Double or scaled Float storage)
+     * @return Ok if a sample was appended
+     */
+    AsciiLineStatus parseAsciiLine(const char* begin, const char* end, ComtradeRecording& out);
+
+    /**
+     * @brief Parse one ASCII .dat line and append it
+     * @return false if the line is blank, incomplete or invalid (nothing appended)
+     */
+    bool parseAsciiLine(const std::string& line, ComtradeRecording& out) {
+        return parseAsciiLine(line.data(), line.data() + line.size(), out) == AsciiLineStatus::Ok;
+    }
+
+    /**
+     * @brief Parse every line of a text range and append the samples
+     * @param begin Start of the range (start of a line)
+     * @param end End of the range (after a newline, or end of file)
+     * @param out Recording to append to
+     * @param maxIssues Issues to record before only counting
+     * @return Line and skip counts; rawOverflow if a raw column cannot hold a
+     *         value exactly (the caller re-parses with a wider storage)
+     */
+    AsciiBlockResult parseAsciiBlock(const char* begin, const char* end, ComtradeRecording& out,
+                                     size_t maxIssues);
+
+    const BinaryRecordLayout& layout() const { return layout_; }
+
+private:
+    // Records per transposed block in decodeBinary()
+    static constexpr size_t kBinaryBlockRecords = 256;
+
+    template <typename Raw>
+    void decodeBinaryBlocks(const uint8_t* records, size_t count, ComtradeRecording& out, size_t first) const;
+
+    // Parse one line of integer fields into the row buffers in a single pass;
+    // false if any field needs the general parser (nothing is reported)
+    bool parseIntegerFields(const char* begin, const char* end, int& sampleNumber, uint64_t& timestamp);
+
+    // Parse one line into the row buffers
+    AsciiLineStatus parseAsciiFields(const char* begin, const char* end, int& sampleNumber, uint64_t& timestamp);
+
+    // Store the row buffer's analog values at a row of the given columns;
+    // false if a raw column cannot hold a value exactly
+    bool storeAsciiAnalog(AnalogStorage storage, bool raw, void* const* columns, size_t row) const;
+
+    int numAnalog_;
+    int numDigital_;
+    double timeFactor_;
+    std::vector<AnalogScale> scales_;
+    BinaryRecordLayout layout_;
+
+    // ASCII row buffers (analog values raw, as parsed)
+    std::vector<double> analogRow_;
+    std::vector<uint8_t> digitalRow_;
+};
+
+#endif // COMTRADE_DECODER_H
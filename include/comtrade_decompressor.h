@@ -0,0 +1,129 @@
+#ifndef COMTRADE_DECOMPRESSOR_H
+#define COMTRADE_DECOMPRESSOR_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @brief Compression of a .dat file
+ */
+enum class DatCompression {
+    None,
+    Gzip,   // .gz (zlib)
+    Zstd    // .zst (libzstd)
+};
+
+/**
+ * @brief Decompresses a .dat in a background thread into a bounded set of blocks
+ *
+ * A worker thread reads the compressed file sequentially and inflates it
+ * into a fixed ring of kBlocks blocks; the caller takes the filled blocks in
+ * order with next() and hands each back with release(). Reading and
+ * decompression overlap the caller's decoding, memory stays bounded whatever
+ * the file size, and nothing is written to disk.
+ *
+ * Concatenated gzip members and zstd frames are read as one stream.
+ * Support for each format depends on the libraries found at build time
+ * (isSupported()).
+ *
+ * Example usage:
+ * @code
+ * ComtradeDecompressor input;
+ * if (input.open("fault.dat.gz", DatCompression::Gzip)) {
+ *     const char* data;
+ *     size_t size;
+ *     while (input.next(data, size)) {
+ *         decode(data, size);
+ *         input.release();
+ *     }
+ *     if (!input.getLastError().empty()) { ... }
+ * }
+ * @endcode
+ */
+class ComtradeDecompressor {
+public:
+    static constexpr size_t kBlockBytes = 1 << 20;  // Decompressed bytes per block
+    static constexpr size_t kBlocks = 8;            // Blocks in flight
+
+    ComtradeDecompressor();
+    ~ComtradeDecompressor();
+
+    ComtradeDecompressor(const ComtradeDecompressor&) = delete;
+    ComtradeDecompressor& operator=(const ComtradeDecompressor&) = delete;
+
+    /**
+     * @brief Compression implied by a file name (.gz, .zst)
+     */
+    static DatCompression compressionFor(const std::string& path);
+
+    /**
+     * @brief True if this build can decompress the format
+     */
+    static bool isSupported(DatCompression compression);
+
+    /**
+     * @brief Open a compressed file and start decompressing
+     * @param path Compressed .dat
+     * @param compression Gzip or Zstd
+     * @return false if the file cannot be opened or the format is not supported
+     */
+    bool open(const std::string& path, DatCompression compression);
+
+    /**
+     * @brief Wait for the next block of decompressed data
+     * @param data Output block (valid until release())
+     * @param size Output byte count (> 0)
+     * @return false at end of data or on error (getLastError() tells which)
+     */
+    bool next(const char*& data, size_t& size);
+
+    /**
+     * @brief Hand the block from next() back to the worker
+     */
+    void release();
+
+    /**
+     * @brief Stop the worker and close the file
+     */
+    void close();
+
+    /**
+     * @brief Compressed bytes read so far
+     */
+    uint64_t compressedBytes() const;
+
+    /**
+     * @brief Error message (empty after a clean end of data)
+     */
+    std::string getLastError() const;
+
+    class Codec;
+
+private:
+    void worker();
+
+    std::unique_ptr<Codec> codec_;
+    std::thread thread_;
+    std::string path_;
+
+    // Ring of blocks: the worker fills, the caller drains, both in order
+    std::vector<std::vector<char>> blocks_;
+    std::vector<size_t> blockSizes_;
+    size_t produced_;       // Blocks filled so far
+    size_t consumed_;       // Blocks released so far
+    bool finished_;         // Worker reached the end of data (or failed)
+    bool stop_;             // Caller asked the worker to stop
+    uint64_t compressedBytes_;
+    std::string lastError_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable blockReady_;
+    std::condition_variable blockFree_;
+};
+
+#endif // COMTRADE_DECOMPRESSOR_H
@@ -4,6 +4,13 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include "comtrade_recording.h"
+
+class ComtradeDecompressor;
+class CacheSource;
+enum class DatCompression;
 
 /**
  * @brief COMTRADE data format
@@ -11,7 +18,8 @@
 enum class DataFormat {
     ASCII,
     BINARY,
-    BINARY32
+    BINARY32,
+    FLOAT32     // C37.111-2013: IEEE 754 single-precision analog values
 };
 
 /**
@@ -89,12 +97,79 @@ struct ComtradeSample {
     std::vector<bool> digitalValues;     // Digital channel states
 };
 
+/**
+ * @brief A .dat line that was skipped during loading
+ */
+struct ComtradeParseIssue {
+    uint64_t line;          // 1-based line number in the .dat
+    std::string message;
+};
+
+/**
+ * @brief How load() keeps analog values in memory
+ */
+enum class SampleStorage {
+    Double,   // Scaled doubles: direct pointer access, 8 bytes per value
+    Float,    // Scaled values rounded to float: 4 bytes per value, lossy
+    Raw,      // Raw .dat values plus per-channel scale, scaled on access: lossless,
+              // 2 bytes (BINARY) or 4 bytes (BINARY32, FLOAT32, integer ASCII)
+    Auto,     // Smallest lossless layout: Raw int16/int32 (float for FLOAT32) with its
+              // scale, Double only for ASCII values Raw cannot hold exactly
+    PreferDouble  // Double (pointer access, no scaling on read) whenever it fits
+                  // memoryBudget, otherwise the smallest lossless layout as Auto
+};
+
+/**
+ * @brief Options for ComtradeParser::load()
+ */
+struct ComtradeLoadOptions {
+    unsigned numThreads = 0;  // Worker threads for .dat decoding (0 = hardware concurrency)
+    
+    // Analog storage (see ComtradeRecording)
+    SampleStorage storage = SampleStorage::Double;
+    uint64_t memoryBudget = 0;  // Max bytes for the recording's columns (0 = unlimited);
+                                // load() fails if the chosen storage does not fit
+    
+    // Time window: only samples between these offsets (seconds from the first
+    // sample) are decoded; located from the .cfg rate table (see load())
+    double startTime = 0.0;
+    double endTime = 0.0;       // 0 = end of recording
+    
+    // Parsed-recording cache (see ComtradeCache); not used for windowed loads
+    bool useCache = false;
+    std::string cacheDir;     // Directory for cache files (empty = next to the .cfg/.cff)
+    bool paranoidCache = false; // Also check every byte of the source on a hit (reads it whole)
+    std::shared_ptr<const CacheSource> cacheSource;  // Source identity shared with another cache
+                                                     // (nullptr = taken by load())
+};
+
+/**
+ * @brief Outcome of the cache lookup in ComtradeParser::load()
+ */
+enum class CacheResult {
+    Disabled,   // useCache not set
+    Hit,        // Loaded from the cache
+    Miss,       // No cache file yet
+    Stale       // Cache file did not match the source (changed, or unreadable)
+};
+
+/**
+ * @brief Cache activity of the last load
+ */
+struct ComtradeCacheReport {
+    CacheResult result = CacheResult::Disabled;
+    std::string path;         // Cache file
+    std::string detail;       // Reason for a stale entry, or a write failure
+    bool written = false;     // Cache file (re)written after a miss
+};
+
 /**
  * @brief COMTRADE file parser
  * 
- * Parses IEEE C37.111 COMTRADE files (.cfg + .dat)
+ * Parses IEEE C37.111 COMTRADE files (.cfg + .dat, or a single .cff)
  * Supports 1991, 1999, and 2013 revisions
- * Handles ASCII and Binary data formats
+ * Handles ASCII, BINARY, BINARY32 and FLOAT32 data formats
+ * Samples are stored column-wise (see ComtradeRecording)
  */
 class ComtradeParser {
 public:
@@ -103,11 +178,60 @@ public:
     
     /**
      * @brief Load and parse COMTRADE files
-     * @param cfgPath Path to .cfg file
-     * @param datPath Path to .dat file (optional, auto-detected if empty)
+     *
+     * With a time window (options.startTime/endTime) only that part of the
+     * .dat is decoded: binary records are addressed directly from the rate
+     * table, ASCII lines through a sparse line index (one line per sample).
+     * Files without rates (timestamps only) are decoded whole and cut to the
+     * window by timestamp. Row 0 of the recording is then .dat sample
+     * getWindowStart().
+     *
+     * A gzip or zstd compressed .dat (.dat.gz, .dat.zst) is decompressed in a
+     * background thread and decoded block by block as it arrives, without a
+     * temporary file; it is found automatically when the plain .dat does not
+     * exist. The memory budget is checked against the .cfg sample count and
+     * again as samples arrive, and a window ends the decompression at its
+     * last sample.
+     *
+     * @param cfgPath Path to .cfg file, or to a .cff file holding both
+     * @param datPath Path to .dat file, may be .gz/.zst (optional, auto-detected if empty; ignored for .cff)
+     * @param options Decoding options
+     * @return true if successful, false otherwise
+     */
+    bool load(const std::string& cfgPath, const std::string& datPath = "",
+              const ComtradeLoadOptions& options = ComtradeLoadOptions());
+    
+    /**
+     * @brief Parse only the .cfg file (no samples are loaded)
+     * @param cfgPath Path to .cfg file, or to a .cff file
      * @return true if successful, false otherwise
      */
-    bool load(const std::string& cfgPath, const std::string& datPath = "");
+    bool loadConfig(const std::string& cfgPath);
+    
+    /**
+     * @brief Bytes load() will allocate for a recording's columns
+     *
+     * Uses the sample count the .cfg declares (within the options' window)
+     * and the first storage load() would pick under options.memoryBudget.
+     *
+     * @param config Parsed .cfg (see loadConfig())
+     * @param options Load options
+     * @param bytes Output estimate (0 if the .cfg declares no sample count)
+     * @return false if no storage fits options.memoryBudget
+     */
+    static bool estimateLoadBytes(const ComtradeConfig& config, const ComtradeLoadOptions& options, uint64_t& bytes);
+    
+    /**
+     * @brief Default .dat path for a .cfg path (same name, .dat extension)
+     */
+    static std::string datPathFor(const std::string& cfgPath);
+    
+    /**
+     * @brief .dat file load() reads for a .cfg
+     * @param cfgPath Path to .cfg file
+     * @param datPath Given .dat path (empty = datPathFor(), or its .gz/.zst when only that exists)
+     */
+    static std::string resolveDatPath(const std::string& cfgPath, const std::string& datPath);
     
     /**
      * @brief Get configuration
@@ -121,6 +245,11 @@ public:
      */
     int getTotalSamples() const { return config_.totalSamples; }
     
+    /**
+     * @brief Index in the .dat of the first loaded sample (0 unless windowed)
+     */
+    uint64_t getWindowStart() const { return windowStart_; }
+    
     /**
      * @brief Get sample rate at given index
      * @param sampleIndex Sample number (0-based)
@@ -129,7 +258,7 @@ public:
     double getSampleRate(int sampleIndex) const;
     
     /**
-     * @brief Get sample at given index
+     * @brief Get sample at given index (copies it; prefer getSampleView())
      * @param index Sample number (0-based)
      * @param sample Output parameter for sample data
      * @return true if successful, false if index out of range
@@ -137,11 +266,40 @@ public:
     bool getSample(int index, ComtradeSample& sample) const;
     
     /**
-     * @brief Get all samples (for batch processing)
+     * @brief Get all samples in row form
      * @return Vector of all samples
      */
+    [[deprecated("copies every sample; use getRecording(), getSampleView() or getTimeRange()")]]
     std::vector<ComtradeSample> getAllSamples() const;
     
+    /**
+     * @brief Read one sample in place
+     * @param index Sample number (0-based, must be < getRecording().sampleCount())
+     * @return View valid until the next load() or clear()
+     */
+    ComtradeSampleView getSampleView(size_t index) const { return recording_.sample(index); }
+    
+    /**
+     * @brief Scaled values of an analog channel, in place
+     * @param name Channel name
+     * @return View of the whole channel, empty if there is no such channel
+     */
+    AnalogColumn getAnalogData(const std::string& name) const;
+    
+    /**
+     * @brief Samples between two offsets from the start of the recording
+     * @param startSeconds First offset (inclusive)
+     * @param endSeconds Last offset (exclusive, 0 = end of recording)
+     * @return View valid until the next load() or clear()
+     */
+    ComtradeRecordingView getTimeRange(double startSeconds, double endSeconds = 0.0) const;
+    
+    /**
+     * @brief Get the columnar sample storage
+     * @return Per-channel arrays, indexed by AnalogChannel/DigitalChannel index
+     */
+    const ComtradeRecording& getRecording() const { return recording_; }
+    
     /**
      * @brief Get analog channel by name
      * @param name Channel name
@@ -155,6 +313,23 @@ public:
      */
     bool isLoaded() const { return loaded_; }
     
+    /**
+     * @brief Number of ASCII .dat lines skipped as incomplete or invalid
+     */
+    uint64_t getSkippedLines() const { return skippedLines_; }
+    
+    /**
+     * @brief First skipped lines with their line numbers and reasons
+     *
+     * Not kept in the cache: after a cache hit only the count is known.
+     */
+    const std::vector<ComtradeParseIssue>& getParseIssues() const { return parseIssues_; }
+    
+    /**
+     * @brief Cache hit/miss for the last load()
+     */
+    const ComtradeCacheReport& getCacheReport() const { return cacheReport_; }
+    
     /**
      * @brief Get last error message
      * @return Error description
@@ -168,9 +343,22 @@ public:
 
 private:
     bool parseCfg(const std::string& cfgPath);
+    bool parseCfgStream(std::istream& file);
     bool parseDatAscii(const std::string& datPath);
-    bool parseDatBinary(const std::string& datPath);
-    bool parseDatBinary32(const std::string& datPath);
+    bool parseDatBinary(const std::string& datPath);  // BINARY, BINARY32 and FLOAT32, memory-mapped
+    bool parseDatCompressed(const std::string& datPath, DatCompression compression);
+    bool decodeBinaryCompressed(ComtradeDecompressor& input, uint64_t first, uint64_t last);
+    bool parseAsciiCompressed(const std::string& datPath, DatCompression compression, AnalogStorage storage,
+                              bool raw, uint64_t first, uint64_t last, bool& overflow);  // overflow: value did not fit
+    bool loadCff(const std::string& cffPath, bool loadData);
+    bool loadSource(const std::string& cfgPath, const std::string& datPath);
+    bool parseAsciiText(const char* text, size_t size);
+    bool parseAsciiWindow(const char* text, size_t size);
+    bool parseAsciiChunks(const char* text, size_t size, AnalogStorage storage, bool raw);  // false: value did not fit
+    bool decodeBinaryRecords(const uint8_t* records, size_t numRecords);
+    bool decodeBinaryRange(const uint8_t* records, size_t numRecords);
+    bool windowed() const { return options_.startTime > 0.0 || options_.endTime > 0.0; }
+    void trimToTimeWindow();  // Window by timestamp, for files without rates
     
     // Helper functions
     std::vector<std::string> splitLine(const std::string& line, char delim = ',');
@@ -182,7 +370,12 @@ private:
     void setError(const std::string& msg);
     
     ComtradeConfig config_;
-    std::vector<ComtradeSample> samples_;
+    ComtradeRecording recording_;
+    ComtradeLoadOptions options_;
+    uint64_t skippedLines_;
+    uint64_t windowStart_;    // .dat index of recording row 0
+    std::vector<ComtradeParseIssue> parseIssues_;
+    ComtradeCacheReport cacheReport_;
     bool loaded_;
     std::string lastError_;
 };
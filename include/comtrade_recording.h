@@ -0,0 +1,495 @@
+#ifndef COMTRADE_RECORDING_H
+#define COMTRADE_RECORDING_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "analog_scaling.h"
+
+struct ComtradeSample;
+class ComtradeSampleView;
+class ComtradeRecordingView;
+class AnalogColumn;
+class DigitalColumn;
+
+/**
+ * @brief Element type of the analog columns
+ */
+enum class AnalogStorage {
+    Double,  // 8 bytes per value
+    Float,   // 4 bytes per value
+    Int16,   // 2 bytes per value (raw BINARY values)
+    Int32    // 4 bytes per value (raw BINARY32 or integer ASCII values)
+};
+
+/**
+ * @brief A change of state on a digital channel
+ */
+struct DigitalEdge {
+    uint64_t sample;  // Row of the first sample with the new state
+    int channel;      // Digital channel index
+    bool state;       // New state
+};
+
+/**
+ * @brief Read-only view of a contiguous column (pointer + length, never owns)
+ *
+ * Valid until the recording it points into is modified or destroyed.
+ */
+template <typename T>
+class ColumnSpan {
+public:
+    ColumnSpan() : data_(nullptr), size_(0) {}
+    ColumnSpan(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    /**
+     * @brief Part of the span (no bounds check)
+     */
+    ColumnSpan subspan(size_t first, size_t count) const { return ColumnSpan(data_ + first, count); }
+
+private:
+    const T* data_;
+    size_t size_;
+};
+
+/**
+ * @brief Columnar (structure-of-arrays) storage for a COMTRADE recording
+ *
+ * Every analog channel is one contiguous array, timestamps and sample numbers
+ * have their own arrays, and each digital channel is a bit plane packed
+ * into 64-bit words (sample i is bit i % 64 of word i / 64; bits past the
+ * last sample are zero). A recording costs a handful of allocations
+ * regardless of its length, and consumers read whole channels directly.
+ *
+ * Analog columns hold either scaled values (double, or float to halve the
+ * memory) or the raw .dat values with a per-channel AnalogScale, scaled on
+ * access. Raw int16/int32 columns are lossless and take a quarter or half of
+ * the space of doubles; analogValue()/copyAnalog() give the same bits as a
+ * Double recording. The pointer accessors (analog(), analogFloat(), ...)
+ * return nullptr unless the recording uses that element type.
+ *
+ * Digital channels usually change state rarely: buildDigitalEdges() indexes
+ * every transition as (sample, channel, new state), so consumers can walk
+ * the state changes without scanning the planes. The index is not kept up
+ * to date by writes; the loaders build it once the planes are complete.
+ *
+ * Analog and digital channels are addressed by position in the .cfg
+ * (AnalogChannel::index / DigitalChannel::index).
+ */
+class ComtradeRecording {
+public:
+    /**
+     * @brief Discard data and set the channel layout (capacity is kept)
+     * @param numAnalog Number of analog channels
+     * @param numDigital Number of digital channels
+     */
+    void reset(int numAnalog, int numDigital);
+
+    /**
+     * @brief Discard data and choose the analog element type
+     * @param storage Element type
+     * @param scales Per-channel scale for raw columns (one per channel, required
+     *               for Int16/Int32); empty if the columns hold scaled values
+     */
+    void setAnalogStorage(AnalogStorage storage, const std::vector<AnalogScale>& scales = {});
+
+    /**
+     * @brief Resize every column (new samples are zero)
+     * @param numSamples Sample count
+     */
+    void resize(size_t numSamples);
+
+    /**
+     * @brief Reserve capacity in every column
+     * @param numSamples Expected sample count
+     */
+    void reserve(size_t numSamples);
+
+    /**
+     * @brief Append one sample (row) to all columns
+     * @param sampleNumber Sample number from the .dat
+     * @param timestamp Microseconds since start
+     * @param analog numAnalog scaled values (Double or scaled Float storage only)
+     * @param digital numDigital states (0/1)
+     */
+    void append(int sampleNumber, uint64_t timestamp, const double* analog, const uint8_t* digital);
+
+    /**
+     * @brief Copy rows from a recording with the same channel layout
+     * @param src Source recording
+     * @param srcFirst First source row
+     * @param count Number of rows
+     * @param dstFirst First destination row (must already exist)
+     */
+    void copyRows(const ComtradeRecording& src, size_t srcFirst, size_t count, size_t dstFirst);
+
+    /**
+     * @brief Copy only the digital states of rows (see copyRows())
+     *
+     * The 64-sample words at both ends of the destination range are read and
+     * rewritten, so concurrent copies into neighbouring ranges of one
+     * recording must not include the digital states.
+     */
+    void copyDigitalRows(const ComtradeRecording& src, size_t srcFirst, size_t count, size_t dstFirst);
+
+    /**
+     * @brief Copy analog values, timestamps and sample numbers of rows
+     *
+     * Touches only the destination rows, so it is safe to run concurrently
+     * for disjoint ranges of one recording.
+     */
+    void copyRowsWithoutDigital(const ComtradeRecording& src, size_t srcFirst, size_t count, size_t dstFirst);
+
+    /**
+     * @brief Keep only rows [first, first + count) (clamped), moved to the front
+     *
+     * Capacity is kept; the edge index is rebuilt.
+     */
+    void keepRows(size_t first, size_t count);
+
+    /**
+     * @brief Release all storage
+     */
+    void clear();
+
+    size_t sampleCount() const { return timestamps_.size(); }
+    size_t capacity() const { return timestamps_.capacity(); }
+    int analogChannelCount() const { return numAnalog_; }
+    int digitalChannelCount() const { return static_cast<int>(digital_.size()); }
+
+    AnalogStorage analogStorage() const { return storage_; }
+
+    /**
+     * @brief True if analog columns hold raw values (scaled on access)
+     */
+    bool analogIsRaw() const { return !scales_.empty(); }
+
+    /**
+     * @brief Scale applied on access (identity for scaled columns)
+     */
+    AnalogScale analogScale(int channel) const { return scales_.empty() ? AnalogScale() : scales_[channel]; }
+
+    /**
+     * @brief Bytes per analog value for an element type
+     */
+    static size_t bytesPerValue(AnalogStorage storage);
+
+    /**
+     * @brief Memory a recording of the given shape needs (columns only)
+     */
+    static size_t estimateBytes(size_t numSamples, int numAnalog, int numDigital, AnalogStorage storage);
+
+    /**
+     * @brief Scaled value of one analog sample, whatever the storage
+     * @param channel Channel index
+     * @param index Sample index (no bounds check)
+     */
+    double analogValue(int channel, size_t index) const;
+
+    /**
+     * @brief Scaled values of a run of samples (vector kernels for raw columns)
+     * @param channel Channel index
+     * @param first First sample
+     * @param count Number of samples
+     * @param out Output, count values
+     */
+    void copyAnalog(int channel, size_t first, size_t count, double* out) const;
+
+    /**
+     * @brief Analog column of the matching element type (nullptr otherwise)
+     */
+    const double* analog(int channel) const { return storage_ == AnalogStorage::Double ? analog_[channel].data() : nullptr; }
+    double* analog(int channel) { return storage_ == AnalogStorage::Double ? analog_[channel].data() : nullptr; }
+    const float* analogFloat(int channel) const { return storage_ == AnalogStorage::Float ? analogFloat_[channel].data() : nullptr; }
+    float* analogFloat(int channel) { return storage_ == AnalogStorage::Float ? analogFloat_[channel].data() : nullptr; }
+    const int16_t* analogInt16(int channel) const { return storage_ == AnalogStorage::Int16 ? analog16_[channel].data() : nullptr; }
+    int16_t* analogInt16(int channel) { return storage_ == AnalogStorage::Int16 ? analog16_[channel].data() : nullptr; }
+    const int32_t* analogInt32(int channel) const { return storage_ == AnalogStorage::Int32 ? analog32_[channel].data() : nullptr; }
+    int32_t* analogInt32(int channel) { return storage_ == AnalogStorage::Int32 ? analog32_[channel].data() : nullptr; }
+
+    /**
+     * @brief Analog column as bytes, whatever the element type
+     */
+    const void* analogBytes(int channel) const;
+    void* analogBytes(int channel);
+
+    /**
+     * @brief Packed states of one digital channel (digitalWordCount(sampleCount()) words)
+     */
+    const uint64_t* digitalWords(int channel) const { return digital_[channel].data(); }
+    uint64_t* digitalWords(int channel) { return digital_[channel].data(); }
+
+    /**
+     * @brief Words in a digital plane of numSamples samples
+     */
+    static size_t digitalWordCount(size_t numSamples) { return (numSamples + 63) / 64; }
+
+    /**
+     * @brief State of one digital sample
+     * @param channel Channel index
+     * @param index Sample index (no bounds check)
+     */
+    bool digitalState(int channel, size_t index) const { return (digital_[channel][index / 64] >> (index % 64)) & 1u; }
+
+    /**
+     * @brief Set the state of one digital sample (does not update the edge index)
+     */
+    void setDigitalState(int channel, size_t index, bool state) {
+        uint64_t bit = uint64_t(1) << (index % 64);
+        uint64_t& word = digital_[channel][index / 64];
+        word = state ? (word | bit) : (word & ~bit);
+    }
+
+    /**
+     * @brief Rebuild the edge index from the digital planes
+     *
+     * Works a word at a time, so the cost is one pass over the packed
+     * planes plus the number of edges. Row 0 is never an edge.
+     */
+    void buildDigitalEdges();
+
+    /**
+     * @brief Every digital state change, ordered by sample then channel
+     */
+    const std::vector<DigitalEdge>& digitalEdges() const { return edges_; }
+
+    /**
+     * @brief Digital state changes in rows [first, last)
+     */
+    ColumnSpan<DigitalEdge> digitalEdges(size_t first, size_t last) const;
+
+    /**
+     * @brief Timestamps in microseconds since start
+     */
+    const uint64_t* timestamps() const { return timestamps_.data(); }
+    uint64_t* timestamps() { return timestamps_.data(); }
+
+    /**
+     * @brief Sample numbers as stored in the .dat
+     */
+    const int* sampleNumbers() const { return sampleNumbers_.data(); }
+    int* sampleNumbers() { return sampleNumbers_.data(); }
+
+    /**
+     * @brief Whole columns as views
+     */
+    AnalogColumn analogColumn(int channel) const;
+    DigitalColumn digitalColumn(int channel) const;
+    ColumnSpan<uint64_t> timestampColumn() const { return ColumnSpan<uint64_t>(timestamps(), sampleCount()); }
+
+    /**
+     * @brief One sample, read in place
+     * @param index Sample index (0-based, no bounds check)
+     */
+    ComtradeSampleView sample(size_t index) const;
+
+    /**
+     * @brief Rows [first, first + count) (clamped to the recording)
+     */
+    ComtradeRecordingView view(size_t first, size_t count) const;
+
+    /**
+     * @brief Samples with startUs <= timestamp < endUs
+     *
+     * Binary search, so timestamps must not decrease (as in any valid .dat).
+     */
+    ComtradeRecordingView timeRange(uint64_t startUs, uint64_t endUs) const;
+
+    /**
+     * @brief Gather one sample into row form (allocates; prefer sample())
+     * @param index Sample index (0-based, no bounds check)
+     * @param sample Output sample
+     */
+    void getSample(size_t index, ComtradeSample& sample) const;
+
+    /**
+     * @brief Bytes held by all columns
+     */
+    size_t memoryBytes() const;
+
+private:
+    template <typename F>
+    void forEachColumn(F f);
+
+    AnalogStorage storage_ = AnalogStorage::Double;
+    std::vector<AnalogScale> scales_;            // Raw columns only
+    int numAnalog_ = 0;
+
+    // Analog columns, [channel][sample]; only the set matching storage_ is used
+    std::vector<std::vector<double>> analog_;
+    std::vector<std::vector<float>> analogFloat_;
+    std::vector<std::vector<int16_t>> analog16_;
+    std::vector<std::vector<int32_t>> analog32_;
+
+    std::vector<std::vector<uint64_t>> digital_; // [channel][sample / 64], bit sample % 64
+    std::vector<DigitalEdge> edges_;              // See buildDigitalEdges()
+    std::vector<uint64_t> timestamps_;
+    std::vector<int> sampleNumbers_;
+};
+
+/**
+ * @brief Scaled values of (part of) one analog channel, read in place
+ *
+ * Works for every storage; data() gives the doubles directly when the
+ * recording stores them. Valid until the recording is modified or destroyed.
+ */
+class AnalogColumn {
+public:
+    AnalogColumn() : recording_(nullptr), channel_(0), first_(0), size_(0) {}
+    AnalogColumn(const ComtradeRecording& recording, int channel, size_t first, size_t size)
+        : recording_(&recording), channel_(channel), first_(first), size_(size) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    double operator[](size_t i) const { return recording_->analogValue(channel_, first_ + i); }
+
+    /**
+     * @brief Scaled doubles in place, nullptr unless the storage is Double
+     */
+    const double* data() const {
+        const double* column = recording_ ? recording_->analog(channel_) : nullptr;
+        return column ? column + first_ : nullptr;
+    }
+
+    /**
+     * @brief Scale all values into out (size() entries)
+     */
+    void copyTo(double* out) const {
+        if (size_ > 0) {
+            recording_->copyAnalog(channel_, first_, size_, out);
+        }
+    }
+
+    /**
+     * @brief Part of the column (no bounds check)
+     */
+    AnalogColumn subspan(size_t first, size_t count) const {
+        return AnalogColumn(*recording_, channel_, first_ + first, count);
+    }
+
+private:
+    const ComtradeRecording* recording_;
+    int channel_;
+    size_t first_;
+    size_t size_;
+};
+
+/**
+ * @brief States of (part of) one digital channel, read in place
+ *
+ * Valid until the recording is modified or destroyed.
+ */
+class DigitalColumn {
+public:
+    DigitalColumn() : recording_(nullptr), channel_(0), first_(0), size_(0) {}
+    DigitalColumn(const ComtradeRecording& recording, int channel, size_t first, size_t size)
+        : recording_(&recording), channel_(channel), first_(first), size_(size) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    bool operator[](size_t i) const { return recording_->digitalState(channel_, first_ + i); }
+
+    /**
+     * @brief Part of the column (no bounds check)
+     */
+    DigitalColumn subspan(size_t first, size_t count) const {
+        return DigitalColumn(*recording_, channel_, first_ + first, count);
+    }
+
+private:
+    const ComtradeRecording* recording_;
+    int channel_;
+    size_t first_;
+    size_t size_;
+};
+
+/**
+ * @brief One row of a recording, read in place (no copy, no allocation)
+ */
+class ComtradeSampleView {
+public:
+    ComtradeSampleView(const ComtradeRecording& recording, size_t index)
+        : recording_(&recording), index_(index) {}
+
+    size_t index() const { return index_; }
+    int sampleNumber() const { return recording_->sampleNumbers()[index_]; }
+    uint64_t timestamp() const { return recording_->timestamps()[index_]; }
+
+    int analogCount() const { return recording_->analogChannelCount(); }
+    int digitalCount() const { return recording_->digitalChannelCount(); }
+    double analog(int channel) const { return recording_->analogValue(channel, index_); }
+    bool digital(int channel) const { return recording_->digitalState(channel, index_); }
+
+private:
+    const ComtradeRecording* recording_;
+    size_t index_;
+};
+
+/**
+ * @brief A run of consecutive rows of a recording (no copy)
+ *
+ * Row 0 of the view is row firstIndex() of the recording. Valid until the
+ * recording is modified or destroyed.
+ */
+class ComtradeRecordingView {
+public:
+    ComtradeRecordingView() : recording_(nullptr), first_(0), count_(0) {}
+    ComtradeRecordingView(const ComtradeRecording& recording, size_t first, size_t count)
+        : recording_(&recording), first_(first), count_(count) {}
+
+    size_t firstIndex() const { return first_; }
+    size_t sampleCount() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    ComtradeSampleView operator[](size_t i) const { return ComtradeSampleView(*recording_, first_ + i); }
+
+    AnalogColumn analog(int channel) const { return recording_->analogColumn(channel).subspan(first_, count_); }
+    DigitalColumn digital(int channel) const { return recording_->digitalColumn(channel).subspan(first_, count_); }
+    ColumnSpan<uint64_t> timestamps() const { return recording_->timestampColumn().subspan(first_, count_); }
+    ColumnSpan<int> sampleNumbers() const { return ColumnSpan<int>(recording_->sampleNumbers() + first_, count_); }
+
+    /**
+     * @brief Digital state changes inside the view (recording row numbers)
+     */
+    ColumnSpan<DigitalEdge> digitalEdges() const { return recording_->digitalEdges(first_, first_ + count_); }
+
+private:
+    const ComtradeRecording* recording_;
+    size_t first_;
+    size_t count_;
+};
+
+inline ComtradeSampleView ComtradeRecording::sample(size_t index) const {
+    return ComtradeSampleView(*this, index);
+}
+
+inline AnalogColumn ComtradeRecording::analogColumn(int channel) const {
+    return AnalogColumn(*this, channel, 0, sampleCount());
+}
+
+inline DigitalColumn ComtradeRecording::digitalColumn(int channel) const {
+    return DigitalColumn(*this, channel, 0, sampleCount());
+}
+
+inline double ComtradeRecording::analogValue(int channel, size_t index) const {
+    double value;
+    switch (storage_) {
+        case AnalogStorage::Double: return analog_[channel][index];
+        case AnalogStorage::Float:  value = analogFloat_[channel][index]; break;
+        case AnalogStorage::Int16:  value = analog16_[channel][index]; break;
+        default:                    value = analog32_[channel][index]; break;
+    }
+    return scales_.empty() ? value : scales_[channel].apply(value);
+}
+
+#endif // COMTRADE_RECORDING_H
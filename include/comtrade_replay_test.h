@@ -8,10 +8,20 @@
 #include <cstdint>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include "realtime.h"
+#include "sample_scheduler.h"
+#include "tsc_clock.h"
+#include "resample_stage.h"
 
 // Forward declarations
 class RawSocket;
+class Clock;
 class ComtradeParser;
+class ResampledCache;
+class CacheSource;
+struct ComtradeCacheReport;
+struct ComtradeConfig;
 
 /**
  * @brief Configuration for COMTRADE Replay Test
@@ -34,6 +44,8 @@ struct ComtradeReplayConfig {
     uint16_t appId = 0x4000;
     std::string svId = "ComtradeReplay";
     uint16_t sampleRate = 4800;  // Target output sample rate (Hz)
+    ResamplerOptions resampler;  // Rate conversion when the recording rate differs
+    bool compensateSkew = true;  // Align channels by their .cfg skew while resampling
     
     // Channel mapping: maps COMTRADE channel names to SV channel indices (0-7)
     // Format: {"COMTRADE_NAME", SV_channel_index}
@@ -49,6 +61,41 @@ struct ComtradeReplayConfig {
     bool loopPlayback = false;  // Loop continuously
     double startTimeOffset = 0.0;  // Start at this time offset (seconds)
     double endTimeOffset = 0.0;    // End at this time offset (0 = end of file)
+                                   // Only the samples in the window are decoded
+    
+    // Streaming: read the .dat block by block while transmitting, so memory
+    // use does not depend on the recording length
+    bool streaming = false;
+    size_t streamBlockSamples = 4096;  // COMTRADE samples per block
+    
+    // Resampling runs on its own thread, a few blocks ahead of transmission
+    // (loaded and streamed recordings alike)
+    size_t resampleBlockSamples = 4096;  // Output samples per block
+    size_t resampleLookahead = 2;        // Blocks ready ahead of the one being sent
+    unsigned resampleThreads = 1;        // Threads filtering each block (1 = the worker alone; more add
+                                         // unpinned helpers beside TX; 0 = hardware concurrency)
+    
+    // Parsed-recording cache (non-streaming loads only): later runs skip the .dat parse
+    bool useCache = false;
+    std::string cacheDir;  // Empty = next to the .cfg (both caches)
+    bool paranoidCache = false;  // Check every byte of the source on a parse cache hit (reads it whole)
+    
+    // Output cache (see ResampledCache): the first run that sends the whole
+    // recording stores the SV output; later runs with the same recording and
+    // output settings replay it with no parse or resampling (streamed too)
+    bool useOutputCache = false;
+    
+    // Sample timing reference (smpCnt=0 on the UTC/TAI second)
+    SampleTimingConfig timing;
+    
+    // Real-time execution profile (scheduling, affinity, memory locking)
+    RealtimeConfig realtime;
+    
+    // Offline output (no interface needed; GOOSE monitoring is skipped)
+    std::string outputFile;        // Write frames to this pcap file instead of the socket
+    bool virtualTime = false;      // Pace on a virtual clock: no real waiting, ideal timestamps
+                                   // (offline output only: configure() rejects it otherwise)
+    double durationSeconds = 0.0;  // Stop after this much stream time (0 = unlimited)
     
     // Display configuration
     bool verboseOutput = true;
@@ -69,6 +116,10 @@ struct ComtradeReplayStats {
     std::chrono::steady_clock::time_point endTime;
     bool stoppedByGoose = false;
     std::string gooseStopReason;
+    RealtimeReport txRealtime;   // What the TX thread was granted
+    RealtimeReport rxRealtime;   // What the GOOSE capture thread was granted
+    SampleTimingStats timing;    // Schedule drift against the time reference
+    FrameTimingStats frameTiming; // Per-frame build/send cost
     
     double getElapsedSeconds() const {
         auto duration = endTime - startTime;
@@ -86,7 +137,9 @@ struct ComtradeReplayStats {
  * 
  * This class replays COMTRADE files as IEC 61850-9-2 Sampled Value packets:
  * - Loads IEEE C37.111 COMTRADE files (.cfg + .dat)
- * - Interpolates/resamples data to 4800 Hz (or configured rate)
+ * - Resamples data to 4800 Hz (or configured rate) with a band-limited
+ *   polyphase filter (or linear interpolation, see ResamplerOptions), by
+ *   sample time across every rate of the .cfg (see TimelineResampler)
  * - Maps COMTRADE channels to SV packet channels
  * - Transmits with precise timing using high-precision timer
  * - Monitors network for GOOSE stop messages
@@ -165,6 +218,20 @@ public:
      */
     void setProgressCallback(std::function<void(uint32_t packets, double seconds)> callback);
     
+    /**
+     * @brief Receive every frame in memory instead of sending it
+     * Set before configure(); replaces the socket like outputFile does.
+     * @param callback Function called with the frame and its Realtime timestamp (ns)
+     */
+    void setFrameCallback(std::function<void(const std::vector<uint8_t>& frame, int64_t timestampNs)> callback);
+    
+    /**
+     * @brief Use an external clock for pacing and timestamps
+     * Any clock other than a SystemClock needs offline output; run() rejects it on a live interface.
+     * @param clock Clock that outlives the test (nullptr = system or virtual clock per config)
+     */
+    void setClock(Clock* clock);
+    
     /**
      * @brief Print current configuration to console
      */
@@ -179,11 +246,21 @@ private:
     // Internal methods
     void gooseCaptureThreadFunc();
     void transmissionLoop();
+    bool isOffline() const;
+    Clock& activeClock();
     bool loadComtradeFile();
-    std::vector<std::vector<double>> resampleData(const std::vector<std::vector<double>>& input, 
-                                                    double inputRate, 
-                                                    double outputRate);
-    double interpolateLinear(const std::vector<double>& data, double index);
+    void printCacheReport(const ComtradeCacheReport& report);
+    void printResamplerSpec(const ComtradeConfig& cfg) const;
+    void printTimelineReport() const;
+    bool needsResampling(const ComtradeConfig& cfg) const;
+    bool mapChannels(const ComtradeConfig& cfg, std::vector<int>& columns, std::vector<int>& svChannels);
+    bool configureStage(const ComtradeConfig& cfg, const std::vector<int>& columns,
+                        const std::vector<int>& svChannels);
+    bool openStream();
+    bool openOutputCache();
+    std::string outputCacheSettings() const;
+    void printOutputCacheReport() const;
+    bool nextBlock();
     
     // Configuration and state
     ComtradeReplayConfig config_;
@@ -197,10 +274,23 @@ private:
     // Callbacks
     std::function<void(const std::string&, uint32_t, uint32_t)> gooseCallback_;
     std::function<void(uint32_t, double)> progressCallback_;
+    std::function<void(const std::vector<uint8_t>&, int64_t)> frameCallback_;
+    
+    // Time source: injected, owned virtual clock, or the system clock
+    Clock* externalClock_;
+    std::unique_ptr<Clock> virtualClock_;
     
-    // COMTRADE data (resampled to output rate)
-    std::vector<std::vector<int32_t>> resampledData_;  // [channel][sample]
-    int numSamples_;
+    // COMTRADE data: the source (loaded recording or stream reader) feeds the
+    // resampling stage, which hands transmission one block at a time
+    std::unique_ptr<ResampleSource> source_;
+    std::unique_ptr<ResampledCache> outputCache_;  // Entry played back or recorded (useOutputCache)
+    std::shared_ptr<const CacheSource> cacheSource_;  // Source identity of both caches, taken once
+    bool outputCached_;                            // outputCache_ is played back, source_ unused
+    std::string outputCacheDetail_;                // Why a stored entry was stale
+    ResampleStage stage_;
+    const ResampledBlock* block_;  // Block being sent (nullptr before the first)
+    int numSamples_;               // Samples in block_
+    uint64_t samplesSent_;         // Output samples handed out in this pass
 };
 
 #endif // COMTRADE_REPLAY_TEST_H
@@ -0,0 +1,139 @@
+#ifndef COMTRADE_STREAM_READER_H
+#define COMTRADE_STREAM_READER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <cstdint>
+#include "comtrade_parser.h"
+#include "comtrade_recording.h"
+
+class ComtradeDecoder;
+
+/**
+ * @brief Block-wise COMTRADE reader with bounded memory
+ *
+ * Reads the .dat in blocks of N samples (ASCII, BINARY, BINARY32 and
+ * FLOAT32, from a .cfg/.dat pair or the DAT section of a .cff) through
+ * a fixed-size buffered read, so the first block is available immediately and
+ * memory use depends only on the block size, never on the file length.
+ * Values are identical to ComtradeParser::load().
+ *
+ * Example usage:
+ * @code
+ * ComtradeStreamReader reader;
+ * ComtradeRecording block;
+ * if (reader.open("fault.cfg")) {
+ *     while (reader.next(block)) {
+ *         process(block.analog(0), block.sampleCount());
+ *     }
+ *     if (!reader.getLastError().empty()) { ... }
+ * }
+ * @endcode
+ */
+class ComtradeStreamReader {
+public:
+    ComtradeStreamReader();
+    ~ComtradeStreamReader();
+
+    /**
+     * @brief Parse the .cfg and open the .dat for streaming
+     * @param cfgPath Path to .cfg file, or to a .cff file
+     * @param datPath Path to .dat file (optional, auto-detected if empty; ignored for .cff)
+     * @param blockSamples Samples per block
+     * @return true on success, false on failure (also for a .dat.gz/.dat.zst)
+     */
+    bool open(const std::string& cfgPath, const std::string& datPath = "", size_t blockSamples = 4096);
+
+    /**
+     * @brief Read only the samples between two time offsets, from the start
+     *
+     * Offsets are seconds from the first sample, located with the .cfg rate
+     * table: binary files seek to the first record, ASCII files skip lines
+     * without parsing them. rewind() returns to the window start.
+     *
+     * @param startSeconds First offset (inclusive)
+     * @param endSeconds Last offset (exclusive, 0 = end of recording)
+     * @return false if not open or the .cfg has no sample rates
+     */
+    bool setTimeWindow(double startSeconds, double endSeconds);
+
+    /**
+     * @brief Read the next block
+     * @param block Output; reset to the channel layout and filled with up to
+     *        blockSamples() samples (its capacity is reused between calls);
+     *        its digital edge index covers changes inside the block only
+     * @return false at end of data or on error (getLastError() tells which)
+     */
+    bool next(ComtradeRecording& block);
+
+    /**
+     * @brief Restart from the first sample (of the window, if set)
+     * @return true on success, false on failure
+     */
+    bool rewind();
+
+    /**
+     * @brief Close the .dat file
+     */
+    void close();
+
+    const ComtradeConfig& getConfig() const { return config_; }
+    size_t blockSamples() const { return blockSamples_; }
+
+    /**
+     * @brief Samples returned so far (index of the next block's first sample)
+     */
+    uint64_t samplesRead() const { return samplesRead_; }
+
+    /**
+     * @brief Total samples for binary files, within the window (0 for ASCII: unknown until the end)
+     */
+    uint64_t totalSamples() const { return totalSamples_; }
+
+    /**
+     * @brief Index in the .dat of the first sample returned
+     */
+    uint64_t windowStart() const { return windowFirst_; }
+
+    /**
+     * @brief Sample rate at a sample index, from the .cfg rate table
+     */
+    double getSampleRate(int sampleIndex) const;
+
+    /**
+     * @brief Get analog channel by name
+     * @return Pointer to channel config, nullptr if not found
+     */
+    const AnalogChannel* getAnalogChannel(const std::string& name) const;
+
+    /**
+     * @brief Error message (empty after a clean end of data)
+     */
+    std::string getLastError() const { return lastError_; }
+
+private:
+    bool openData();
+
+    ComtradeParser cfgParser_;
+    ComtradeConfig config_;
+    std::string datPath_;
+    std::ifstream file_;
+    std::unique_ptr<ComtradeDecoder> decoder_;
+    std::vector<char> readBuffer_;     // Stream buffer for the .dat
+    std::vector<uint8_t> blockBuffer_; // One block of binary records
+    std::string line_;
+    size_t blockSamples_;
+    uint64_t datOffset_;        // Start of the data in datPath_ (DAT section of a .cff)
+    uint64_t datBytes_;         // Data length (unbounded for a plain .dat)
+    uint64_t asciiRemaining_;   // ASCII bytes left to read
+    uint64_t windowFirst_;      // Sample range set by setTimeWindow()
+    uint64_t windowLast_;
+    uint64_t asciiLinesLeft_;   // ASCII lines left in the window
+    uint64_t samplesRead_;
+    uint64_t totalSamples_;
+    std::string lastError_;
+};
+
+#endif // COMTRADE_STREAM_READER_H
@@ -0,0 +1,160 @@
+#ifndef CYCLIC_EXECUTIVE_H
+#define CYCLIC_EXECUTIVE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "realtime.h"
+
+/**
+ * @brief Per-job statistics
+ */
+struct CyclicJobStats {
+    std::string name;
+    long long periodNs = 0;
+    uint64_t runs = 0;
+    uint64_t missedReleases = 0;    // Releases skipped because the job fell a full period behind
+    int64_t maxLatenessNs = 0;      // Worst start time past the release
+    int64_t maxRuntimeNs = 0;       // Worst job execution time
+};
+
+/**
+ * @brief Executive statistics
+ */
+struct CyclicExecutiveStats {
+    uint64_t ticks = 0;             // Wake-ups that ran at least one job
+    uint64_t jobsRun = 0;
+    int64_t totalOverheadNs = 0;    // Time per tick spent outside job bodies
+    int64_t maxOverheadNs = 0;
+    std::vector<CyclicJobStats> jobs;
+
+    double getAverageOverheadNs() const {
+        return ticks > 0 ? static_cast<double>(totalOverheadNs) / ticks : 0.0;
+    }
+};
+
+/**
+ * @brief Single-thread cyclic executive for periodic jobs
+ *
+ * Runs any number of periodic jobs (SV streams at different rates, GOOSE
+ * retransmissions, statistics snapshots) on one thread. Pending releases
+ * are kept in a binary min-heap ordered by deadline, so each tick costs
+ * O(log jobs). The thread sleeps on an absolute timerfd on Linux and on
+ * Timer elsewhere, and can be pinned with a RealtimeConfig.
+ *
+ * Release k of a job is due at phase + k * period from run() start,
+ * computed from k rather than accumulated, so the schedule does not drift;
+ * addRateJob() keeps the period exact (1e9 / rate ns) where a whole number
+ * of nanoseconds would not (208333 ns at 4800 Hz loses 1.6 ppm).
+ *
+ * A job that falls a full period behind skips the missed releases instead
+ * of bursting, and the skips are counted in its statistics.
+ *
+ * Example usage:
+ * @code
+ * CyclicExecutive exec;
+ * exec.addRateJob("SV 4800", 4800, [&](uint64_t n) { sendSv(n); });
+ * exec.addJob("Stats", 1000000000, [&](uint64_t) { printStats(); });
+ * exec.run();  // Blocks until stop()
+ * @endcode
+ */
+class CyclicExecutive {
+public:
+    using JobFunction = std::function<void(uint64_t release)>;
+
+    CyclicExecutive();
+    ~CyclicExecutive();
+
+    /**
+     * @brief Register a periodic job (only before run())
+     * @param name Job name for statistics
+     * @param periodNs Release period in nanoseconds
+     * @param function Job body, called with the release number
+     * @param phaseNs Offset of the first release from run() start
+     * @return Job index, -1 on invalid period or while running
+     */
+    int addJob(const std::string& name, long long periodNs, JobFunction function, long long phaseNs = 0);
+
+    /**
+     * @brief Register a job released a whole number of times per second (only before run())
+     * @param name Job name for statistics
+     * @param rateHz Releases per second; release k is due k * 1e9 / rateHz ns after the first
+     * @param function Job body, called with the release number
+     * @param phaseNs Offset of the first release from run() start
+     * @return Job index, -1 on invalid rate or while running
+     */
+    int addRateJob(const std::string& name, uint32_t rateHz, JobFunction function, long long phaseNs = 0);
+
+    /**
+     * @brief Real-time profile applied to the executive thread in run()
+     * @param config Real-time configuration (TX priority and CPU are used)
+     */
+    void setRealtimeProfile(const RealtimeConfig& config) { realtime_ = config; }
+
+    /**
+     * @brief Run all jobs on the calling thread (blocking)
+     * @return false if no jobs are registered
+     */
+    bool run();
+
+    /**
+     * @brief Stop the executive; takes effect at the next wake-up
+     * Thread-safe. Can be called from signal handler or a job.
+     */
+    void stop() { running_ = false; }
+
+    /**
+     * @brief Check if the executive is running
+     */
+    bool isRunning() const { return running_; }
+
+    /**
+     * @brief Get statistics (call after run() returns or from a job)
+     */
+    const CyclicExecutiveStats& getStatistics() const { return stats_; }
+
+    /**
+     * @brief Report of what the real-time profile was granted
+     */
+    const RealtimeReport& getRealtimeReport() const { return realtimeReport_; }
+
+    /**
+     * @brief Print statistics to console
+     */
+    void printStatistics() const;
+
+private:
+    struct Job {
+        JobFunction function;
+        long long periodNs;         // Whole nanoseconds (rounded down for rate jobs)
+        uint64_t periodSpanNs;      // The period is exactly periodSpanNs / periodCount ns
+        uint64_t periodCount;
+        long long phaseNs;
+        int64_t firstReleaseNs;
+        int64_t nextReleaseNs;
+        uint64_t release;
+    };
+
+    struct HeapEntry {
+        int64_t deadlineNs;
+        int job;
+    };
+
+    int addJob(const std::string& name, uint64_t spanNs, uint64_t count, JobFunction function, long long phaseNs);
+    static int64_t releaseNs(const Job& job, uint64_t release);
+    static int64_t nowNs();
+    bool sleepUntil(int64_t deadlineNs);
+    void pushRelease(int job);
+
+    std::vector<Job> jobs_;
+    std::vector<HeapEntry> heap_;
+    CyclicExecutiveStats stats_;
+    RealtimeConfig realtime_;
+    RealtimeReport realtimeReport_;
+    std::atomic<bool> running_;
+    int timerFd_;
+};
+
+#endif // CYCLIC_EXECUTIVE_H
@@ -0,0 +1,230 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ * Linux/macOS: mmap(PROT_READ, MAP_PRIVATE) with madvise access hints
+ * Windows: CreateFileMapping/MapViewOfFile (hints are no-ops)
+ *
+ * The mapping is released on close() or destruction. Move-only.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Expected access pattern, passed to madvise()
+     */
+    enum class Access {
+        Normal,
+        Sequential,  // MADV_SEQUENTIAL: aggressive read-ahead, drop pages behind
+        Random,      // MADV_RANDOM: no read-ahead
+        WillNeed     // MADV_WILLNEED: start reading the whole range now
+    };
+
+    MappedFile() : data_(nullptr), size_(0), open_(false)
+#ifdef _WIN32
+        , file_(INVALID_HANDLE_VALUE), mapping_(nullptr)
+#endif
+    {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept : MappedFile() {
+        swap(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Map a file read-only
+     * @param path File path
+     * @return true on success (an empty file maps to size 0), false on failure
+     */
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            lastError_ = "Failed to open " + path;
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file_, &fileSize)) {
+            lastError_ = "Failed to get size of " + path;
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(fileSize.QuadPart);
+        if (size_ == 0) {
+            open_ = true;
+            return true;
+        }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            lastError_ = "Failed to map " + path;
+            close();
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) {
+            lastError_ = "Failed to map " + path;
+            close();
+            return false;
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            lastError_ = "Failed to open " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            lastError_ = "Failed to stat " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                lastError_ = "Failed to map " + path + ": " + std::strerror(errno);
+                size_ = 0;
+                ::close(fd);
+                return false;
+            }
+            data_ = static_cast<const uint8_t*>(addr);
+        }
+        // The mapping keeps the file referenced
+        ::close(fd);
+#endif
+        open_ = true;
+        return true;
+    }
+
+    /**
+     * @brief Unmap the file
+     */
+    void close() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+    /**
+     * @brief Hint the expected access pattern for a range (best effort)
+     * @param access Access pattern
+     * @param offset Byte offset of the range
+     * @param length Range length in bytes (0 = to end of file)
+     */
+    void advise(Access access, size_t offset = 0, size_t length = 0) const {
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+        if (!data_ || offset >= size_) {
+            return;
+        }
+        // madvise needs a page-aligned start
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset - offset % page;
+        size_t end = (length == 0 || offset + length > size_) ? size_ : offset + length;
+
+        int advice = MADV_NORMAL;
+        switch (access) {
+            case Access::Sequential: advice = MADV_SEQUENTIAL; break;
+            case Access::Random: advice = MADV_RANDOM; break;
+            case Access::WillNeed: advice = MADV_WILLNEED; break;
+            case Access::Normal:
+            default: break;
+        }
+        madvise(const_cast<uint8_t*>(data_) + begin, end - begin, advice);
+#else
+        (void)access;
+        (void)offset;
+        (void)length;
+#endif
+    }
+
+    /**
+     * @brief Ask for transparent huge pages (best effort)
+     *
+     * Only honoured for file mappings on kernels with read-only THP for
+     * file systems; otherwise the call fails silently.
+     */
+    void adviseHugePages() const {
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+        if (data_) {
+            madvise(const_cast<uint8_t*>(data_), size_, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return open_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    void swap(MappedFile& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(open_, other.open_);
+        std::swap(lastError_, other.lastError_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#endif
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    bool open_;
+    std::string lastError_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,102 @@
+#ifndef PCAP_WRITER_H
+#define PCAP_WRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * @brief Minimal pcap file writer for offline frame output
+ *
+ * Writes the nanosecond-resolution pcap format (magic 0xA1B23C4D, Ethernet
+ * link type), readable by Wireshark and tcpdump. Used instead of a raw socket
+ * when a test writes its stream to a file, e.g. together with virtual time.
+ */
+class PcapWriter {
+public:
+    PcapWriter() : framesWritten_(0) {}
+
+    ~PcapWriter() {
+        close();
+    }
+
+    /**
+     * @brief Create file and write the global header
+     * @param path Output file path
+     * @return true on success, false on failure
+     */
+    bool open(const std::string& path) {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_.is_open()) {
+            return false;
+        }
+        framesWritten_ = 0;
+
+        writeValue<uint32_t>(0xA1B23C4D);  // Nanosecond timestamps
+        writeValue<uint16_t>(2);           // Version major
+        writeValue<uint16_t>(4);           // Version minor
+        writeValue<int32_t>(0);            // Timezone offset
+        writeValue<uint32_t>(0);           // Timestamp accuracy
+        writeValue<uint32_t>(65535);       // Snap length
+        writeValue<uint32_t>(1);           // LINKTYPE_ETHERNET
+        return file_.good();
+    }
+
+    /**
+     * @brief Append one frame
+     * @param frame Complete Ethernet frame
+     * @param timestampNs Capture time in nanoseconds since the Unix epoch
+     * @return true on success, false on failure
+     */
+    bool write(const std::vector<uint8_t>& frame, int64_t timestampNs) {
+        if (!file_.is_open()) {
+            return false;
+        }
+        writeValue<uint32_t>(static_cast<uint32_t>(timestampNs / 1000000000LL));
+        writeValue<uint32_t>(static_cast<uint32_t>(timestampNs % 1000000000LL));
+        writeValue<uint32_t>(static_cast<uint32_t>(frame.size()));
+        writeValue<uint32_t>(static_cast<uint32_t>(frame.size()));
+        file_.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+        if (!file_.good()) {
+            return false;
+        }
+        framesWritten_++;
+        return true;
+    }
+
+    /**
+     * @brief Flush and close the file
+     */
+    void close() {
+        if (file_.is_open()) {
+            file_.close();
+        }
+    }
+
+    /**
+     * @brief Check if file is open
+     */
+    bool isOpen() const {
+        return file_.is_open();
+    }
+
+    /**
+     * @brief Number of frames written since open()
+     */
+    uint64_t framesWritten() const {
+        return framesWritten_;
+    }
+
+private:
+    template <typename T>
+    void writeValue(T value) {
+        // pcap readers detect byte order from the magic, so host order is fine
+        file_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::ofstream file_;
+    uint64_t framesWritten_;
+};
+
+#endif // PCAP_WRITER_H
@@ -8,9 +8,14 @@
 #include <cstdint>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include "realtime.h"
+#include "sample_scheduler.h"
+#include "tsc_clock.h"
 
 // Forward declarations
 class RawSocket;
+class Clock;
 class Ethernet;
 class Virtual_LAN;
 class SampledValue;
@@ -50,6 +55,18 @@ struct PhasorInjectionConfig {
         {0.0, 0.0}       // VN
     };
     
+    // Sample timing reference (smpCnt=0 on the UTC/TAI second)
+    SampleTimingConfig timing;
+    
+    // Real-time execution profile (scheduling, affinity, memory locking)
+    RealtimeConfig realtime;
+    
+    // Offline output (no interface needed; GOOSE monitoring is skipped)
+    std::string outputFile;        // Write frames to this pcap file instead of the socket
+    bool virtualTime = false;      // Pace on a virtual clock: no real waiting, ideal timestamps
+                                   // (offline output only: configure() rejects it otherwise)
+    double durationSeconds = 0.0;  // Stop after this much stream time (0 = unlimited)
+    
     // Display configuration
     bool verboseOutput = true;
     uint32_t progressInterval = 1000;  // Print progress every N packets
@@ -65,6 +82,10 @@ struct PhasorInjectionStats {
     std::chrono::steady_clock::time_point endTime;
     bool stoppedByGoose = false;
     std::string gooseStopReason;
+    RealtimeReport txRealtime;   // What the TX thread was granted
+    RealtimeReport rxRealtime;   // What the GOOSE capture thread was granted
+    SampleTimingStats timing;    // Schedule drift against the time reference
+    FrameTimingStats frameTiming; // Per-frame build/send cost
     
     double getElapsedSeconds() const {
         auto duration = endTime - startTime;
@@ -154,6 +175,20 @@ public:
      */
     void setProgressCallback(std::function<void(uint32_t packets, double seconds)> callback);
     
+    /**
+     * @brief Receive every frame in memory instead of sending it
+     * Set before configure(); replaces the socket like outputFile does.
+     * @param callback Function called with the frame and its Realtime timestamp (ns)
+     */
+    void setFrameCallback(std::function<void(const std::vector<uint8_t>& frame, int64_t timestampNs)> callback);
+    
+    /**
+     * @brief Use an external clock for pacing and timestamps
+     * Any clock other than a SystemClock needs offline output; run() rejects it on a live interface.
+     * @param clock Clock that outlives the test (nullptr = system or virtual clock per config)
+     */
+    void setClock(Clock* clock);
+    
     /**
      * @brief Print current configuration to console
      */
@@ -181,11 +216,18 @@ private:
     // Callbacks
     std::function<void(const std::string&, uint32_t, uint32_t)> gooseCallback_;
     std::function<void(uint32_t, double)> progressCallback_;
+    std::function<void(const std::vector<uint8_t>&, int64_t)> frameCallback_;
+    
+    // Time source: injected, owned virtual clock, or the system clock
+    Clock* externalClock_;
+    std::unique_ptr<Clock> virtualClock_;
     
     // Internal methods
     void gooseCaptureThreadFunc();
     bool openSocket();
     void transmissionLoop();
+    bool isOffline() const;
+    Clock& activeClock();
 };
 
 #endif // PHASOR_INJECTION_TEST_H
@@ -185,7 +185,7 @@ public:
         // Bind to interface
         struct ifreq ifr;
         std::memset(&ifr, 0, sizeof(ifr));
-        std::strncpy(ifr.ifr_name, interface.c_str(), sizeof(ifr.ifr_name) - 1);
+        std::strncpy(ifr.ifr_name, iface.c_str(), sizeof(ifr.ifr_name) - 1);
         
         if (ioctl(fd_, BIOCSETIF, &ifr) < 0) {
             ::close(fd_);
@@ -219,7 +219,7 @@ public:
         // Get interface index
         struct ifreq ifr;
         std::memset(&ifr, 0, sizeof(ifr));
-        std::strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+        std::strncpy(ifr.ifr_name, iface.c_str(), IFNAMSIZ - 1);
         
         if (ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
             ::close(fd_);
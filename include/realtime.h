@@ -0,0 +1,108 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Scheduling policy requested for a real-time thread
+ */
+enum class RealtimePolicy {
+    Other,      // Default time-sharing scheduler (no change)
+    Fifo,       // SCHED_FIFO fixed priority
+    Deadline    // SCHED_DEADLINE (Linux), falls back to SCHED_FIFO
+};
+
+/**
+ * @brief Thread role the profile is applied to
+ */
+enum class RealtimeRole {
+    Transmit,   // SV transmission loop
+    Capture     // GOOSE capture thread
+};
+
+/**
+ * @brief Real-time execution profile for TX and RX threads
+ *
+ * Every step is best-effort: missing capabilities (CAP_SYS_NICE,
+ * CAP_IPC_LOCK, RLIMIT_MEMLOCK, ...) are recorded in the report and the
+ * test keeps running with whatever was granted.
+ */
+struct RealtimeConfig {
+    bool enabled = false;
+
+    // Scheduling
+    RealtimePolicy policy = RealtimePolicy::Fifo;
+    int txPriority = 80;                // SCHED_FIFO priority for TX (1-99)
+    int rxPriority = 70;                // SCHED_FIFO priority for GOOSE capture (1-99)
+    double deadlineRuntimeFraction = 0.5;  // SCHED_DEADLINE runtime as fraction of sample period
+
+    // CPU affinity (-1 = leave unpinned)
+    int txCpu = -1;
+    int rxCpu = -1;
+
+    // Memory
+    bool lockMemory = true;             // mlockall(MCL_CURRENT | MCL_FUTURE)
+    bool prefaultBuffers = true;        // Touch replay/frame buffers before the first frame
+    size_t prefaultStackBytes = 256 * 1024;  // Stack depth to prefault per thread
+};
+
+/**
+ * @brief What was actually granted when applying a profile
+ */
+struct RealtimeReport {
+    std::string role;
+    std::string policy = "OTHER";       // Policy in effect after applying the profile
+    int priority = 0;
+    int cpu = -1;                       // CPU the thread is pinned to (-1 = unpinned)
+    bool memoryLocked = false;
+    size_t prefaultedBytes = 0;
+    std::vector<std::string> warnings;  // Steps that could not be granted
+};
+
+/**
+ * @brief Apply scheduling policy and CPU affinity to the calling thread
+ *
+ * Lock and prefault memory first (lockProcessMemory(), prefaultStack(),
+ * prefaultMemory()): a page fault taken once the thread runs under
+ * SCHED_FIFO/SCHED_DEADLINE stalls it at that priority.
+ * @param config Real-time profile
+ * @param role Thread role (selects priority and CPU)
+ * @param periodNs Sample period, used to size SCHED_DEADLINE parameters
+ * @param prepared Report of those memory steps, carried into the result
+ * @return Report of what was granted
+ */
+RealtimeReport applyRealtimeProfile(const RealtimeConfig& config, RealtimeRole role, long long periodNs,
+                                    const RealtimeReport& prepared = RealtimeReport());
+
+/**
+ * @brief Lock all current and future process memory into RAM
+ * @param report Report updated with the outcome
+ * @return true if memory is locked
+ */
+bool lockProcessMemory(RealtimeReport& report);
+
+/**
+ * @brief Touch the given number of bytes of the calling thread's stack
+ * @param bytes Stack depth to prefault
+ * @return Number of bytes touched
+ */
+size_t prefaultStack(size_t bytes);
+
+/**
+ * @brief Touch every page of a buffer so no page fault happens in the hot loop
+ * @param data Buffer start
+ * @param bytes Buffer size in bytes
+ * @return Number of bytes touched
+ */
+size_t prefaultMemory(void* data, size_t bytes);
+
+/**
+ * @brief Print a real-time report to console
+ * @param report Report to print
+ */
+void printRealtimeReport(const RealtimeReport& report);
+
+#endif // REALTIME_H
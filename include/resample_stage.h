@@ -0,0 +1,201 @@
+#ifndef RESAMPLE_STAGE_H
+#define RESAMPLE_STAGE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "timeline_resampler.h"
+
+class ThreadPool;
+class ResampledCache;
+
+/**
+ * @brief Recording samples fed to a ResampleStage
+ *
+ * Called from the stage's worker thread only, while the stage runs.
+ */
+class ResampleSource {
+public:
+    virtual ~ResampleSource() = default;
+
+    /**
+     * @brief Go back to the first sample
+     */
+    virtual bool rewind() = 0;
+
+    /**
+     * @brief Push the next samples into the timeline
+     * @return false at the end of the recording, or on error (getLastError() set)
+     */
+    virtual bool read(TimelineResampler& timeline) = 0;
+
+    virtual std::string getLastError() const = 0;
+};
+
+/**
+ * @brief Values per SV sample (IEC 61850-9-2LE: four currents, four voltages)
+ */
+constexpr size_t kSvChannels = 8;
+
+/**
+ * @brief Output samples of one block, per SV channel
+ */
+struct ResampledBlock {
+    std::vector<std::vector<int32_t>> channels;  // [kSvChannels][sample]; unmapped channels stay zero
+    size_t count = 0;                            // Samples in the block
+};
+
+/**
+ * @brief Resamples a recording on a worker thread, a few blocks ahead of transmission
+ *
+ * The worker pulls output samples from a TimelineResampler, feeding it from
+ * the source whenever it needs input, and converts them to INT32 blocks in
+ * a ring of lookahead + 1 buffers allocated up front. The consumer takes
+ * blocks in order with next(); the worker stays at most lookahead blocks
+ * ahead of it. Memory and the wait for the first block therefore depend on
+ * the block size and lookahead, not on the recording length.
+ *
+ * With more than one thread, the worker filters each block together with a
+ * pool of threads - 1 helpers (see TimelineResampler::setThreadPool()). The
+ * helpers are not pinned or prioritised, so on a real-time host they compete
+ * with the transmit thread for CPUs; one thread (the worker alone) is the
+ * safe choice there.
+ *
+ * Output can also come from a ResampledCache entry instead
+ * (configureCached()): the worker then only copies blocks out of the mapped
+ * file. Conversely, recordTo() has the worker store the first pass that
+ * reaches the end of the recording in an entry.
+ *
+ * The worker is started once and kept across rewind(), so it does not pick
+ * up a real-time profile applied to the consumer thread afterwards.
+ *
+ * Example usage:
+ * @code
+ * ResampleStage stage;
+ * stage.configure(cfg.sampleRates, {0, 1, 2}, 4800.0, ResamplerOptions(), 4096, 2, 1);
+ * stage.start(source);
+ * while (const ResampledBlock* block = stage.next()) {
+ *     transmit(*block);
+ * }
+ * stage.stop();
+ * @endcode
+ */
+class ResampleStage {
+public:
+    ResampleStage();
+    ~ResampleStage();
+
+    ResampleStage(const ResampleStage&) = delete;
+    ResampleStage& operator=(const ResampleStage&) = delete;
+
+    /**
+     * @brief Set up the resampling (stops the worker)
+     * @param rates Sample rate table of the recording
+     * @param svChannels SV channel (0 .. kSvChannels - 1) of each value the source pushes per sample
+     * @param outputRate Output sample rate (Hz)
+     * @param options Rate conversion filter
+     * @param blockSamples Output samples per block
+     * @param lookahead Blocks the worker may have ready beyond the one in use
+     * @param threads Threads filtering each block (1 = the worker alone, 0 = hardware concurrency)
+     * @return false if the timeline cannot be configured
+     */
+    bool configure(const std::vector<SampleRate>& rates, const std::vector<int>& svChannels, double outputRate,
+                   const ResamplerOptions& options, size_t blockSamples, size_t lookahead, unsigned threads);
+
+    /**
+     * @brief Play an output cache entry back instead of resampling (stops the worker)
+     * @param cache Entry after a hit (see ResampledCache::open()); must outlive the stage's use
+     * @param blockSamples Output samples per block
+     * @param lookahead Blocks the worker may have ready beyond the one in use
+     */
+    void configureCached(const ResampledCache& cache, size_t blockSamples, size_t lookahead);
+
+    /**
+     * @brief Store the next pass that reaches the end of the recording in an output cache entry
+     *
+     * A pass cut short by rewind() or stop() is dropped and the next one
+     * recorded instead; after one entry is written, recording stops.
+     *
+     * @param cache Entry written by the worker (nullptr = none); must outlive the worker
+     */
+    void recordTo(ResampledCache* cache);
+
+    /**
+     * @brief Sampling offset of each value the source pushes (from the next configure())
+     * @param seconds See TimelineResampler::setChannelSkew()
+     */
+    void setChannelSkew(const std::vector<double>& seconds) { timeline_.setChannelSkew(seconds); }
+
+    /**
+     * @brief Start the worker on a source, from its first sample
+     * @param source Read by the worker until stop(); must outlive it (nullptr with configureCached())
+     */
+    void start(ResampleSource* source);
+
+    /**
+     * @brief Start again from the first sample (blocks not taken are dropped)
+     */
+    void rewind();
+
+    /**
+     * @brief Take the next block, handing the previous one back
+     * @return nullptr at the end of the recording or on error (see getLastError())
+     */
+    const ResampledBlock* next();
+
+    /**
+     * @brief Stop the worker (start() runs it again)
+     */
+    void stop();
+
+    /**
+     * @brief Timeline of the last pass; read it only while the worker is stopped
+     * or after next() returned nullptr
+     */
+    const TimelineResampler& timeline() const { return timeline_; }
+
+    std::string getLastError() const;
+
+private:
+    void run();
+    void allocate(size_t lookahead);
+    bool fill(ResampledBlock& block, uint64_t generation);
+    bool fillCached(ResampledBlock& block);
+
+    TimelineResampler timeline_;
+    std::vector<SampleRate> rates_;
+    std::vector<int> svChannels_;
+    double outputRate_;
+    ResamplerOptions options_;
+    size_t blockSamples_;
+    std::vector<double> pulled_;        // [sample][value] from the timeline
+    std::unique_ptr<ThreadPool> pool_;  // Helpers of the worker (nullptr: one thread)
+    const ResampledCache* cached_;      // Entry played back (nullptr: resample the source)
+    uint64_t cachedNext_;               // Next sample of cached_ to copy
+    ResampledCache* recorder_;          // Entry the current pass is written to (nullptr: none)
+
+    ResampleSource* source_;
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;    // Worker: a slot was freed, or a rewind or stop
+    std::condition_variable produced_;  // Consumer: a block is ready, or the end
+    std::vector<ResampledBlock> ring_;
+    size_t head_;                       // Next slot the worker fills
+    size_t tail_;                       // Next slot handed out
+    size_t filled_;                     // Slots ready or in use by the consumer
+    bool holding_;                      // The consumer has ring_[tail_]
+    bool rewindPending_;                // The worker must reset the timeline and source
+    bool ended_;                        // No blocks after the ones filled
+    bool failed_;
+    bool quit_;
+    std::atomic<uint64_t> generation_;  // Bumped by rewind(): blocks filled before it are dropped
+    std::string lastError_;
+};
+
+#endif // RESAMPLE_STAGE_H
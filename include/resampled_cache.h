@@ -0,0 +1,138 @@
+#ifndef RESAMPLED_CACHE_H
+#define RESAMPLED_CACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "comtrade_cache.h"
+#include "mapped_file.h"
+#include "timeline_resampler.h"
+
+struct ResampledBlock;
+
+/**
+ * @brief Recording an entry of a ResampledCache stands for
+ */
+struct ResampledCacheInfo {
+    uint64_t recordingSamples = 0;  // COMTRADE samples that were resampled
+    double recordingRate = 0.0;     // Rate at the first of them (Hz)
+    TimelineReport report;          // Timeline of the pass that wrote the entry
+};
+
+/**
+ * @brief On-disk cache of the final output of a replay: mapped, resampled
+ * and converted to INT32
+ *
+ * An entry holds the output samples as one flat [sample][value] array of
+ * int32_t, 64-byte aligned behind a fixed header, so a hit maps the file
+ * and hands blocks out of it with no parse, mapping or filtering at all.
+ * Values are in the order of the SV channels given to begin().
+ *
+ * An entry is tied to the recording by the key and probe of a CacheSource
+ * (see comtrade_cache.h), so open() never reads the source whole, and to
+ * everything else that shapes the output by a settings string (target
+ * rate, resampler options, channel mapping, ...) built by the caller and
+ * compared verbatim. Entries for other settings live side by side:
+ * "fault.cfg-1a2b3c4d5e6f7a8b.out.cache", next to the source or in the cache
+ * directory.
+ *
+ * An entry is written while a pass runs (begin(), append() per block,
+ * commit() at the end) to a temporary file renamed into place by commit(),
+ * so a reader never sees a partial entry; a pass that does not reach the
+ * end is abandon()ed.
+ */
+class ResampledCache {
+public:
+    /**
+     * @brief Identify the source and the entry
+     * @param cfgPath .cfg or .cff file
+     * @param datPath .dat file (see ComtradeParser::resolveDatPath(); ignored for .cff)
+     * @param cacheDir Cache directory (empty = next to cfgPath)
+     * @param settings Everything besides the recording that shapes the output
+     * @param source Identity of the source, shared with the parse cache (nullptr = take it here)
+     */
+    ResampledCache(const std::string& cfgPath, const std::string& datPath, const std::string& cacheDir,
+                   const std::string& settings, std::shared_ptr<const CacheSource> source = nullptr);
+    ~ResampledCache();
+
+    ResampledCache(const ResampledCache&) = delete;
+    ResampledCache& operator=(const ResampledCache&) = delete;
+
+    /**
+     * @brief Map the entry for the source and settings
+     * @param detail Reason when the result is Stale
+     * @return Hit (samples() readable until the cache is destroyed), Miss or Stale
+     */
+    CacheResult open(std::string& detail);
+
+    const ResampledCacheInfo& info() const { return info_; }
+    uint64_t sampleCount() const { return sampleCount_; }
+    const std::vector<int>& svChannels() const { return svChannels_; }  // SV channel per value
+    const int32_t* samples() const { return samples_; }                 // [sample][value] after a hit
+
+    /**
+     * @brief Describe the recording an entry written from now on stands for
+     */
+    void describe(uint64_t recordingSamples, double recordingRate);
+
+    /**
+     * @brief Start writing an entry (drops one in progress)
+     * @param svChannels SV channel (0 .. kSvChannels - 1) of each value stored per sample
+     * @return false if the temporary file cannot be created (getLastError() set)
+     */
+    bool begin(const std::vector<int>& svChannels);
+
+    /**
+     * @brief Append the samples of a block
+     * @return false on a write error (the entry is abandoned)
+     */
+    bool append(const ResampledBlock& block);
+
+    /**
+     * @brief Finish the entry and move it into place
+     *
+     * Checks the source key and probe again and stores the hash of its whole
+     * content, read here unless the shared CacheSource already has it.
+     *
+     * @param report Timeline of the pass
+     * @return false if it could not be written, or the source changed meanwhile
+     */
+    bool commit(const TimelineReport& report);
+
+    /**
+     * @brief Drop the entry being written
+     * @param reason Kept as getLastError() (empty = keep the current one)
+     */
+    void abandon(const std::string& reason = "");
+
+    bool writing() const { return out_.is_open(); }
+    bool written() const { return written_; }  // An entry was committed
+    const std::string& path() const { return path_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::shared_ptr<const CacheSource> source_;  // Identity of the recording
+    std::string settings_;
+    std::string path_;
+    std::string lastError_;
+
+    // Entry read by open()
+    MappedFile file_;
+    ResampledCacheInfo info_;
+    std::vector<int> svChannels_;
+    uint64_t sampleCount_;
+    const int32_t* samples_;
+
+    // Entry being written
+    std::ofstream out_;
+    std::string tempPath_;
+    ResampledCacheInfo writeInfo_;  // See describe()
+    std::vector<int> writeChannels_;
+    std::vector<int32_t> frames_;   // One block, interleaved
+    uint64_t writeSamples_;         // Samples appended
+    bool written_;
+};
+
+#endif // RESAMPLED_CACHE_H
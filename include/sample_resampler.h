@@ -0,0 +1,220 @@
+#ifndef SAMPLE_RESAMPLER_H
+#define SAMPLE_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Interpolation used to change the sample rate
+ */
+enum class ResamplerMethod {
+    Linear,     // Straight line between neighbouring samples (no anti-aliasing)
+    Polyphase   // Band-limited FIR (Kaiser-windowed sinc)
+};
+
+/**
+ * @brief Filter requirements for SampleResampler
+ *
+ * The stopband starts at the lower of the two Nyquist frequencies, so
+ * nothing above it survives as an alias (downsampling) or image (upsampling).
+ */
+struct ResamplerOptions {
+    ResamplerMethod method = ResamplerMethod::Polyphase;
+    double passband = 0.8;        // Passband edge as a fraction of the stopband edge
+    double stopbandDb = 90.0;     // Stopband attenuation (dB)
+    unsigned maxPhases = 1024;    // Largest L of an L/M ratio given exact coefficient banks
+    unsigned tablePhases = 256;   // Phases of the interpolated table used for other ratios
+};
+
+/**
+ * @brief Filter a configured SampleResampler actually uses
+ */
+struct ResamplerSpec {
+    ResamplerMethod method = ResamplerMethod::Linear;
+    bool rational = false;      // Exact L/M banks (false: interpolated table)
+    unsigned up = 1;            // L (rational ratios)
+    unsigned down = 1;          // M (rational ratios)
+    unsigned phases = 0;        // Coefficient banks (0 for linear)
+    unsigned taps = 2;          // Input samples per output sample
+    double passbandHz = 0.0;    // Passband edge
+    double stopbandHz = 0.0;    // Stopband edge
+    double stopbandDb = 0.0;    // Attenuation from stopbandHz up
+    double rippleDb = 0.0;      // Peak passband ripple
+};
+
+/**
+ * @brief Frame-interleaved input samples ([sample][channel]) of one stream
+ *
+ * Holds stream samples first .. first + count - 1. The stream runs from
+ * sample begin to sample end - 1; taps outside it read the edge sample.
+ * end stays at its default while the end of the stream is not known yet,
+ * and begin = INT64_MIN when the caller supplies every tap itself.
+ */
+struct ResamplerInput {
+    const double* frames = nullptr;
+    size_t channels = 0;
+    int64_t first = 0;              // Stream index of frames[0]
+    size_t count = 0;               // Samples held
+    int64_t begin = 0;              // First sample of the stream
+    int64_t end = INT64_MAX;        // One past the last sample of the stream
+};
+
+/**
+ * @brief Per-caller buffers of SampleResampler::process()
+ *
+ * One per thread when several threads process disjoint outputs or channels
+ * of the same resampler at once.
+ */
+struct ResamplerScratch {
+    std::vector<double> coefs;      // Interpolated coefficients of the current output
+    std::vector<double> edge;       // Clamped input frames for outputs at the stream edges
+};
+
+/**
+ * @brief Converts uniformly sampled channels from one rate to another
+ *
+ * Output sample n is the input evaluated at position origin + n *
+ * inputRate / outputRate (origin 0 unless setOrigin() moves it). The
+ * polyphase method checks whether the ratio is a fraction L/M with
+ * L <= maxPhases (rates compared in whole millihertz); if so, each of the L
+ * positions between two input samples gets its own precomputed coefficient
+ * bank. Other ratios, and origins off the 1/L grid, interpolate between the
+ * banks of a finely divided table. Either way one set of coefficients serves
+ * every channel of an output sample, and the multiply-adds run across
+ * channels (AVX2 when available, see activeSimdLevel()).
+ *
+ * Channels sampled at different instants (setChannelSkew()) are each
+ * evaluated at their own position: every channel gets its own taps,
+ * still multiplied and added across channels in one pass. Those taps are
+ * precomputed per phase, for the exact banks and for the table alike, so
+ * the cost over shared coefficients is one more load per tap (for the
+ * table, two loads and the interpolation, done as the taps are applied).
+ *
+ * Example usage:
+ * @code
+ * SampleResampler resampler;
+ * if (resampler.configure(1000.0, 4800.0)) {
+ *     ResamplerInput input;
+ *     input.frames = frames;        // [sample][channel]
+ *     input.channels = 3;
+ *     input.count = numSamples;
+ *     input.end = static_cast<int64_t>(numSamples);
+ *     std::vector<double> out(resampler.outputSamples(numSamples) * 3);
+ *     resampler.process(input, 0, out.size() / 3, out.data());
+ * }
+ * @endcode
+ */
+class SampleResampler {
+public:
+    SampleResampler();
+
+    /**
+     * @brief Design the filter for a rate pair
+     * @param inputRate Input sample rate (Hz)
+     * @param outputRate Output sample rate (Hz)
+     * @param options Method and filter requirements
+     * @return false if a rate is not positive or the filter would be unreasonably long
+     */
+    bool configure(double inputRate, double outputRate, const ResamplerOptions& options = ResamplerOptions());
+
+    const ResamplerSpec& spec() const { return spec_; }
+    double ratio() const { return ratio_; }  // Output rate / input rate
+
+    /**
+     * @brief Output length for an input of inputSamples (ceil(inputSamples * ratio))
+     */
+    uint64_t outputSamples(uint64_t inputSamples) const;
+
+    /**
+     * @brief Input position of output sample 0 (fraction of an input sample, >= 0)
+     */
+    void setOrigin(double position);
+    double origin() const { return origin_; }
+
+    /**
+     * @brief Evaluate each channel at its own position (fractional delay)
+     *
+     * Sample i of channel c was taken at input position i + skew[c], so
+     * output n of channel c reads the input at position(n) - skew[c].
+     * Cleared by configure().
+     * @param skew Offset per channel in input samples (all zero = none)
+     */
+    void setChannelSkew(const std::vector<double>& skew);
+    bool skewed() const { return !skew_.empty(); }
+
+    /**
+     * @brief Input samples output sample n reads, before edge clamping
+     * @param output Output sample index
+     * @param first Output, first input index (may be negative)
+     * @param last Output, last input index (may be past the end)
+     */
+    void inputSpan(uint64_t output, int64_t& first, int64_t& last) const;
+
+    /**
+     * @brief Compute output samples firstOutput .. firstOutput + count - 1
+     * @param input Input samples; must hold every sample inputSpan() names
+     *              for these outputs that lies inside the stream
+     * @param firstOutput Index of the first output sample
+     * @param count Output samples to compute
+     * @param out Output, count * input.channels values ([sample][channel])
+     */
+    void process(const ResamplerInput& input, uint64_t firstOutput, size_t count, double* out);
+
+    /**
+     * @brief Compute some channels of output samples firstOutput .. firstOutput + count - 1
+     *
+     * Safe to call from several threads at once for disjoint outputs or
+     * channels, each with its own scratch; the values written are those of
+     * process() over all channels.
+     * @param input Input samples, as for process()
+     * @param firstOutput Index of the first output sample
+     * @param count Output samples to compute
+     * @param firstChannel First channel computed
+     * @param channelCount Channels computed
+     * @param out Output, count * input.channels values ([sample][channel]); only
+     *            the channels computed are written
+     * @param scratch Buffers of this caller
+     */
+    void process(const ResamplerInput& input, uint64_t firstOutput, size_t count, size_t firstChannel,
+                 size_t channelCount, double* out, ResamplerScratch& scratch) const;
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    const double* coefficients(uint64_t output, int64_t begin, int64_t end, int64_t& firstTap,
+                               double* coefs) const;
+    void processSkewed(const ResamplerInput& input, uint64_t firstOutput, size_t count, size_t firstChannel,
+                       size_t channelCount, double* out, ResamplerScratch& scratch) const;
+    const double* skewedCoefficients(uint64_t output, size_t firstChannel, size_t channelCount, int64_t& firstTap,
+                                     double* coefs, const double*& upper, double& weight) const;
+    void designBanks(std::vector<double>& banks, size_t phases, size_t count) const;
+    void designBank(double frac, double* bank) const;
+    void designSkewBanks(std::vector<double>& banks, size_t phases, size_t count) const;
+    void designSkewTable();
+
+    ResamplerSpec spec_;
+    double ratio_;              // Output rate / input rate
+    double step_;               // Input samples per output sample (table and linear)
+    double cutoff_;             // Filter cutoff (1 = input Nyquist frequency)
+    double beta_;               // Kaiser window shape
+    unsigned tablePhases_;
+    double origin_;             // Input position of output 0
+    uint64_t originUnits_;      // origin_ in 1/L steps (rational banks)
+    bool useTable_;             // Positions off the exact banks
+    std::vector<double> bank_;  // [phase][tap], L exact banks (rational ratios)
+    std::vector<double> table_; // [phase][tap], tablePhases + 1 banks (built when needed)
+    ResamplerScratch scratch_;  // Buffers of process() over all channels
+    std::vector<double> skew_;  // Per channel offsets (input samples); empty = none
+    int64_t skewLow_;           // Tap reach added by the skew: before the first tap
+    int64_t skewHigh_;          // and after the last
+    size_t span_;               // Taps read per output with skew
+    std::vector<double> skewBanks_;  // [phase][tap][channel], span_ taps (exact banks)
+    std::vector<double> skewTable_;  // [phase][tap][channel], span_ taps, tablePhases + 1 banks
+    std::string lastError_;
+};
+
+const char* resamplerMethodName(ResamplerMethod method);
+
+#endif // SAMPLE_RESAMPLER_H
@@ -0,0 +1,140 @@
+#ifndef SAMPLE_SCHEDULER_H
+#define SAMPLE_SCHEDULER_H
+
+#include <cstdint>
+#include <memory>
+
+class Timer;
+class Clock;
+
+/**
+ * @brief Time reference that sample deadlines are tied to
+ */
+enum class TimeReference {
+    Monotonic,  // Free-running CLOCK_MONOTONIC (no discipline)
+    UTC,        // CLOCK_REALTIME, as disciplined by PTP/NTP
+    TAI         // CLOCK_TAI (Linux), falls back to CLOCK_REALTIME elsewhere
+};
+
+/**
+ * @brief Get display name of a time reference
+ */
+inline const char* timeReferenceName(TimeReference reference) {
+    switch (reference) {
+        case TimeReference::Monotonic: return "MONOTONIC";
+        case TimeReference::TAI: return "TAI";
+        case TimeReference::UTC:
+        default: return "UTC";
+    }
+}
+
+/**
+ * @brief Sample timing configuration
+ */
+struct SampleTimingConfig {
+    TimeReference reference = TimeReference::UTC;
+    double maxSlewPpm = 1000.0;             // Max rate correction while following the reference
+    long long stepThresholdNs = 1000000;    // Offsets beyond this re-align instead of slewing
+};
+
+/**
+ * @brief Sample timing statistics
+ */
+struct SampleTimingStats {
+    int64_t lastDriftNs = 0;        // Schedule offset from the reference at the last sample
+    int64_t maxAbsDriftNs = 0;      // Largest absolute offset seen
+    uint32_t clockSteps = 0;        // Re-alignments after a reference clock step (either way)
+    uint64_t samplesSkipped = 0;    // Samples skipped by forward re-alignments
+};
+
+/**
+ * @brief Periodic sample scheduler disciplined to UTC or TAI
+ *
+ * Sample k is due at reference second + k/rate, with sample 0 aligned to the
+ * next whole second so smpCnt=0 coincides with the reference second. Sleeping
+ * is done on CLOCK_MONOTONIC; the REALTIME/TAI-to-MONOTONIC offset is measured
+ * every sample and followed at no more than maxSlewPpm, so PTP/NTP adjustments
+ * are tracked smoothly. Offsets larger than stepThresholdNs are treated as a
+ * clock step and the sample index is re-anchored to the reference: a forward
+ * step skips samples, a backward step moves the index back so transmission
+ * carries on without a gap (smpCnt values of the current second repeat).
+ *
+ * All readings and sleeps go through a Clock, so a VirtualClock runs the
+ * exact ideal schedule without waiting.
+ *
+ * Example usage:
+ * @code
+ * SampleScheduler scheduler(config.timing, 4800);
+ * scheduler.start();                       // Wait for sample 0
+ * while (running) {
+ *     send(frame);
+ *     uint64_t k = scheduler.advance();    // Next sample index
+ *     sv.smpCnt = k % 4800;
+ *     frame = build();
+ *     scheduler.wait();                    // Sleep until sample k is due
+ * }
+ * @endcode
+ */
+class SampleScheduler {
+public:
+    /**
+     * @param config Timing configuration
+     * @param sampleRate Samples per second
+     * @param clock Time source (nullptr = system clock)
+     */
+    SampleScheduler(const SampleTimingConfig& config, uint32_t sampleRate, Clock* clock = nullptr);
+    ~SampleScheduler();
+
+    /**
+     * @brief Align sample 0 to the next reference second and wait for it
+     */
+    void start();
+
+    /**
+     * @brief Move to the next sample, applying clock discipline
+     * @return Index of the sample now scheduled
+     */
+    uint64_t advance();
+
+    /**
+     * @brief Sleep until the scheduled sample is due
+     */
+    void wait();
+
+    /**
+     * @brief Monotonic deadline of the sample currently scheduled
+     */
+    int64_t deadlineNs() const;
+
+    /**
+     * @brief Index of the sample currently scheduled
+     */
+    uint64_t sampleIndex() const { return sampleIndex_; }
+
+    /**
+     * @brief Reference time of sample 0 in seconds since the clock epoch
+     */
+    int64_t epochSeconds() const { return epochNs_ / 1000000000LL; }
+
+    /**
+     * @brief Get timing statistics
+     */
+    const SampleTimingStats& getStats() const { return stats_; }
+
+private:
+    int64_t idealReferenceNs(uint64_t k) const;
+    int64_t measureOffsetNs() const;
+    void discipline();
+
+    Clock& clock_;
+    std::unique_ptr<Timer> timer_;
+    SampleTimingConfig config_;
+    uint32_t sampleRate_;
+    int64_t periodNs_;
+    uint64_t sampleIndex_;
+    int64_t epochNs_;       // Reference time of sample 0
+    int64_t appliedOffsetNs_;  // Reference minus monotonic offset used for deadlines
+    SampleTimingStats stats_;
+};
+
+#endif // SAMPLE_SCHEDULER_H
@@ -0,0 +1,114 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/**
+ * @brief Fixed-size worker pool for data-parallel loading
+ *
+ * Tasks run in submission order as workers become free. submit() returns a
+ * future, so callers wait for (and merge) results in their own order.
+ *
+ * Example usage:
+ * @code
+ * ThreadPool pool(4);
+ * std::vector<std::future<size_t>> parts;
+ * for (auto& chunk : chunks) {
+ *     parts.push_back(pool.submit([&chunk] { return parse(chunk); }));
+ * }
+ * for (auto& part : parts) total += part.get();
+ * @endcode
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Start the workers
+     * @param numThreads Worker count (0 = hardware concurrency)
+     */
+    explicit ThreadPool(unsigned numThreads = 0) : stopping_(false) {
+        if (numThreads == 0) {
+            numThreads = defaultThreadCount();
+        }
+        workers_.reserve(numThreads);
+        for (unsigned i = 0; i < numThreads; i++) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queue a task
+     * @param task Callable with no arguments
+     * @return Future for the task's result
+     */
+    template <typename F>
+    auto submit(F task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged] { (*packaged)(); });
+        }
+        condition_.notify_one();
+        return result;
+    }
+
+    /**
+     * @brief Number of workers
+     */
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    /**
+     * @brief Hardware concurrency, at least 1
+     */
+    static unsigned defaultThreadCount() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,271 @@
+#ifndef TIMELINE_RESAMPLER_H
+#define TIMELINE_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sample_resampler.h"
+
+struct SampleRate;
+class ThreadPool;
+
+/**
+ * @brief Time of .dat samples from the sample rate table
+ *
+ * A sample in a segment with a rate is timed by its sample number from the
+ * start of the segment; segments with rate 0 are timed by the sample
+ * timestamps. The current segment follows the sample numbers as they go
+ * by, so timing a recording is one pass with no search of the table per
+ * sample.
+ */
+class SampleClock {
+public:
+    explicit SampleClock(const std::vector<SampleRate>& rates);
+
+    /**
+     * @brief Time of one sample
+     * @param sampleNumber .dat sample number (1 = first sample of the recording)
+     * @param timestampUs .dat timestamp, used in segments without a rate
+     * @param rate Output, rate of the sample's segment (0 = timed by timestamps)
+     * @param segment Output, index of that segment
+     * @return Seconds since the first sample of the recording
+     */
+    double time(int64_t sampleNumber, uint64_t timestampUs, double& rate, size_t& segment);
+
+private:
+    struct Segment {
+        int64_t firstNumber;    // First sample number in the segment
+        int64_t lastNumber;     // Last sample number (the last segment runs on)
+        double rate;            // 0 = timed by timestamps
+        double start;           // Time of firstNumber
+        bool anchored;          // start is known
+    };
+    std::vector<Segment> segments_;
+    size_t current_;
+};
+
+/**
+ * @brief How a recording's samples lie in time, as found by TimelineResampler
+ */
+struct TimelineReport {
+    size_t runs = 0;                // Stretches of consecutive samples at one rate
+    size_t rateChanges = 0;         // Run boundaries where the rate changes
+    size_t gaps = 0;                // Run boundaries where sample numbers skip
+    uint64_t missingSamples = 0;    // Samples skipped in those gaps
+    uint64_t droppedSamples = 0;    // Samples not after the previous one in time (ignored)
+    std::vector<double> rates;      // Rates in order of appearance (0 = timed by timestamps)
+};
+
+/**
+ * @brief Resamples a recording onto one output rate by sample time
+ *
+ * Samples are pushed in .dat order; each is timed by SampleClock and the
+ * recording is cut into runs of consecutive samples at one rate, split
+ * where the rate changes or sample numbers skip (missing samples). Output
+ * sample n lies at n / outputRate seconds after the first sample pushed and
+ * is produced by the run it falls in: uniform runs through a SampleResampler
+ * for their rate, runs timed by timestamps by linear interpolation in time.
+ * Runs, filter positions and rates all follow from the previous sample, so
+ * the whole recording is timed and resampled in a single pass.
+ *
+ * Filter taps past either end of a run read the neighbouring run at the
+ * run's own spacing, band-limited, so the output stays continuous and as
+ * accurate over rate changes as inside a run:
+ * - in a slower run, that run is resampled onto this run's grid by a
+ *   polyphase filter for the rate pair (a SampleResampler with an origin)
+ * - in a faster run, its samples are interpolated by a short Lagrange
+ *   polynomial; the faster run is oversampled for this run's band, and the
+ *   polynomial stays inside it, so neither fill needs the other
+ * The taps of such a polyphase fill that fall in a faster run again are
+ * interpolated, others read the samples linearly in time. At the same rate
+ * (a gap, or a new segment) and in runs timed by timestamps, taps read the
+ * samples linearly in time, and outside the recording its edge samples. A
+ * 350 Hz tone across 1200, 4800, 1000 and 9600 Hz segments comes out at
+ * about -90 dB at the rate changes as inside the segments; the content a
+ * faster run holds above the slower run's band is left out there.
+ *
+ * Only the samples the next outputs still read are kept, so input can be
+ * pushed block by block while output is pulled; pull() returns what the
+ * input so far determines, and everything once finish() is called. With one
+ * run (a single rate, nothing missing) the output is that of a
+ * SampleResampler over the whole recording.
+ *
+ * Channels sampled at their own instants (setChannelSkew()) are each
+ * resampled at their own times: uniform runs through the filter's per
+ * channel taps, runs timed by timestamps by interpolating each channel at
+ * its time. Runs at the output rate are then always filtered.
+ *
+ * With a thread pool, long batches of a uniform run are split into output
+ * time ranges (and groups of 4 channels when a batch is short) computed at
+ * once. Every range reads the same input samples, taps past its edges
+ * included, so the output does not depend on the split.
+ *
+ * Example usage:
+ * @code
+ * TimelineResampler timeline;
+ * timeline.configure(config.sampleRates, channels, 4800.0, ResamplerOptions());
+ * timeline.push(sampleNumbers, timestamps, frames, count);  // [sample][channel]
+ * timeline.finish();
+ * std::vector<double> out(4096 * channels);
+ * while (size_t n = timeline.pull(out.data(), 4096)) { use(out, n); }
+ * @endcode
+ */
+class TimelineResampler {
+public:
+    TimelineResampler();
+    ~TimelineResampler();
+
+    TimelineResampler(const TimelineResampler&) = delete;
+    TimelineResampler& operator=(const TimelineResampler&) = delete;
+
+    /**
+     * @brief Start a new recording
+     * @param rates Sample rate table of the .cfg
+     * @param channels Values per sample
+     * @param outputRate Output sample rate (Hz)
+     * @param options Filter for uniform runs; at rates within 0.1 Hz of the
+     *                output rate, runs on the output grid pass through
+     *                unfiltered and others are shifted onto it by the filter
+     * @return false if a filter cannot be designed
+     */
+    bool configure(const std::vector<SampleRate>& rates, size_t channels, double outputRate,
+                   const ResamplerOptions& options);
+
+    /**
+     * @brief Share the filtering of each batch with a pool's workers
+     * @param pool Pool that outlives the resampler (nullptr = caller thread only);
+     *             the calling thread computes a part too
+     */
+    void setThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+    /**
+     * @brief Time each channel's samples by its own offset (from the next configure())
+     * @param seconds Per value of a sample, how much later than the sample
+     *                time it was taken (empty or all zero = none)
+     */
+    void setChannelSkew(const std::vector<double>& seconds) { skew_ = seconds; }
+    const std::vector<double>& channelSkew() const { return skew_; }
+
+    /**
+     * @brief Append samples in .dat order
+     * @param sampleNumbers .dat sample numbers
+     * @param timestamps .dat timestamps (microseconds)
+     * @param frames count * channels values ([sample][channel])
+     * @param count Samples
+     */
+    void push(const int* sampleNumbers, const uint64_t* timestamps, const double* frames, size_t count);
+
+    /**
+     * @brief No more input: the last run ends with the last sample pushed
+     */
+    void finish();
+
+    /**
+     * @brief Take the next output samples the input so far determines
+     * @param out Output, up to maxCount * channels values ([sample][channel])
+     * @param maxCount Output samples wanted
+     * @return Samples written (0: more input needed, or done())
+     */
+    size_t pull(double* out, size_t maxCount);
+
+    /**
+     * @brief Finished and every output sample pulled
+     */
+    bool done() const { return finished_ && nextOutput_ >= endOutput_; }
+
+    uint64_t outputsPulled() const { return nextOutput_; }
+    uint64_t samplesPushed() const { return rowBase_ + times_.size() + report_.droppedSamples; }
+
+    /**
+     * @brief Output length (known after finish())
+     */
+    uint64_t totalOutputs() const { return endOutput_; }
+
+    /**
+     * @brief Filter used for uniform runs at a rate (nullptr if the table has no such rate)
+     */
+    const SampleResampler* resamplerFor(double rate) const;
+
+    double outputRate() const { return outputRate_; }
+    const TimelineReport& report() const { return report_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    struct Run {
+        uint64_t firstRow;      // Index (among samples kept) of the run's first sample
+        uint64_t rows;          // Samples in the run so far
+        double start;           // Time of the first sample (s after the first sample pushed)
+        double rate;            // Sample rate; 0 = timed by timestamps
+        uint64_t firstOutput;   // First output sample the run produces
+        double origin;          // Position of firstOutput, in samples from the run's first
+        SampleResampler* resampler;  // Shared by the runs at this rate (nullptr: rate 0)
+    };
+
+    struct RateFilter {
+        double rate;
+        std::unique_ptr<SampleResampler> resampler;
+        std::unique_ptr<SampleResampler> shifted;   // Pass-through rates: runs off the output grid
+    };
+
+    // A slower run resampled onto a faster run's grid, for the faster run's taps
+    struct Bridge {
+        double from;
+        double to;
+        std::unique_ptr<SampleResampler> resampler;
+    };
+
+    const RateFilter* findFilter(double rate) const;
+    SampleResampler* findBridge(double from, double to) const;
+    size_t readyOutputs(const Run& run, const Run* next, size_t maxCount);
+    void renderUniform(Run& run, size_t count, double* out);
+    void fillOutside(const Run& run, int64_t first, int64_t last, double* frames);
+    void bridgeRun(const Run& slower, SampleResampler& bridge, double time, size_t count, double* out);
+    bool interpolate(const Run& run, double time, double* out) const;
+    const Run* runAt(double time, const Run* except) const;
+    void renderTimed(size_t count, double* out);
+    void filter(const SampleResampler& resampler, const ResamplerInput& input, uint64_t first, size_t count,
+                double* out);
+    void sampleAt(double time, size_t& cursor, double* out) const;
+    double channelAt(double time, size_t channel, size_t cursor) const;
+    size_t rowAtOrBefore(double time) const;
+    void trimRows();
+
+    size_t channels_;
+    double outputRate_;
+    std::vector<RateFilter> filters_;  // One per rate of the table
+    std::vector<Bridge> bridges_;      // One per pair of rates of the table
+    std::unique_ptr<SampleClock> clock_;
+    double margin_;             // Longest filter reach before an output (s)
+    double reach_;              // Longest reach of a fill past a tap (s)
+    std::vector<double> skew_;  // Per channel sampling offsets (s)
+    bool skewed_;               // skew_ applies (one value per channel, not all zero)
+    double lead_;               // Furthest any channel reads past an output's time (s)
+
+    // Samples still read by outputs to come
+    std::vector<double> times_;     // [row] time (s after the first sample)
+    std::vector<double> frames_;    // [row][channel]
+    uint64_t rowBase_;              // Index of times_[0] among all samples kept
+    double firstTime_;              // Clock time of the first sample
+    double lastTime_;               // Time of the last sample
+    int64_t lastNumber_;            // Sample number of the last sample
+    size_t lastSegment_;
+
+    std::deque<Run> past_;          // Runs done with whose samples are still kept
+    std::deque<Run> runs_;          // runs_[0] produces the next output
+    bool firstRun_;                 // runs_[0] is the recording's first run (clamps at its start)
+    uint64_t nextOutput_;
+    uint64_t endOutput_;            // Output length (UINT64_MAX until finish())
+    bool finished_;
+
+    std::vector<double> grid_;      // Run samples at the run's spacing for one batch
+    std::vector<double> bridgeGrid_;  // Slower run samples read by a bridge
+    ThreadPool* pool_;
+    std::vector<ResamplerScratch> scratch_;  // One per part of a batch
+    TimelineReport report_;
+    std::string lastError_;
+};
+
+#endif // TIMELINE_RESAMPLER_H
@@ -0,0 +1,209 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+    #include <x86intrin.h>
+    #define TSC_CLOCK_X86 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define TSC_CLOCK_X86 1
+#endif
+
+/**
+ * @brief Per-frame build/send timing gathered in the transmission loops
+ */
+struct FrameTimingStats {
+    uint64_t frames = 0;
+    int64_t totalBuildNs = 0;   // Payload build + frame assembly
+    int64_t maxBuildNs = 0;
+    int64_t totalSendNs = 0;    // Socket send call
+    int64_t maxSendNs = 0;
+
+    void record(int64_t buildNs, int64_t sendNs) {
+        frames++;
+        totalBuildNs += buildNs;
+        totalSendNs += sendNs;
+        if (buildNs > maxBuildNs) maxBuildNs = buildNs;
+        if (sendNs > maxSendNs) maxSendNs = sendNs;
+    }
+
+    double getAverageBuildNs() const { return frames > 0 ? static_cast<double>(totalBuildNs) / frames : 0.0; }
+    double getAverageSendNs() const { return frames > 0 ? static_cast<double>(totalSendNs) / frames : 0.0; }
+};
+
+/**
+ * @brief Low-overhead clock for hot-path timestamps
+ *
+ * Reads the invariant TSC with rdtscp and converts ticks to steady_clock
+ * nanoseconds (CLOCK_MONOTONIC on Linux) using a calibrated slope. The
+ * anchor is refreshed every recalibration interval, so conversion error
+ * never accumulates and frequency estimates improve over longer baselines.
+ *
+ * Falls back to steady_clock when the CPU does not report an invariant TSC
+ * with rdtscp, or when calibration gives an implausible frequency.
+ *
+ * A re-anchor can land behind the last extrapolated reading (the old slope
+ * ran fast); readings are held at the latest one returned, so nowNs() never
+ * goes backwards and a difference of two readings is never negative. That
+ * latest reading is plain per-instance state, like the anchor.
+ *
+ * Not thread-safe: one instance per thread (the transmission loops each
+ * create their own), so nowNs() needs no atomics.
+ */
+class TscClock {
+public:
+    /**
+     * @brief Detect and calibrate the TSC
+     * @param calibrationNs Initial calibration window (blocks for this long)
+     * @param recalibrationNs Interval between anchor refreshes
+     */
+    explicit TscClock(int64_t calibrationNs = 5000000, int64_t recalibrationNs = 1000000000)
+        : useTsc_(false), nsPerTick_(0.0), baseTicks_(0), baseNs_(0),
+          recalibrationTicks_(0), recalibrationNs_(recalibrationNs), lastNs_(INT64_MIN) {
+        if (!hasInvariantTsc()) {
+            return;
+        }
+
+        uint64_t t0;
+        int64_t n0 = pairedRead(t0);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(calibrationNs));
+        uint64_t t1;
+        int64_t n1 = pairedRead(t1);
+
+        if (t1 <= t0 || n1 <= n0) {
+            return;
+        }
+        double nsPerTick = static_cast<double>(n1 - n0) / static_cast<double>(t1 - t0);
+
+        // Accept 100 MHz .. 10 GHz
+        if (nsPerTick < 0.1 || nsPerTick > 10.0) {
+            return;
+        }
+
+        nsPerTick_ = nsPerTick;
+        baseTicks_ = t1;
+        baseNs_ = n1;
+        recalibrationTicks_ = static_cast<uint64_t>(recalibrationNs_ / nsPerTick_);
+        useTsc_ = true;
+    }
+
+    /**
+     * @brief Current time in steady_clock nanoseconds
+     */
+    int64_t nowNs() {
+#ifdef TSC_CLOCK_X86
+        if (useTsc_) {
+            uint64_t ticks = readTsc();
+            uint64_t delta = ticks - baseTicks_;
+            if (delta >= recalibrationTicks_) {
+                // The fresh anchor is read after 'ticks', so it is the better timestamp
+                recalibrate();
+                return latest(baseNs_);
+            }
+            return latest(baseNs_ + static_cast<int64_t>(static_cast<double>(delta) * nsPerTick_));
+        }
+#endif
+        return steadyNs();
+    }
+
+    /**
+     * @brief Check if the TSC path is in use
+     */
+    bool usingTsc() const { return useTsc_; }
+
+    /**
+     * @brief Calibrated TSC frequency in Hz (0 when falling back)
+     */
+    double frequencyHz() const { return useTsc_ ? 1e9 / nsPerTick_ : 0.0; }
+
+    /**
+     * @brief Re-anchor to steady_clock and refine the frequency estimate
+     */
+    void recalibrate() {
+        if (!useTsc_) {
+            return;
+        }
+        uint64_t ticks;
+        int64_t ns = pairedRead(ticks);
+        if (ticks > baseTicks_ && ns > baseNs_) {
+            double measured = static_cast<double>(ns - baseNs_) / static_cast<double>(ticks - baseTicks_);
+            // Smooth so one preempted calibration read cannot swing the slope
+            if (measured > 0.1 && measured < 10.0) {
+                nsPerTick_ = 0.75 * nsPerTick_ + 0.25 * measured;
+            }
+        }
+        baseTicks_ = ticks;
+        baseNs_ = ns;
+        recalibrationTicks_ = static_cast<uint64_t>(recalibrationNs_ / nsPerTick_);
+    }
+
+private:
+    // Max of a reading and the readings returned before it
+    int64_t latest(int64_t ns) {
+        ns = std::max(ns, lastNs_);
+        lastNs_ = ns;
+        return ns;
+    }
+
+    static int64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#ifdef TSC_CLOCK_X86
+    static uint64_t readTsc() {
+        unsigned int aux;
+        return __rdtscp(&aux);
+    }
+#else
+    static uint64_t readTsc() { return 0; }
+#endif
+
+    // Reference read bracketed by two TSC reads; TSC midpoint pairs with it
+    static int64_t pairedRead(uint64_t& ticks) {
+        uint64_t before = readTsc();
+        int64_t ns = steadyNs();
+        uint64_t after = readTsc();
+        ticks = before + (after - before) / 2;
+        return ns;
+    }
+
+    static bool hasInvariantTsc() {
+#if defined(TSC_CLOCK_X86) && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0x80000000);
+        if (static_cast<unsigned int>(regs[0]) < 0x80000007u) return false;
+        __cpuid(regs, 0x80000001);
+        bool rdtscp = (regs[3] & (1 << 27)) != 0;
+        __cpuid(regs, 0x80000007);
+        bool invariant = (regs[3] & (1 << 8)) != 0;
+        return rdtscp && invariant;
+#elif defined(TSC_CLOCK_X86)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u) return false;
+        __get_cpuid(0x80000001u, &eax, &ebx, &ecx, &edx);
+        bool rdtscp = (edx & (1u << 27)) != 0;
+        __get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx);
+        bool invariant = (edx & (1u << 8)) != 0;
+        return rdtscp && invariant;
+#else
+        return false;
+#endif
+    }
+
+    bool useTsc_;
+    double nsPerTick_;
+    uint64_t baseTicks_;
+    int64_t baseNs_;
+    uint64_t recalibrationTicks_;
+    int64_t recalibrationNs_;
+    int64_t lastNs_;  // Latest reading returned (TSC path)
+};
+
+#endif // TSC_CLOCK_H
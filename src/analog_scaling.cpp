@@ -0,0 +1,220 @@
+#include "analog_scaling.h"
+#include "comtrade_parser.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <immintrin.h>
+    #define ANALOG_SCALING_X86 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define TARGET_SSE41
+        #define TARGET_AVX2
+    #else
+        #define TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+AnalogScale AnalogScale::forChannel(const AnalogChannel& channel) {
+    AnalogScale scale;
+    scale.a = channel.a;
+    scale.b = channel.b;
+    // Apply CT/PT ratio to get primary values
+    scale.ratio = (channel.secondary != 0.0) ? (channel.primary / channel.secondary) : 1.0;
+    return scale;
+}
+
+namespace {
+
+template <typename In, typename Out>
+void scaleScalar(const In* raw, size_t count, const AnalogScale& scale, Out* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<Out>(scale.apply(static_cast<double>(raw[i])));
+    }
+}
+
+#ifdef ANALOG_SCALING_X86
+
+// Every kernel multiplies, adds and multiplies again in separate instructions
+// (same rounding as the scalar formula); int/float -> double conversion is exact
+
+// SSE4.1: two values per vector
+TARGET_SSE41 inline __m128d load2(const int16_t* raw) {
+    int32_t pair;
+    std::memcpy(&pair, raw, sizeof(pair));
+    return _mm_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_cvtsi32_si128(pair)));
+}
+
+TARGET_SSE41 inline __m128d load2(const int32_t* raw) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(raw)));
+}
+
+TARGET_SSE41 inline __m128d load2(const float* raw) {
+    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(raw))));
+}
+
+TARGET_SSE41 inline void store2(double* out, __m128d value) {
+    _mm_storeu_pd(out, value);
+}
+
+TARGET_SSE41 inline void store2(float* out, __m128d value) {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_castps_si128(_mm_cvtpd_ps(value)));
+}
+
+template <typename In, typename Out>
+TARGET_SSE41 void scaleSse41(const In* raw, size_t count, const AnalogScale& scale, Out* out) {
+    const __m128d a = _mm_set1_pd(scale.a);
+    const __m128d b = _mm_set1_pd(scale.b);
+    const __m128d ratio = _mm_set1_pd(scale.ratio);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d lo = load2(raw + i);
+        __m128d hi = load2(raw + i + 2);
+        store2(out + i, _mm_mul_pd(_mm_add_pd(_mm_mul_pd(a, lo), b), ratio));
+        store2(out + i + 2, _mm_mul_pd(_mm_add_pd(_mm_mul_pd(a, hi), b), ratio));
+    }
+    scaleScalar(raw + i, count - i, scale, out + i);
+}
+
+// AVX2: four values per vector
+TARGET_AVX2 inline __m256d load4(const int16_t* raw) {
+    return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(raw))));
+}
+
+TARGET_AVX2 inline __m256d load4(const int32_t* raw) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(raw)));
+}
+
+TARGET_AVX2 inline __m256d load4(const float* raw) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(raw));
+}
+
+TARGET_AVX2 inline void store4(double* out, __m256d value) {
+    _mm256_storeu_pd(out, value);
+}
+
+TARGET_AVX2 inline void store4(float* out, __m256d value) {
+    _mm_storeu_ps(out, _mm256_cvtpd_ps(value));
+}
+
+template <typename In, typename Out>
+TARGET_AVX2 void scaleAvx2(const In* raw, size_t count, const AnalogScale& scale, Out* out) {
+    const __m256d a = _mm256_set1_pd(scale.a);
+    const __m256d b = _mm256_set1_pd(scale.b);
+    const __m256d ratio = _mm256_set1_pd(scale.ratio);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d lo = load4(raw + i);
+        __m256d hi = load4(raw + i + 4);
+        store4(out + i, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(a, lo), b), ratio));
+        store4(out + i + 4, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(a, hi), b), ratio));
+    }
+    scaleScalar(raw + i, count - i, scale, out + i);
+}
+
+#endif // ANALOG_SCALING_X86
+
+SimdLevel detectLevel() {
+#if defined(ANALOG_SCALING_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 0);
+    int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    bool sse41 = (regs[2] & (1 << 19)) != 0;
+    bool osAvx = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 &&
+                 (_xgetbv(0) & 0x6) == 0x6;  // OS saves YMM state
+    bool avx2 = false;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        avx2 = (regs[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? SimdLevel::AVX2 : (sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar);
+#elif defined(ANALOG_SCALING_X86)
+    // Also checks OS support for the YMM state
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE41;
+    }
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+std::atomic<int> g_level(-1);
+
+template <typename In, typename Out>
+void dispatch(const In* raw, size_t count, const AnalogScale& scale, Out* out) {
+    switch (activeSimdLevel()) {
+#ifdef ANALOG_SCALING_X86
+        case SimdLevel::AVX2:
+            scaleAvx2(raw, count, scale, out);
+            return;
+        case SimdLevel::SSE41:
+            scaleSse41(raw, count, scale, out);
+            return;
+#endif
+        default:
+            scaleScalar(raw, count, scale, out);
+            return;
+    }
+}
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel detected = detectLevel();
+    return detected;
+}
+
+SimdLevel activeSimdLevel() {
+    int level = g_level.load(std::memory_order_relaxed);
+    if (level < 0) {
+        return detectSimdLevel();
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+void setSimdLevel(SimdLevel level) {
+    if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+        level = detectSimdLevel();
+    }
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:  return "AVX2";
+        case SimdLevel::SSE41: return "SSE4.1";
+        default:               return "scalar";
+    }
+}
+
+void scaleAnalog(const int16_t* raw, size_t count, const AnalogScale& scale, double* out) {
+    dispatch(raw, count, scale, out);
+}
+
+void scaleAnalog(const int32_t* raw, size_t count, const AnalogScale& scale, double* out) {
+    dispatch(raw, count, scale, out);
+}
+
+void scaleAnalog(const int16_t* raw, size_t count, const AnalogScale& scale, float* out) {
+    dispatch(raw, count, scale, out);
+}
+
+void scaleAnalog(const int32_t* raw, size_t count, const AnalogScale& scale, float* out) {
+    dispatch(raw, count, scale, out);
+}
+
+void scaleAnalog(const float* raw, size_t count, const AnalogScale& scale, double* out) {
+    dispatch(raw, count, scale, out);
+}
+
+void scaleAnalog(const float* raw, size_t count, const AnalogScale& scale, float* out) {
+    dispatch(raw, count, scale, out);
+}
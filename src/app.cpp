@@ -110,6 +110,20 @@ int run_phasor_injection(){
     config.verboseOutput = true;
     config.progressInterval = 1000;
     
+    // Sample timing: smpCnt=0 tied to the UTC second, following PTP/NTP
+    config.timing.reference = TimeReference::UTC;
+    
+    // Real-time profile (degrades gracefully without CAP_SYS_NICE/CAP_IPC_LOCK)
+    config.realtime.enabled = false;
+    config.realtime.policy = RealtimePolicy::Fifo;
+    config.realtime.txCpu = -1;
+    config.realtime.rxCpu = -1;
+    
+    // Offline run: write a pcap on a virtual clock instead of the interface
+    // config.outputFile = "phasor.pcap";
+    // config.virtualTime = true;
+    // config.durationSeconds = 600.0;
+    
     // Set phasors: [magnitude, phase_degrees]
     config.phasors[0][0] = 100.0;    config.phasors[0][1] = 0.0;      // IA
     config.phasors[1][0] = 100.0;    config.phasors[1][1] = -120.0;   // IB
@@ -143,6 +157,9 @@ int run_comtrade_replay(){
     config.appId = 0x4000;
     config.svId = "ComtradeReplay";
     config.sampleRate = 4800;
+    config.resampler.method = ResamplerMethod::Polyphase;  // Band-limited; Linear = straight lines
+    config.resampler.stopbandDb = 90.0;
+    config.compensateSkew = true;  // Align channels by the .cfg skew column
     
     // Channel mapping
     config.channelMapping = {
@@ -163,6 +180,28 @@ int run_comtrade_replay(){
     config.loopPlayback = false;
     config.startTimeOffset = 0.0;
     config.endTimeOffset = 0.0;
+    config.streaming = false;          // true: fixed memory for hour-long recordings
+    config.streamBlockSamples = 4096;
+    config.resampleBlockSamples = 4096; // Resampled while sending, this many samples at a time
+    config.resampleLookahead = 2;
+    config.resampleThreads = 1;        // Helpers beyond 1 are unpinned and compete with TX
+    config.useCache = false;           // true: reuse the parsed recording on later runs
+    config.cacheDir = "";              // Empty = next to the .cfg
+    config.useOutputCache = false;     // true: replay the stored SV output on later runs
+    
+    // Sample timing: smpCnt=0 tied to the UTC second, following PTP/NTP
+    config.timing.reference = TimeReference::UTC;
+    
+    // Real-time profile (degrades gracefully without CAP_SYS_NICE/CAP_IPC_LOCK)
+    config.realtime.enabled = false;
+    config.realtime.policy = RealtimePolicy::Fifo;
+    config.realtime.txCpu = -1;
+    config.realtime.rxCpu = -1;
+    
+    // Offline run: write a pcap on a virtual clock instead of the interface
+    // config.outputFile = "comtrade_replay.pcap";
+    // config.virtualTime = true;
+    // config.durationSeconds = 600.0;
     
     // Display configuration
     config.verboseOutput = true;
@@ -0,0 +1,1752 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cfloat>
+#include <algorithm>
+#include "comtrade_parser.h"
+#include "comtrade_recording.h"
+#include "comtrade_campaign.h"
+#include "thread_pool.h"
+#include "analog_scaling.h"
+#include "sample_resampler.h"
+#include "timeline_resampler.h"
+#include "resample_stage.h"
+#include "resampled_cache.h"
+
+#ifdef COMTRADE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Define M_PI if not defined (Windows)
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief COMTRADE loading benchmark
+ *
+ * Writes synthetic recordings (8 analog, 16 digital channels at 4800 Hz)
+ * to a scratch directory and times the loaders on them. Every variant is
+ * checked against a reference before its time is reported.
+ *
+ * Usage: comtrade_bench [records] [max threads] [scratch directory]
+ *        comtrade_bench ascii [megabytes] [max threads] [scratch directory]
+ *
+ * The ascii mode runs only the ASCII parse on a file of at least the given
+ * size (default 500 MB) and checks it against the 10x target over the
+ * previous loader.
+ */
+
+namespace {
+
+const int kNumAnalog = 8;
+const int kNumDigital = 16;
+const int kRepetitions = 3;
+
+// Channel gain (times channel number) of the synthetic recordings; the
+// storage benchmark's gain gives primary values a float cannot hold exactly
+const double kChannelGain = 0.01;
+const double kStorageChannelGain = 0.0123;
+
+// ASCII-only mode: default file size, and the speedup over the previous
+// loader that the parallel parser aims for
+const double kAsciiTargetMegabytes = 500.0;
+const double kAsciiTargetSpeedup = 10.0;
+
+// Files in the campaign loading benchmark, and runs of its shared budget
+// case (every one must load every file)
+const size_t kCampaignFiles = 8;
+const int kCampaignBudgetRuns = 20;
+
+// Resampling benchmark: output rate, and the largest polyphase error allowed
+// against the exact signal (fraction of its peak)
+const double kResampleOutputRate = 4800.0;
+const double kResampleTolerance = 1e-4;
+
+// Timeline benchmark: rate table segments (rates cycle through the list) and
+// the samples missing from one of them
+const size_t kTimelineSegments = 16;
+const double kTimelineRates[] = {1200.0, 4800.0, 1000.0, 9600.0};
+const size_t kTimelineGapMs = 5;
+
+// Resampling stage benchmark: output block size and blocks resampled ahead
+const size_t kStageBlockSamples = 4096;
+const size_t kStageLookahead = 2;
+const double kStageInputRate = 1000.0;
+
+// Output cache benchmark: the 4800 Hz bench recording replayed at this rate
+const double kOutputCacheRate = 4000.0;
+
+// Parallel resampling benchmark: a high-rate recording with many channels
+const size_t kParallelChannels = 24;
+const double kParallelInputRate = 9600.0;
+
+// Skew benchmark: channels of one multiplexed ADC, taken one after another
+// across each sample period
+const double kSkewInputRates[] = {1000.0, 997.0, 4800.0};
+
+// Scaling kernel timing: values per call, and the input span cycled through
+const size_t kScalingBlock = 256;
+const size_t kScalingWindow = 16384;
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Speedup column of a thread scaling row
+ *
+ * With a single hardware thread the workers only take turns on it, so the
+ * ratio of a multi-threaded run says nothing about scaling and is not shown.
+ */
+std::string scalingColumn(unsigned threads, double baselineMs, double ms) {
+    std::ostringstream column;
+    if (threads > 1 && ThreadPool::defaultThreadCount() < 2) {
+        column << "not measurable (1 hardware thread)";
+    } else {
+        column << std::fixed << std::setprecision(1) << std::setw(5) << baselineMs / ms << "x";
+    }
+    return column.str();
+}
+
+uint64_t fileBytes(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+/**
+ * @brief Write <prefix>.cfg for a synthetic recording
+ */
+bool writeConfig(const std::string& prefix, size_t numRecords, const char* format, double gain = kChannelGain) {
+    std::ofstream cfg(prefix + ".cfg");
+    if (!cfg.is_open()) {
+        return false;
+    }
+    cfg << "BENCH,DEV,1999\n";
+    cfg << (kNumAnalog + kNumDigital) << "," << kNumAnalog << "A," << kNumDigital << "D\n";
+    for (int i = 0; i < kNumAnalog; i++) {
+        cfg << (i + 1) << ",CH" << i << ",A,,A," << gain * (i + 1) << "," << 0.5 * i
+            << ",0,-32767,32767," << 100 * (i + 1) << "," << (1 + i % 3) << ",P\n";
+    }
+    for (int i = 0; i < kNumDigital; i++) {
+        cfg << (i + 1) << ",D" << i << ",,,0\n";
+    }
+    cfg << "50\n1\n4800," << numRecords << "\n";
+    cfg << "01/01/2020,00:00:00.000000\n01/01/2020,00:00:00.000000\n" << format << "\n1\n";
+    return cfg.good();
+}
+
+// Synthetic sample values: three-phase sine waves and slow digital toggles
+int16_t analogRaw(size_t record, int channel) {
+    double phase = 2.0 * M_PI * 50.0 * static_cast<double>(record) / 4800.0 - channel * 2.0944;
+    return static_cast<int16_t>(20000.0 * std::sin(phase));
+}
+
+int digitalState(size_t record, int channel) {
+    return static_cast<int>((record / (100 + 37 * channel)) & 1);
+}
+
+/**
+ * @brief Write <prefix>.cfg and an ASCII <prefix>.dat
+ */
+bool writeAsciiRecording(const std::string& prefix, size_t numRecords) {
+    if (!writeConfig(prefix, numRecords, "ASCII")) {
+        return false;
+    }
+
+    FILE* dat = std::fopen((prefix + ".dat").c_str(), "wb");
+    if (!dat) {
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(dat, buffer.data(), _IOFBF, buffer.size());
+    for (size_t r = 0; r < numRecords; r++) {
+        std::fprintf(dat, "%zu,%zu", r + 1, (r * 1000000) / 4800);
+        for (int i = 0; i < kNumAnalog; i++) {
+            std::fprintf(dat, ",%d", analogRaw(r, i));
+        }
+        for (int i = 0; i < kNumDigital; i++) {
+            std::fprintf(dat, ",%d", digitalState(r, i));
+        }
+        std::fputs("\r\n", dat);
+    }
+    return std::fclose(dat) == 0;
+}
+
+/**
+ * @brief Write <prefix>.cfg and a BINARY (16-bit) <prefix>.dat
+ */
+bool writeBinaryRecording(const std::string& prefix, size_t numRecords, double gain = kChannelGain) {
+    if (!writeConfig(prefix, numRecords, "BINARY", gain)) {
+        return false;
+    }
+
+    std::ofstream dat(prefix + ".dat", std::ios::binary);
+    if (!dat.is_open()) {
+        return false;
+    }
+    const int numWords = (kNumDigital + 15) / 16;
+    std::vector<uint8_t> record(8 + 2 * kNumAnalog + 2 * numWords);
+    for (size_t r = 0; r < numRecords; r++) {
+        uint32_t sampleNumber = static_cast<uint32_t>(r + 1);
+        uint32_t timestamp = static_cast<uint32_t>((r * 1000000) / 4800);
+        std::memcpy(&record[0], &sampleNumber, 4);
+        std::memcpy(&record[4], &timestamp, 4);
+        for (int i = 0; i < kNumAnalog; i++) {
+            int16_t raw = analogRaw(r, i);
+            std::memcpy(&record[8 + 2 * i], &raw, 2);
+        }
+        for (int w = 0; w < numWords; w++) {
+            uint16_t word = 0;
+            for (int b = 0; b < 16 && w * 16 + b < kNumDigital; b++) {
+                word |= static_cast<uint16_t>(digitalState(r, w * 16 + b) << b);
+            }
+            std::memcpy(&record[8 + 2 * kNumAnalog + 2 * w], &word, 2);
+        }
+        dat.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+    }
+    return dat.good();
+}
+
+/**
+ * @brief Best-of-N load() time
+ * @return Milliseconds, negative if loading failed
+ */
+double timeLoad(ComtradeParser& parser, const std::string& cfgPath, unsigned numThreads) {
+    ComtradeLoadOptions options;
+    options.numThreads = numThreads;
+    double bestMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!parser.load(cfgPath, "", options)) {
+            std::cerr << "Load failed: " << parser.getLastError() << std::endl;
+            return -1.0;
+        }
+        bestMs = std::min(bestMs, elapsedMs(start));
+    }
+    return bestMs;
+}
+
+bool sameRecording(const ComtradeRecording& a, const ComtradeRecording& b) {
+    size_t n = a.sampleCount();
+    if (n != b.sampleCount() || a.analogChannelCount() != b.analogChannelCount() ||
+        a.digitalChannelCount() != b.digitalChannelCount()) {
+        return false;
+    }
+    if (n == 0) {
+        return true;
+    }
+    // Reduced storage is compared through its double values
+    std::vector<double> bufferA;
+    std::vector<double> bufferB;
+    auto values = [n](const ComtradeRecording& r, int ch, std::vector<double>& buffer) {
+        if (r.analogStorage() == AnalogStorage::Double) {
+            return r.analog(ch);
+        }
+        buffer.resize(n);
+        r.analogColumn(ch).copyTo(buffer.data());
+        return static_cast<const double*>(buffer.data());
+    };
+    for (int ch = 0; ch < a.analogChannelCount(); ch++) {
+        if (std::memcmp(values(a, ch, bufferA), values(b, ch, bufferB), n * sizeof(double)) != 0) {
+            return false;
+        }
+    }
+    for (int ch = 0; ch < a.digitalChannelCount(); ch++) {
+        if (std::memcmp(a.digitalWords(ch), b.digitalWords(ch),
+                        ComtradeRecording::digitalWordCount(n) * sizeof(uint64_t)) != 0) {
+            return false;
+        }
+    }
+    return std::memcmp(a.timestamps(), b.timestamps(), n * sizeof(uint64_t)) == 0 &&
+           std::memcmp(a.sampleNumbers(), b.sampleNumbers(), n * sizeof(int)) == 0;
+}
+
+std::string trimField(const std::string& str) {
+    size_t start = 0;
+    size_t end = str.length();
+    while (start < end && std::isspace(static_cast<unsigned char>(str[start]))) {
+        start++;
+    }
+    while (end > start && std::isspace(static_cast<unsigned char>(str[end - 1]))) {
+        end--;
+    }
+    return str.substr(start, end - start);
+}
+
+/**
+ * @brief The previous ASCII loader: getline, stringstream split, stod/stoi
+ */
+bool legacyParseAscii(const std::string& datPath, const ComtradeConfig& config, ComtradeRecording& out) {
+    std::ifstream file(datPath);
+    if (!file.is_open()) {
+        return false;
+    }
+    int numAnalog = config.numAnalogChannels;
+    int numDigital = config.numDigitalChannels;
+    out.reset(numAnalog, numDigital);
+    std::vector<double> analogRow(numAnalog);
+    std::vector<uint8_t> digitalRow(numDigital);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<std::string> tokens;
+        std::stringstream ss(line);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            tokens.push_back(trimField(token));
+        }
+        if (tokens.size() < static_cast<size_t>(2 + numAnalog + numDigital)) {
+            continue;
+        }
+        try {
+            int sampleNumber = std::stoi(tokens[0]);
+            double time = std::stod(tokens[1]);
+            uint64_t timestamp = static_cast<uint64_t>(std::llround(time * config.timeFactor));  // Microseconds
+            for (int i = 0; i < numAnalog; i++) {
+                const AnalogChannel& channel = config.analogChannels[i];
+                double engSecondary = channel.a * std::stod(tokens[2 + i]) + channel.b;
+                double ratio = (channel.secondary != 0.0) ? (channel.primary / channel.secondary) : 1.0;
+                analogRow[i] = engSecondary * ratio;
+            }
+            for (int i = 0; i < numDigital; i++) {
+                digitalRow[i] = std::stoi(tokens[2 + numAnalog + i]) != 0 ? 1 : 0;
+            }
+            out.append(sampleNumber, timestamp, analogRow.data(), digitalRow.data());
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Records whose ASCII .dat file takes at least the given size
+ *
+ * Measured on a sample file; later records only get longer (wider sample
+ * numbers and timestamps), so the real file is never smaller.
+ */
+size_t asciiRecordsForMegabytes(const std::string& dir, double megabytes) {
+    const size_t sampleRecords = 10000;
+    std::string prefix = dir + "/bench_ascii_size";
+    if (!writeAsciiRecording(prefix, sampleRecords)) {
+        return 0;
+    }
+    double bytesPerRecord = static_cast<double>(fileBytes(prefix + ".dat")) / sampleRecords;
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return bytesPerRecord > 0.0 ? static_cast<size_t>(std::ceil(megabytes * 1e6 / bytesPerRecord)) : 0;
+}
+
+/**
+ * @brief ASCII .dat parsing: legacy loader vs. load() with 1..maxThreads workers
+ * @param targetSpeedup Report the best speedup against this target (0 = no target)
+ */
+bool benchAsciiParse(const std::string& dir, size_t numRecords, unsigned maxThreads, double targetSpeedup = 0.0) {
+    std::string prefix = dir + "/bench_ascii";
+    std::cout << "--- ASCII .dat parse (" << numRecords << " records) ---" << std::endl;
+    if (!writeAsciiRecording(prefix, numRecords)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+    double megabytes = static_cast<double>(fileBytes(prefix + ".dat")) / 1e6;
+
+    ComtradeParser reference;
+    if (!reference.loadConfig(prefix + ".cfg")) {
+        std::cerr << "Failed to parse config: " << reference.getLastError() << std::endl;
+        return false;
+    }
+    ComtradeRecording expected;
+    double legacyMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        legacyParseAscii(prefix + ".dat", reference.getConfig(), expected);
+        legacyMs = std::min(legacyMs, elapsedMs(start));
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  legacy      " << std::setw(8) << legacyMs << " ms  "
+              << std::setw(7) << megabytes / (legacyMs / 1000.0) << " MB/s" << std::endl;
+
+    bool identical = true;
+    double bestSpeedup = 0.0;
+    unsigned bestThreads = 1;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        ComtradeParser parser;
+        double bestMs = timeLoad(parser, prefix + ".cfg", threads);
+        if (bestMs < 0.0) {
+            return false;
+        }
+        bool same = sameRecording(parser.getRecording(), expected);
+        identical = identical && same;
+        std::cout << "  " << std::setw(2) << threads << " thread(s)" << std::setw(8) << bestMs << " ms  "
+                  << std::setw(7) << megabytes / (bestMs / 1000.0) << " MB/s  "
+                  << std::setw(5) << legacyMs / bestMs << "x" << (same ? "" : "  MISMATCH") << std::endl;
+        if (legacyMs / bestMs > bestSpeedup) {
+            bestSpeedup = legacyMs / bestMs;
+            bestThreads = threads;
+        }
+    }
+    if (targetSpeedup > 0.0) {
+        std::cout << "  target " << targetSpeedup << "x on " << megabytes << " MB: "
+                  << (bestSpeedup >= targetSpeedup ? "met" : "NOT met") << " (best " << bestSpeedup
+                  << "x with " << bestThreads << " thread(s))" << std::endl;
+    }
+
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return identical;
+}
+
+/**
+ * @brief BINARY .dat decoding: scaling of load() from 1 to maxThreads workers
+ */
+bool benchBinaryDecode(const std::string& dir, size_t numRecords, unsigned maxThreads) {
+    std::string prefix = dir + "/bench_binary";
+    std::cout << "--- BINARY .dat decode (" << numRecords << " records) ---" << std::endl;
+    if (!writeBinaryRecording(prefix, numRecords)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+    double megabytes = static_cast<double>(fileBytes(prefix + ".dat")) / 1e6;
+
+    // Single-threaded decoding is the reference
+    ComtradeParser reference;
+    double singleMs = timeLoad(reference, prefix + ".cfg", 1);
+    if (singleMs < 0.0) {
+        return false;
+    }
+
+    bool identical = true;
+    std::cout << std::fixed << std::setprecision(1);
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        ComtradeParser parser;
+        double bestMs = threads == 1 ? singleMs : timeLoad(parser, prefix + ".cfg", threads);
+        if (bestMs < 0.0) {
+            return false;
+        }
+        bool same = threads == 1 || sameRecording(parser.getRecording(), reference.getRecording());
+        identical = identical && same;
+        std::cout << "  " << std::setw(2) << threads << " thread(s)" << std::setw(8) << bestMs << " ms  "
+                  << std::setw(7) << megabytes / (bestMs / 1000.0) << " MB/s  "
+                  << scalingColumn(threads, singleMs, bestMs) << (same ? "" : "  MISMATCH") << std::endl;
+    }
+
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return identical;
+}
+
+/**
+ * @brief Analog storage modes: load time, memory, and values against Double
+ */
+bool benchStorage(const std::string& dir, size_t numRecords) {
+    std::string prefix = dir + "/bench_storage";
+    std::cout << "--- Analog storage (" << numRecords << " BINARY records) ---" << std::endl;
+    if (!writeBinaryRecording(prefix, numRecords, kStorageChannelGain)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+
+    ComtradeParser reference;
+    if (timeLoad(reference, prefix + ".cfg", 0) < 0.0) {
+        return false;
+    }
+    const ComtradeRecording& expected = reference.getRecording();
+    size_t doubleBytes = expected.memoryBytes();
+
+    struct Mode {
+        const char* name;
+        SampleStorage storage;
+        uint64_t budget;
+        bool exact;  // Values must match Double bit for bit (else: be rounded, within FLT_EPSILON)
+    };
+    const Mode modes[] = {
+        {"double", SampleStorage::Double, 0, true},
+        {"float", SampleStorage::Float, 0, false},
+        {"raw", SampleStorage::Raw, 0, true},
+        {"auto", SampleStorage::Auto, 0, true},
+        {"prefer double, 60%", SampleStorage::PreferDouble, doubleBytes * 6 / 10, true},
+    };
+
+    bool ok = true;
+    std::vector<double> values(numRecords);
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Mode& mode : modes) {
+        ComtradeLoadOptions options;
+        options.storage = mode.storage;
+        options.memoryBudget = mode.budget;
+        ComtradeParser parser;
+        double bestMs = 1e300;
+        for (int rep = 0; rep < kRepetitions; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!parser.load(prefix + ".cfg", "", options)) {
+                std::cerr << "Load failed: " << parser.getLastError() << std::endl;
+                return false;
+            }
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+
+        // Largest relative deviation from the double values
+        const ComtradeRecording& recording = parser.getRecording();
+        double maxError = 0.0;
+        bool identical = true;
+        for (int ch = 0; ch < recording.analogChannelCount(); ch++) {
+            recording.analogColumn(ch).copyTo(values.data());
+            const double* want = expected.analog(ch);
+            identical = identical && std::memcmp(values.data(), want, numRecords * sizeof(double)) == 0;
+            for (size_t i = 0; i < numRecords; i++) {
+                if (want[i] != 0.0) {
+                    maxError = std::max(maxError, std::abs(values[i] - want[i]) / std::abs(want[i]));
+                }
+            }
+        }
+        bool pass = mode.exact ? identical : maxError > 0.0 && maxError <= FLT_EPSILON;
+        ok = ok && pass;
+        std::cout << "  " << std::left << std::setw(19) << mode.name << std::right
+                  << std::setw(8) << bestMs << " ms  "
+                  << std::setw(7) << static_cast<double>(recording.memoryBytes()) / 1e6 << " MB  ";
+        if (identical) {
+            std::cout << "exact";
+        } else {
+            std::cout << "max rel. error " << std::scientific << maxError << std::fixed;
+        }
+        std::cout << (pass ? "" : "  MISMATCH") << std::endl;
+    }
+
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return ok;
+}
+
+/**
+ * @brief Campaign loading: files one at a time vs. concurrently, and under a shared memory budget
+ */
+bool benchCampaign(const std::string& dir, size_t numRecords, unsigned maxThreads) {
+    size_t fileRecords = std::max<size_t>(numRecords / kCampaignFiles, 1000);
+    std::cout << "--- Campaign of " << kCampaignFiles << " files (" << fileRecords
+              << " records each, BINARY and ASCII) ---" << std::endl;
+
+    std::vector<std::string> cfgPaths;
+    for (size_t i = 0; i < kCampaignFiles; i++) {
+        std::string prefix = dir + "/bench_campaign" + std::to_string(i);
+        if (!(i % 2 == 0 ? writeBinaryRecording(prefix, fileRecords) : writeAsciiRecording(prefix, fileRecords))) {
+            std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+            return false;
+        }
+        cfgPaths.push_back(prefix + ".cfg");
+    }
+
+    // Reference: one parser after the other, each using every thread
+    std::vector<ComtradeParser> reference(kCampaignFiles);
+    double sequentialMs = 1e300;
+    uint64_t totalBytes = 0;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        totalBytes = 0;
+        for (size_t i = 0; i < kCampaignFiles; i++) {
+            if (!reference[i].load(cfgPaths[i])) {
+                std::cerr << "Load failed: " << reference[i].getLastError() << std::endl;
+                return false;
+            }
+            totalBytes += reference[i].getRecording().memoryBytes();
+        }
+        sequentialMs = std::min(sequentialMs, elapsedMs(start));
+    }
+
+    auto runCampaign = [&](const ComtradeCampaignOptions& options, int repetitions, double& bestMs,
+                           size_t& rawFiles) {
+        bool same = true;
+        bestMs = 1e300;
+        for (int rep = 0; rep < repetitions; rep++) {
+            ComtradeCampaignLoader loader(options);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<ComtradeCampaignResult> results = loader.loadAll(cfgPaths);
+            bestMs = std::min(bestMs, elapsedMs(start));
+            rawFiles = 0;
+            for (size_t i = 0; i < results.size(); i++) {
+                if (!results[i].ok) {
+                    std::cerr << "Load failed: " << results[i].cfgPath << ": " << results[i].error << std::endl;
+                    return false;
+                }
+                const ComtradeRecording& recording = results[i].parser->getRecording();
+                rawFiles += recording.analogIsRaw() ? 1 : 0;
+                same = same && sameRecording(recording, reference[i].getRecording());
+            }
+        }
+        return same;
+    };
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  one at a time  " << std::setw(8) << sequentialMs << " ms" << std::endl;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        ComtradeCampaignOptions options;
+        options.numThreads = threads;
+        double bestMs;
+        size_t rawFiles;
+        bool same = runCampaign(options, kRepetitions, bestMs, rawFiles);
+        ok = ok && same;
+        std::cout << "  " << std::setw(2) << threads << " thread(s)   " << std::setw(8) << bestMs << " ms  "
+                  << scalingColumn(threads, sequentialMs, bestMs) << (same ? "" : "  MISMATCH") << std::endl;
+    }
+
+    // A shared budget below the double size: PreferDouble keeps later files
+    // raw. Which files still get doubles depends on the order the loads run
+    // in, so the case is repeated and every run must load every file
+    ComtradeCampaignOptions options;
+    options.numThreads = maxThreads;
+    options.memoryBudget = totalBytes * 6 / 10;
+    options.load.storage = SampleStorage::PreferDouble;
+    double budgetMs = 1e300;
+    size_t fewestRaw = kCampaignFiles;
+    size_t mostRaw = 0;
+    int passed = 0;
+    for (int run = 0; run < kCampaignBudgetRuns; run++) {
+        double runMs;
+        size_t rawFiles = 0;
+        if (runCampaign(options, 1, runMs, rawFiles)) {
+            passed++;
+            budgetMs = std::min(budgetMs, runMs);
+            fewestRaw = std::min(fewestRaw, rawFiles);
+            mostRaw = std::max(mostRaw, rawFiles);
+        }
+    }
+    bool same = passed == kCampaignBudgetRuns;
+    ok = ok && same;
+    std::cout << "  budget " << static_cast<double>(options.memoryBudget) / 1e6 << " MB ("
+              << static_cast<double>(totalBytes) / 1e6 << " MB as double)  " << budgetMs << " ms  "
+              << fewestRaw << "-" << mostRaw << " of " << kCampaignFiles << " files raw, " << passed << " of "
+              << kCampaignBudgetRuns << " runs" << (same ? "" : "  MISMATCH") << std::endl;
+
+    for (const auto& cfgPath : cfgPaths) {
+        std::remove(cfgPath.c_str());
+        std::remove(ComtradeParser::datPathFor(cfgPath).c_str());
+    }
+    return ok;
+}
+
+/**
+ * @brief Time-window loads: a 200 ms window from the middle vs. the whole file
+ */
+bool benchTimeWindow(const std::string& dir, size_t numRecords) {
+    std::string prefix = dir + "/bench_window";
+    std::cout << "--- 200 ms time window (" << numRecords << " records) ---" << std::endl;
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int binary = 1; binary >= 0; binary--) {
+        if (!(binary ? writeBinaryRecording(prefix, numRecords) : writeAsciiRecording(prefix, numRecords))) {
+            std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+            return false;
+        }
+
+        ComtradeParser whole;
+        double wholeMs = timeLoad(whole, prefix + ".cfg", 0);
+        if (wholeMs < 0.0) {
+            return false;
+        }
+
+        // Window from the rate table: the same rows as the whole recording
+        ComtradeLoadOptions options;
+        options.startTime = static_cast<double>(numRecords / 2) / 4800.0;
+        options.endTime = options.startTime + 0.2;
+        ComtradeParser parser;
+        double windowMs = 1e300;
+        for (int rep = 0; rep < kRepetitions; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!parser.load(prefix + ".cfg", "", options)) {
+                std::cerr << "Load failed: " << parser.getLastError() << std::endl;
+                return false;
+            }
+            windowMs = std::min(windowMs, elapsedMs(start));
+        }
+
+        const ComtradeRecording& window = parser.getRecording();
+        const ComtradeRecording& expected = whole.getRecording();
+        size_t first = static_cast<size_t>(parser.getWindowStart());
+        bool same = first == numRecords / 2 && window.sampleCount() == std::min<size_t>(960, numRecords - first);
+        for (size_t i = 0; same && i < window.sampleCount(); i++) {
+            same = window.timestamps()[i] == expected.timestamps()[first + i];
+            for (int ch = 0; same && ch < window.analogChannelCount(); ch++) {
+                same = window.analogValue(ch, i) == expected.analogValue(ch, first + i);
+            }
+        }
+        ok = ok && same;
+        std::cout << "  " << (binary ? "BINARY" : "ASCII ") << "  whole " << std::setw(8) << wholeMs << " ms  window "
+                  << std::setw(6) << windowMs << " ms (" << window.sampleCount() << " samples)  "
+                  << std::setw(7) << std::setprecision(0) << wholeMs / windowMs << "x" << std::setprecision(2)
+                  << (same ? "" : "  MISMATCH") << std::endl;
+
+        std::remove((prefix + ".cfg").c_str());
+        std::remove((prefix + ".dat").c_str());
+    }
+    return ok;
+}
+
+/**
+ * @brief Digital state changes: per-sample scan of the planes vs. the edge index
+ */
+bool benchDigitalEdges(const std::string& dir, size_t numRecords) {
+    std::string prefix = dir + "/bench_digital";
+    std::cout << "--- Digital edges (" << numRecords << " BINARY records) ---" << std::endl;
+    if (!writeBinaryRecording(prefix, numRecords)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+
+    ComtradeParser parser;
+    if (timeLoad(parser, prefix + ".cfg", 0) < 0.0) {
+        return false;
+    }
+    const ComtradeRecording& recording = parser.getRecording();
+
+    // Reference: compare every sample with the one before it
+    std::vector<DigitalEdge> scanned;
+    double scanMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        scanned.clear();
+        for (size_t i = 1; i < numRecords; i++) {
+            for (int ch = 0; ch < recording.digitalChannelCount(); ch++) {
+                bool state = recording.digitalState(ch, i);
+                if (state != recording.digitalState(ch, i - 1)) {
+                    scanned.push_back(DigitalEdge{i, ch, state});
+                }
+            }
+        }
+        scanMs = std::min(scanMs, elapsedMs(start));
+    }
+
+    // Same walk over the index (as a consumer would: count changes per channel)
+    std::vector<size_t> changes(recording.digitalChannelCount());
+    double indexMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        std::fill(changes.begin(), changes.end(), 0);
+        for (const DigitalEdge& edge : recording.digitalEdges()) {
+            changes[edge.channel]++;
+        }
+        indexMs = std::min(indexMs, elapsedMs(start));
+    }
+
+    const std::vector<DigitalEdge>& edges = recording.digitalEdges();
+    bool same = scanned.size() == edges.size();
+    for (size_t i = 0; same && i < edges.size(); i++) {
+        same = scanned[i].sample == edges[i].sample && scanned[i].channel == edges[i].channel &&
+               scanned[i].state == edges[i].state;
+    }
+
+    size_t planeBytes = recording.digitalChannelCount() * ComtradeRecording::digitalWordCount(numRecords) *
+                        sizeof(uint64_t);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  planes      " << std::setw(8) << static_cast<double>(planeBytes) / 1e6 << " MB  (byte per sample: "
+              << static_cast<double>(recording.digitalChannelCount() * numRecords) / 1e6 << " MB)" << std::endl;
+    std::cout << "  scan        " << std::setw(8) << scanMs << " ms" << std::endl;
+    std::cout << "  edge index  " << std::setw(8) << indexMs << " ms  (" << edges.size() << " edges)"
+              << (same ? "" : "  MISMATCH") << std::endl;
+
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return same;
+}
+
+/**
+ * @brief Compressed .dat: plain file vs. .dat.gz decoded while a background thread inflates it
+ */
+bool benchCompressed(const std::string& dir, size_t numRecords) {
+    std::cout << "--- Compressed .dat (" << numRecords << " records) ---" << std::endl;
+#ifndef COMTRADE_HAVE_ZLIB
+    std::cout << "  skipped: built without zlib" << std::endl;
+    return true;
+#else
+    std::string prefix = dir + "/bench_compressed";
+    std::string datPath = prefix + ".dat";
+    std::string gzPath = datPath + ".gz";
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int binary = 1; binary >= 0; binary--) {
+        if (!(binary ? writeBinaryRecording(prefix, numRecords) : writeAsciiRecording(prefix, numRecords))) {
+            std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+            return false;
+        }
+
+        // Default gzip level, as an archive would be written
+        std::ifstream plain(datPath, std::ios::binary);
+        gzFile gz = gzopen(gzPath.c_str(), "wb6");
+        if (!gz) {
+            std::cerr << "Failed to write " << gzPath << std::endl;
+            return false;
+        }
+        std::vector<char> buffer(1 << 20);
+        while (plain.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || plain.gcount() > 0) {
+            gzwrite(gz, buffer.data(), static_cast<unsigned>(plain.gcount()));
+        }
+        if (gzclose(gz) != Z_OK) {
+            std::cerr << "Failed to write " << gzPath << std::endl;
+            return false;
+        }
+        plain.close();
+
+        ComtradeParser reference;
+        double plainMs = timeLoad(reference, prefix + ".cfg", 0);
+        if (plainMs < 0.0) {
+            return false;
+        }
+        uint64_t plainBytes = fileBytes(datPath);
+        uint64_t gzBytes = fileBytes(gzPath);
+
+        // Only the .dat.gz left: found by load() itself
+        std::remove(datPath.c_str());
+        ComtradeParser parser;
+        double gzMs = timeLoad(parser, prefix + ".cfg", 0);
+        if (gzMs < 0.0) {
+            return false;
+        }
+
+        bool same = sameRecording(parser.getRecording(), reference.getRecording());
+        ok = ok && same;
+        std::cout << "  " << (binary ? "BINARY" : "ASCII ") << "  .dat " << std::setw(7) << plainBytes / 1e6
+                  << " MB " << std::setw(8) << plainMs << " ms   .dat.gz " << std::setw(6) << gzBytes / 1e6
+                  << " MB " << std::setw(8) << gzMs << " ms   " << std::setprecision(1)
+                  << static_cast<double>(plainBytes) / static_cast<double>(gzBytes) << "x fewer bytes read"
+                  << std::setprecision(2) << (same ? "" : "  MISMATCH") << std::endl;
+
+        std::remove((prefix + ".cfg").c_str());
+        std::remove(gzPath.c_str());
+    }
+    return ok;
+#endif
+}
+
+/**
+ * @brief Parsed-recording cache: full ASCII parse vs. first (writing) and later (hit) loads
+ */
+bool benchCache(const std::string& dir, size_t numRecords) {
+    std::string prefix = dir + "/bench_cache";
+    std::cout << "--- Recording cache (" << numRecords << " ASCII records) ---" << std::endl;
+    if (!writeAsciiRecording(prefix, numRecords)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+
+    ComtradeParser reference;
+    double parseMs = timeLoad(reference, prefix + ".cfg", 0);
+    if (parseMs < 0.0) {
+        return false;
+    }
+
+    ComtradeLoadOptions options;
+    options.useCache = true;
+    options.cacheDir = dir;
+    ComtradeParser parser;
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = parser.load(prefix + ".cfg", "", options);
+    double missMs = elapsedMs(start);
+    ComtradeCacheReport firstLoad = parser.getCacheReport();
+
+    double hitMs = 1e300;
+    bool allHits = true;
+    for (int rep = 0; loaded && rep < kRepetitions; rep++) {
+        start = std::chrono::steady_clock::now();
+        loaded = parser.load(prefix + ".cfg", "", options);
+        hitMs = std::min(hitMs, elapsedMs(start));
+        allHits = allHits && parser.getCacheReport().result == CacheResult::Hit;
+    }
+    if (!loaded) {
+        std::cerr << "Load failed: " << parser.getLastError() << std::endl;
+        return false;
+    }
+    if (!firstLoad.written || !allHits) {
+        std::cerr << "Cache not used: " << firstLoad.detail << std::endl;
+        return false;
+    }
+    bool same = sameRecording(parser.getRecording(), reference.getRecording());
+
+    // Paranoid hits read the whole source again for the content hash
+    double paranoidMs = 1e300;
+    options.paranoidCache = true;
+    for (int rep = 0; loaded && rep < kRepetitions; rep++) {
+        start = std::chrono::steady_clock::now();
+        loaded = parser.load(prefix + ".cfg", "", options);
+        paranoidMs = std::min(paranoidMs, elapsedMs(start));
+        allHits = allHits && parser.getCacheReport().result == CacheResult::Hit;
+    }
+    if (!loaded || !allHits) {
+        std::cerr << "Paranoid load not a hit: " << parser.getCacheReport().detail << std::endl;
+        return false;
+    }
+    same = same && sameRecording(parser.getRecording(), reference.getRecording());
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  parse       " << std::setw(8) << parseMs << " ms" << std::endl;
+    std::cout << "  miss+write  " << std::setw(8) << missMs << " ms  ("
+              << static_cast<double>(fileBytes(firstLoad.path)) / 1e6 << " MB cache file)" << std::endl;
+    std::cout << "  hit         " << std::setw(8) << hitMs << " ms  "
+              << std::setw(7) << parseMs / hitMs << "x" << (same ? "" : "  MISMATCH") << std::endl;
+    std::cout << "  hit (paranoid)" << std::setw(6) << paranoidMs << " ms  "
+              << std::setw(7) << parseMs / paranoidMs << "x" << std::endl;
+
+    std::remove(firstLoad.path.c_str());
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return same;
+}
+
+// Resampling input: 50 Hz with a 7th harmonic (350 Hz, inside the passband
+// of every rate below), phase-shifted per channel
+double resampleSignal(double t, size_t channel) {
+    return 100.0 * std::sin(2.0 * M_PI * 50.0 * t + 0.5 * channel) +
+           20.0 * std::sin(2.0 * M_PI * 350.0 * t + 0.3 * channel);
+}
+
+bool benchResampleRate(double inputRate, size_t numOutput) {
+    const size_t channels = kNumAnalog;
+    size_t numInput = static_cast<size_t>(numOutput * inputRate / kResampleOutputRate) + 1;
+    std::vector<double> frames(numInput * channels);
+    for (size_t i = 0; i < numInput; i++) {
+        for (size_t ch = 0; ch < channels; ch++) {
+            frames[i * channels + ch] = resampleSignal(i / inputRate, ch);
+        }
+    }
+    ResamplerInput input;
+    input.frames = frames.data();
+    input.channels = channels;
+    input.count = numInput;
+    input.end = static_cast<int64_t>(numInput);
+
+    bool ok = true;
+    double linearMs = 0.0;
+    for (ResamplerMethod method : {ResamplerMethod::Linear, ResamplerMethod::Polyphase}) {
+        SampleResampler resampler;
+        ResamplerOptions options;
+        options.method = method;
+        if (!resampler.configure(inputRate, kResampleOutputRate, options)) {
+            std::cerr << resampler.getLastError() << std::endl;
+            return false;
+        }
+        size_t count = static_cast<size_t>(resampler.outputSamples(numInput));
+        std::vector<double> out(count * channels);
+        double bestMs = 1e300;
+        for (int rep = 0; rep < kRepetitions; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            resampler.process(input, 0, count, out.data());
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        if (method == ResamplerMethod::Linear) {
+            linearMs = bestMs;
+        }
+
+        // Reference: the signal itself at the output times (away from the
+        // edges, where the filter sees held samples), and the scalar kernel
+        double maxError = 0.0;
+        for (size_t n = count / 10; n < count - count / 10; n++) {
+            for (size_t ch = 0; ch < channels; ch++) {
+                double error = out[n * channels + ch] - resampleSignal(n / kResampleOutputRate, ch);
+                maxError = std::max(maxError, std::abs(error));
+            }
+        }
+        SimdLevel level = activeSimdLevel();
+        setSimdLevel(SimdLevel::Scalar);
+        std::vector<double> scalar(count * channels);
+        resampler.process(input, 0, count, scalar.data());
+        setSimdLevel(level);
+        bool same = std::memcmp(scalar.data(), out.data(), out.size() * sizeof(double)) == 0;
+        bool accurate = method == ResamplerMethod::Linear || maxError <= kResampleTolerance * 120.0;
+        ok = ok && same && accurate;
+
+        const ResamplerSpec& spec = resampler.spec();
+        std::ostringstream filter;
+        if (method == ResamplerMethod::Linear) {
+            filter << "2 taps";
+        } else {
+            filter << spec.taps << " taps x " << spec.phases << (spec.rational ? " (L/M " : " (table");
+            if (spec.rational) {
+                filter << spec.up << "/" << spec.down;
+            }
+            filter << ")";
+        }
+        std::cout << "  " << std::setw(6) << std::setprecision(0) << inputRate << " Hz  " << std::left
+                  << std::setw(10) << resamplerMethodName(method) << std::setw(24) << filter.str() << std::right
+                  << std::setprecision(1) << std::setw(8) << bestMs << " ms  " << std::setw(6)
+                  << count * channels / (bestMs * 1000.0) << " M/s  " << std::setw(5) << bestMs / linearMs
+                  << "x linear  error " << std::setw(6) << std::setprecision(1)
+                  << 20.0 * std::log10(std::max(maxError, 1e-12) / 120.0) << " dB"
+                  << (same ? "" : "  SIMD MISMATCH") << (accurate ? "" : "  INACCURATE") << std::endl;
+    }
+    return ok;
+}
+
+/**
+ * @brief Rate conversion to 4800 Hz: linear interpolation against the polyphase filter
+ *
+ * Error is the peak deviation from the exact signal, relative to its peak;
+ * linear interpolation is reported, the polyphase filter must stay within
+ * kResampleTolerance and give the same bits on every SIMD level.
+ */
+bool benchResampling(size_t numOutput) {
+    std::cout << "--- Resampling to " << static_cast<int>(kResampleOutputRate) << " Hz (" << numOutput << " output samples x "
+              << kNumAnalog << " channels, " << simdLevelName(activeSimdLevel()) << ") ---" << std::endl;
+    std::cout << std::fixed;
+    bool ok = benchResampleRate(1000.0, numOutput);   // Rational: 24/5
+    ok = benchResampleRate(997.0, numOutput) && ok;   // Arbitrary: interpolated table
+    ok = benchResampleRate(9600.0, numOutput) && ok;  // Decimation: 1/2
+    return ok;
+}
+
+template <typename Raw, typename Out>
+bool benchScalingKernel(const char* label, const std::vector<Raw>& raw, const AnalogScale& scale) {
+    // Reference: the scalar formula, value by value
+    std::vector<Out> expected(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+        expected[i] = static_cast<Out>(scale.apply(static_cast<double>(raw[i])));
+    }
+
+    bool identical = true;
+    std::vector<Out> out(raw.size());
+    double scalarMs = 0.0;
+    for (int level = 0; level <= static_cast<int>(detectSimdLevel()); level++) {
+        setSimdLevel(static_cast<SimdLevel>(level));
+        scaleAnalog(raw.data(), raw.size(), scale, out.data());
+        bool same = std::memcmp(out.data(), expected.data(), out.size() * sizeof(Out)) == 0;
+        identical = identical && same;
+
+        // Timed on a cache-resident block, as in the decoder, so memory
+        // bandwidth does not hide the kernel
+        double bestMs = 1e300;
+        for (int rep = 0; rep < kRepetitions; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t first = 0; first + kScalingBlock <= raw.size(); first += kScalingBlock) {
+                scaleAnalog(raw.data() + std::min(first % kScalingWindow, raw.size() - kScalingBlock),
+                            kScalingBlock, scale, out.data());
+            }
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        if (level == 0) {
+            scalarMs = bestMs;
+        }
+        std::cout << "  " << std::left << std::setw(16) << label << std::setw(7)
+                  << simdLevelName(static_cast<SimdLevel>(level)) << std::right
+                  << std::setw(8) << bestMs << " ms  "
+                  << std::setw(7) << static_cast<double>(raw.size()) / (bestMs * 1000.0) << " M/s  "
+                  << std::setw(5) << scalarMs / bestMs << "x" << (same ? "" : "  MISMATCH") << std::endl;
+    }
+    setSimdLevel(detectSimdLevel());
+    return identical;
+}
+
+/**
+ * @brief Analog scaling kernels: every SIMD level against the scalar formula
+ */
+bool benchAnalogScaling(size_t numValues) {
+    std::cout << "--- Analog scaling kernels (" << numValues << " values, CPU supports "
+              << simdLevelName(detectSimdLevel()) << ") ---" << std::endl;
+
+    // Full-range raw values and a CT ratio that does not fold exactly
+    AnalogScale scale;
+    scale.a = 0.0123456789;
+    scale.b = -0.37;
+    scale.ratio = 1200.0 / 5.0 / 3.0;
+    std::vector<int16_t> raw16(numValues);
+    std::vector<int32_t> raw32(numValues);
+    std::vector<float> rawFloat(numValues);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < numValues; i++) {
+        state = state * 1664525u + 1013904223u;
+        raw16[i] = static_cast<int16_t>(state >> 16);
+        raw32[i] = static_cast<int32_t>(state);
+        rawFloat[i] = static_cast<float>(raw32[i]) / 65536.0f;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    bool ok = benchScalingKernel<int16_t, double>("int16 -> double", raw16, scale);
+    ok = benchScalingKernel<int32_t, double>("int32 -> double", raw32, scale) && ok;
+    ok = benchScalingKernel<int16_t, float>("int16 -> float", raw16, scale) && ok;
+    ok = benchScalingKernel<int32_t, float>("int32 -> float", raw32, scale) && ok;
+    ok = benchScalingKernel<float, double>("float -> double", rawFloat, scale) && ok;
+    return ok;
+}
+
+// Sample time the way a lookup per sample finds it: walk the rate table
+// from the start until the segment holding the sample
+double tableSearchTime(const std::vector<SampleRate>& rates, int64_t number) {
+    double start = 0.0;
+    int64_t first = 1;
+    for (size_t i = 0; i < rates.size(); i++) {
+        if (number <= rates[i].endSample || i + 1 == rates.size()) {
+            return start + static_cast<double>(number - first) / rates[i].rate;
+        }
+        start += static_cast<double>(rates[i].endSample - first + 1) / rates[i].rate;
+        first = rates[i].endSample + 1;
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Resampling a multi-rate recording by sample time
+ *
+ * The rate table cycles through kTimelineRates and one segment misses
+ * kTimelineGapMs of samples. Sample times from SampleClock must equal a
+ * search of the table per sample; the output must be the same pushed whole
+ * or block by block, and within kResampleTolerance of the exact signal away
+ * from the gap, inside segments and at rate changes (where taps read the
+ * neighbouring segment resampled onto the run's grid) alike.
+ */
+bool benchTimeline(size_t numOutput) {
+    const size_t channels = kNumAnalog;
+    const size_t numRates = sizeof(kTimelineRates) / sizeof(kTimelineRates[0]);
+    const double duration = numOutput / kResampleOutputRate;
+    const double segmentSeconds = duration / kTimelineSegments;
+
+    // Rate table and samples: each segment starts where the previous one ends
+    std::vector<SampleRate> rates;
+    std::vector<double> boundaries;  // Segment start times
+    int64_t endSample = 0;
+    double start = 0.0;
+    for (size_t k = 0; k < kTimelineSegments; k++) {
+        double rate = kTimelineRates[k % numRates];
+        int64_t count = std::max<int64_t>(1, std::llround(segmentSeconds * rate));
+        endSample += count;
+        rates.push_back({rate, static_cast<int>(endSample)});
+        boundaries.push_back(start);
+        start += count / rate;
+    }
+    const size_t gapSegment = kTimelineSegments / 3;
+    const int64_t gapFirst = rates[gapSegment].endSample -
+                             std::llround(segmentSeconds * rates[gapSegment].rate / 2.0);
+    const int64_t gapCount = std::max<int64_t>(1, std::llround(kTimelineGapMs * 1e-3 * rates[gapSegment].rate));
+
+    std::vector<int64_t> allNumbers(static_cast<size_t>(endSample));
+    for (int64_t s = 1; s <= endSample; s++) {
+        allNumbers[static_cast<size_t>(s - 1)] = s;
+    }
+    std::cout << "--- Timeline resampling to " << static_cast<int>(kResampleOutputRate) << " Hz (" << endSample
+              << " samples in " << kTimelineSegments << " segments of " << static_cast<int>(kTimelineRates[2]) << "-"
+              << static_cast<int>(kTimelineRates[3]) << " Hz, " << gapCount << " missing) ---" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    // Sample times: one table search per sample against SampleClock
+    std::vector<double> searched(allNumbers.size());
+    double searchMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < allNumbers.size(); i++) {
+            searched[i] = tableSearchTime(rates, allNumbers[i]);
+        }
+        searchMs = std::min(searchMs, elapsedMs(startTime));
+    }
+    std::vector<double> clocked(allNumbers.size());
+    double clockMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        SampleClock clock(rates);
+        double rate;
+        size_t segment;
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < allNumbers.size(); i++) {
+            clocked[i] = clock.time(allNumbers[i], 0, rate, segment);
+        }
+        clockMs = std::min(clockMs, elapsedMs(startTime));
+    }
+    bool sameTimes = searched == clocked;
+    std::cout << "  Sample times: table search " << std::setw(7) << searchMs << " ms, SampleClock " << std::setw(7)
+              << clockMs << " ms (" << searchMs / clockMs << "x)" << (sameTimes ? "" : "  MISMATCH") << std::endl;
+
+    // The recording without the gap
+    std::vector<int> numbers;
+    std::vector<uint64_t> timestamps;
+    std::vector<double> frames;
+    for (size_t i = 0; i < allNumbers.size(); i++) {
+        int64_t number = allNumbers[i];
+        if (number >= gapFirst && number < gapFirst + gapCount) {
+            continue;
+        }
+        numbers.push_back(static_cast<int>(number));
+        timestamps.push_back(static_cast<uint64_t>(std::llround(searched[i] * 1e6)));
+        for (size_t ch = 0; ch < channels; ch++) {
+            frames.push_back(resampleSignal(searched[i], ch));
+        }
+    }
+    const double gapStart = tableSearchTime(rates, gapFirst);
+    const double gapEnd = tableSearchTime(rates, gapFirst + gapCount);
+
+    auto resample = [&](size_t block, std::vector<double>& out, TimelineResampler& timeline) {
+        out.clear();
+        std::vector<double> chunk(4096 * channels);
+        for (size_t first = 0; first < numbers.size(); first += block) {
+            size_t count = std::min(block, numbers.size() - first);
+            timeline.push(&numbers[first], &timestamps[first], &frames[first * channels], count);
+            while (size_t n = timeline.pull(chunk.data(), 4096)) {
+                out.insert(out.end(), chunk.begin(), chunk.begin() + n * channels);
+            }
+        }
+        timeline.finish();
+        while (size_t n = timeline.pull(chunk.data(), 4096)) {
+            out.insert(out.end(), chunk.begin(), chunk.begin() + n * channels);
+        }
+    };
+    TimelineResampler timeline;
+    if (!timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions())) {
+        std::cerr << timeline.getLastError() << std::endl;
+        return false;
+    }
+    std::vector<double> whole;
+    double bestMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions());
+        auto startTime = std::chrono::steady_clock::now();
+        resample(numbers.size(), whole, timeline);
+        bestMs = std::min(bestMs, elapsedMs(startTime));
+    }
+    const TimelineReport report = timeline.report();
+    std::vector<double> blocks;
+    timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions());
+    resample(4096, blocks, timeline);
+    bool sameBlocks = whole == blocks;
+
+    // Exact signal at the output times, away from the edges and the gap;
+    // near rate changes reported on their own
+    double reach = 0.0;
+    for (double rate : kTimelineRates) {
+        reach = std::max(reach, (timeline.resamplerFor(rate)->spec().taps + 4) / rate);
+    }
+    double insideError = 0.0;
+    double boundaryError = 0.0;
+    const size_t count = whole.size() / channels;
+    for (size_t n = 0; n < count; n++) {
+        double t = n / kResampleOutputRate;
+        if (t < reach || t > start - reach || (t > gapStart - reach && t < gapEnd + reach)) {
+            continue;
+        }
+        bool nearBoundary = false;
+        for (double boundary : boundaries) {
+            nearBoundary = nearBoundary || std::abs(t - boundary) < reach;
+        }
+        for (size_t ch = 0; ch < channels; ch++) {
+            double error = std::abs(whole[n * channels + ch] - resampleSignal(t, ch));
+            double& worst = nearBoundary ? boundaryError : insideError;
+            worst = std::max(worst, error);
+        }
+    }
+    bool accurate = insideError <= kResampleTolerance * 120.0 && boundaryError <= kResampleTolerance * 120.0;
+    std::cout << "  Timeline: " << std::setw(7) << bestMs << " ms, " << numbers.size() * channels / (bestMs * 1000.0)
+              << " M/s in, " << count << " samples out; " << report.runs << " runs, " << report.gaps << " gap"
+              << (sameBlocks ? ", 4096-sample blocks identical" : "  BLOCK MISMATCH") << std::endl;
+    std::cout << "  Error: " << 20.0 * std::log10(std::max(insideError, 1e-12) / 120.0) << " dB inside segments, "
+              << 20.0 * std::log10(std::max(boundaryError, 1e-12) / 120.0) << " dB at rate changes"
+              << (accurate ? "" : "  INACCURATE") << std::endl;
+    return sameTimes && sameBlocks && accurate;
+}
+
+/**
+ * @brief Timeline resampling of many channels: scaling from 1 to maxThreads threads
+ *
+ * Output is pulled in stage-sized blocks, each split between the threads;
+ * every thread count must give the bits of the single-threaded run.
+ */
+bool benchParallelResampling(size_t numOutput, unsigned maxThreads) {
+    const size_t channels = kParallelChannels;
+    const size_t numInput = static_cast<size_t>(numOutput * kParallelInputRate / kResampleOutputRate) + 1;
+    const std::vector<SampleRate> rates = {{kParallelInputRate, static_cast<int>(numInput)}};
+    std::vector<int> numbers(numInput);
+    std::vector<uint64_t> timestamps(numInput);
+    std::vector<double> frames(numInput * channels);
+    for (size_t i = 0; i < numInput; i++) {
+        numbers[i] = static_cast<int>(i + 1);
+        timestamps[i] = static_cast<uint64_t>(std::llround(i * 1e6 / kParallelInputRate));
+        for (size_t ch = 0; ch < channels; ch++) {
+            frames[i * channels + ch] = resampleSignal(i / kParallelInputRate, ch);
+        }
+    }
+    std::cout << "--- Parallel resampling " << static_cast<int>(kParallelInputRate) << " -> "
+              << static_cast<int>(kResampleOutputRate) << " Hz (" << numInput << " samples x " << channels
+              << " channels, " << kStageBlockSamples << "-sample blocks) ---" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::vector<double> reference;
+    double singleMs = 0.0;
+    bool identical = true;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads - 1) : nullptr);
+        std::vector<double> out;
+        double bestMs = 1e300;
+        for (int rep = 0; rep < kRepetitions; rep++) {
+            TimelineResampler timeline;
+            if (!timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions())) {
+                std::cerr << timeline.getLastError() << std::endl;
+                return false;
+            }
+            timeline.setThreadPool(pool.get());
+            auto start = std::chrono::steady_clock::now();
+            timeline.push(numbers.data(), timestamps.data(), frames.data(), numInput);
+            timeline.finish();
+            out.resize(timeline.totalOutputs() * channels);
+            size_t count = 0;
+            while (size_t n = timeline.pull(out.data() + count * channels, kStageBlockSamples)) {
+                count += n;
+            }
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        if (threads == 1) {
+            reference = out;
+            singleMs = bestMs;
+        }
+        bool same = out == reference;
+        identical = identical && same;
+        std::cout << "  " << std::setw(2) << threads << " thread(s)" << std::setw(8) << bestMs << " ms  "
+                  << std::setw(7) << out.size() / (bestMs * 1000.0) << " M/s out  "
+                  << scalingColumn(threads, singleMs, bestMs) << (same ? "" : "  MISMATCH") << std::endl;
+    }
+    return identical;
+}
+
+/**
+ * @brief Skew compensation: accuracy and cost on top of resampling
+ *
+ * Channel c of the recording is taken c / channels of a sample period
+ * after the sample time. Compensated output must match the signal at the
+ * output times within kResampleTolerance (away from the edges); the error
+ * left without compensation is reported.
+ */
+bool benchSkew(size_t numOutput) {
+    const size_t channels = kNumAnalog;
+    std::cout << "--- Skew compensation to " << static_cast<int>(kResampleOutputRate) << " Hz (" << channels
+              << " channels multiplexed over one sample period) ---" << std::endl;
+    std::cout << std::fixed;
+    bool ok = true;
+    for (double inputRate : kSkewInputRates) {
+        const size_t numInput = static_cast<size_t>(numOutput * inputRate / kResampleOutputRate) + 1;
+        const std::vector<SampleRate> rates = {{inputRate, static_cast<int>(numInput)}};
+        std::vector<double> skew(channels);
+        for (size_t ch = 0; ch < channels; ch++) {
+            skew[ch] = static_cast<double>(ch) / (channels * inputRate);
+        }
+        std::vector<int> numbers(numInput);
+        std::vector<uint64_t> timestamps(numInput);
+        std::vector<double> frames(numInput * channels);
+        for (size_t i = 0; i < numInput; i++) {
+            numbers[i] = static_cast<int>(i + 1);
+            timestamps[i] = static_cast<uint64_t>(std::llround(i * 1e6 / inputRate));
+            for (size_t ch = 0; ch < channels; ch++) {
+                frames[i * channels + ch] = resampleSignal(i / inputRate + skew[ch], ch);
+            }
+        }
+
+        auto resample = [&](bool compensate, std::vector<double>& out) {
+            double bestMs = 1e300;
+            for (int rep = 0; rep < kRepetitions; rep++) {
+                TimelineResampler timeline;
+                timeline.setChannelSkew(compensate ? skew : std::vector<double>());
+                if (!timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions())) {
+                    std::cerr << timeline.getLastError() << std::endl;
+                    return -1.0;
+                }
+                auto start = std::chrono::steady_clock::now();
+                timeline.push(numbers.data(), timestamps.data(), frames.data(), numInput);
+                timeline.finish();
+                out.resize(timeline.totalOutputs() * channels);
+                out.resize(timeline.pull(out.data(), timeline.totalOutputs()) * channels);
+                bestMs = std::min(bestMs, elapsedMs(start));
+            }
+            return bestMs;
+        };
+        std::vector<double> plain;
+        std::vector<double> aligned;
+        double plainMs = resample(false, plain);
+        double alignedMs = resample(true, aligned);
+        if (plainMs < 0.0 || alignedMs < 0.0) {
+            return false;
+        }
+
+        const size_t count = aligned.size() / channels;
+        double plainError = 0.0;
+        double alignedError = 0.0;
+        for (size_t n = count / 10; n < count - count / 10; n++) {
+            for (size_t ch = 0; ch < channels; ch++) {
+                double exact = resampleSignal(n / kResampleOutputRate, ch);
+                plainError = std::max(plainError, std::abs(plain[n * channels + ch] - exact));
+                alignedError = std::max(alignedError, std::abs(aligned[n * channels + ch] - exact));
+            }
+        }
+        bool accurate = alignedError <= kResampleTolerance * 120.0;
+        ok = ok && accurate;
+        std::cout << "  " << std::setw(6) << std::setprecision(0) << inputRate << " Hz  skew up to " << std::setw(4)
+                  << skew.back() * 1e6 << " us  error " << std::setprecision(1) << std::setw(6)
+                  << 20.0 * std::log10(std::max(plainError, 1e-12) / 120.0) << " dB -> " << std::setw(6)
+                  << 20.0 * std::log10(std::max(alignedError, 1e-12) / 120.0) << " dB  " << std::setw(7)
+                  << alignedMs << " ms (" << std::setprecision(2) << alignedMs / plainMs << "x)"
+                  << (accurate ? "" : "  INACCURATE") << std::endl;
+    }
+    return ok;
+}
+
+/**
+ * @brief In-memory recording pushed to a ResampleStage a block at a time
+ */
+class BenchSource : public ResampleSource {
+public:
+    BenchSource(const std::vector<int>& numbers, const std::vector<uint64_t>& timestamps,
+                const std::vector<double>& frames, size_t channels)
+        : numbers_(numbers), timestamps_(timestamps), frames_(frames), channels_(channels), next_(0) {
+    }
+
+    bool rewind() override {
+        next_ = 0;
+        return true;
+    }
+
+    bool read(TimelineResampler& timeline) override {
+        if (next_ >= numbers_.size()) {
+            return false;
+        }
+        size_t count = std::min(kStageBlockSamples, numbers_.size() - next_);
+        timeline.push(&numbers_[next_], &timestamps_[next_], &frames_[next_ * channels_], count);
+        next_ += count;
+        return true;
+    }
+
+    std::string getLastError() const override { return std::string(); }
+
+private:
+    const std::vector<int>& numbers_;
+    const std::vector<uint64_t>& timestamps_;
+    const std::vector<double>& frames_;
+    size_t channels_;
+    size_t next_;
+};
+
+/**
+ * @brief Resampling everything before transmission against the streaming stage
+ *
+ * Upfront is the whole recording resampled and converted to INT32 before the
+ * first sample can go out; the stage hands out its first block after
+ * resampling that block only. Every block of the stage (a full pass, then a
+ * pass after rewinding part way through) must match the upfront output.
+ */
+bool benchStage(size_t numOutput) {
+    const size_t channels = kNumAnalog;
+    const size_t numInput = static_cast<size_t>(numOutput * kStageInputRate / kResampleOutputRate) + 1;
+    const std::vector<SampleRate> rates = {{kStageInputRate, static_cast<int>(numInput)}};
+    std::vector<int> numbers(numInput);
+    std::vector<uint64_t> timestamps(numInput);
+    std::vector<double> frames(numInput * channels);
+    for (size_t i = 0; i < numInput; i++) {
+        numbers[i] = static_cast<int>(i + 1);
+        timestamps[i] = static_cast<uint64_t>(std::llround(i * 1e6 / kStageInputRate));
+        for (size_t ch = 0; ch < channels; ch++) {
+            frames[i * channels + ch] = 1000.0 * resampleSignal(i / kStageInputRate, ch);
+        }
+    }
+    std::cout << "--- Resampling stage " << static_cast<int>(kStageInputRate) << " -> "
+              << static_cast<int>(kResampleOutputRate) << " Hz (" << numInput << " samples x " << channels
+              << " channels, " << kStageBlockSamples << "-sample blocks, " << kStageLookahead << " ahead) ---"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    // Upfront: the whole output, per channel, before transmission starts
+    std::vector<std::vector<int32_t>> upfront;
+    double upfrontMs = 1e300;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        TimelineResampler timeline;
+        if (!timeline.configure(rates, channels, kResampleOutputRate, ResamplerOptions())) {
+            std::cerr << timeline.getLastError() << std::endl;
+            return false;
+        }
+        timeline.push(numbers.data(), timestamps.data(), frames.data(), numInput);
+        timeline.finish();
+        std::vector<double> out(timeline.totalOutputs() * channels);
+        size_t count = timeline.pull(out.data(), timeline.totalOutputs());
+        upfront.assign(channels, std::vector<int32_t>(count));
+        for (size_t ch = 0; ch < channels; ch++) {
+            for (size_t i = 0; i < count; i++) {
+                upfront[ch][i] = static_cast<int32_t>(out[i * channels + ch]);
+            }
+        }
+        upfrontMs = std::min(upfrontMs, elapsedMs(start));
+    }
+    const size_t count = upfront[0].size();
+
+    // Stage: time to the first block, then the rest checked block by block
+    std::vector<int> svChannels(channels);
+    for (size_t ch = 0; ch < channels; ch++) {
+        svChannels[ch] = static_cast<int>(ch);
+    }
+    BenchSource source(numbers, timestamps, frames, channels);
+    ResampleStage stage;
+    if (!stage.configure(rates, svChannels, kResampleOutputRate, ResamplerOptions(), kStageBlockSamples,
+                         kStageLookahead, 1)) {
+        std::cerr << stage.getLastError() << std::endl;
+        return false;
+    }
+    auto drain = [&](size_t& checked) {
+        bool same = true;
+        while (const ResampledBlock* block = stage.next()) {
+            for (size_t ch = 0; ch < channels && same; ch++) {
+                same = checked + block->count <= count &&
+                       std::equal(block->channels[ch].begin(), block->channels[ch].begin() + block->count,
+                                  upfront[ch].begin() + checked);
+            }
+            checked += block->count;
+        }
+        return same && checked == count;
+    };
+    double firstMs = 1e300;
+    double totalMs = 1e300;
+    bool same = true;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        stage.start(&source);
+        const ResampledBlock* first = stage.next();
+        firstMs = std::min(firstMs, elapsedMs(start));
+        size_t checked = 0;
+        for (size_t ch = 0; ch < channels && first; ch++) {
+            same = same && std::equal(first->channels[ch].begin(), first->channels[ch].begin() + first->count,
+                                      upfront[ch].begin());
+        }
+        checked = first ? first->count : 0;
+        same = drain(checked) && same;
+        totalMs = std::min(totalMs, elapsedMs(start));
+        stage.stop();
+    }
+
+    // Rewind part way through a pass: blocks resampled ahead are dropped
+    stage.start(&source);
+    for (size_t i = 0; i < kStageLookahead + 1; i++) {
+        stage.next();
+    }
+    stage.rewind();
+    size_t checked = 0;
+    bool sameRewound = drain(checked);
+    stage.stop();
+
+    double upfrontMb = count * channels * sizeof(int32_t) / (1024.0 * 1024.0);
+    double ringKb = (kStageLookahead + 1) * 8 * kStageBlockSamples * sizeof(int32_t) / 1024.0;
+    std::cout << "  Upfront: " << std::setw(7) << upfrontMs << " ms before the first sample, " << upfrontMb
+              << " MB of output" << std::endl;
+    std::cout << "  Stage:   " << std::setw(7) << firstMs << " ms before the first sample (" << upfrontMs / firstMs
+              << "x sooner), " << totalMs << " ms for all " << count << ", " << ringKb << " KB of blocks"
+              << (same ? "" : "  MISMATCH") << (sameRewound ? ", identical after rewind" : "  REWIND MISMATCH")
+              << std::endl;
+    return same && sameRewound;
+}
+
+/**
+ * @brief Output cache: parse, map and resample against a hit
+ *
+ * The first pass goes from the .dat to the stage's blocks and is recorded
+ * in a ResampledCache entry; a hit only copies blocks out of the mapped
+ * entry. Every block of a hit must match the recorded pass.
+ */
+bool benchOutputCache(const std::string& dir, size_t numRecords) {
+    std::string prefix = dir + "/bench_output";
+    std::cout << "--- Output cache (" << numRecords << " ASCII records, 4800 -> "
+              << static_cast<int>(kOutputCacheRate) << " Hz, " << kNumAnalog << " channels) ---" << std::endl;
+    if (!writeAsciiRecording(prefix, numRecords)) {
+        std::cerr << "Failed to write " << prefix << ".cfg/.dat" << std::endl;
+        return false;
+    }
+    std::vector<int> svChannels(kNumAnalog);
+    for (int ch = 0; ch < kNumAnalog; ch++) {
+        svChannels[ch] = ch;
+    }
+
+    // Miss: parse, interleave the mapped channels, resample up to the first block
+    ResampledCache recorded(prefix + ".cfg", prefix + ".dat", dir, "bench");
+    auto start = std::chrono::steady_clock::now();
+    ComtradeParser parser;
+    if (!parser.load(prefix + ".cfg")) {
+        std::cerr << "Load failed: " << parser.getLastError() << std::endl;
+        return false;
+    }
+    const ComtradeRecording& recording = parser.getRecording();
+    const size_t numInput = recording.sampleCount();
+    std::vector<int> numbers(recording.sampleNumbers(), recording.sampleNumbers() + numInput);
+    std::vector<uint64_t> timestamps(recording.timestamps(), recording.timestamps() + numInput);
+    std::vector<double> column(numInput);
+    std::vector<double> frames(numInput * kNumAnalog);
+    for (int ch = 0; ch < kNumAnalog; ch++) {
+        recording.analogColumn(ch).copyTo(column.data());
+        for (size_t i = 0; i < numInput; i++) {
+            frames[i * kNumAnalog + ch] = column[i];
+        }
+    }
+    BenchSource source(numbers, timestamps, frames, kNumAnalog);
+    ResampleStage stage;
+    if (!stage.configure(parser.getConfig().sampleRates, svChannels, kOutputCacheRate, ResamplerOptions(),
+                         kStageBlockSamples, kStageLookahead, 1)) {
+        std::cerr << stage.getLastError() << std::endl;
+        return false;
+    }
+    stage.recordTo(&recorded);
+    stage.start(&source);
+    std::vector<std::vector<int32_t>> output(kNumAnalog);
+    const ResampledBlock* block = stage.next();
+    double missFirstMs = elapsedMs(start);
+    for (; block; block = stage.next()) {
+        for (int ch = 0; ch < kNumAnalog; ch++) {
+            output[ch].insert(output[ch].end(), block->channels[ch].begin(),
+                              block->channels[ch].begin() + block->count);
+        }
+    }
+    double missMs = elapsedMs(start);
+    stage.stop();
+    if (!recorded.written()) {
+        std::cerr << "Output cache not written: " << recorded.getLastError() << std::endl;
+        return false;
+    }
+
+    // Hit: open the entry and copy blocks out of it
+    double hitFirstMs = 1e300;
+    double hitMs = 1e300;
+    bool same = true;
+    for (int rep = 0; rep < kRepetitions; rep++) {
+        start = std::chrono::steady_clock::now();
+        ResampledCache cache(prefix + ".cfg", prefix + ".dat", dir, "bench");
+        std::string detail;
+        if (cache.open(detail) != CacheResult::Hit) {
+            std::cerr << "Output cache not used: " << detail << std::endl;
+            return false;
+        }
+        ResampleStage replay;
+        replay.configureCached(cache, kStageBlockSamples, kStageLookahead);
+        replay.start(nullptr);
+        size_t checked = 0;
+        block = replay.next();
+        hitFirstMs = std::min(hitFirstMs, elapsedMs(start));
+        for (; block; block = replay.next()) {
+            for (int ch = 0; ch < kNumAnalog && same; ch++) {
+                same = checked + block->count <= output[ch].size() &&
+                       std::equal(block->channels[ch].begin(), block->channels[ch].begin() + block->count,
+                                  output[ch].begin() + checked);
+            }
+            checked += block->count;
+        }
+        hitMs = std::min(hitMs, elapsedMs(start));
+        same = same && checked == output[0].size();
+        replay.stop();
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  parse+resample  " << std::setw(7) << missFirstMs << " ms to the first block, " << missMs
+              << " ms for all " << output[0].size() << " (recorded, "
+              << static_cast<double>(fileBytes(recorded.path())) / 1e6 << " MB cache file)" << std::endl;
+    std::cout << "  hit             " << std::setw(7) << hitFirstMs << " ms to the first block ("
+              << missFirstMs / hitFirstMs << "x sooner), " << hitMs << " ms for all"
+              << (same ? "" : "  MISMATCH") << std::endl;
+
+    std::remove(recorded.path().c_str());
+    std::remove((prefix + ".cfg").c_str());
+    std::remove((prefix + ".dat").c_str());
+    return same;
+}
+
+/**
+ * @brief ascii mode: comtrade_bench ascii [megabytes] [max threads] [scratch directory]
+ */
+int runAsciiTarget(int argc, char* argv[]) {
+    double megabytes = kAsciiTargetMegabytes;
+    unsigned maxThreads = ThreadPool::defaultThreadCount();
+    std::string dir = ".";
+
+    if (argc > 2) {
+        megabytes = std::strtod(argv[2], nullptr);
+    }
+    if (argc > 3) {
+        maxThreads = static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10));
+    }
+    if (argc > 4) {
+        dir = argv[4];
+    }
+    if (!(megabytes > 0.0) || maxThreads == 0) {
+        std::cerr << "Usage: " << argv[0] << " ascii [megabytes] [max threads] [scratch directory]" << std::endl;
+        return 1;
+    }
+
+    size_t numRecords = asciiRecordsForMegabytes(dir, megabytes);
+    if (numRecords == 0) {
+        std::cerr << "Failed to write a sample file in " << dir << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== COMTRADE ASCII Parse Target ===" << std::endl;
+    std::cout << "Hardware threads: " << ThreadPool::defaultThreadCount() << std::endl;
+    std::cout << std::endl;
+
+    bool ok = benchAsciiParse(dir, numRecords, maxThreads, kAsciiTargetSpeedup);
+    std::cout << std::endl;
+    std::cout << (ok ? "All results identical to the reference" : "RESULT MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "ascii") == 0) {
+        return runAsciiTarget(argc, argv);
+    }
+
+    size_t numRecords = 1000000;
+    unsigned maxThreads = ThreadPool::defaultThreadCount();
+    std::string dir = ".";
+
+    if (argc > 1) {
+        numRecords = static_cast<size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        maxThreads = static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10));
+    }
+    if (argc > 3) {
+        dir = argv[3];
+    }
+    if (numRecords == 0 || maxThreads == 0) {
+        std::cerr << "Usage: " << argv[0] << " [records] [max threads] [scratch directory]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== COMTRADE Load Benchmark ===" << std::endl;
+    std::cout << "Hardware threads: " << ThreadPool::defaultThreadCount() << std::endl;
+    std::cout << std::endl;
+
+    bool ok = benchAsciiParse(dir, numRecords, maxThreads);
+    std::cout << std::endl;
+    ok = benchBinaryDecode(dir, numRecords, maxThreads) && ok;
+    std::cout << std::endl;
+    ok = benchStorage(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchDigitalEdges(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchTimeWindow(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchCampaign(dir, numRecords, maxThreads) && ok;
+    std::cout << std::endl;
+    ok = benchCompressed(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchCache(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchAnalogScaling(numRecords * kNumAnalog) && ok;
+    std::cout << std::endl;
+    ok = benchResampling(numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchTimeline(numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchSkew(numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchStage(numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchOutputCache(dir, numRecords) && ok;
+    std::cout << std::endl;
+    ok = benchParallelResampling(numRecords, maxThreads) && ok;
+
+    std::cout << std::endl;
+    std::cout << (ok ? "All results identical to the reference" : "RESULT MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "comtrade_binary_reader.h"
+
+bool ComtradeBinaryReader::open(const std::string& datPath, const ComtradeConfig& config) {
+    close();
+
+    if (config.dataFormat == DataFormat::ASCII) {
+        lastError_ = "Not a binary COMTRADE data format";
+        return false;
+    }
+    layout_ = BinaryRecordLayout::forConfig(config);
+
+    if (!file_.open(datPath)) {
+        lastError_ = "Failed to open binary .dat file: " + file_.getLastError();
+        return false;
+    }
+
+    if (!countRecords(file_.size(), layout_, config, recordCount_, lastError_)) {
+        close();
+        return false;
+    }
+
+    // One forward pass: aggressive read-ahead, and large pages where the kernel allows
+    file_.advise(MappedFile::Access::Sequential);
+    file_.adviseHugePages();
+    return true;
+}
+
+void ComtradeBinaryReader::close() {
+    file_.close();
+    recordCount_ = 0;
+}
+
+bool ComtradeBinaryReader::countRecords(uint64_t fileSize, const BinaryRecordLayout& layout,
+                                        const ComtradeConfig& config, size_t& count, std::string& error) {
+    if (fileSize % layout.recordSize != 0) {
+        error = "Binary .dat size " + std::to_string(fileSize) +
+                " is not a multiple of the record size " + std::to_string(layout.recordSize) +
+                " (truncated file or .cfg channel count mismatch)";
+        return false;
+    }
+    count = static_cast<size_t>(fileSize / layout.recordSize);
+
+    // The last rate entry's end sample is the declared record count
+    if (!config.sampleRates.empty() && config.sampleRates.back().endSample > 0) {
+        size_t declared = static_cast<size_t>(config.sampleRates.back().endSample);
+        if (count < declared) {
+            error = "Binary .dat holds " + std::to_string(count) +
+                    " records but the .cfg declares " + std::to_string(declared);
+            return false;
+        }
+        count = declared;
+    }
+    return true;
+}
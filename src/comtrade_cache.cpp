@@ -0,0 +1,504 @@
+#include "comtrade_cache.h"
+#include "comtrade_cff.h"
+#include "mapped_file.h"
+#include "cache_hash.h"
+
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+    #include <sys/stat.h>
+#endif
+#include <random>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kCacheMagic[8] = {'C', 'T', 'C', 'A', 'C', 'H', 'E', '\0'};
+const uint32_t kCacheVersion = 6;
+const uint32_t kByteOrderMark = 0x01020304;  // Reads back differently on another byte order
+
+// Bytes read at a time while hashing a source file
+const size_t kHashChunkBytes = 1 << 20;
+
+// Content probe: files up to this size are read whole, larger ones at both
+// ends and at evenly spread pages between them
+const uint64_t kProbeWholeBytes = 1 << 20;
+const uint64_t kProbeEndBytes = 64 * 1024;
+const uint64_t kProbePageBytes = 4096;
+const uint64_t kProbePages = 16;
+
+// Column alignment inside the cache file
+const uint64_t kColumnAlignment = 64;
+
+/**
+ * @brief Fixed header at the start of a cache file (native byte order)
+ */
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t keyHash;
+    uint64_t probeHash;
+    uint64_t contentHash;          // Every byte of the source, checked by paranoid loads
+    uint64_t variantHash;          // Load options that shape the data
+    uint64_t fileSize;             // Whole cache file, catches truncation
+    uint64_t numSamples;
+    uint32_t numAnalog;
+    uint32_t numDigital;
+    uint32_t storage;              // AnalogStorage of the analog columns
+    uint32_t raw;                  // Analog columns hold raw values, scaled by the scale table
+    uint64_t skippedLines;
+    uint64_t cfgOffset;
+    uint64_t cfgSize;
+    uint64_t scalesOffset;         // numAnalog AnalogScale (a, b, ratio), raw columns only
+    uint64_t timestampsOffset;     // numSamples uint64_t
+    uint64_t sampleNumbersOffset;  // numSamples int32_t
+    uint64_t analogOffset;         // numAnalog columns of numSamples values, analogStride apart
+    uint64_t analogStride;
+    uint64_t digitalOffset;        // numDigital packed planes (uint64_t words), digitalStride apart
+    uint64_t digitalStride;
+};
+
+/**
+ * @brief Column placement for a recording of a given shape
+ */
+struct CacheLayout {
+    CacheHeader header;
+
+    CacheLayout(uint64_t numSamples, uint32_t numAnalog, uint32_t numDigital, uint32_t storage, uint32_t raw,
+                uint64_t cfgSize) {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.version = kCacheVersion;
+        header.byteOrder = kByteOrderMark;
+        header.numSamples = numSamples;
+        header.numAnalog = numAnalog;
+        header.numDigital = numDigital;
+        header.storage = storage;
+        header.raw = raw;
+
+        uint64_t pos = sizeof(CacheHeader);
+        header.cfgOffset = pos;
+        header.cfgSize = cfgSize;
+        pos = align(pos + cfgSize);
+        header.scalesOffset = pos;
+        pos = align(pos + (raw ? numAnalog * 3 * sizeof(double) : 0));
+        header.timestampsOffset = pos;
+        pos = align(pos + numSamples * sizeof(uint64_t));
+        header.sampleNumbersOffset = pos;
+        pos = align(pos + numSamples * sizeof(int32_t));
+        header.analogOffset = pos;
+        header.analogStride = align(numSamples * ComtradeRecording::bytesPerValue(static_cast<AnalogStorage>(storage)));
+        pos += numAnalog * header.analogStride;
+        header.digitalOffset = pos;
+        header.digitalStride = align(ComtradeRecording::digitalWordCount(numSamples) * sizeof(uint64_t));
+        pos += numDigital * header.digitalStride;
+        header.fileSize = pos;
+    }
+
+    static uint64_t align(uint64_t pos) {
+        return (pos + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+    }
+};
+
+std::string absolutePath(const std::string& path) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    return ec ? path : absolute.lexically_normal().string();
+}
+
+// Hash a whole file, streamed a chunk at a time
+bool hashContent(const std::string& path, uint64_t size, ContentHash& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(kHashChunkBytes);
+    uint64_t read = 0;
+    while (read < size) {
+        file.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(size - read, buffer.size())));
+        if (file.gcount() <= 0) {
+            return false;
+        }
+        hash.add(buffer.data(), static_cast<size_t>(file.gcount()));
+        read += static_cast<uint64_t>(file.gcount());
+    }
+    return true;
+}
+
+// Hash a few ranges of a file: the whole of a small one, both ends and
+// spread pages of a large one
+bool hashProbe(const std::string& path, uint64_t size, ContentHash& hash) {
+    if (size <= kProbeWholeBytes) {
+        return hashContent(path, size, hash);
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(kProbeEndBytes);
+    auto add = [&](uint64_t offset, uint64_t length) {
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(buffer.data(), static_cast<std::streamsize>(length));
+        hash.add(buffer.data(), static_cast<size_t>(file.gcount()));
+        return file.gcount() == static_cast<std::streamsize>(length);
+    };
+    bool ok = add(0, kProbeEndBytes);
+    uint64_t span = size - 2 * kProbeEndBytes - kProbePageBytes;
+    for (uint64_t page = 1; page <= kProbePages && ok; page++) {
+        ok = add(kProbeEndBytes + span * page / (kProbePages + 1), kProbePageBytes);
+    }
+    return ok && add(size - kProbeEndBytes, kProbeEndBytes);
+}
+
+} // namespace
+
+CacheSource::CacheSource(const std::string& cfgPath, const std::string& datPath)
+    : cff_(ComtradeCffFile::isCffPath(cfgPath)), keyHash_(0), probeHash_(0), ok_(false),
+      contentDone_(false), contentHash_(0) {
+    files_.push_back(absolutePath(cfgPath));
+    if (!cff_) {
+        files_.push_back(absolutePath(datPath));
+    }
+    ok_ = computeIdentity(keyHash_, probeHash_, error_);
+}
+
+bool CacheSource::computeIdentity(uint64_t& keyHash, uint64_t& probeHash, std::string& error) const {
+    Fnv1a key;
+    Fnv1a probe;
+    key.add(static_cast<uint64_t>(kCacheVersion));
+    for (const std::string& file : files_) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(file, ec);
+        if (ec) {
+            error = "Cannot stat " + file + ": " + ec.message();
+            return false;
+        }
+        fs::file_time_type mtime = fs::last_write_time(file, ec);
+        if (ec) {
+            error = "Cannot stat " + file + ": " + ec.message();
+            return false;
+        }
+        key.add(file);
+        key.add(size);
+        key.add(static_cast<uint64_t>(mtime.time_since_epoch().count()));
+#ifndef _WIN32
+        // A file replaced or rewritten in place gets a new inode or status-change time
+        struct stat info;
+        if (::stat(file.c_str(), &info) == 0) {
+            key.add(static_cast<uint64_t>(info.st_dev));
+            key.add(static_cast<uint64_t>(info.st_ino));
+            key.add(static_cast<uint64_t>(info.st_ctime));
+#ifdef __linux__
+            key.add(static_cast<uint64_t>(info.st_ctim.tv_nsec));
+#endif
+        }
+#endif
+
+        ContentHash fileProbe;
+        if (!hashProbe(file, size, fileProbe)) {
+            error = "Cannot read " + file;
+            return false;
+        }
+        probe.add(fileProbe.value());
+    }
+    keyHash = key.value();
+    probeHash = probe.value();
+    return true;
+}
+
+bool CacheSource::identity(uint64_t& keyHash, uint64_t& probeHash, std::string& error) const {
+    if (!ok_) {
+        error = error_;
+        return false;
+    }
+    keyHash = keyHash_;
+    probeHash = probeHash_;
+    return true;
+}
+
+bool CacheSource::contentHash(uint64_t& hash, std::string& error) const {
+    if (!ok_) {
+        error = error_;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(contentMutex_);
+    if (!contentDone_) {
+        Fnv1a content;
+        for (const std::string& file : files_) {
+            std::error_code ec;
+            uint64_t size = fs::file_size(file, ec);
+            ContentHash fileContent;
+            if (ec || !hashContent(file, size, fileContent)) {
+                error = "Cannot read " + file;
+                return false;
+            }
+            content.add(fileContent.value());
+        }
+        contentHash_ = content.value();
+        contentDone_ = true;
+    }
+    hash = contentHash_;
+    return true;
+}
+
+bool CacheSource::unchanged(std::string& error) const {
+    uint64_t keyHash = 0;
+    uint64_t probeHash = 0;
+    if (!identity(keyHash, probeHash, error) || !computeIdentity(keyHash, probeHash, error)) {
+        return false;
+    }
+    if (keyHash != keyHash_ || probeHash != probeHash_) {
+        error = "source changed while loading, cache not written";
+        return false;
+    }
+    return true;
+}
+
+ComtradeCache::ComtradeCache(const std::string& cfgPath, const std::string& datPath,
+                             const std::string& cacheDir, const std::string& variant, bool paranoid,
+                             std::shared_ptr<const CacheSource> source)
+    : source_(source ? std::move(source) : std::make_shared<const CacheSource>(cfgPath, datPath)),
+      path_(pathFor(cfgPath, cacheDir)), variantHash_(0), paranoid_(paranoid) {
+    Fnv1a variantHash;
+    variantHash.add(variant);
+    variantHash_ = variantHash.value();
+}
+
+std::string ComtradeCache::pathFor(const std::string& cfgPath, const std::string& cacheDir) {
+    if (cacheDir.empty()) {
+        return cfgPath + ".cache";
+    }
+    Fnv1a pathHash;
+    pathHash.add(absolutePath(cfgPath));
+    fs::path name = fs::path(cfgPath).filename();
+    return (fs::path(cacheDir) / (name.string() + "-" + toHex(pathHash.value()) + ".cache")).string();
+}
+
+bool ComtradeCache::readCfgText(std::string& text, std::string& error) const {
+    if (source_->cff()) {
+        ComtradeCffFile cff;
+        if (!cff.open(source_->files()[0])) {
+            error = cff.getLastError();
+            return false;
+        }
+        text.assign(cff.cfg().data, cff.cfg().size);
+        return true;
+    }
+
+    std::ifstream file(source_->files()[0], std::ios::binary);
+    if (!file.is_open()) {
+        error = "Failed to open .cfg file: " + source_->files()[0];
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+CacheResult ComtradeCache::load(std::string& cfgText, ComtradeRecording& recording,
+                                uint64_t& skippedLines, std::string& detail) const {
+    std::error_code ec;
+    if (!fs::exists(path_, ec)) {
+        return CacheResult::Miss;
+    }
+    uint64_t keyHash = 0;
+    uint64_t probeHash = 0;
+    if (!source_->identity(keyHash, probeHash, detail)) {
+        return CacheResult::Stale;
+    }
+
+    MappedFile file;
+    if (!file.open(path_)) {
+        detail = file.getLastError();
+        return CacheResult::Stale;
+    }
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+        detail = "cache file truncated";
+        return CacheResult::Stale;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0) {
+        detail = "not a cache file";
+        return CacheResult::Stale;
+    }
+    if (header.byteOrder != kByteOrderMark) {
+        detail = "cache written on a machine with another byte order";
+        return CacheResult::Stale;
+    }
+    if (header.version != kCacheVersion) {
+        detail = "cache version " + std::to_string(header.version) + ", expected " +
+                 std::to_string(kCacheVersion);
+        return CacheResult::Stale;
+    }
+    if (header.keyHash != keyHash) {
+        detail = "source path, size or modification time changed";
+        return CacheResult::Stale;
+    }
+    if (header.probeHash != probeHash) {
+        detail = "source content changed";
+        return CacheResult::Stale;
+    }
+    if (header.variantHash != variantHash_) {
+        detail = "stored with other load options";
+        return CacheResult::Stale;
+    }
+    if (paranoid_) {
+        uint64_t contentHash = 0;
+        if (!source_->contentHash(contentHash, detail)) {
+            return CacheResult::Stale;
+        }
+        if (header.contentHash != contentHash) {
+            detail = "source content changed";
+            return CacheResult::Stale;
+        }
+    }
+
+    // Recompute the layout from the shape so a damaged header cannot point outside the file
+    CacheLayout layout(header.numSamples, header.numAnalog, header.numDigital,
+                       std::min<uint32_t>(header.storage, static_cast<uint32_t>(AnalogStorage::Int32)),
+                       header.raw, header.cfgSize);
+    if (header.storage > static_cast<uint32_t>(AnalogStorage::Int32) || header.raw > 1 ||
+        std::memcmp(&layout.header.cfgOffset, &header.cfgOffset,
+                    sizeof(CacheHeader) - offsetof(CacheHeader, cfgOffset)) != 0 ||
+        header.fileSize != layout.header.fileSize || file.size() != header.fileSize) {
+        detail = "cache file truncated or damaged";
+        return CacheResult::Stale;
+    }
+
+    file.advise(MappedFile::Access::Sequential, 0, file.size());
+    const uint8_t* base = file.data();
+    size_t numSamples = static_cast<size_t>(header.numSamples);
+
+    cfgText.assign(reinterpret_cast<const char*>(base + header.cfgOffset), static_cast<size_t>(header.cfgSize));
+    AnalogStorage storage = static_cast<AnalogStorage>(header.storage);
+    std::vector<AnalogScale> scales(header.raw ? header.numAnalog : 0);
+    for (size_t ch = 0; ch < scales.size(); ch++) {
+        double coefficients[3];
+        std::memcpy(coefficients, base + header.scalesOffset + ch * sizeof(coefficients), sizeof(coefficients));
+        scales[ch].a = coefficients[0];
+        scales[ch].b = coefficients[1];
+        scales[ch].ratio = coefficients[2];
+    }
+    recording.reset(static_cast<int>(header.numAnalog), static_cast<int>(header.numDigital));
+    recording.setAnalogStorage(storage, scales);
+    recording.resize(numSamples);
+    std::memcpy(recording.timestamps(), base + header.timestampsOffset, numSamples * sizeof(uint64_t));
+    std::memcpy(recording.sampleNumbers(), base + header.sampleNumbersOffset, numSamples * sizeof(int32_t));
+    size_t valueBytes = ComtradeRecording::bytesPerValue(storage);
+    size_t digitalBytes = ComtradeRecording::digitalWordCount(numSamples) * sizeof(uint64_t);
+    for (uint32_t ch = 0; ch < header.numAnalog; ch++) {
+        std::memcpy(recording.analogBytes(static_cast<int>(ch)),
+                    base + header.analogOffset + ch * header.analogStride, numSamples * valueBytes);
+    }
+    for (uint32_t ch = 0; ch < header.numDigital; ch++) {
+        std::memcpy(recording.digitalWords(static_cast<int>(ch)),
+                    base + header.digitalOffset + ch * header.digitalStride, digitalBytes);
+    }
+    recording.buildDigitalEdges();
+    skippedLines = header.skippedLines;
+    return CacheResult::Hit;
+}
+
+bool ComtradeCache::store(const ComtradeRecording& recording, uint64_t skippedLines, std::string& error) const {
+    uint64_t keyHash = 0;
+    uint64_t probeHash = 0;
+    if (!source_->identity(keyHash, probeHash, error)) {
+        return false;
+    }
+
+    std::string cfgText;
+    if (!readCfgText(cfgText, error)) {
+        return false;
+    }
+
+    // The recording must come from the source the hashes describe
+    uint64_t contentHash = 0;
+    if (!source_->unchanged(error) || !source_->contentHash(contentHash, error)) {
+        return false;
+    }
+
+    size_t numSamples = recording.sampleCount();
+    int numAnalog = recording.analogChannelCount();
+    CacheLayout layout(numSamples, static_cast<uint32_t>(numAnalog),
+                       static_cast<uint32_t>(recording.digitalChannelCount()),
+                       static_cast<uint32_t>(recording.analogStorage()), recording.analogIsRaw() ? 1 : 0,
+                       cfgText.size());
+    CacheHeader& header = layout.header;
+    header.keyHash = keyHash;
+    header.probeHash = probeHash;
+    header.contentHash = contentHash;
+    header.variantHash = variantHash_;
+
+    std::vector<double> scales;
+    if (recording.analogIsRaw()) {
+        for (int ch = 0; ch < numAnalog; ch++) {
+            AnalogScale scale = recording.analogScale(ch);
+            scales.push_back(scale.a);
+            scales.push_back(scale.b);
+            scales.push_back(scale.ratio);
+        }
+    }
+    size_t valueBytes = ComtradeRecording::bytesPerValue(recording.analogStorage());
+    size_t digitalBytes = ComtradeRecording::digitalWordCount(numSamples) * sizeof(uint64_t);
+    header.skippedLines = skippedLines;
+
+    std::error_code ec;
+    fs::path target(path_);
+    if (target.has_parent_path()) {
+        fs::create_directories(target.parent_path(), ec);
+    }
+
+    // Unique temporary name so concurrent writers never share a file
+    std::random_device random;
+    std::string tempPath = path_ + ".tmp" + toHex((static_cast<uint64_t>(random()) << 32) | random());
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            error = "Failed to create cache file: " + tempPath;
+            return false;
+        }
+
+        uint64_t written = 0;
+        static const char zeros[kColumnAlignment] = {};
+        auto write = [&](uint64_t offset, const void* data, uint64_t size) {
+            out.write(zeros, static_cast<std::streamsize>(offset - written));  // Alignment padding
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written = offset + size;
+        };
+
+        write(0, &header, sizeof(header));
+        write(header.cfgOffset, cfgText.data(), cfgText.size());
+        write(header.scalesOffset, scales.data(), scales.size() * sizeof(double));
+        write(header.timestampsOffset, recording.timestamps(), numSamples * sizeof(uint64_t));
+        write(header.sampleNumbersOffset, recording.sampleNumbers(), numSamples * sizeof(int32_t));
+        for (int ch = 0; ch < numAnalog; ch++) {
+            write(header.analogOffset + ch * header.analogStride, recording.analogBytes(ch), numSamples * valueBytes);
+        }
+        for (int ch = 0; ch < recording.digitalChannelCount(); ch++) {
+            write(header.digitalOffset + ch * header.digitalStride, recording.digitalWords(ch), digitalBytes);
+        }
+        out.write(zeros, static_cast<std::streamsize>(header.fileSize - written));
+
+        out.flush();
+        if (!out) {
+            error = "Failed to write cache file: " + tempPath;
+            out.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tempPath, path_, ec);
+    if (ec) {
+        error = "Failed to move cache file into place: " + ec.message();
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,213 @@
+#include "comtrade_campaign.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t toMegabytes(uint64_t bytes) {
+    return (bytes + (1 << 20) - 1) >> 20;
+}
+
+} // namespace
+
+ComtradeCampaignLoader::ComtradeCampaignLoader(const ComtradeCampaignOptions& options)
+    : options_(options), pool_(new ThreadPool(options.numThreads)),
+      started_(0), returned_(0), inFlight_(0), bytesInUse_(0), heldBack_(0) {
+}
+
+ComtradeCampaignLoader::~ComtradeCampaignLoader() {
+    // Runs the queued loads to completion before the members they use go away
+    pool_.reset();
+}
+
+void ComtradeCampaignLoader::start(const std::vector<std::string>& cfgPaths) {
+    if (cfgPaths.empty()) {
+        return;
+    }
+
+    // Workers left over when there are fewer files than threads decode inside each file
+    unsigned threadsPerFile = options_.load.numThreads;
+    if (threadsPerFile == 0) {
+        threadsPerFile = std::max<unsigned>(1, pool_->size() / static_cast<unsigned>(cfgPaths.size()));
+    }
+
+    // Under a budget, every file's smallest layout is held back for it until
+    // it starts, so early files cannot take the room later ones need
+    std::vector<uint64_t> minimumBytes(cfgPaths.size(), 0);
+    if (options_.memoryBudget > 0) {
+        ComtradeLoadOptions smallest = options_.load;
+        smallest.memoryBudget = 0;
+        if (smallest.storage == SampleStorage::PreferDouble) {
+            smallest.storage = SampleStorage::Raw;
+        }
+        for (size_t i = 0; i < cfgPaths.size(); i++) {
+            ComtradeParser parser;
+            if (parser.loadConfig(cfgPaths[i])) {
+                ComtradeParser::estimateLoadBytes(parser.getConfig(), smallest, minimumBytes[i]);
+            }
+        }
+    }
+
+    size_t first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = started_;
+        started_ += cfgPaths.size();
+        for (uint64_t bytes : minimumBytes) {
+            heldBack_ += bytes;
+        }
+    }
+    for (size_t i = 0; i < cfgPaths.size(); i++) {
+        std::string cfgPath = cfgPaths[i];
+        size_t index = first + i;
+        uint64_t minimum = minimumBytes[i];
+        pool_->submit([this, index, cfgPath, threadsPerFile, minimum] {
+            loadFile(index, cfgPath, threadsPerFile, minimum);
+        });
+    }
+}
+
+void ComtradeCampaignLoader::loadFile(size_t index, const std::string& cfgPath, unsigned threadsPerFile,
+                                      uint64_t minimumBytes) {
+    ComtradeCampaignResult result;
+    result.index = index;
+    result.cfgPath = cfgPath;
+    result.parser.reset(new ComtradeParser());
+    ComtradeParser& parser = *result.parser;
+
+    ComtradeLoadOptions load = options_.load;
+    load.numThreads = threadsPerFile;
+    const uint64_t budget = options_.memoryBudget;
+
+    // Reserve the file's estimated size from the shared budget before loading.
+    // Its own minimum stays held back until the reservation replaces it, in
+    // the same critical section, so no other load can count it as free
+    bool admitted = true;
+    uint64_t reserved = 0;
+    if (budget > 0) {
+        bool configured = parser.loadConfig(cfgPath);
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!configured) {
+            result.error = parser.getLastError();
+            admitted = false;
+        }
+        while (admitted) {
+            uint64_t committed = bytesInUse_ + (heldBack_ - minimumBytes);
+            uint64_t left = budget - std::min(committed, budget);
+            load.memoryBudget = left;
+            if (left > 0 && ComtradeParser::estimateLoadBytes(parser.getConfig(), load, reserved)) {
+                bytesInUse_ += reserved;
+                inFlight_++;
+                break;
+            }
+            if (inFlight_ == 0) {
+                result.error = "Campaign memory budget exhausted: " + std::to_string(toMegabytes(left)) +
+                               " of " + std::to_string(toMegabytes(budget)) + " MB left";
+                admitted = false;
+                break;
+            }
+            // Loads in flight may need less than they reserved
+            released_.wait(lock);
+        }
+        heldBack_ -= minimumBytes;
+        if (!admitted) {
+            released_.notify_all();
+        }
+    }
+
+    bool loaded = false;
+    if (admitted) {
+        auto startTime = std::chrono::steady_clock::now();
+        loaded = parser.load(cfgPath, "", load);
+        result.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        if (!loaded) {
+            result.error = parser.getLastError();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget > 0 && admitted) {
+        // Replace the reservation with what the recording actually holds
+        bytesInUse_ -= reserved;
+        inFlight_--;
+        released_.notify_all();
+    }
+    if (loaded) {
+        // Columns only, as ComtradeLoadOptions::memoryBudget counts them
+        const ComtradeRecording& recording = parser.getRecording();
+        uint64_t bytes = ComtradeRecording::estimateBytes(recording.sampleCount(), recording.analogChannelCount(),
+                                                          recording.digitalChannelCount(), recording.analogStorage());
+        if (budget > 0 && bytesInUse_ + heldBack_ + bytes > budget) {
+            // Only when the .cfg understated the sample count
+            result.error = "Recording needs " + std::to_string(toMegabytes(bytes)) + " MB, campaign budget has " +
+                           std::to_string(toMegabytes(budget - std::min(bytesInUse_ + heldBack_, budget))) +
+                           " MB left";
+            parser.clear();
+        } else {
+            bytesInUse_ += bytes;
+            result.memoryBytes = bytes;
+            result.ok = true;
+        }
+    }
+    results_.push_back(std::move(result));
+    completed_.notify_all();
+}
+
+bool ComtradeCampaignLoader::next(ComtradeCampaignResult& result) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_.wait(lock, [this] { return !results_.empty() || returned_ == started_; });
+    if (results_.empty()) {
+        return false;
+    }
+    result = std::move(results_.front());
+    results_.pop_front();
+    returned_++;
+    return true;
+}
+
+std::vector<ComtradeCampaignResult> ComtradeCampaignLoader::loadAll(const std::vector<std::string>& cfgPaths) {
+    size_t first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = started_;
+    }
+    start(cfgPaths);
+
+    std::vector<ComtradeCampaignResult> results(cfgPaths.size());
+    std::vector<ComtradeCampaignResult> others;
+    size_t remaining = cfgPaths.size();
+    ComtradeCampaignResult result;
+    while (remaining > 0 && next(result)) {
+        if (result.index >= first && result.index < first + cfgPaths.size()) {
+            results[result.index - first] = std::move(result);
+            remaining--;
+        } else {
+            others.push_back(std::move(result));
+        }
+    }
+
+    // Files from earlier start() calls stay available to next()
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& other : others) {
+        results_.push_back(std::move(other));
+        returned_--;
+    }
+    return results;
+}
+
+void ComtradeCampaignLoader::reset() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_.wait(lock, [this] { return returned_ + results_.size() == started_; });
+    results_.clear();
+    started_ = 0;
+    returned_ = 0;
+    bytesInUse_ = 0;
+    heldBack_ = 0;
+}
+
+uint64_t ComtradeCampaignLoader::bytesInUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesInUse_;
+}
@@ -0,0 +1,198 @@
+#include "comtrade_cff.h"
+
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+
+/**
+ * @brief Parsed "--- file type: ... ---" line
+ */
+struct SectionHeader {
+    std::string type;        // CFG, INF, HDR, DAT ASCII or DAT BINARY (upper case)
+    uint64_t byteCount = 0;  // DAT BINARY only
+    bool hasByteCount = false;
+};
+
+bool parseSectionHeader(const char* begin, const char* end, SectionHeader& header) {
+    while (begin < end && std::isspace(static_cast<unsigned char>(*begin))) {
+        begin++;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(end[-1]))) {
+        end--;
+    }
+    if (end - begin < 6 || std::strncmp(begin, "---", 3) != 0 || std::strncmp(end - 3, "---", 3) != 0) {
+        return false;
+    }
+
+    // Upper-case the text between the dashes, collapsing runs of spaces
+    std::string text;
+    for (const char* p = begin + 3; p < end - 3; p++) {
+        char c = static_cast<char>(std::toupper(static_cast<unsigned char>(*p)));
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!text.empty() && text.back() != ' ') {
+                text += ' ';
+            }
+        } else {
+            text += c;
+        }
+    }
+    if (!text.empty() && text.back() == ' ') {
+        text.pop_back();
+    }
+
+    const std::string prefix = "FILE TYPE:";
+    if (text.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    text.erase(0, prefix.size());
+    if (!text.empty() && text[0] == ' ') {
+        text.erase(0, 1);
+    }
+
+    size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+        std::string count = text.substr(colon + 1);
+        char* parsed = nullptr;
+        header.byteCount = std::strtoull(count.c_str(), &parsed, 10);
+        header.hasByteCount = parsed != count.c_str();
+        text.erase(colon);
+        while (!text.empty() && text.back() == ' ') {
+            text.pop_back();
+        }
+    }
+    header.type = text;
+    return true;
+}
+
+bool isBlankLine(const char* begin, const char* end) {
+    for (const char* p = begin; p < end; p++) {
+        if (!std::isspace(static_cast<unsigned char>(*p))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool ComtradeCffFile::open(const std::string& path) {
+    close();
+
+    if (!file_.open(path)) {
+        lastError_ = "Failed to open .cff file: " + file_.getLastError();
+        return false;
+    }
+    if (!parseSections()) {
+        file_.close();
+        return false;
+    }
+    if (!cfg_.present || !dat_.present) {
+        lastError_ = std::string(".cff file has no ") + (cfg_.present ? "DAT" : "CFG") + " section: " + path;
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+void ComtradeCffFile::close() {
+    file_.close();
+    cfg_ = CffSection();
+    inf_ = CffSection();
+    hdr_ = CffSection();
+    dat_ = CffSection();
+    datIsBinary_ = false;
+    lastError_.clear();
+}
+
+bool ComtradeCffFile::parseSections() {
+    const char* begin = reinterpret_cast<const char*>(file_.data());
+    const char* end = begin + file_.size();
+    const char* pos = begin;
+    CffSection* open = nullptr;  // Text section waiting for its end
+    CffSection ignored;
+
+    while (pos < end) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* lineEnd = newline ? newline : end;
+        const char* next = newline ? newline + 1 : end;
+
+        SectionHeader header;
+        if (!parseSectionHeader(pos, lineEnd, header)) {
+            if (!open && !isBlankLine(pos, lineEnd)) {
+                lastError_ = "Data outside a section at byte " + std::to_string(pos - begin) + " of .cff file";
+                return false;
+            }
+            pos = next;
+            continue;
+        }
+
+        if (open) {
+            open->size = static_cast<size_t>(pos - open->data);
+            open = nullptr;
+        }
+
+        CffSection* section = &ignored;  // Unknown section types are skipped
+        bool binary = false;
+        if (header.type == "CFG") {
+            section = &cfg_;
+        } else if (header.type == "INF") {
+            section = &inf_;
+        } else if (header.type == "HDR") {
+            section = &hdr_;
+        } else if (header.type == "DAT ASCII") {
+            section = &dat_;
+        } else if (header.type == "DAT BINARY") {
+            section = &dat_;
+            binary = true;
+        }
+        if (section != &ignored && section->present) {
+            lastError_ = "Duplicate " + header.type + " section in .cff file";
+            return false;
+        }
+        section->present = true;
+        section->data = next;
+
+        if (!binary) {
+            open = section;
+            pos = next;
+            continue;
+        }
+
+        // Binary data has an explicit length and may contain anything, newlines included
+        if (!header.hasByteCount) {
+            lastError_ = "DAT BINARY section without a byte count in .cff file";
+            return false;
+        }
+        if (header.byteCount > static_cast<uint64_t>(end - next)) {
+            lastError_ = "DAT BINARY section declares " + std::to_string(header.byteCount) +
+                         " bytes but only " + std::to_string(end - next) + " remain (truncated .cff file)";
+            return false;
+        }
+        datIsBinary_ = true;
+        section->size = static_cast<size_t>(header.byteCount);
+        pos = next + header.byteCount;
+        while (pos < end && (*pos == '\r' || *pos == '\n')) {
+            pos++;
+        }
+    }
+
+    if (open) {
+        open->size = static_cast<size_t>(end - open->data);
+    }
+    return true;
+}
+
+bool ComtradeCffFile::isCffPath(const std::string& path) {
+    size_t dotPos = path.find_last_of('.');
+    if (dotPos == std::string::npos || path.size() - dotPos != 4) {
+        return false;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (std::tolower(static_cast<unsigned char>(path[dotPos + 1 + i])) != "cff"[i]) {
+            return false;
+        }
+    }
+    return true;
+}
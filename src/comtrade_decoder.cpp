@@ -0,0 +1,526 @@
+#include "comtrade_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Same set as std::isspace in the "C" locale
+inline bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool isBlank(const char* begin, const char* end) {
+    for (const char* p = begin; p < end; p++) {
+        if (!isSpace(*p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void trimToken(const char*& begin, const char*& end) {
+    while (begin < end && isSpace(*begin)) {
+        begin++;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        end--;
+    }
+}
+
+// from_chars takes no '+': skip one, but reject a second sign as stod/stoi do
+bool skipPlusSign(const char*& begin, const char* end) {
+    if (begin < end && *begin == '+') {
+        begin++;
+        return begin == end || (*begin != '-' && *begin != '+');
+    }
+    return true;
+}
+
+// Like std::stoi: optional sign, trailing characters ignored, range checked
+bool parseInt(const char* begin, const char* end, int& value) {
+    if (!skipPlusSign(begin, end)) {
+        return false;
+    }
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc();
+}
+
+// Like std::stod: optional sign, trailing characters ignored, range checked
+bool parseDouble(const char* begin, const char* end, double& value) {
+    if (!skipPlusSign(begin, end)) {
+        return false;
+    }
+
+    // Fast path for plain integers (the usual ASCII sample value): exact, and
+    // int64 -> double rounds the same way as a decimal conversion
+    const char* p = begin;
+    bool negative = p < end && *p == '-';
+    if (negative) {
+        p++;
+    }
+    const char* digits = p;
+    int64_t integer = 0;
+    while (p < end && p - digits < 18 && *p >= '0' && *p <= '9') {
+        integer = integer * 10 + (*p - '0');
+        p++;
+    }
+    if (p > digits && (p == end || (*p != '.' && *p != 'e' && *p != 'E' && (*p < '0' || *p > '9')))) {
+        value = static_cast<double>(negative ? -integer : integer);
+        if (negative && integer == 0) {
+            value = -0.0;
+        }
+        return true;
+    }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc();
+#else
+    // No floating-point from_chars: strtod on a terminated copy
+    char buffer[64];
+    size_t length = static_cast<size_t>(end - begin);
+    if (length == 0 || length >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* parsed = nullptr;
+    errno = 0;
+    value = std::strtod(buffer, &parsed);
+    return parsed != buffer && errno != ERANGE;
+#endif
+}
+
+// One comma-separated field holding a plain decimal integer (optional '-',
+// up to 18 digits, spaces around it); false for anything else, which the
+// general field parser then handles
+inline bool scanIntegerField(const char*& p, const char* end, int64_t& value, bool& comma) {
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    // Signs vary row to row: keep them off the branch predictor
+    const int64_t negative = p < end && *p == '-';
+    p += negative;
+    const char* digits = p;
+    int64_t integer = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10u) {
+        integer = integer * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits || p - digits > 18 || (negative && integer == 0)) {
+        return false;
+    }
+    while (p < end && isSpace(*p)) {
+        p++;
+    }
+    comma = p < end && *p == ',';
+    if (p < end && !comma) {
+        return false;
+    }
+    p += comma;
+    value = (integer ^ -negative) + negative;
+    return true;
+}
+
+// Write one channel's run of raw values in the recording's analog storage
+template <typename Raw>
+void storeAnalog(const Raw* raw, size_t count, const AnalogScale& scale,
+                 ComtradeRecording& out, int channel, size_t row) {
+    switch (out.analogStorage()) {
+        case AnalogStorage::Double:
+            scaleAnalog(raw, count, scale, out.analog(channel) + row);
+            break;
+        case AnalogStorage::Float:
+            if (out.analogIsRaw()) {
+                std::copy_n(raw, count, out.analogFloat(channel) + row);
+            } else {
+                scaleAnalog(raw, count, scale, out.analogFloat(channel) + row);
+            }
+            break;
+        case AnalogStorage::Int16:
+            std::copy_n(raw, count, out.analogInt16(channel) + row);
+            break;
+        case AnalogStorage::Int32:
+            std::copy_n(raw, count, out.analogInt32(channel) + row);
+            break;
+    }
+}
+
+// Raw ASCII value as an integer of type Int, if it is one exactly (-0 is not)
+template <typename Int>
+bool exactInteger(double value, Int& out) {
+    if (!(value >= static_cast<double>(std::numeric_limits<Int>::min()) &&
+          value <= static_cast<double>(std::numeric_limits<Int>::max()))) {
+        return false;
+    }
+    out = static_cast<Int>(value);
+    return static_cast<double>(out) == value && !(value == 0.0 && std::signbit(value));
+}
+
+} // namespace
+
+bool sampleWindowFromRates(const ComtradeConfig& config, double startSeconds, double endSeconds,
+                           uint64_t& first, uint64_t& last) {
+    if (config.sampleRates.empty()) {
+        return false;
+    }
+    for (const auto& sr : config.sampleRates) {
+        if (sr.rate <= 0.0) {
+            return false;
+        }
+    }
+    uint64_t total = static_cast<uint64_t>(std::max(0, config.sampleRates.back().endSample));
+
+    // First sample at or after an offset (tolerant of rounding in the product)
+    auto sampleAt = [&config, total](double seconds) -> uint64_t {
+        uint64_t segmentFirst = 0;
+        double segmentStart = 0.0;
+        for (const auto& sr : config.sampleRates) {
+            uint64_t segmentEnd = static_cast<uint64_t>(std::max(0, sr.endSample));
+            if (segmentEnd <= segmentFirst) {
+                continue;
+            }
+            double segmentLength = static_cast<double>(segmentEnd - segmentFirst) / sr.rate;
+            if (seconds < segmentStart + segmentLength) {
+                double offset = std::ceil((seconds - segmentStart) * sr.rate - 1e-9);
+                return segmentFirst + static_cast<uint64_t>(std::max(0.0, offset));
+            }
+            segmentFirst = segmentEnd;
+            segmentStart += segmentLength;
+        }
+        return total;
+    };
+
+    first = std::min(sampleAt(std::max(0.0, startSeconds)), total);
+    last = endSeconds > 0.0 ? std::max(first, std::min(sampleAt(endSeconds), total)) : total;
+    return true;
+}
+
+size_t AsciiLineIndex::lineStart(uint64_t line) {
+    size_t block = static_cast<size_t>(line / kStride);
+    while (starts_.size() <= block && scanned_ < size_) {
+        // Extend the index by one stride of lines
+        const char* p = text_ + scanned_;
+        const char* end = text_ + size_;
+        uint64_t target = static_cast<uint64_t>(starts_.size()) * kStride;
+        while (lines_ < target && p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            p = newline ? newline + 1 : end;
+            lines_++;
+        }
+        scanned_ = static_cast<size_t>(p - text_);
+        if (lines_ == target && scanned_ < size_) {
+            starts_.push_back(scanned_);
+        }
+    }
+    if (starts_.size() <= block) {
+        return size_;
+    }
+
+    // Walk from the indexed line to the one asked for
+    const char* p = text_ + starts_[block];
+    const char* end = text_ + size_;
+    for (uint64_t i = static_cast<uint64_t>(block) * kStride; i < line && p < end; i++) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+    return static_cast<size_t>(p - text_);
+}
+
+ComtradeDecoder::ComtradeDecoder(const ComtradeConfig& config)
+    : numAnalog_(config.numAnalogChannels),
+      numDigital_(config.numDigitalChannels),
+      timeFactor_(config.timeFactor),
+      layout_(BinaryRecordLayout::forConfig(config)),
+      analogRow_(config.numAnalogChannels),
+      digitalRow_(config.numDigitalChannels) {
+    scales_.reserve(numAnalog_);
+    for (int i = 0; i < numAnalog_; i++) {
+        scales_.push_back(AnalogScale::forChannel(config.analogChannels[i]));
+    }
+}
+
+void ComtradeDecoder::decodeBinary(const uint8_t* records, size_t count,
+                                   ComtradeRecording& out, size_t first) const {
+    if (layout_.floatAnalog) {
+        decodeBinaryBlocks<float>(records, count, out, first);
+    } else if (layout_.analogBytes == 2) {
+        decodeBinaryBlocks<int16_t>(records, count, out, first);
+    } else {
+        decodeBinaryBlocks<int32_t>(records, count, out, first);
+    }
+}
+
+template <typename Raw>
+void ComtradeDecoder::decodeBinaryBlocks(const uint8_t* records, size_t count,
+                                         ComtradeRecording& out, size_t first) const {
+    std::vector<uint64_t*> digitalColumns(numDigital_);
+    for (int i = 0; i < numDigital_; i++) {
+        digitalColumns[i] = out.digitalWords(i);
+    }
+    // States of the current 64-row word of every digital channel
+    std::vector<uint64_t> digitalBits(numDigital_);
+    int* sampleNumbers = out.sampleNumbers() + first;
+    uint64_t* timestamps = out.timestamps() + first;
+    int bitsPerWord = static_cast<int>(layout_.digitalWordBytes * 8);
+
+    // Raw analog values of one block, transposed to one contiguous run per
+    // channel so they can be scaled with the vector kernels
+    std::vector<Raw> rawBlock(static_cast<size_t>(numAnalog_) * kBinaryBlockRecords);
+
+    for (size_t blockStart = 0; blockStart < count; blockStart += kBinaryBlockRecords) {
+        size_t blockCount = std::min(kBinaryBlockRecords, count - blockStart);
+        for (size_t k = 0; k < blockCount; k++) {
+            size_t r = blockStart + k;
+            BinaryRecordView record(records + r * layout_.recordSize, layout_);
+            sampleNumbers[r] = static_cast<int>(record.sampleNumber());
+
+            // The field counts microseconds, scaled by timeFactor
+            timestamps[r] = static_cast<uint64_t>(
+                std::max<long long>(0, std::llround(static_cast<double>(record.timestamp()) * timeFactor_)));
+
+            // Raw has the width of the stored field: copy it as is
+            const uint8_t* analogField = record.data() + 8;
+            for (int i = 0; i < numAnalog_; i++) {
+                std::memcpy(&rawBlock[i * kBinaryBlockRecords + k], analogField + i * sizeof(Raw), sizeof(Raw));
+            }
+
+            // Regroup the record's digital words (one bit per channel) into
+            // per-channel words (one bit per row)
+            size_t row = first + r;
+            for (int w = 0; w < layout_.numDigitalWords; w++) {
+                uint32_t digitalWord = record.digitalWord(w);
+                for (int b = 0; b < bitsPerWord && (w * bitsPerWord + b) < numDigital_; b++) {
+                    digitalBits[w * bitsPerWord + b] |= static_cast<uint64_t>((digitalWord >> b) & 1u) << (row % 64);
+                }
+            }
+            if (row % 64 == 63 || r == count - 1) {
+                // Rows outside [first, first + count) keep their bits
+                size_t low = r < row % 64 ? row % 64 - r : 0;
+                uint64_t mask = (~uint64_t(0) >> (63 - row % 64)) & (~uint64_t(0) << low);
+                for (int i = 0; i < numDigital_; i++) {
+                    uint64_t& word = digitalColumns[i][row / 64];
+                    word = (word & ~mask) | digitalBits[i];
+                    digitalBits[i] = 0;
+                }
+            }
+        }
+
+        for (int i = 0; i < numAnalog_; i++) {
+            storeAnalog(&rawBlock[i * kBinaryBlockRecords], blockCount, scales_[i], out, i, first + blockStart);
+        }
+    }
+}
+
+AsciiLineStatus ComtradeDecoder::parseAsciiLine(const char* begin, const char* end, ComtradeRecording& out) {
+    int sampleNumber = 0;
+    uint64_t timestamp = 0;
+    AsciiLineStatus status = parseAsciiFields(begin, end, sampleNumber, timestamp);
+    if (status == AsciiLineStatus::Ok) {
+        for (int i = 0; i < numAnalog_; i++) {
+            analogRow_[i] = scales_[i].apply(analogRow_[i]);
+        }
+        out.append(sampleNumber, timestamp, analogRow_.data(), digitalRow_.data());
+    }
+    return status;
+}
+
+bool ComtradeDecoder::storeAsciiAnalog(AnalogStorage storage, bool raw, void* const* columns, size_t row) const {
+    switch (storage) {
+        case AnalogStorage::Double:
+            for (int i = 0; i < numAnalog_; i++) {
+                static_cast<double*>(columns[i])[row] = scales_[i].apply(analogRow_[i]);
+            }
+            return true;
+        case AnalogStorage::Float:
+            for (int i = 0; i < numAnalog_; i++) {
+                float value = static_cast<float>(raw ? analogRow_[i] : scales_[i].apply(analogRow_[i]));
+                if (raw && static_cast<double>(value) != analogRow_[i]) {
+                    return false;
+                }
+                static_cast<float*>(columns[i])[row] = value;
+            }
+            return true;
+        case AnalogStorage::Int16:
+            for (int i = 0; i < numAnalog_; i++) {
+                if (!exactInteger(analogRow_[i], static_cast<int16_t*>(columns[i])[row])) {
+                    return false;
+                }
+            }
+            return true;
+        case AnalogStorage::Int32:
+            for (int i = 0; i < numAnalog_; i++) {
+                if (!exactInteger(analogRow_[i], static_cast<int32_t*>(columns[i])[row])) {
+                    return false;
+                }
+            }
+            return true;
+    }
+    return true;
+}
+
+bool ComtradeDecoder::parseIntegerFields(const char* begin, const char* end,
+                                         int& sampleNumber, uint64_t& timestamp) {
+    const int expectedFields = 2 + numAnalog_ + numDigital_;
+    const char* pos = begin;
+    int64_t value = 0;
+    bool comma = true;
+    for (int field = 0; field < expectedFields; field++) {
+        // A field missing before the last one is left to the general parser
+        if (!comma || !scanIntegerField(pos, end, value, comma)) {
+            return false;
+        }
+        if (field == 0) {
+            if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+                return false;
+            }
+            sampleNumber = static_cast<int>(value);
+        } else if (field == 1) {
+            double time = static_cast<double>(value);
+            timestamp = static_cast<uint64_t>(std::max<long long>(0, std::llround(time * timeFactor_)));
+        } else if (field < 2 + numAnalog_) {
+            analogRow_[field - 2] = static_cast<double>(value);
+        } else {
+            if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+                return false;
+            }
+            digitalRow_[field - 2 - numAnalog_] = value != 0 ? 1 : 0;
+        }
+    }
+    return true;
+}
+
+AsciiLineStatus ComtradeDecoder::parseAsciiFields(const char* begin, const char* end,
+                                                  int& sampleNumber, uint64_t& timestamp) {
+    // Most files hold integers only: read those in one pass
+    if (parseIntegerFields(begin, end, sampleNumber, timestamp)) {
+        return AsciiLineStatus::Ok;
+    }
+
+    // ASCII format: sample#, time, A1, A2, ..., AN, D1, D2, ..., DN (one token per digital)
+    const int expectedFields = 2 + numAnalog_ + numDigital_;
+    const char* pos = begin;
+
+    for (int field = 0; field < expectedFields; field++) {
+        if (pos > end) {
+            return AsciiLineStatus::Incomplete;
+        }
+        // Fields are short: a plain scan beats memchr here
+        const char* tokenEnd = pos;
+        while (tokenEnd < end && *tokenEnd != ',') {
+            tokenEnd++;
+        }
+        bool comma = tokenEnd < end;
+        const char* tokenBegin = pos;
+        pos = tokenEnd + 1;
+
+        // A trailing comma does not start another field
+        if (!comma && tokenBegin == end && field > 0) {
+            return AsciiLineStatus::Incomplete;
+        }
+        trimToken(tokenBegin, tokenEnd);
+
+        bool ok;
+        if (field == 0) {
+            ok = parseInt(tokenBegin, tokenEnd, sampleNumber);
+            if (!ok && isBlank(begin, end)) {
+                return AsciiLineStatus::Blank;
+            }
+        } else if (field == 1) {
+            // Timestamp: microseconds scaled by timeFactor (rounded, so fractional factors stay exact)
+            double time = 0.0;
+            ok = parseDouble(tokenBegin, tokenEnd, time);
+            timestamp = static_cast<uint64_t>(std::max<long long>(0, std::llround(time * timeFactor_)));
+        } else if (field < 2 + numAnalog_) {
+            int i = field - 2;
+            ok = parseDouble(tokenBegin, tokenEnd, analogRow_[i]);
+        } else {
+            // Digital values (ASCII format: one token per digital, not bit-packed)
+            int digitalValue = 0;
+            ok = parseInt(tokenBegin, tokenEnd, digitalValue);
+            digitalRow_[field - 2 - numAnalog_] = digitalValue != 0 ? 1 : 0;
+        }
+        if (!ok) {
+            // A missing field reads as incomplete, anything else as invalid
+            return tokenBegin == tokenEnd && !comma ? AsciiLineStatus::Incomplete : AsciiLineStatus::Invalid;
+        }
+    }
+    return AsciiLineStatus::Ok;
+}
+
+AsciiBlockResult ComtradeDecoder::parseAsciiBlock(const char* begin, const char* end,
+                                                  ComtradeRecording& out, size_t maxIssues) {
+    AsciiBlockResult result;
+
+    // Rows are written straight into the columns, which grow in steps
+    size_t row = out.sampleCount();
+    size_t capacity = row;
+    const AnalogStorage storage = out.analogStorage();
+    const bool raw = out.analogIsRaw();
+    std::vector<void*> analogColumns(numAnalog_);
+    std::vector<uint64_t*> digitalColumns(numDigital_);
+    int* sampleNumbers = nullptr;
+    uint64_t* timestamps = nullptr;
+
+    const char* line = begin;
+    while (line < end) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        const char* lineEnd = newline ? newline : end;
+        result.lines++;
+
+        int sampleNumber = 0;
+        uint64_t timestamp = 0;
+        AsciiLineStatus status = parseAsciiFields(line, lineEnd, sampleNumber, timestamp);
+        if (status == AsciiLineStatus::Ok) {
+            if (row == capacity) {
+                // Fill reserved space first, then double; never past the rows the
+                // rest of the range can hold (a field is at least a digit and a
+                // separator), so appending a small block does not clear the
+                // whole reservation
+                size_t minLineBytes = 2 * static_cast<size_t>(2 + numAnalog_ + numDigital_);
+                size_t fit = row + static_cast<size_t>(end - line) / minLineBytes + 1;
+                capacity = out.capacity() > row ? out.capacity() : std::max<size_t>(row * 2, 4096);
+                capacity = std::min(capacity, fit);
+                out.resize(capacity);
+                for (int i = 0; i < numAnalog_; i++) {
+                    analogColumns[i] = out.analogBytes(i);
+                }
+                for (int i = 0; i < numDigital_; i++) {
+                    digitalColumns[i] = out.digitalWords(i);
+                }
+                sampleNumbers = out.sampleNumbers();
+                timestamps = out.timestamps();
+            }
+            if (!storeAsciiAnalog(storage, raw, analogColumns.data(), row)) {
+                result.rawOverflow = true;
+                break;
+            }
+            // Bits past the last row are zero, so setting is enough
+            for (int i = 0; i < numDigital_; i++) {
+                digitalColumns[i][row / 64] |= static_cast<uint64_t>(digitalRow_[i]) << (row % 64);
+            }
+            sampleNumbers[row] = sampleNumber;
+            timestamps[row] = timestamp;
+            row++;
+        } else if (status == AsciiLineStatus::Incomplete || status == AsciiLineStatus::Invalid) {
+            result.skipped++;
+            if (result.issues.size() < maxIssues) {
+                ComtradeParseIssue issue;
+                issue.line = result.lines;
+                issue.message = status == AsciiLineStatus::Incomplete
+                    ? "incomplete line (expected " + std::to_string(2 + numAnalog_ + numDigital_) + " fields)"
+                    : "invalid number";
+                result.issues.push_back(issue);
+            }
+        }
+        line = lineEnd + 1;
+    }
+    out.resize(row);
+    return result;
+}
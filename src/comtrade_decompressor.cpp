@@ -0,0 +1,336 @@
+#include "comtrade_decompressor.h"
+
+#include <fstream>
+
+#ifdef COMTRADE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef COMTRADE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Compressed bytes per read
+const size_t kInputBytes = 256 << 10;
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    if (text.size() < suffix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < suffix.size(); ++i) {
+        char c = text[text.size() - suffix.size() + i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != suffix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Streaming decompressor for one format
+ *
+ * fill() inflates up to `capacity` bytes into `out`, reading more input from
+ * the file as needed; it returns 0 with an empty error at the end of data.
+ */
+class ComtradeDecompressor::Codec {
+public:
+    virtual ~Codec() = default;
+
+    bool openFile(const std::string& path) {
+        file_.open(path, std::ios::binary);
+        input_.resize(kInputBytes);
+        return file_.is_open();
+    }
+
+    virtual size_t fill(char* out, size_t capacity, std::string& error) = 0;
+
+    uint64_t bytesRead() const { return bytesRead_; }
+
+protected:
+    // Read the next chunk of compressed input; false at end of file
+    bool readInput(size_t& size) {
+        file_.read(input_.data(), static_cast<std::streamsize>(input_.size()));
+        size = static_cast<size_t>(file_.gcount());
+        bytesRead_ += size;
+        return size > 0;
+    }
+
+    std::ifstream file_;
+    std::vector<char> input_;
+    uint64_t bytesRead_ = 0;
+};
+
+namespace {
+
+#ifdef COMTRADE_HAVE_ZLIB
+class GzipCodec : public ComtradeDecompressor::Codec {
+public:
+    GzipCodec() {
+        stream_ = z_stream();
+        // 15 + 32: any window size, gzip or zlib header detected automatically
+        ok_ = inflateInit2(&stream_, 15 + 32) == Z_OK;
+    }
+
+    ~GzipCodec() override {
+        if (ok_) {
+            inflateEnd(&stream_);
+        }
+    }
+
+    size_t fill(char* out, size_t capacity, std::string& error) override {
+        if (!ok_) {
+            error = "Failed to initialize zlib";
+            return 0;
+        }
+        stream_.next_out = reinterpret_cast<Bytef*>(out);
+        stream_.avail_out = static_cast<uInt>(capacity);
+
+        while (stream_.avail_out > 0) {
+            // Output that filled the last block may still be pending in the inflater
+            if (stream_.avail_in == 0 && !outputFull_) {
+                size_t size = 0;
+                if (!readInput(size)) {
+                    if (inMember_) {
+                        error = "Truncated gzip data";
+                    }
+                    break;
+                }
+                stream_.next_in = reinterpret_cast<Bytef*>(input_.data());
+                stream_.avail_in = static_cast<uInt>(size);
+            }
+            inMember_ = true;
+            int result = inflate(&stream_, Z_NO_FLUSH);
+            outputFull_ = stream_.avail_out == 0;
+            if (result == Z_STREAM_END) {
+                // Concatenated members (e.g. parallel gzip) continue the stream
+                inMember_ = false;
+                inflateReset(&stream_);
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                error = std::string("Corrupt gzip data: ") + (stream_.msg ? stream_.msg : "inflate failed");
+                break;
+            }
+        }
+        return capacity - stream_.avail_out;
+    }
+
+private:
+    z_stream stream_;
+    bool ok_ = false;
+    bool inMember_ = false;     // Inside a gzip member (input ending here is truncation)
+    bool outputFull_ = false;   // Last inflate() filled the output
+};
+#endif
+
+#ifdef COMTRADE_HAVE_ZSTD
+class ZstdCodec : public ComtradeDecompressor::Codec {
+public:
+    ZstdCodec() : stream_(ZSTD_createDStream()) {
+        if (stream_) {
+            ZSTD_initDStream(stream_);
+        }
+    }
+
+    ~ZstdCodec() override {
+        ZSTD_freeDStream(stream_);
+    }
+
+    size_t fill(char* out, size_t capacity, std::string& error) override {
+        if (!stream_) {
+            error = "Failed to initialize zstd";
+            return 0;
+        }
+        ZSTD_outBuffer output = {out, capacity, 0};
+
+        while (output.pos < output.size) {
+            // Output that filled the last block may still be buffered in the decoder
+            if (in_.pos == in_.size && !outputFull_) {
+                size_t size = 0;
+                if (!readInput(size)) {
+                    if (pending_ != 0) {
+                        error = "Truncated zstd data";
+                    }
+                    break;
+                }
+                in_ = {input_.data(), size, 0};
+            }
+            // 0 = frame complete; the next frame (if any) starts on its own
+            pending_ = ZSTD_decompressStream(stream_, &output, &in_);
+            outputFull_ = output.pos == output.size;
+            if (ZSTD_isError(pending_)) {
+                error = std::string("Corrupt zstd data: ") + ZSTD_getErrorName(pending_);
+                break;
+            }
+        }
+        return output.pos;
+    }
+
+private:
+    ZSTD_DStream* stream_;
+    ZSTD_inBuffer in_ = {nullptr, 0, 0};
+    size_t pending_ = 0;        // Last ZSTD_decompressStream() result (0 = between frames)
+    bool outputFull_ = false;   // Last call filled the output
+};
+#endif
+
+} // namespace
+
+ComtradeDecompressor::ComtradeDecompressor()
+    : produced_(0), consumed_(0), finished_(true), stop_(false), compressedBytes_(0) {
+}
+
+ComtradeDecompressor::~ComtradeDecompressor() {
+    close();
+}
+
+DatCompression ComtradeDecompressor::compressionFor(const std::string& path) {
+    if (endsWith(path, ".gz")) {
+        return DatCompression::Gzip;
+    }
+    if (endsWith(path, ".zst")) {
+        return DatCompression::Zstd;
+    }
+    return DatCompression::None;
+}
+
+bool ComtradeDecompressor::isSupported(DatCompression compression) {
+    switch (compression) {
+#ifdef COMTRADE_HAVE_ZLIB
+        case DatCompression::Gzip:
+            return true;
+#endif
+#ifdef COMTRADE_HAVE_ZSTD
+        case DatCompression::Zstd:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool ComtradeDecompressor::open(const std::string& path, DatCompression compression) {
+    close();
+    lastError_.clear();
+
+    switch (compression) {
+        case DatCompression::Gzip:
+#ifdef COMTRADE_HAVE_ZLIB
+            codec_.reset(new GzipCodec());
+            break;
+#else
+            lastError_ = "gzip support not built (zlib not found): " + path;
+            return false;
+#endif
+        case DatCompression::Zstd:
+#ifdef COMTRADE_HAVE_ZSTD
+            codec_.reset(new ZstdCodec());
+            break;
+#else
+            lastError_ = "zstd support not built (libzstd not found): " + path;
+            return false;
+#endif
+        default:
+            lastError_ = "Not a compressed file: " + path;
+            return false;
+    }
+    if (!codec_->openFile(path)) {
+        codec_.reset();
+        lastError_ = "Failed to open .dat file: " + path;
+        return false;
+    }
+
+    path_ = path;
+    blocks_.resize(kBlocks);
+    blockSizes_.assign(kBlocks, 0);
+    produced_ = 0;
+    consumed_ = 0;
+    finished_ = false;
+    stop_ = false;
+    compressedBytes_ = 0;
+    thread_ = std::thread(&ComtradeDecompressor::worker, this);
+    return true;
+}
+
+void ComtradeDecompressor::worker() {
+    for (;;) {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            blockFree_.wait(lock, [this] { return stop_ || produced_ - consumed_ < kBlocks; });
+            if (stop_) {
+                break;
+            }
+            slot = produced_ % kBlocks;
+        }
+
+        // The slot is not visible to the caller until produced_ moves past it
+        std::vector<char>& block = blocks_[slot];
+        block.resize(kBlockBytes);
+        std::string error;
+        size_t size = codec_->fill(block.data(), block.size(), error);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        compressedBytes_ = codec_->bytesRead();
+        if (size > 0) {
+            blockSizes_[slot] = size;
+            ++produced_;
+        }
+        if (!error.empty() || size < kBlockBytes) {
+            lastError_ = error.empty() ? error : error + ": " + path_;
+            finished_ = true;
+            blockReady_.notify_all();
+            break;
+        }
+        blockReady_.notify_all();
+    }
+}
+
+bool ComtradeDecompressor::next(const char*& data, size_t& size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    blockReady_.wait(lock, [this] { return finished_ || produced_ > consumed_; });
+    if (produced_ == consumed_) {
+        return false;
+    }
+    size_t slot = consumed_ % kBlocks;
+    data = blocks_[slot].data();
+    size = blockSizes_[slot];
+    return true;
+}
+
+void ComtradeDecompressor::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (consumed_ < produced_) {
+        ++consumed_;
+        blockFree_.notify_all();
+    }
+}
+
+void ComtradeDecompressor::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        blockFree_.notify_all();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    codec_.reset();
+    finished_ = true;
+    produced_ = 0;
+    consumed_ = 0;
+}
+
+uint64_t ComtradeDecompressor::compressedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return compressedBytes_;
+}
+
+std::string ComtradeDecompressor::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
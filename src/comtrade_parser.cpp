@@ -1,4 +1,11 @@
 #include "comtrade_parser.h"
+#include "comtrade_binary_reader.h"
+#include "comtrade_decoder.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "comtrade_cff.h"
+#include "comtrade_cache.h"
+#include "comtrade_decompressor.h"
 
 #include <fstream>
 #include <sstream>
@@ -6,9 +13,177 @@
 #include <cmath>
 #include <cstring>
 #include <cctype>
+#include <future>
+#include <limits>
+
+namespace {
+
+// Parse issues kept per load (further skipped lines are only counted)
+const size_t kMaxParseIssues = 100;
+
+// Smallest ASCII chunk handed to a worker
+const size_t kMinAsciiChunkBytes = 1 << 20;
+
+// Smallest binary record range handed to a worker
+const size_t kMinBinaryChunkRecords = 16384;
+
+// Read-only stream buffer over text that is already in memory
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, size_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+/**
+ * @brief One analog layout for the recording
+ */
+struct StorageChoice {
+    AnalogStorage storage;
+    bool raw;  // Columns hold raw .dat values
+};
+
+// Smallest layouts that hold the .dat values exactly, smallest first
+std::vector<StorageChoice> rawStorageChoices(const ComtradeConfig& config) {
+    switch (config.dataFormat) {
+        case DataFormat::BINARY:
+            return {{AnalogStorage::Int16, true}};
+        case DataFormat::BINARY32:
+            return {{AnalogStorage::Int32, true}};
+        case DataFormat::FLOAT32:
+            return {{AnalogStorage::Float, true}};
+        default:
+            break;
+    }
+    
+    // ASCII: the .cfg min/max suggest the width, the parse confirms it; a
+    // value that is not an integer falls back to doubles
+    bool fits16 = true;
+    for (const auto& channel : config.analogChannels) {
+        fits16 = fits16 && channel.min >= -32768.0 && channel.max <= 32767.0 && channel.min <= channel.max;
+    }
+    std::vector<StorageChoice> choices;
+    if (fits16) {
+        choices.push_back({AnalogStorage::Int16, true});
+    }
+    choices.push_back({AnalogStorage::Int32, true});
+    choices.push_back({AnalogStorage::Double, false});
+    return choices;
+}
+
+const char* storageName(const StorageChoice& choice) {
+    switch (choice.storage) {
+        case AnalogStorage::Double: return "double";
+        case AnalogStorage::Float:  return choice.raw ? "raw float" : "float";
+        case AnalogStorage::Int16:  return "raw int16";
+        default:                    return "raw int32";
+    }
+}
+
+void prepareRecording(ComtradeRecording& recording, const ComtradeConfig& config, const StorageChoice& choice) {
+    std::vector<AnalogScale> scales;
+    if (choice.raw) {
+        for (const auto& channel : config.analogChannels) {
+            scales.push_back(AnalogScale::forChannel(channel));
+        }
+    }
+    recording.reset(config.numAnalogChannels, config.numDigitalChannels);
+    recording.setAnalogStorage(choice.storage, scales);
+}
+
+uint64_t toMegabytes(uint64_t bytes) {
+    return (bytes + (1 << 20) - 1) >> 20;
+}
+
+// Bytes of a recording of numSamples in a layout
+uint64_t recordingBytes(const ComtradeConfig& config, size_t numSamples, AnalogStorage storage) {
+    return static_cast<uint64_t>(ComtradeRecording::estimateBytes(
+        numSamples, config.numAnalogChannels, config.numDigitalChannels, storage));
+}
+
+std::string budgetError(uint64_t bytes, const StorageChoice& choice, uint64_t budget) {
+    return "Recording needs " + std::to_string(toMegabytes(bytes)) + " MB as " + storageName(choice) +
+           ", memory budget is " + std::to_string(toMegabytes(budget)) + " MB";
+}
+
+// Layouts to try for the options, in order; empty (with an error) if none fits the budget
+std::vector<StorageChoice> storageChoices(const ComtradeConfig& config, const ComtradeLoadOptions& options,
+                                          size_t numSamples, std::string& error) {
+    auto bytes = [&](const StorageChoice& choice) {
+        return recordingBytes(config, numSamples, choice.storage);
+    };
+    const StorageChoice doubles = {AnalogStorage::Double, false};
+    uint64_t budget = options.memoryBudget;
+    
+    std::vector<StorageChoice> wanted;
+    switch (options.storage) {
+        case SampleStorage::Double:
+            wanted.push_back(doubles);
+            break;
+        case SampleStorage::Float:
+            wanted.push_back({AnalogStorage::Float, false});
+            break;
+        case SampleStorage::Raw:
+        case SampleStorage::Auto:
+            // Smallest first; Float is lossy, so never picked for a scaled format
+            wanted = rawStorageChoices(config);
+            break;
+        case SampleStorage::PreferDouble:
+            if (budget == 0 || bytes(doubles) <= budget) {
+                wanted.push_back(doubles);
+            } else {
+                wanted = rawStorageChoices(config);
+            }
+            break;
+    }
+    if (budget == 0) {
+        return wanted;
+    }
+    
+    std::vector<StorageChoice> choices;
+    for (const auto& choice : wanted) {
+        if (bytes(choice) <= budget) {
+            choices.push_back(choice);
+        }
+    }
+    if (choices.empty()) {
+        error = budgetError(bytes(wanted.front()), wanted.front(), budget);
+    }
+    return choices;
+}
+
+bool fileExists(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return file.is_open();
+}
+
+// Samples the .cfg declares (last rate entry's end sample), 0 if unknown
+uint64_t declaredSamples(const ComtradeConfig& config) {
+    if (config.sampleRates.empty() || config.sampleRates.back().endSample <= 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(config.sampleRates.back().endSample);
+}
+
+// Count lines to estimate an ASCII recording's size
+size_t countLines(const char* text, size_t size) {
+    size_t lines = 0;
+    const char* end = text + size;
+    for (const char* pos = text; pos < end; lines++) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (!newline) {
+            return lines + 1;
+        }
+        pos = newline + 1;
+    }
+    return lines;
+}
+
+} // namespace
 
 ComtradeParser::ComtradeParser() 
-    : loaded_(false) {
+    : skippedLines_(0), windowStart_(0), loaded_(false) {
 }
 
 ComtradeParser::~ComtradeParser() {
@@ -17,7 +192,11 @@ ComtradeParser::~ComtradeParser() {
 
 void ComtradeParser::clear() {
     config_ = ComtradeConfig();
-    samples_.clear();
+    recording_.clear();
+    skippedLines_ = 0;
+    windowStart_ = 0;
+    parseIssues_.clear();
+    cacheReport_ = ComtradeCacheReport();
     loaded_ = false;
     lastError_.clear();
 }
@@ -62,24 +241,74 @@ std::vector<std::string> ComtradeParser::splitLine(const std::string& line, char
     return tokens;
 }
 
-bool ComtradeParser::load(const std::string& cfgPath, const std::string& datPath) {
+bool ComtradeParser::load(const std::string& cfgPath, const std::string& datPath,
+                          const ComtradeLoadOptions& options) {
     clear();
+    options_ = options;
+    
+    std::string datFile = resolveDatPath(cfgPath, datPath);
+    if (!options_.useCache || windowed()) {
+        return loadSource(cfgPath, datFile);
+    }
+    
+    // Entries depend on the storage settings, not on the thread count
+    std::string variant = "storage=" + std::to_string(static_cast<int>(options_.storage)) +
+                          ";budget=" + std::to_string(options_.memoryBudget);
+    ComtradeCache cache(cfgPath, datFile, options_.cacheDir, variant, options_.paranoidCache,
+                        options_.cacheSource);
+    cacheReport_.path = cache.path();
+    
+    std::string cfgText;
+    cacheReport_.result = cache.load(cfgText, recording_, skippedLines_, cacheReport_.detail);
+    if (cacheReport_.result == CacheResult::Hit) {
+        MemoryStreamBuf cfgBuffer(cfgText.data(), cfgText.size());
+        std::istream cfgStream(&cfgBuffer);
+        if (parseCfgStream(cfgStream) &&
+            recording_.analogChannelCount() == config_.numAnalogChannels &&
+            recording_.digitalChannelCount() == config_.numDigitalChannels) {
+            config_.totalSamples = static_cast<int>(recording_.sampleCount());
+            loaded_ = true;
+            return true;
+        }
+        
+        // Entry does not describe a valid recording: fall back to the source
+        config_ = ComtradeConfig();
+        recording_.clear();
+        skippedLines_ = 0;
+        lastError_.clear();
+        cacheReport_.result = CacheResult::Stale;
+        cacheReport_.detail = "cached configuration does not match the cached data";
+    }
+    
+    if (!loadSource(cfgPath, datFile)) {
+        return false;
+    }
+    
+    // A failed write only costs the next load a full parse
+    std::string error;
+    cacheReport_.written = cache.store(recording_, skippedLines_, error);
+    if (!cacheReport_.written) {
+        cacheReport_.detail = error;
+    }
+    return true;
+}
+
+bool ComtradeParser::loadSource(const std::string& cfgPath, const std::string& datFile) {
+    // Single-file container: cfg and dat come from the same mapping
+    if (ComtradeCffFile::isCffPath(cfgPath)) {
+        return loadCff(cfgPath, true);
+    }
     
     // Parse configuration file
     if (!parseCfg(cfgPath)) {
         return false;
     }
     
-    // Determine .dat file path if not provided
-    std::string datFile = datPath;
-    if (datFile.empty()) {
-        // Replace .cfg extension with .dat
-        size_t dotPos = cfgPath.find_last_of('.');
-        if (dotPos != std::string::npos) {
-            datFile = cfgPath.substr(0, dotPos) + ".dat";
-        } else {
-            datFile = cfgPath + ".dat";
-        }
+    // Compressed .dat: decoded as the background thread inflates it
+    DatCompression compression = ComtradeDecompressor::compressionFor(datFile);
+    if (compression != DatCompression::None) {
+        loaded_ = parseDatCompressed(datFile, compression);
+        return loaded_;
     }
     
     // Parse data file based on format
@@ -89,10 +318,9 @@ bool ComtradeParser::load(const std::string& cfgPath, const std::string& datPath
             success = parseDatAscii(datFile);
             break;
         case DataFormat::BINARY:
-            success = parseDatBinary(datFile);
-            break;
         case DataFormat::BINARY32:
-            success = parseDatBinary32(datFile);
+        case DataFormat::FLOAT32:
+            success = parseDatBinary(datFile);
             break;
         default:
             setError("Unknown data format");
@@ -106,13 +334,111 @@ bool ComtradeParser::load(const std::string& cfgPath, const std::string& datPath
     return success;
 }
 
+bool ComtradeParser::loadConfig(const std::string& cfgPath) {
+    clear();
+    if (ComtradeCffFile::isCffPath(cfgPath)) {
+        return loadCff(cfgPath, false);
+    }
+    return parseCfg(cfgPath);
+}
+
+bool ComtradeParser::loadCff(const std::string& cffPath, bool loadData) {
+    ComtradeCffFile cff;
+    if (!cff.open(cffPath)) {
+        setError(cff.getLastError());
+        return false;
+    }
+    
+    // The cfg section is small: parse it through a stream over the mapping
+    MemoryStreamBuf cfgBuffer(cff.cfg().data, cff.cfg().size);
+    std::istream cfgStream(&cfgBuffer);
+    if (!parseCfgStream(cfgStream)) {
+        return false;
+    }
+    if (!loadData) {
+        return true;
+    }
+    
+    bool binary = config_.dataFormat != DataFormat::ASCII;
+    if (binary != cff.datIsBinary()) {
+        setError(std::string(".cff DAT section is ") + (cff.datIsBinary() ? "binary" : "ASCII") +
+                 " but the CFG section declares another format");
+        return false;
+    }
+    
+    // The dat section is decoded in place
+    const CffSection& dat = cff.dat();
+    cff.file().advise(MappedFile::Access::Sequential, dat.offset(cff.file()), dat.size);
+    bool success;
+    if (binary) {
+        size_t numRecords = 0;
+        std::string error;
+        ComtradeDecoder decoder(config_);
+        if (!ComtradeBinaryReader::countRecords(dat.size, decoder.layout(), config_, numRecords, error)) {
+            setError(error);
+            return false;
+        }
+        success = decodeBinaryRecords(reinterpret_cast<const uint8_t*>(dat.data), numRecords);
+    } else {
+        success = parseAsciiText(dat.data, dat.size);
+    }
+    
+    loaded_ = success;
+    return success;
+}
+
+bool ComtradeParser::estimateLoadBytes(const ComtradeConfig& config, const ComtradeLoadOptions& options,
+                                       uint64_t& bytes) {
+    uint64_t first = 0;
+    uint64_t last = declaredSamples(config);
+    if (options.startTime > 0.0 || options.endTime > 0.0) {
+        sampleWindowFromRates(config, options.startTime, options.endTime, first, last);
+    }
+    size_t numSamples = static_cast<size_t>(last - first);
+    std::string error;
+    std::vector<StorageChoice> choices = storageChoices(config, options, numSamples, error);
+    if (choices.empty()) {
+        bytes = 0;
+        return false;
+    }
+    bytes = ComtradeRecording::estimateBytes(numSamples, config.numAnalogChannels, config.numDigitalChannels,
+                                             choices.front().storage);
+    return true;
+}
+
+std::string ComtradeParser::datPathFor(const std::string& cfgPath) {
+    // Replace .cfg extension with .dat
+    size_t dotPos = cfgPath.find_last_of('.');
+    if (dotPos != std::string::npos) {
+        return cfgPath.substr(0, dotPos) + ".dat";
+    }
+    return cfgPath + ".dat";
+}
+
+std::string ComtradeParser::resolveDatPath(const std::string& cfgPath, const std::string& datPath) {
+    std::string datFile = datPath.empty() ? datPathFor(cfgPath) : datPath;
+    if (datPath.empty() && !fileExists(datFile)) {
+        // Archived recordings keep only the compressed .dat
+        for (const char* suffix : {".gz", ".zst"}) {
+            if (fileExists(datFile + suffix)) {
+                datFile += suffix;
+                break;
+            }
+        }
+    }
+    return datFile;
+}
+
 bool ComtradeParser::parseCfg(const std::string& cfgPath) {
     std::ifstream file(cfgPath);
     if (!file.is_open()) {
         setError("Failed to open .cfg file: " + cfgPath);
         return false;
     }
-    
+    return parseCfgStream(file);
+}
+
+bool ComtradeParser::parseCfgStream(std::istream& file) {
     std::string line;
     int lineNum = 0;
     
@@ -259,6 +585,8 @@ bool ComtradeParser::parseCfg(const std::string& cfgPath) {
             config_.dataFormat = DataFormat::BINARY;
         } else if (formatStr == "BINARY32") {
             config_.dataFormat = DataFormat::BINARY32;
+        } else if (formatStr == "FLOAT32") {
+            config_.dataFormat = DataFormat::FLOAT32;
         } else {
             setError("Unknown data format: " + formatStr);
             return false;
@@ -330,206 +658,518 @@ bool ComtradeParser::parseDigitalChannelLine(const std::string& line, DigitalCha
 }
 
 bool ComtradeParser::parseDatAscii(const std::string& datPath) {
-    std::ifstream file(datPath);
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.open(datPath)) {
         setError("Failed to open .dat file: " + datPath);
         return false;
     }
+    file.advise(MappedFile::Access::Sequential);
+    return parseAsciiText(reinterpret_cast<const char*>(file.data()), file.size());
+}
+
+bool ComtradeParser::parseAsciiText(const char* text, size_t size) {
+    // A window is cut from the text before anything is parsed
+    uint64_t firstLine = 0;
+    bool byRate = false;
+    if (windowed()) {
+        uint64_t last = 0;
+        byRate = sampleWindowFromRates(config_, options_.startTime, options_.endTime, firstLine, last);
+        if (byRate) {
+            AsciiLineIndex lines(text, size);
+            size_t begin = lines.lineStart(firstLine);
+            size_t end = lines.lineStart(last);
+            text += begin;
+            size = end - begin;
+            windowStart_ = firstLine;
+        }
+    }
+    if (!parseAsciiWindow(text, size)) {
+        return false;
+    }
+    for (auto& issue : parseIssues_) {
+        issue.line += firstLine;
+    }
+    if (windowed() && !byRate) {
+        trimToTimeWindow();
+    }
+    return true;
+}
+
+bool ComtradeParser::parseAsciiWindow(const char* text, size_t size) {
+    // The sample count only matters against a budget
+    size_t estimate = options_.memoryBudget > 0 ? countLines(text, size) : 0;
+    std::string error;
+    std::vector<StorageChoice> choices = storageChoices(config_, options_, estimate, error);
+    if (choices.empty()) {
+        setError(error);
+        return false;
+    }
     
-    std::string line;
-    samples_.clear();
+    // Raw columns are confirmed by the parse itself: a value that does not
+    // fit sends it to the next (wider) layout
+    for (const auto& choice : choices) {
+        skippedLines_ = 0;
+        parseIssues_.clear();
+        if (parseAsciiChunks(text, size, choice.storage, choice.raw)) {
+            return true;
+        }
+    }
+    recording_.clear();
+    setError(std::string("ASCII .dat values do not fit ") + storageName(choices.back()) +
+             " storage and wider storage exceeds the memory budget");
+    return false;
+}
+
+bool ComtradeParser::parseAsciiChunks(const char* text, size_t size, AnalogStorage storage, bool raw) {
+    const StorageChoice choice = {storage, raw};
+    prepareRecording(recording_, config_, choice);
+    const char* textEnd = text + size;
     
-    while (std::getline(file, line)) {
-        auto tokens = splitLine(line);
-        
-        // ASCII format: sample#, time, A1, A2, ..., AN, D1, D2, ..., DN (one token per digital)
-        size_t expectedTokens = 2 + config_.numAnalogChannels + config_.numDigitalChannels;
-        
-        if (tokens.size() < expectedTokens) {
-            continue;  // Skip incomplete lines
+    // Split at line boundaries into a few chunks per worker
+    unsigned numThreads = options_.numThreads > 0 ? options_.numThreads : ThreadPool::defaultThreadCount();
+    size_t numChunks = std::max<size_t>(1, std::min<size_t>(numThreads * 4, size / kMinAsciiChunkBytes));
+    if (numThreads == 1) {
+        numChunks = 1;
+    }
+    
+    if (numChunks == 1) {
+        if (!windowed() && !config_.sampleRates.empty() && config_.sampleRates.back().endSample > 0) {
+            recording_.reserve(static_cast<size_t>(config_.sampleRates.back().endSample));
         }
-        
-        try {
-            ComtradeSample sample;
-            sample.sampleNumber = std::stoi(tokens[0]);
-            
-            // Timestamp: preserve fractional seconds, apply timeFactor, store as microseconds
-            double timeSec = std::stod(tokens[1]) * config_.timeFactor;
-            sample.timestamp = static_cast<uint64_t>(timeSec * 1e6);  // Convert to microseconds
-            
-            // Parse analog values with full scaling: engSecondary = a * raw + b, then engPrimary = engSecondary * (primary/secondary)
-            sample.analogValues.reserve(config_.numAnalogChannels);
-            for (int i = 0; i < config_.numAnalogChannels; i++) {
-                double rawValue = std::stod(tokens[2 + i]);
-                const auto& channel = config_.analogChannels[i];
-                double engSecondary = channel.a * rawValue + channel.b;
-                
-                // Apply CT/PT ratio to get primary values
-                double ctPtRatio = (channel.secondary != 0.0) ? (channel.primary / channel.secondary) : 1.0;
-                double engPrimary = engSecondary * ctPtRatio;
+        ComtradeDecoder decoder(config_);
+        AsciiBlockResult result = decoder.parseAsciiBlock(text, textEnd, recording_, kMaxParseIssues);
+        if (result.rawOverflow) {
+            return false;
+        }
+        skippedLines_ = result.skipped;
+        parseIssues_ = std::move(result.issues);
+        recording_.buildDigitalEdges();
+        config_.totalSamples = static_cast<int>(recording_.sampleCount());
+        return true;
+    }
+    
+    std::vector<const char*> bounds(1, text);
+    for (size_t i = 1; i < numChunks; i++) {
+        const char* target = text + size * i / numChunks;
+        if (target <= bounds.back()) {
+            continue;
+        }
+        const char* newline = static_cast<const char*>(std::memchr(target, '\n', textEnd - target));
+        if (!newline) {
+            break;
+        }
+        bounds.push_back(newline + 1);
+    }
+    bounds.push_back(textEnd);
+    numChunks = bounds.size() - 1;
+    
+    // Parse every chunk into its own recording
+    std::vector<ComtradeRecording> parts(numChunks);
+    std::vector<AsciiBlockResult> results(numChunks);
+    {
+        ThreadPool pool(std::min<unsigned>(numThreads, static_cast<unsigned>(numChunks)));
+        std::vector<std::future<void>> done;
+        for (size_t i = 0; i < numChunks; i++) {
+            done.push_back(pool.submit([this, i, &choice, &bounds, &parts, &results] {
+                const char* begin = bounds[i];
+                const char* end = bounds[i + 1];
+                prepareRecording(parts[i], config_, choice);
                 
-                sample.analogValues.push_back(engPrimary);
+                // Size the columns from the first line's length
+                const char* firstNewline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                if (firstNewline && firstNewline > begin) {
+                    parts[i].reserve(static_cast<size_t>(end - begin) / static_cast<size_t>(firstNewline + 1 - begin) + 16);
+                }
+                ComtradeDecoder decoder(config_);
+                results[i] = decoder.parseAsciiBlock(begin, end, parts[i], kMaxParseIssues);
+            }));
+        }
+        for (auto& task : done) {
+            task.get();
+        }
+        for (const auto& result : results) {
+            if (result.rawOverflow) {
+                return false;
             }
-            
-            // Parse digital values (ASCII format: one token per digital, not bit-packed)
-            sample.digitalValues.reserve(config_.numDigitalChannels);
-            for (int i = 0; i < config_.numDigitalChannels; i++) {
-                int digitalValue = std::stoi(tokens[2 + config_.numAnalogChannels + i]);
-                sample.digitalValues.push_back(digitalValue != 0);
+        }
+        
+        // Merge in file order: line numbers become global, rows land at their offsets
+        std::vector<size_t> firstRow(numChunks);
+        size_t totalRows = 0;
+        uint64_t lineOffset = 0;
+        for (size_t i = 0; i < numChunks; i++) {
+            firstRow[i] = totalRows;
+            totalRows += parts[i].sampleCount();
+            skippedLines_ += results[i].skipped;
+            for (const auto& issue : results[i].issues) {
+                if (parseIssues_.size() < kMaxParseIssues) {
+                    parseIssues_.push_back(ComtradeParseIssue{lineOffset + issue.line, issue.message});
+                }
             }
-            
-            samples_.push_back(sample);
-            
-        } catch (const std::exception&) {
-            continue;  // Skip invalid lines
+            lineOffset += results[i].lines;
+        }
+        
+        recording_.resize(totalRows);
+        done.clear();
+        for (size_t i = 0; i < numChunks; i++) {
+            done.push_back(pool.submit([this, i, &parts, &firstRow] {
+                recording_.copyRowsWithoutDigital(parts[i], 0, parts[i].sampleCount(), firstRow[i]);
+            }));
+        }
+        for (auto& task : done) {
+            task.get();
+        }
+        
+        // Neighbouring parts can share a 64-row digital word: merge those in order
+        for (size_t i = 0; i < numChunks; i++) {
+            recording_.copyDigitalRows(parts[i], 0, parts[i].sampleCount(), firstRow[i]);
+            parts[i].clear();
         }
     }
     
-    config_.totalSamples = static_cast<int>(samples_.size());
+    recording_.buildDigitalEdges();
+    config_.totalSamples = static_cast<int>(recording_.sampleCount());
     return true;
 }
 
 bool ComtradeParser::parseDatBinary(const std::string& datPath) {
-    std::ifstream file(datPath, std::ios::binary);
-    if (!file.is_open()) {
-        setError("Failed to open binary .dat file: " + datPath);
+    // BINARY, BINARY32 and FLOAT32 differ only in field widths, handled by the record layout
+    ComtradeBinaryReader reader;
+    if (!reader.open(datPath, config_)) {
+        setError(reader.getLastError());
         return false;
     }
+    return decodeBinaryRecords(reader.file().data(), reader.recordCount());
+}
+
+bool ComtradeParser::decodeBinaryRecords(const uint8_t* records, size_t numRecords) {
+    // Records are fixed-size: a window is a plain index range
+    uint64_t first = 0;
+    uint64_t last = numRecords;
+    bool byRate = windowed() &&
+                  sampleWindowFromRates(config_, options_.startTime, options_.endTime, first, last);
+    if (byRate) {
+        last = std::min<uint64_t>(last, numRecords);
+        first = std::min(first, last);
+        windowStart_ = first;
+    }
+    if (!decodeBinaryRange(records + first * BinaryRecordLayout::forConfig(config_).recordSize,
+                           static_cast<size_t>(last - first))) {
+        return false;
+    }
+    if (windowed() && !byRate) {
+        trimToTimeWindow();
+    }
+    return true;
+}
+
+bool ComtradeParser::decodeBinaryRange(const uint8_t* records, size_t numRecords) {
+    // Record count is known up front: size every column once and fill in place
+    std::string error;
+    std::vector<StorageChoice> choices = storageChoices(config_, options_, numRecords, error);
+    if (choices.empty()) {
+        setError(error);
+        return false;
+    }
+    prepareRecording(recording_, config_, choices.front());
+    recording_.resize(numRecords);
     
-    samples_.clear();
+    // Records are fixed-size: each worker decodes its own index range into
+    // its own rows, so the result is the same for any thread count
+    ComtradeDecoder decoder(config_);
+    size_t recordSize = decoder.layout().recordSize;
+    unsigned numThreads = options_.numThreads > 0 ? options_.numThreads : ThreadPool::defaultThreadCount();
+    size_t numChunks = std::min<size_t>(numThreads * 4, numRecords / kMinBinaryChunkRecords);
     
-    // Each record: 4 bytes sample#, 4 bytes timestamp, 2 bytes per analog, 2 bytes per 16 digitals
-    size_t recordSize = 8 + config_.numAnalogChannels * 2 + 
-                       ((config_.numDigitalChannels + 15) / 16) * 2;
+    if (numThreads == 1 || numChunks <= 1) {
+        decoder.decodeBinary(records, numRecords, recording_, 0);
+    } else {
+        ThreadPool pool(numThreads);
+        std::vector<std::future<void>> done;
+        for (size_t i = 0; i < numChunks; i++) {
+            // Chunks start on 64-row boundaries so no two share a digital word
+            size_t first = numRecords * i / numChunks / 64 * 64;
+            size_t count = (i + 1 == numChunks ? numRecords : numRecords * (i + 1) / numChunks / 64 * 64) - first;
+            done.push_back(pool.submit([this, &decoder, records, recordSize, first, count] {
+                decoder.decodeBinary(records + first * recordSize, count, recording_, first);
+            }));
+        }
+        for (auto& task : done) {
+            task.get();
+        }
+    }
     
-    std::vector<char> buffer(recordSize);
+    recording_.buildDigitalEdges();
+    config_.totalSamples = static_cast<int>(numRecords);
+    return true;
+}
+
+bool ComtradeParser::parseDatCompressed(const std::string& datPath, DatCompression compression) {
+    // The data arrives in order: a window is located by counting records or lines
+    uint64_t first = 0;
+    uint64_t last = std::numeric_limits<uint64_t>::max();
+    bool byRate = windowed() &&
+                  sampleWindowFromRates(config_, options_.startTime, options_.endTime, first, last);
+    if (byRate) {
+        windowStart_ = first;
+    }
     
-    while (file.read(buffer.data(), recordSize)) {
-        ComtradeSample sample;
-        
-        // Read sample number and timestamp
-        uint32_t sampleNum, timestampRaw;
-        std::memcpy(&sampleNum, buffer.data(), 4);
-        std::memcpy(&timestampRaw, buffer.data() + 4, 4);
-        sample.sampleNumber = static_cast<int>(sampleNum);
-        
-        // Apply timeFactor and store as microseconds
-        double timeSec = static_cast<double>(timestampRaw) * config_.timeFactor;
-        sample.timestamp = static_cast<uint64_t>(timeSec * 1e6);
-        
-        // Read analog values (16-bit signed integers) with full scaling
-        sample.analogValues.reserve(config_.numAnalogChannels);
-        for (int i = 0; i < config_.numAnalogChannels; i++) {
-            int16_t rawValue;
-            std::memcpy(&rawValue, buffer.data() + 8 + i * 2, 2);
-            
-            const auto& channel = config_.analogChannels[i];
-            double engSecondary = channel.a * static_cast<double>(rawValue) + channel.b;
-            
-            // Apply CT/PT ratio to get primary values
-            double ctPtRatio = (channel.secondary != 0.0) ? (channel.primary / channel.secondary) : 1.0;
-            double engPrimary = engSecondary * ctPtRatio;
-            
-            sample.analogValues.push_back(engPrimary);
+    if (config_.dataFormat != DataFormat::ASCII) {
+        ComtradeDecompressor input;
+        if (!input.open(datPath, compression)) {
+            setError(input.getLastError());
+            return false;
+        }
+        if (!decodeBinaryCompressed(input, first, last)) {
+            return false;
+        }
+    } else {
+        uint64_t declared = declaredSamples(config_);
+        size_t estimate = declared > first ? static_cast<size_t>(std::min(last, declared) - first) : 0;
+        std::string error;
+        std::vector<StorageChoice> choices = storageChoices(config_, options_, estimate, error);
+        if (choices.empty()) {
+            setError(error);
+            return false;
         }
         
-        // Read digital values (bit-packed in binary format)
-        size_t digitalOffset = 8 + config_.numAnalogChannels * 2;
-        int numDigitalWords = (config_.numDigitalChannels + 15) / 16;
-        
-        sample.digitalValues.reserve(config_.numDigitalChannels);
-        for (int w = 0; w < numDigitalWords; w++) {
-            uint16_t digitalWord;
-            std::memcpy(&digitalWord, buffer.data() + digitalOffset + w * 2, 2);
-            
-            for (int b = 0; b < 16 && (w * 16 + b) < config_.numDigitalChannels; b++) {
-                bool bitValue = (digitalWord & (1u << b)) != 0;
-                sample.digitalValues.push_back(bitValue);
+        // As for mapped text, a value that does not fit a raw layout restarts
+        // the parse (and the decompression) with the next one
+        bool parsed = false;
+        for (const auto& choice : choices) {
+            bool overflow = false;
+            skippedLines_ = 0;
+            parseIssues_.clear();
+            if (parseAsciiCompressed(datPath, compression, choice.storage, choice.raw, first, last, overflow)) {
+                parsed = true;
+                break;
+            }
+            if (!overflow) {
+                return false;
             }
         }
-        
-        samples_.push_back(sample);
+        if (!parsed) {
+            recording_.clear();
+            setError(std::string("ASCII .dat values do not fit ") + storageName(choices.back()) +
+                     " storage and wider storage exceeds the memory budget");
+            return false;
+        }
     }
     
-    config_.totalSamples = static_cast<int>(samples_.size());
+    recording_.buildDigitalEdges();
+    config_.totalSamples = static_cast<int>(recording_.sampleCount());
+    if (windowed() && !byRate) {
+        trimToTimeWindow();
+    }
     return true;
 }
 
-bool ComtradeParser::parseDatBinary32(const std::string& datPath) {
-    std::ifstream file(datPath, std::ios::binary);
-    if (!file.is_open()) {
-        setError("Failed to open binary32 .dat file: " + datPath);
+bool ComtradeParser::decodeBinaryCompressed(ComtradeDecompressor& input, uint64_t first, uint64_t last) {
+    ComtradeDecoder decoder(config_);
+    size_t recordSize = decoder.layout().recordSize;
+    uint64_t declared = declaredSamples(config_);
+    if (declared > 0) {
+        last = std::min(last, declared);
+    }
+    
+    size_t estimate = declared > first ? static_cast<size_t>(last - first) : 0;
+    std::string error;
+    std::vector<StorageChoice> choices = storageChoices(config_, options_, estimate, error);
+    if (choices.empty()) {
+        setError(error);
         return false;
     }
+    const StorageChoice choice = choices.front();
+    prepareRecording(recording_, config_, choice);
+    recording_.reserve(estimate);
     
-    samples_.clear();
+    // Decode the whole records of a block that fall in [first, last); false
+    // (with the error set) once they would take the recording past the budget,
+    // which the estimate misses when the .cfg undercounts the samples
+    uint64_t record = 0;    // .dat index of the next record
+    auto decodeRecords = [&](const uint8_t* records, size_t count) {
+        uint64_t begin = std::max(record, first);
+        uint64_t end = std::min<uint64_t>(record + count, last);
+        if (begin < end) {
+            size_t row = recording_.sampleCount();
+            size_t rows = row + static_cast<size_t>(end - begin);
+            uint64_t bytes = recordingBytes(config_, rows, choice.storage);
+            if (options_.memoryBudget > 0 && bytes > options_.memoryBudget) {
+                recording_.clear();
+                setError(budgetError(bytes, choice, options_.memoryBudget));
+                return false;
+            }
+            recording_.resize(rows);
+            decoder.decodeBinary(records + (begin - record) * recordSize, static_cast<size_t>(end - begin),
+                                 recording_, row);
+        }
+        record += count;
+        return true;
+    };
     
-    size_t recordSize = 8 + config_.numAnalogChannels * 4 + 
-                       ((config_.numDigitalChannels + 31) / 32) * 4;
+    // A record split between two blocks is reassembled in `carry`
+    std::vector<uint8_t> carry;
+    carry.reserve(recordSize);
+    uint64_t totalBytes = 0;
+    const char* data;
+    size_t size;
+    while (record < last && input.next(data, size)) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        totalBytes += size;
+        if (!carry.empty()) {
+            size_t take = std::min(recordSize - carry.size(), size);
+            carry.insert(carry.end(), bytes, bytes + take);
+            bytes += take;
+            size -= take;
+            if (carry.size() == recordSize) {
+                if (!decodeRecords(carry.data(), 1)) {
+                    return false;
+                }
+                carry.clear();
+            }
+        }
+        if (carry.empty()) {
+            size_t count = size / recordSize;
+            if (!decodeRecords(bytes, count)) {
+                return false;
+            }
+            carry.assign(bytes + count * recordSize, bytes + size);
+        }
+        input.release();
+    }
     
-    std::vector<char> buffer(recordSize);
+    if (!input.getLastError().empty()) {
+        setError(input.getLastError());
+        return false;
+    }
+    if (record < last) {
+        // Whole file read: same size checks as a mapped .dat
+        size_t count = 0;
+        if (!ComtradeBinaryReader::countRecords(totalBytes, decoder.layout(), config_, count, error)) {
+            setError(error);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ComtradeParser::parseAsciiCompressed(const std::string& datPath, DatCompression compression,
+                                          AnalogStorage storage, bool raw, uint64_t first, uint64_t last,
+                                          bool& overflow) {
+    overflow = false;
+    ComtradeDecompressor input;
+    if (!input.open(datPath, compression)) {
+        setError(input.getLastError());
+        return false;
+    }
+    prepareRecording(recording_, config_, StorageChoice{storage, raw});
+    uint64_t declared = declaredSamples(config_);
+    if (!windowed() && declared > 0) {
+        recording_.reserve(static_cast<size_t>(declared));
+    }
     
-    while (file.read(buffer.data(), recordSize)) {
-        ComtradeSample sample;
-        
-        uint32_t sampleNum, timestampRaw;
-        std::memcpy(&sampleNum, buffer.data(), 4);
-        std::memcpy(&timestampRaw, buffer.data() + 4, 4);
-        sample.sampleNumber = static_cast<int>(sampleNum);
-        
-        // Apply timeFactor and store as microseconds
-        double timeSec = static_cast<double>(timestampRaw) * config_.timeFactor;
-        sample.timestamp = static_cast<uint64_t>(timeSec * 1e6);
-        
-        // Read analog values (32-bit signed integers) with full scaling
-        sample.analogValues.reserve(config_.numAnalogChannels);
-        for (int i = 0; i < config_.numAnalogChannels; i++) {
-            int32_t rawValue;
-            std::memcpy(&rawValue, buffer.data() + 8 + i * 4, 4);
-            
-            const auto& channel = config_.analogChannels[i];
-            double engSecondary = channel.a * static_cast<double>(rawValue) + channel.b;
-            
-            // Apply CT/PT ratio to get primary values
-            double ctPtRatio = (channel.secondary != 0.0) ? (channel.primary / channel.secondary) : 1.0;
-            double engPrimary = engSecondary * ctPtRatio;
-            
-            sample.analogValues.push_back(engPrimary);
+    // Parse the complete lines in [begin, end) that fall in [first, last);
+    // false if a value did not fit the raw storage (overflow set) or the
+    // recording grew past the memory budget (error set)
+    const StorageChoice choice = {storage, raw};
+    ComtradeDecoder decoder(config_);
+    uint64_t line = 0;      // .dat index of the next line
+    auto parseLines = [&](const char* begin, const char* end) {
+        for (; line < first && begin < end; line++) {
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            begin = newline ? newline + 1 : end;
         }
-        
-        // Read digital values (bit-packed in binary format)
-        size_t digitalOffset = 8 + config_.numAnalogChannels * 4;
-        int numDigitalWords = (config_.numDigitalChannels + 31) / 32;
-        
-        sample.digitalValues.reserve(config_.numDigitalChannels);
-        for (int w = 0; w < numDigitalWords; w++) {
-            uint32_t digitalWord;
-            std::memcpy(&digitalWord, buffer.data() + digitalOffset + w * 4, 4);
-            
-            for (int b = 0; b < 32 && (w * 32 + b) < config_.numDigitalChannels; b++) {
-                bool bitValue = (digitalWord & (1u << b)) != 0;
-                sample.digitalValues.push_back(bitValue);
+        if (last != std::numeric_limits<uint64_t>::max()) {
+            const char* stop = begin;
+            for (uint64_t n = line; n < last && stop < end; n++) {
+                const char* newline = static_cast<const char*>(std::memchr(stop, '\n', end - stop));
+                stop = newline ? newline + 1 : end;
             }
+            end = stop;
+        }
+        if (begin >= end) {
+            return true;
+        }
+        AsciiBlockResult result = decoder.parseAsciiBlock(begin, end, recording_, kMaxParseIssues);
+        if (result.rawOverflow) {
+            overflow = true;
+            return false;
+        }
+        skippedLines_ += result.skipped;
+        for (const auto& issue : result.issues) {
+            if (parseIssues_.size() < kMaxParseIssues) {
+                parseIssues_.push_back(ComtradeParseIssue{line + issue.line, issue.message});
+            }
+        }
+        line += result.lines;
+        uint64_t bytes = recordingBytes(config_, recording_.sampleCount(), storage);
+        if (options_.memoryBudget > 0 && bytes > options_.memoryBudget) {
+            recording_.clear();
+            setError(budgetError(bytes, choice, options_.memoryBudget));
+            return false;
+        }
+        return true;
+    };
+    
+    // A line split between two blocks is reassembled in `carry`
+    std::string carry;
+    const char* data;
+    size_t size;
+    while (line < last && input.next(data, size)) {
+        const char* end = data + size;
+        const char* lastNewline = end;
+        while (lastNewline > data && lastNewline[-1] != '\n') {
+            lastNewline--;
+        }
+        if (lastNewline == data) {
+            carry.append(data, size);
+            input.release();
+            continue;
         }
         
-        samples_.push_back(sample);
+        const char* begin = data;
+        if (!carry.empty()) {
+            const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+            carry.append(data, newline + 1);
+            if (!parseLines(carry.data(), carry.data() + carry.size())) {
+                return false;
+            }
+            begin = newline + 1;
+        }
+        if (!parseLines(begin, lastNewline)) {
+            return false;
+        }
+        carry.assign(lastNewline, end);
+        input.release();
+    }
+    
+    if (!input.getLastError().empty()) {
+        setError(input.getLastError());
+        return false;
     }
     
-    config_.totalSamples = static_cast<int>(samples_.size());
+    // Last line without a newline
+    if (!parseLines(carry.data(), carry.data() + carry.size())) {
+        return false;
+    }
     return true;
 }
 
 bool ComtradeParser::getSample(int index, ComtradeSample& sample) const {
-    if (index < 0 || index >= static_cast<int>(samples_.size())) {
+    if (index < 0 || index >= static_cast<int>(recording_.sampleCount())) {
         return false;
     }
     
-    sample = samples_[index];
+    recording_.getSample(static_cast<size_t>(index), sample);
     return true;
 }
 
 std::vector<ComtradeSample> ComtradeParser::getAllSamples() const {
-    return samples_;
+    std::vector<ComtradeSample> samples(recording_.sampleCount());
+    for (size_t i = 0; i < samples.size(); i++) {
+        recording_.getSample(i, samples[i]);
+    }
+    return samples;
 }
 
 double ComtradeParser::getSampleRate(int sampleIndex) const {
@@ -546,6 +1186,28 @@ double ComtradeParser::getSampleRate(int sampleIndex) const {
     return 0.0;
 }
 
+void ComtradeParser::trimToTimeWindow() {
+    ComtradeRecordingView window = getTimeRange(options_.startTime, options_.endTime);
+    windowStart_ = window.firstIndex();
+    recording_.keepRows(window.firstIndex(), window.sampleCount());
+    config_.totalSamples = static_cast<int>(recording_.sampleCount());
+}
+
+AnalogColumn ComtradeParser::getAnalogData(const std::string& name) const {
+    const AnalogChannel* channel = getAnalogChannel(name);
+    if (!channel || channel->index < 0 || channel->index >= recording_.analogChannelCount()) {
+        return AnalogColumn();
+    }
+    return recording_.analogColumn(channel->index);
+}
+
+ComtradeRecordingView ComtradeParser::getTimeRange(double startSeconds, double endSeconds) const {
+    uint64_t startUs = startSeconds > 0.0 ? static_cast<uint64_t>(std::llround(startSeconds * 1e6)) : 0;
+    uint64_t endUs = endSeconds > 0.0 ? static_cast<uint64_t>(std::llround(endSeconds * 1e6))
+                                      : std::numeric_limits<uint64_t>::max();
+    return recording_.timeRange(startUs, endUs);
+}
+
 const AnalogChannel* ComtradeParser::getAnalogChannel(const std::string& name) const {
     for (const auto& channel : config_.analogChannels) {
         if (channel.name == name) {
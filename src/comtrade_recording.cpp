@@ -0,0 +1,346 @@
+#include "comtrade_recording.h"
+#include "comtrade_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+template <typename F>
+void ComtradeRecording::forEachColumn(F f) {
+    // Inactive analog sets have no columns, so this touches only live data
+    for (auto& column : analog_) {
+        f(column);
+    }
+    for (auto& column : analogFloat_) {
+        f(column);
+    }
+    for (auto& column : analog16_) {
+        f(column);
+    }
+    for (auto& column : analog32_) {
+        f(column);
+    }
+}
+
+namespace {
+
+// Index of the lowest set bit (value != 0)
+int countTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Bits [bit, bit + count) of a plane, count <= 64
+uint64_t readBits(const uint64_t* words, size_t bit, size_t count) {
+    size_t shift = bit % 64;
+    uint64_t value = words[bit / 64] >> shift;
+    if (shift != 0 && shift + count > 64) {
+        value |= words[bit / 64 + 1] << (64 - shift);
+    }
+    return count == 64 ? value : value & ((uint64_t(1) << count) - 1);
+}
+
+// Copy count bits between planes at any bit offsets; other bits of the
+// destination words are kept
+void copyBits(const uint64_t* src, size_t srcBit, uint64_t* dst, size_t dstBit, size_t count) {
+    while (count > 0) {
+        size_t shift = dstBit % 64;
+        size_t n = std::min<size_t>(64 - shift, count);
+        uint64_t mask = (n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1) << shift;
+        uint64_t& word = dst[dstBit / 64];
+        word = (word & ~mask) | ((readBits(src, srcBit, n) << shift) & mask);
+        srcBit += n;
+        dstBit += n;
+        count -= n;
+    }
+}
+
+} // namespace
+
+void ComtradeRecording::reset(int numAnalog, int numDigital) {
+    // Surviving columns keep their capacity, so a reused block does not reallocate
+    numAnalog_ = numAnalog;
+    analog_.resize(storage_ == AnalogStorage::Double ? numAnalog : 0);
+    analogFloat_.resize(storage_ == AnalogStorage::Float ? numAnalog : 0);
+    analog16_.resize(storage_ == AnalogStorage::Int16 ? numAnalog : 0);
+    analog32_.resize(storage_ == AnalogStorage::Int32 ? numAnalog : 0);
+    digital_.resize(numDigital);
+    if (!scales_.empty()) {
+        scales_.resize(numAnalog);
+    }
+    edges_.clear();
+    resize(0);
+}
+
+void ComtradeRecording::setAnalogStorage(AnalogStorage storage, const std::vector<AnalogScale>& scales) {
+    if (storage != storage_) {
+        analog_.clear();
+        analogFloat_.clear();
+        analog16_.clear();
+        analog32_.clear();
+        storage_ = storage;
+    }
+    scales_ = scales;
+    reset(numAnalog_, digitalChannelCount());
+}
+
+void ComtradeRecording::resize(size_t numSamples) {
+    forEachColumn([numSamples](auto& column) { column.resize(numSamples); });
+    size_t words = digitalWordCount(numSamples);
+    for (auto& column : digital_) {
+        column.resize(words);
+        if (numSamples % 64 != 0) {
+            // Keep the bits past the last sample zero, so growing again reads zeros
+            column.back() &= (uint64_t(1) << (numSamples % 64)) - 1;
+        }
+    }
+    timestamps_.resize(numSamples);
+    sampleNumbers_.resize(numSamples);
+}
+
+void ComtradeRecording::reserve(size_t numSamples) {
+    forEachColumn([numSamples](auto& column) { column.reserve(numSamples); });
+    for (auto& column : digital_) {
+        column.reserve(digitalWordCount(numSamples));
+    }
+    timestamps_.reserve(numSamples);
+    sampleNumbers_.reserve(numSamples);
+}
+
+void ComtradeRecording::append(int sampleNumber, uint64_t timestamp,
+                               const double* analog, const uint8_t* digital) {
+    for (size_t ch = 0; ch < analog_.size(); ch++) {
+        analog_[ch].push_back(analog[ch]);
+    }
+    for (size_t ch = 0; ch < analogFloat_.size(); ch++) {
+        analogFloat_[ch].push_back(static_cast<float>(analog[ch]));
+    }
+    size_t index = timestamps_.size();
+    if (index % 64 == 0) {
+        for (auto& column : digital_) {
+            column.push_back(0);
+        }
+    }
+    for (size_t ch = 0; ch < digital_.size(); ch++) {
+        digital_[ch].back() |= static_cast<uint64_t>(digital[ch] != 0) << (index % 64);
+    }
+    timestamps_.push_back(timestamp);
+    sampleNumbers_.push_back(sampleNumber);
+}
+
+void ComtradeRecording::copyRows(const ComtradeRecording& src, size_t srcFirst, size_t count, size_t dstFirst) {
+    copyRowsWithoutDigital(src, srcFirst, count, dstFirst);
+    copyDigitalRows(src, srcFirst, count, dstFirst);
+}
+
+void ComtradeRecording::copyDigitalRows(const ComtradeRecording& src, size_t srcFirst, size_t count, size_t dstFirst) {
+    for (size_t ch = 0; ch < digital_.size(); ch++) {
+        copyBits(src.digital_[ch].data(), srcFirst, digital_[ch].data(), dstFirst, count);
+    }
+}
+
+void ComtradeRecording::copyRowsWithoutDigital(const ComtradeRecording& src, size_t srcFirst, size_t count,
+                                               size_t dstFirst) {
+    if (count == 0) {
+        return;
+    }
+    size_t valueBytes = bytesPerValue(storage_);
+    for (int ch = 0; ch < numAnalog_; ch++) {
+        std::memcpy(static_cast<uint8_t*>(analogBytes(ch)) + dstFirst * valueBytes,
+                    static_cast<const uint8_t*>(src.analogBytes(ch)) + srcFirst * valueBytes, count * valueBytes);
+    }
+    std::copy_n(src.timestamps_.begin() + srcFirst, count, timestamps_.begin() + dstFirst);
+    std::copy_n(src.sampleNumbers_.begin() + srcFirst, count, sampleNumbers_.begin() + dstFirst);
+}
+
+void ComtradeRecording::keepRows(size_t first, size_t count) {
+    size_t total = sampleCount();
+    first = std::min(first, total);
+    count = std::min(count, total - first);
+    if (first > 0 && count > 0) {
+        // Rows move towards the front, so copying forward never reads a row
+        // it has already overwritten
+        size_t valueBytes = bytesPerValue(storage_);
+        for (int ch = 0; ch < numAnalog_; ch++) {
+            uint8_t* column = static_cast<uint8_t*>(analogBytes(ch));
+            std::memmove(column, column + first * valueBytes, count * valueBytes);
+        }
+        for (auto& column : digital_) {
+            copyBits(column.data(), first, column.data(), 0, count);
+        }
+        std::copy_n(timestamps_.begin() + first, count, timestamps_.begin());
+        std::copy_n(sampleNumbers_.begin() + first, count, sampleNumbers_.begin());
+    }
+    resize(count);
+    buildDigitalEdges();
+}
+
+void ComtradeRecording::clear() {
+    analog_.clear();
+    analogFloat_.clear();
+    analog16_.clear();
+    analog32_.clear();
+    digital_.clear();
+    edges_.clear();
+    edges_.shrink_to_fit();
+    numAnalog_ = 0;
+    storage_ = AnalogStorage::Double;
+    scales_.clear();
+    timestamps_.clear();
+    timestamps_.shrink_to_fit();
+    sampleNumbers_.clear();
+    sampleNumbers_.shrink_to_fit();
+}
+
+size_t ComtradeRecording::bytesPerValue(AnalogStorage storage) {
+    switch (storage) {
+        case AnalogStorage::Double: return sizeof(double);
+        case AnalogStorage::Float:  return sizeof(float);
+        case AnalogStorage::Int16:  return sizeof(int16_t);
+        default:                    return sizeof(int32_t);
+    }
+}
+
+size_t ComtradeRecording::estimateBytes(size_t numSamples, int numAnalog, int numDigital, AnalogStorage storage) {
+    size_t perSample = sizeof(uint64_t) + sizeof(int) + static_cast<size_t>(numAnalog) * bytesPerValue(storage);
+    return numSamples * perSample + static_cast<size_t>(numDigital) * digitalWordCount(numSamples) * sizeof(uint64_t);
+}
+
+const void* ComtradeRecording::analogBytes(int channel) const {
+    switch (storage_) {
+        case AnalogStorage::Double: return analog_[channel].data();
+        case AnalogStorage::Float:  return analogFloat_[channel].data();
+        case AnalogStorage::Int16:  return analog16_[channel].data();
+        default:                    return analog32_[channel].data();
+    }
+}
+
+void* ComtradeRecording::analogBytes(int channel) {
+    return const_cast<void*>(static_cast<const ComtradeRecording&>(*this).analogBytes(channel));
+}
+
+void ComtradeRecording::copyAnalog(int channel, size_t first, size_t count, double* out) const {
+    if (storage_ == AnalogStorage::Double) {
+        std::memcpy(out, analog_[channel].data() + first, count * sizeof(double));
+        return;
+    }
+    AnalogScale scale = analogScale(channel);
+    switch (storage_) {
+        case AnalogStorage::Float:
+            if (scales_.empty()) {
+                std::copy_n(analogFloat_[channel].data() + first, count, out);
+            } else {
+                scaleAnalog(analogFloat_[channel].data() + first, count, scale, out);
+            }
+            break;
+        case AnalogStorage::Int16:
+            scaleAnalog(analog16_[channel].data() + first, count, scale, out);
+            break;
+        default:
+            scaleAnalog(analog32_[channel].data() + first, count, scale, out);
+            break;
+    }
+}
+
+ComtradeRecordingView ComtradeRecording::view(size_t first, size_t count) const {
+    size_t total = sampleCount();
+    first = std::min(first, total);
+    count = std::min(count, total - first);
+    return ComtradeRecordingView(*this, first, count);
+}
+
+ComtradeRecordingView ComtradeRecording::timeRange(uint64_t startUs, uint64_t endUs) const {
+    const uint64_t* begin = timestamps_.data();
+    const uint64_t* end = begin + timestamps_.size();
+    const uint64_t* first = std::lower_bound(begin, end, startUs);
+    const uint64_t* last = std::lower_bound(first, end, std::max(startUs, endUs));
+    return ComtradeRecordingView(*this, static_cast<size_t>(first - begin), static_cast<size_t>(last - first));
+}
+
+void ComtradeRecording::getSample(size_t index, ComtradeSample& sample) const {
+    sample.sampleNumber = sampleNumbers_[index];
+    sample.timestamp = timestamps_[index];
+
+    sample.analogValues.resize(numAnalog_);
+    for (int ch = 0; ch < numAnalog_; ch++) {
+        sample.analogValues[ch] = analogValue(ch, index);
+    }
+
+    sample.digitalValues.resize(digital_.size());
+    for (size_t ch = 0; ch < digital_.size(); ch++) {
+        sample.digitalValues[ch] = digitalState(static_cast<int>(ch), index);
+    }
+}
+
+size_t ComtradeRecording::memoryBytes() const {
+    size_t bytes = timestamps_.capacity() * sizeof(uint64_t) + sampleNumbers_.capacity() * sizeof(int);
+    for (const auto& column : analog_) {
+        bytes += column.capacity() * sizeof(double);
+    }
+    for (const auto& column : analogFloat_) {
+        bytes += column.capacity() * sizeof(float);
+    }
+    for (const auto& column : analog16_) {
+        bytes += column.capacity() * sizeof(int16_t);
+    }
+    for (const auto& column : analog32_) {
+        bytes += column.capacity() * sizeof(int32_t);
+    }
+    for (const auto& column : digital_) {
+        bytes += column.capacity() * sizeof(uint64_t);
+    }
+    return bytes + edges_.capacity() * sizeof(DigitalEdge);
+}
+
+void ComtradeRecording::buildDigitalEdges() {
+    edges_.clear();
+    size_t numSamples = sampleCount();
+    size_t numWords = digitalWordCount(numSamples);
+    size_t numDigital = digital_.size();
+
+    // Walk the planes side by side, 64 samples at a time, so edges come out
+    // ordered by sample and then channel without a sort
+    std::vector<uint64_t> changes(numDigital);
+    std::vector<uint64_t> previous(numDigital, 0);  // Last state of the word before
+    for (size_t w = 0; w < numWords; w++) {
+        uint64_t valid = ~uint64_t(0);
+        if (w == 0) {
+            valid &= ~uint64_t(1);  // Row 0 has no sample before it
+        }
+        if (w == numWords - 1 && numSamples % 64 != 0) {
+            valid &= (uint64_t(1) << (numSamples % 64)) - 1;
+        }
+        uint64_t any = 0;
+        for (size_t ch = 0; ch < numDigital; ch++) {
+            uint64_t word = digital_[ch][w];
+            changes[ch] = (word ^ ((word << 1) | previous[ch])) & valid;
+            previous[ch] = word >> 63;
+            any |= changes[ch];
+        }
+        while (any != 0) {
+            int bit = countTrailingZeros(any);
+            for (size_t ch = 0; ch < numDigital; ch++) {
+                if ((changes[ch] >> bit) & 1u) {
+                    bool state = ((digital_[ch][w] >> bit) & 1u) != 0;
+                    edges_.push_back(DigitalEdge{w * 64 + bit, static_cast<int>(ch), state});
+                }
+            }
+            any &= any - 1;
+        }
+    }
+}
+
+ColumnSpan<DigitalEdge> ComtradeRecording::digitalEdges(size_t first, size_t last) const {
+    auto bySample = [](const DigitalEdge& edge, uint64_t sample) { return edge.sample < sample; };
+    auto begin = std::lower_bound(edges_.begin(), edges_.end(), static_cast<uint64_t>(first), bySample);
+    auto end = std::lower_bound(begin, edges_.end(), static_cast<uint64_t>(std::max(first, last)), bySample);
+    return ColumnSpan<DigitalEdge>(edges_.data() + (begin - edges_.begin()), static_cast<size_t>(end - begin));
+}
@@ -1,19 +1,120 @@
 #include "comtrade_replay_test.h"
 #include "comtrade_parser.h"
+#include "comtrade_stream_reader.h"
+#include "resampled_cache.h"
+#include "comtrade_cache.h"
 #include "ethernet.h"
 #include "vlan.h"
 #include "sampled_value.h"
 #include "goose_decoder.h"
 #include "raw_socket.h"
-#include "timer.h"
+#include "sample_scheduler.h"
+#include "tsc_clock.h"
+#include "realtime.h"
+#include "clock.h"
+#include "pcap_writer.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <cmath>
 #include <algorithm>
 #include <time.h>
 
+namespace {
+
+const size_t kRecordingBlock = 4096;  // Loaded samples pushed into the timeline at a time
+
+// Mapped channels side by side ([sample][channel]), so every output sample
+// applies one set of filter coefficients to all of them
+void interleave(const double* column, size_t count, size_t channel, size_t stride, double* frames) {
+    for (size_t i = 0; i < count; i++) {
+        frames[i * stride + channel] = column[i];
+    }
+}
+
+/**
+ * @brief Mapped channels of a loaded recording, a block at a time
+ */
+class RecordingSource : public ResampleSource {
+public:
+    RecordingSource(std::unique_ptr<ComtradeParser> parser, const std::vector<int>& columns)
+        : parser_(std::move(parser)), columns_(columns), next_(0),
+          column_(kRecordingBlock), frames_(kRecordingBlock * columns.size()) {
+    }
+
+    bool rewind() override {
+        next_ = 0;
+        return true;
+    }
+
+    bool read(TimelineResampler& timeline) override {
+        const ComtradeRecording& recording = parser_->getRecording();
+        if (next_ >= recording.sampleCount()) {
+            return false;
+        }
+        size_t count = std::min(kRecordingBlock, recording.sampleCount() - next_);
+        for (size_t c = 0; c < columns_.size(); c++) {
+            recording.analogColumn(columns_[c]).subspan(next_, count).copyTo(column_.data());
+            interleave(column_.data(), count, c, columns_.size(), frames_.data());
+        }
+        timeline.push(recording.sampleNumbers() + next_, recording.timestamps() + next_, frames_.data(), count);
+        next_ += count;
+        return true;
+    }
+
+    std::string getLastError() const override { return std::string(); }
+
+private:
+    std::unique_ptr<ComtradeParser> parser_;
+    std::vector<int> columns_;      // COMTRADE analog index per timeline value
+    size_t next_;                   // Next sample to push
+    std::vector<double> column_;
+    std::vector<double> frames_;
+};
+
+/**
+ * @brief Mapped channels of a .dat read block by block
+ */
+class StreamSource : public ResampleSource {
+public:
+    StreamSource(std::unique_ptr<ComtradeStreamReader> reader, const std::vector<int>& columns)
+        : reader_(std::move(reader)), columns_(columns) {
+    }
+
+    bool rewind() override {
+        return reader_->rewind();
+    }
+
+    bool read(TimelineResampler& timeline) override {
+        if (!reader_->next(block_)) {
+            return false;
+        }
+        size_t count = block_.sampleCount();
+        frames_.resize(count * columns_.size());
+        for (size_t c = 0; c < columns_.size(); c++) {
+            interleave(block_.analog(columns_[c]), count, c, columns_.size(), frames_.data());
+        }
+        timeline.push(block_.sampleNumbers(), block_.timestamps(), frames_.data(), count);
+        return true;
+    }
+
+    std::string getLastError() const override {
+        std::string error = reader_->getLastError();
+        return error.empty() ? error : "COMTRADE stream error: " + error;
+    }
+
+private:
+    std::unique_ptr<ComtradeStreamReader> reader_;
+    std::vector<int> columns_;
+    ComtradeRecording block_;
+    std::vector<double> frames_;    // Sized by the first block, then reused
+};
+
+} // namespace
+
 ComtradeReplayTest::ComtradeReplayTest() 
-    : running_(false), numSamples_(0) {
+    : running_(false), externalClock_(nullptr), outputCached_(false), block_(nullptr), numSamples_(0),
+      samplesSent_(0) {
 }
 
 ComtradeReplayTest::~ComtradeReplayTest() {
@@ -28,8 +129,10 @@ bool ComtradeReplayTest::configure(const ComtradeReplayConfig& config) {
     
     config_ = config;
     
-    // Auto-detect source MAC if not provided
-    if (config_.srcMac.empty()) {
+    // Auto-detect source MAC if not provided (offline output has no interface)
+    if (config_.srcMac.empty() && isOffline()) {
+        config_.srcMac = "00:00:00:00:00:00";
+    } else if (config_.srcMac.empty()) {
         RawSocket tempSocket;
         if (!tempSocket.open(config_.iface)) {
             lastError_ = "Failed to open interface " + config_.iface + " to detect MAC address";
@@ -50,18 +153,44 @@ bool ComtradeReplayTest::configure(const ComtradeReplayConfig& config) {
         return false;
     }
     
-    if (config_.iface.empty()) {
+    if (config_.iface.empty() && !isOffline()) {
         lastError_ = "Interface name cannot be empty";
         return false;
     }
     
+    // A virtual clock never waits: on a live interface that would flood the wire
+    if (config_.virtualTime && !isOffline()) {
+        lastError_ = "Virtual time needs offline output (outputFile or a frame callback)";
+        return false;
+    }
+    
     if (config_.cfgFilePath.empty()) {
         lastError_ = "COMTRADE .cfg file path cannot be empty";
         return false;
     }
     
-    // Load and process COMTRADE file
-    if (!loadComtradeFile()) {
+    if (config_.startTimeOffset < 0.0 || config_.endTimeOffset < 0.0 ||
+        (config_.endTimeOffset > 0.0 && config_.endTimeOffset <= config_.startTimeOffset)) {
+        lastError_ = "Invalid time window: end offset must be 0 or after the start offset";
+        return false;
+    }
+    
+    // Load the COMTRADE file (streaming only validates it here); resampling
+    // starts with transmission. A cached output needs neither.
+    stage_.recordTo(nullptr);
+    source_.reset();
+    outputCache_.reset();
+    cacheSource_.reset();
+    outputCached_ = false;
+    outputCacheDetail_.clear();
+    if (config_.useOutputCache && openOutputCache()) {
+        return true;
+    }
+    if (config_.streaming) {
+        if (!openStream()) {
+            return false;
+        }
+    } else if (!loadComtradeFile()) {
         return false;
     }
     
@@ -69,154 +198,339 @@ bool ComtradeReplayTest::configure(const ComtradeReplayConfig& config) {
 }
 
 bool ComtradeReplayTest::loadComtradeFile() {
-    // Parse COMTRADE file
-    ComtradeParser parser;
-    if (!parser.load(config_.cfgFilePath, config_.datFilePath)) {
-        lastError_ = "Failed to load COMTRADE file: " + parser.getLastError();
+    // Parse COMTRADE file (kept as the source of the resampling stage)
+    std::unique_ptr<ComtradeParser> parser(new ComtradeParser());
+    ComtradeLoadOptions options;
+    options.useCache = config_.useCache;
+    options.cacheDir = config_.cacheDir;
+    options.paranoidCache = config_.paranoidCache;
+    options.cacheSource = cacheSource_;  // Taken by the output cache, if it is on
+    options.startTime = config_.startTimeOffset;  // Only the window is decoded
+    options.endTime = config_.endTimeOffset;
+    if (!parser->load(config_.cfgFilePath, config_.datFilePath, options)) {
+        lastError_ = "Failed to load COMTRADE file: " + parser->getLastError();
         return false;
     }
     
-    const ComtradeConfig& cfg = parser.getConfig();
-    std::vector<ComtradeSample> samples = parser.getAllSamples();
+    const ComtradeConfig& cfg = parser->getConfig();
+    size_t numRecorded = parser->getRecording().sampleCount();
     
-    if (samples.empty()) {
-        lastError_ = "COMTRADE file contains no samples";
+    if (numRecorded == 0) {
+        lastError_ = options.startTime > 0.0 || options.endTime > 0.0
+            ? "No COMTRADE samples in the time window" : "COMTRADE file contains no samples";
         return false;
     }
     
     // Get original sample rate
-    double originalSampleRate = parser.getSampleRate(0);
+    double originalSampleRate = parser->getSampleRate(static_cast<int>(parser->getWindowStart()));
     stats_.comtradeSampleRate = static_cast<int>(originalSampleRate);
-    stats_.totalComtradeSamples = static_cast<int>(samples.size());
+    stats_.totalComtradeSamples = static_cast<int>(numRecorded);
     stats_.outputSampleRate = config_.sampleRate;
     
-    // Extract analog data for mapped channels
-    std::vector<std::vector<double>> analogData(8);  // 8 SV channels
+    // Map COMTRADE channels to SV channels (unmapped SV channels send zero)
+    std::vector<int> columns;
+    std::vector<int> svChannels;
+    if (!mapChannels(cfg, columns, svChannels) || !configureStage(cfg, columns, svChannels)) {
+        return false;
+    }
     
-    // Initialize with zeros
-    for (int i = 0; i < 8; i++) {
-        analogData[i].resize(samples.size(), 0.0);
+    if (config_.verboseOutput) {
+        if (needsResampling(cfg)) {
+            std::cout << "Resampling from " << originalSampleRate 
+                      << " Hz to " << config_.sampleRate << " Hz while transmitting" << std::endl;
+        }
+        std::cout << "Loaded COMTRADE file:" << std::endl;
+        std::cout << "  Station: " << cfg.stationName << std::endl;
+        std::cout << "  Original samples: " << stats_.totalComtradeSamples 
+                  << " @ " << stats_.comtradeSampleRate << " Hz" << std::endl;
+        std::cout << "  Output: " << stats_.outputSampleRate << " Hz, " << config_.resampleBlockSamples
+                  << "-sample blocks, " << config_.resampleLookahead << " ahead" << std::endl;
+        std::cout << "  Mapped channels: " << config_.channelMapping.size() << std::endl;
+        printResamplerSpec(cfg);
+        printCacheReport(parser->getCacheReport());
+        printOutputCacheReport();
     }
     
-    // Map COMTRADE channels to SV channels
+    source_.reset(new RecordingSource(std::move(parser), columns));
+    return true;
+}
+
+void ComtradeReplayTest::printCacheReport(const ComtradeCacheReport& report) {
+    switch (report.result) {
+        case CacheResult::Disabled:
+            return;
+        case CacheResult::Hit:
+            std::cout << "  Cache: hit (" << report.path << ")" << std::endl;
+            return;
+        case CacheResult::Miss:
+            std::cout << "  Cache: miss";
+            break;
+        case CacheResult::Stale:
+            std::cout << "  Cache: stale";
+            break;
+    }
+    if (report.written) {
+        std::cout << ", written to " << report.path;
+        if (!report.detail.empty()) {
+            std::cout << " (" << report.detail << ")";
+        }
+    } else {
+        std::cout << ", not written: " << report.detail;
+    }
+    std::cout << std::endl;
+}
+
+bool ComtradeReplayTest::needsResampling(const ComtradeConfig& cfg) const {
+    for (const SampleRate& rate : cfg.sampleRates) {
+        if (std::abs(rate.rate - config_.sampleRate) > 0.1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ComtradeReplayTest::mapChannels(const ComtradeConfig& cfg, std::vector<int>& columns,
+                                     std::vector<int>& svChannels) {
+    columns.clear();
+    svChannels.clear();
     for (const auto& mapping : config_.channelMapping) {
-        const std::string& comtradeName = mapping.first;
         int svChannel = mapping.second;
-        
-        if (svChannel < 0 || svChannel >= 8) {
+        if (svChannel < 0 || svChannel >= static_cast<int>(kSvChannels)) {
             lastError_ = "Invalid SV channel index: " + std::to_string(svChannel);
             return false;
         }
         
-        // Find COMTRADE channel
-        const AnalogChannel* ch = parser.getAnalogChannel(comtradeName);
-        if (!ch) {
-            lastError_ = "COMTRADE channel not found: " + comtradeName;
+        auto ch = std::find_if(cfg.analogChannels.begin(), cfg.analogChannels.end(),
+                               [&mapping](const AnalogChannel& channel) { return channel.name == mapping.first; });
+        if (ch == cfg.analogChannels.end()) {
+            lastError_ = "COMTRADE channel not found: " + mapping.first;
             std::cerr << "Available COMTRADE analog channels:" << std::endl;
             for (const auto& availableCh : cfg.analogChannels) {
                 std::cerr << "  " << availableCh.name << std::endl;
             }
             return false;
         }
-        
-        // Extract values
-        for (size_t i = 0; i < samples.size(); i++) {
-            if (ch->index < static_cast<int>(samples[i].analogValues.size())) {
-                analogData[svChannel][i] = samples[i].analogValues[ch->index];
-            }
+        if (ch->index < 0 || ch->index >= cfg.numAnalogChannels) {
+            continue;
+        }
+        // A later mapping to the same SV channel replaces the earlier one
+        auto same = std::find(svChannels.begin(), svChannels.end(), svChannel);
+        if (same != svChannels.end()) {
+            columns[same - svChannels.begin()] = ch->index;
+        } else {
+            columns.push_back(ch->index);
+            svChannels.push_back(svChannel);
         }
     }
-    
-    // Resample to target sample rate if needed
-    std::vector<std::vector<double>> resampledAnalog;
-    if (std::abs(originalSampleRate - config_.sampleRate) > 0.1) {
-        if (config_.verboseOutput) {
-            std::cout << "Resampling from " << originalSampleRate 
-                      << " Hz to " << config_.sampleRate << " Hz..." << std::endl;
+    return true;
+}
+
+bool ComtradeReplayTest::configureStage(const ComtradeConfig& cfg, const std::vector<int>& columns,
+                                        const std::vector<int>& svChannels) {
+    // Skew (microseconds in the .cfg): how late after the sample time each channel was taken
+    std::vector<double> skew;
+    if (config_.compensateSkew) {
+        for (int column : columns) {
+            auto ch = std::find_if(cfg.analogChannels.begin(), cfg.analogChannels.end(),
+                                   [column](const AnalogChannel& channel) { return channel.index == column; });
+            skew.push_back(ch != cfg.analogChannels.end() ? ch->skew * 1e-6 : 0.0);
         }
-        resampledAnalog = resampleData(analogData, originalSampleRate, config_.sampleRate);
-        stats_.samplesInterpolated = static_cast<uint32_t>(resampledAnalog[0].size());
-    } else {
-        resampledAnalog = analogData;
-        stats_.samplesInterpolated = static_cast<uint32_t>(analogData[0].size());
     }
+    stage_.setChannelSkew(skew);
     
-    // Convert to INT32 format for SV packets
-    resampledData_.clear();
-    resampledData_.resize(8);
-    numSamples_ = static_cast<int>(resampledAnalog[0].size());
+    // Close rates are passed through unchanged (linear at ratio 1 copies samples)
+    if (!stage_.configure(cfg.sampleRates, svChannels, config_.sampleRate, config_.resampler,
+                          config_.resampleBlockSamples, config_.resampleLookahead, config_.resampleThreads)) {
+        lastError_ = stage_.getLastError();
+        return false;
+    }
     
-    for (int ch = 0; ch < 8; ch++) {
-        resampledData_[ch].reserve(numSamples_);
-        for (int i = 0; i < numSamples_; i++) {
-            // Convert to INT32 (already in engineering units from COMTRADE)
-            resampledData_[ch].push_back(static_cast<int32_t>(resampledAnalog[ch][i]));
+    // Missed output cache: the first pass that reaches the end fills it
+    if (outputCache_) {
+        outputCache_->describe(static_cast<uint64_t>(std::max(stats_.totalComtradeSamples, 0)),
+                               stats_.comtradeSampleRate);
+        stage_.recordTo(outputCache_.get());
+    }
+    return true;
+}
+
+void ComtradeReplayTest::printResamplerSpec(const ComtradeConfig& cfg) const {
+    // One filter per distinct recording rate (segments of a multi-rate .cfg)
+    std::vector<double> printed;
+    for (const SampleRate& rate : cfg.sampleRates) {
+        const SampleResampler* resampler = stage_.timeline().resamplerFor(rate.rate);
+        if (!resampler || std::abs(rate.rate - config_.sampleRate) <= 0.1 ||
+            std::find(printed.begin(), printed.end(), rate.rate) != printed.end()) {
+            continue;
+        }
+        printed.push_back(rate.rate);
+        std::cout << "  Resampler";
+        if (cfg.sampleRates.size() > 1) {
+            std::cout << " (" << rate.rate << " Hz)";
+        }
+        const ResamplerSpec& spec = resampler->spec();
+        if (spec.method == ResamplerMethod::Linear) {
+            std::cout << ": linear interpolation (no anti-alias filter)" << std::endl;
+            continue;
+        }
+        std::cout << ": polyphase FIR, ";
+        if (spec.rational) {
+            std::cout << "L/M = " << spec.up << "/" << spec.down;
+        } else {
+            std::cout << "ratio " << resampler->ratio() << " (interpolated table)";
         }
+        std::cout << ", " << spec.taps << " taps x " << spec.phases << " phases" << std::endl;
+        std::cout << "    Passband: 0-" << spec.passbandHz << " Hz (ripple +/-" << std::setprecision(2) << spec.rippleDb
+                  << std::setprecision(6) << " dB)"
+                  << ", stopband: from " << spec.stopbandHz << " Hz (-" << spec.stopbandDb << " dB)" << std::endl;
+    }
+    
+    // Channels with a .cfg skew are resampled at their own sample times
+    const std::vector<double>& skew = stage_.timeline().channelSkew();
+    size_t skewed = 0;
+    double largest = 0.0;
+    for (double offset : skew) {
+        skewed += offset != 0.0 ? 1 : 0;
+        largest = std::max(largest, std::abs(offset));
+    }
+    if (skewed > 0) {
+        std::cout << "  Skew: " << skewed << " of " << skew.size() << " channels aligned (up to "
+                  << largest * 1e6 << " us)" << std::endl;
+    }
+}
+
+void ComtradeReplayTest::printTimelineReport() const {
+    // Only worth a line when the recording is more than one uniform stretch
+    const TimelineReport& report = outputCached_ ? outputCache_->info().report : stage_.timeline().report();
+    if (report.runs <= 1 && report.droppedSamples == 0) {
+        return;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6) << "  Timeline: " << report.runs << " segments (";
+    for (size_t i = 0; i < report.rates.size(); i++) {
+        std::cout << (i > 0 ? ", " : "");
+        if (report.rates[i] > 0.0) {
+            std::cout << report.rates[i] << " Hz";
+        } else {
+            std::cout << "timestamps";
+        }
+    }
+    std::cout << "), " << report.rateChanges << " rate changes, " << report.gaps << " gaps ("
+              << report.missingSamples << " samples missing)";
+    if (report.droppedSamples > 0) {
+        std::cout << ", " << report.droppedSamples << " samples out of time order ignored";
+    }
+    std::cout << std::endl;
+}
+
+bool ComtradeReplayTest::openStream() {
+    std::unique_ptr<ComtradeStreamReader> stream(new ComtradeStreamReader());
+    if (!stream->open(config_.cfgFilePath, config_.datFilePath, config_.streamBlockSamples)) {
+        lastError_ = "Failed to open COMTRADE file: " + stream->getLastError();
+        return false;
+    }
+    
+    if ((config_.startTimeOffset > 0.0 || config_.endTimeOffset > 0.0) &&
+        !stream->setTimeWindow(config_.startTimeOffset, config_.endTimeOffset)) {
+        lastError_ = "Failed to open COMTRADE time window: " + stream->getLastError();
+        return false;
+    }
+    
+    const ComtradeConfig& cfg = stream->getConfig();
+    double originalSampleRate = stream->getSampleRate(static_cast<int>(stream->windowStart()));
+    stats_.comtradeSampleRate = static_cast<int>(originalSampleRate);
+    stats_.totalComtradeSamples = static_cast<int>(stream->totalSamples());
+    stats_.outputSampleRate = config_.sampleRate;
+    
+    // Map COMTRADE channels to SV channels
+    std::vector<int> columns;
+    std::vector<int> svChannels;
+    if (!mapChannels(cfg, columns, svChannels) || !configureStage(cfg, columns, svChannels)) {
+        return false;
     }
     
     if (config_.verboseOutput) {
-        std::cout << "Loaded COMTRADE file:" << std::endl;
+        std::cout << "Streaming COMTRADE file:" << std::endl;
         std::cout << "  Station: " << cfg.stationName << std::endl;
-        std::cout << "  Original samples: " << stats_.totalComtradeSamples 
-                  << " @ " << stats_.comtradeSampleRate << " Hz" << std::endl;
-        std::cout << "  Resampled: " << numSamples_ 
-                  << " @ " << stats_.outputSampleRate << " Hz" << std::endl;
+        std::cout << "  Samples: " << (stats_.totalComtradeSamples > 0
+                                          ? std::to_string(stats_.totalComtradeSamples) : std::string("unknown"))
+                  << " @ " << stats_.comtradeSampleRate << " Hz -> " << config_.sampleRate << " Hz" << std::endl;
+        std::cout << "  Block: " << config_.streamBlockSamples << " samples" << std::endl;
         std::cout << "  Mapped channels: " << config_.channelMapping.size() << std::endl;
+        printResamplerSpec(cfg);
+        printOutputCacheReport();
     }
     
+    source_.reset(new StreamSource(std::move(stream), columns));
     return true;
 }
 
-std::vector<std::vector<double>> ComtradeReplayTest::resampleData(
-    const std::vector<std::vector<double>>& input,
-    double inputRate,
-    double outputRate) {
+bool ComtradeReplayTest::openOutputCache() {
+    // Identified once (stat and a few reads) for the parse cache as well; the
+    // whole source is only hashed when an entry is written
+    std::string datPath = ComtradeParser::resolveDatPath(config_.cfgFilePath, config_.datFilePath);
+    cacheSource_ = std::make_shared<const CacheSource>(config_.cfgFilePath, datPath);
+    outputCache_.reset(new ResampledCache(config_.cfgFilePath, datPath, config_.cacheDir,
+                                          outputCacheSettings(), cacheSource_));
+    if (outputCache_->open(outputCacheDetail_) != CacheResult::Hit) {
+        return false;  // Kept to record this run's output
+    }
+    
+    const ResampledCacheInfo& info = outputCache_->info();
+    stats_.comtradeSampleRate = static_cast<int>(info.recordingRate);
+    stats_.totalComtradeSamples = static_cast<int>(info.recordingSamples);
+    stats_.outputSampleRate = config_.sampleRate;
+    stage_.configureCached(*outputCache_, config_.resampleBlockSamples, config_.resampleLookahead);
+    outputCached_ = true;
     
-    if (input.empty() || input[0].empty()) {
-        return input;
+    if (config_.verboseOutput) {
+        std::cout << "Cached COMTRADE output:" << std::endl;
+        std::cout << "  Samples: " << stats_.totalComtradeSamples << " @ " << stats_.comtradeSampleRate
+                  << " Hz -> " << outputCache_->sampleCount() << " @ " << config_.sampleRate << " Hz" << std::endl;
+        std::cout << "  Mapped channels: " << config_.channelMapping.size() << std::endl;
+        printOutputCacheReport();
     }
-    
-    int inputSamples = static_cast<int>(input[0].size());
-    double ratio = outputRate / inputRate;
-    int outputSamples = static_cast<int>(std::ceil(inputSamples * ratio));
-    
-    std::vector<std::vector<double>> output(input.size());
-    
-    for (size_t ch = 0; ch < input.size(); ch++) {
-        output[ch].reserve(outputSamples);
-        
-        for (int i = 0; i < outputSamples; i++) {
-            // Calculate corresponding input index
-            double inputIndex = i / ratio;
-            
-            // Linear interpolation
-            double value = interpolateLinear(input[ch], inputIndex);
-            output[ch].push_back(value);
-        }
+    return true;
+}
+
+std::string ComtradeReplayTest::outputCacheSettings() const {
+    // Everything that shapes the output besides the recording; block sizes,
+    // threads, streaming and the parse cache do not
+    std::ostringstream settings;
+    settings << std::setprecision(17) << "rate=" << config_.sampleRate
+             << ";method=" << static_cast<int>(config_.resampler.method)
+             << ";passband=" << config_.resampler.passband << ";stopband=" << config_.resampler.stopbandDb
+             << ";phases=" << config_.resampler.maxPhases << "," << config_.resampler.tablePhases
+             << ";skew=" << (config_.compensateSkew ? 1 : 0)
+             << ";window=" << config_.startTimeOffset << "," << config_.endTimeOffset << ";map=";
+    for (const auto& mapping : config_.channelMapping) {
+        settings << mapping.first.size() << ":" << mapping.first << "=" << mapping.second << ",";
     }
-    
-    return output;
+    return settings.str();
 }
 
-double ComtradeReplayTest::interpolateLinear(const std::vector<double>& data, double index) {
-    if (data.empty()) {
-        return 0.0;
+void ComtradeReplayTest::printOutputCacheReport() const {
+    if (!outputCache_) {
+        return;
     }
-    
-    if (index <= 0.0) {
-        return data[0];
+    std::cout << "  Output cache: ";
+    if (outputCached_) {
+        std::cout << "hit (" << outputCache_->path() << ")" << std::endl;
+        return;
     }
-    
-    if (index >= data.size() - 1) {
-        return data.back();
+    std::cout << (outputCacheDetail_.empty() ? "miss" : "stale (" + outputCacheDetail_ + ")")
+              << ", written by a run that sends the whole recording" << std::endl;
+}
+
+bool ComtradeReplayTest::nextBlock() {
+    block_ = stage_.next();
+    numSamples_ = block_ ? static_cast<int>(block_->count) : 0;
+    if (!block_) {
+        lastError_ = stage_.getLastError();
+        return false;
     }
-    
-    // Linear interpolation between floor and ceil
-    int i0 = static_cast<int>(std::floor(index));
-    int i1 = i0 + 1;
-    double frac = index - i0;
-    
-    return data[i0] * (1.0 - frac) + data[i1] * frac;
+    samplesSent_ += block_->count;
+    stats_.samplesInterpolated = static_cast<uint32_t>(samplesSent_);
+    return true;
 }
 
 bool ComtradeReplayTest::run() {
@@ -225,7 +539,7 @@ bool ComtradeReplayTest::run() {
         return false;
     }
     
-    if (config_.iface.empty() || numSamples_ == 0) {
+    if ((config_.iface.empty() && !isOffline()) || (!source_ && !outputCached_)) {
         lastError_ = "Test not configured. Call configure() first";
         return false;
     }
@@ -235,11 +549,29 @@ bool ComtradeReplayTest::run() {
     stats_.packetsFailed = 0;
     stats_.stoppedByGoose = false;
     stats_.gooseStopReason.clear();
-    stats_.startTime = std::chrono::steady_clock::now();
+    stats_.txRealtime = RealtimeReport();
+    stats_.rxRealtime = RealtimeReport();
+    stats_.timing = SampleTimingStats();
+    stats_.frameTiming = FrameTimingStats();
+    
+    // Virtual time starts fresh on every run unless a clock was injected
+    virtualClock_.reset();
+    if (config_.virtualTime && !externalClock_) {
+        virtualClock_.reset(new VirtualClock());
+    }
+    
+    // An injected clock other than the system clock does not pace the wire either
+    if (!dynamic_cast<SystemClock*>(&activeClock()) && !isOffline()) {
+        lastError_ = "A non-system clock needs offline output (outputFile or a frame callback)";
+        return false;
+    }
+    stats_.startTime = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(activeClock().now(ClockDomain::Monotonic))));
     
     // Start GOOSE monitoring thread if enabled
     running_ = true;
-    if (config_.enableGooseMonitoring) {
+    if (config_.enableGooseMonitoring && !isOffline()) {
         gooseThread_ = std::thread(&ComtradeReplayTest::gooseCaptureThreadFunc, this);
     }
     
@@ -256,7 +588,9 @@ bool ComtradeReplayTest::run() {
         gooseThread_.join();
     }
     
-    stats_.endTime = std::chrono::steady_clock::now();
+    stats_.endTime = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(activeClock().now(ClockDomain::Monotonic))));
     
     // Print statistics
     if (config_.verboseOutput) {
@@ -295,6 +629,29 @@ void ComtradeReplayTest::setProgressCallback(
     progressCallback_ = callback;
 }
 
+void ComtradeReplayTest::setFrameCallback(
+    std::function<void(const std::vector<uint8_t>&, int64_t)> callback) {
+    frameCallback_ = callback;
+}
+
+void ComtradeReplayTest::setClock(Clock* clock) {
+    externalClock_ = clock;
+}
+
+bool ComtradeReplayTest::isOffline() const {
+    return !config_.outputFile.empty() || static_cast<bool>(frameCallback_);
+}
+
+Clock& ComtradeReplayTest::activeClock() {
+    if (externalClock_) {
+        return *externalClock_;
+    }
+    if (virtualClock_) {
+        return *virtualClock_;
+    }
+    return systemClock();
+}
+
 void ComtradeReplayTest::gooseCaptureThreadFunc() {
     RawSocket socket;
     if (!socket.open(config_.iface)) {
@@ -304,6 +661,15 @@ void ComtradeReplayTest::gooseCaptureThreadFunc() {
         return;
     }
     
+    RealtimeReport prepared;
+    if (config_.realtime.enabled && config_.realtime.prefaultBuffers) {
+        prepared.prefaultedBytes += prefaultStack(config_.realtime.prefaultStackBytes);
+    }
+    stats_.rxRealtime = applyRealtimeProfile(config_.realtime, RealtimeRole::Capture, 0, prepared);
+    if (config_.realtime.enabled && config_.verboseOutput) {
+        printRealtimeReport(stats_.rxRealtime);
+    }
+    
     if (config_.verboseOutput) {
         std::cout << "GOOSE monitoring started" << std::endl;
     }
@@ -356,9 +722,18 @@ void ComtradeReplayTest::gooseCaptureThreadFunc() {
 }
 
 void ComtradeReplayTest::transmissionLoop() {
-    // Open raw socket
+    // Frame sink: raw socket, or pcap file and/or frame callback when offline
+    const bool offline = isOffline();
     RawSocket socket;
-    if (!socket.open(config_.iface)) {
+    PcapWriter pcap;
+    if (!config_.outputFile.empty()) {
+        if (!pcap.open(config_.outputFile)) {
+            lastError_ = "Failed to create output file " + config_.outputFile;
+            std::cerr << "Error: " << lastError_ << std::endl;
+            running_ = false;
+            return;
+        }
+    } else if (!offline && !socket.open(config_.iface)) {
         lastError_ = "Failed to open raw socket on " + config_.iface;
         std::cerr << "Error: " << lastError_ << std::endl;
         std::cerr << "Note: This program requires root privileges (sudo)" << std::endl;
@@ -378,48 +753,84 @@ void ComtradeReplayTest::transmissionLoop() {
     
     if (config_.verboseOutput) {
         std::cout << "Starting COMTRADE replay... (Press Ctrl+C to stop";
-        if (config_.enableGooseMonitoring) {
+        if (config_.enableGooseMonitoring && !offline) {
             std::cout << " or wait for GOOSE";
         }
         std::cout << ")" << std::endl << std::endl;
     }
     
-    // High-precision timer setup
-    Timer timer;
-    struct timespec t_ini, t_start;
+    // Resampling runs ahead on the stage's thread; wait for the first block only
+    lastError_.clear();
+    samplesSent_ = 0;
+    stage_.start(source_.get());
+    if (!nextBlock()) {
+        if (lastError_.empty()) {
+            lastError_ = "COMTRADE file contains no samples";
+        }
+        std::cerr << "Error: " << lastError_ << std::endl;
+        stage_.stop();
+        running_ = false;
+        return;
+    }
+    
+    // Frame buffer reused for every packet
+    std::vector<uint8_t> frame;
+    frame.reserve(ethHeader.size() + vlanTag.size() + 256);
     
     // Calculate wait period in nanoseconds
     long waitPeriod = static_cast<long>(1e9 / config_.sampleRate);
     
-    // Align to next second boundary
-    clock_gettime(CLOCK_MONOTONIC, &t_ini);
-    if (t_ini.tv_nsec > static_cast<long>(5e8)) {
-        t_ini.tv_sec += 2;
-    } else {
-        t_ini.tv_sec += 1;
+    // Lock and touch memory, then apply the real-time profile before the first deadline
+    RealtimeReport prepared;
+    if (config_.realtime.enabled) {
+        if (config_.realtime.lockMemory) {
+            lockProcessMemory(prepared);
+        }
+        if (config_.realtime.prefaultBuffers) {
+            prepared.prefaultedBytes += prefaultStack(config_.realtime.prefaultStackBytes);
+            frame.resize(frame.capacity());  // Whole reserved buffer; clear() keeps it
+            prepared.prefaultedBytes += prefaultMemory(frame.data(), frame.size());
+            frame.clear();
+        }
+    }
+    stats_.txRealtime = applyRealtimeProfile(config_.realtime, RealtimeRole::Transmit, waitPeriod, prepared);
+    if (config_.realtime.enabled && config_.verboseOutput) {
+        printRealtimeReport(stats_.txRealtime);
+    }
+    
+    // Schedule clock (system or virtual) and cheap per-frame timestamps
+    // (TSC when invariant, steady_clock otherwise)
+    Clock& clock = activeClock();
+    TscClock tsc;
+    const int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stats_.startTime.time_since_epoch()).count();
+    if (config_.verboseOutput) {
+        if (tsc.usingTsc()) {
+            std::cout << "Frame timestamps: TSC @ " << std::fixed << std::setprecision(3)
+                      << tsc.frequencyHz() / 1e9 << " GHz" << std::endl;
+        } else {
+            std::cout << "Frame timestamps: steady_clock (no invariant TSC)" << std::endl;
+        }
     }
-    t_ini.tv_nsec = 0;
     
-    // Start timer
-#ifdef _WIN32
-    // On Windows, start from current time (no timespec)
-    timer.start_period(waitPeriod);
-#else
-    // On Unix, use timespec for precise alignment
-    timer.start_period(t_ini);
-#endif
-    timer.wait_period(waitPeriod);
-    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    // Sample k is due at reference second + k/rate (smpCnt=0 on the second)
+    SampleScheduler scheduler(config_.timing, config_.sampleRate, &clock);
+    const uint64_t maxSamples = config_.durationSeconds > 0.0
+        ? static_cast<uint64_t>(config_.durationSeconds * config_.sampleRate + 0.5) : 0;
+    uint64_t streamedSamples = 0;
+    scheduler.start();
     
     // Transmission loop
     int sampleIdx = 0;
     
     do {
-        // Build current sample phasors from resampled data
-        double phasors[8][2];
-        for (int ch = 0; ch < 8; ch++) {
+        int64_t buildStart = tsc.nowNs();
+        
+        // Build current sample phasors from the resampled block
+        double phasors[kSvChannels][2];
+        for (size_t ch = 0; ch < kSvChannels; ch++) {
             // Use INT32 value directly (already scaled in engineering units)
-            phasors[ch][0] = static_cast<double>(resampledData_[ch][sampleIdx]);
+            phasors[ch][0] = static_cast<double>(block_->channels[ch][sampleIdx]);
             phasors[ch][1] = 0.0;  // Phase angle not used for direct values
         }
         
@@ -427,14 +838,29 @@ void ComtradeReplayTest::transmissionLoop() {
         auto svPayload = sv.buildPacket(phasors);
         
         // Build complete frame
-        std::vector<uint8_t> frame;
-        frame.reserve(ethHeader.size() + vlanTag.size() + svPayload.size());
+        frame.clear();
         frame.insert(frame.end(), ethHeader.begin(), ethHeader.end());
         frame.insert(frame.end(), vlanTag.begin(), vlanTag.end());
         frame.insert(frame.end(), svPayload.begin(), svPayload.end());
         
         // Send frame
-        ssize_t sent = socket.send(frame);
+        int64_t sendStart = tsc.nowNs();
+        ssize_t sent;
+        if (offline) {
+            // Schedule clock time: exactly the ideal send time under virtual time
+            int64_t timestampNs = clock.now(ClockDomain::Realtime);
+            sent = static_cast<ssize_t>(frame.size());
+            if (pcap.isOpen() && !pcap.write(frame, timestampNs)) {
+                sent = -1;
+            }
+            if (frameCallback_) {
+                frameCallback_(frame, timestampNs);
+            }
+        } else {
+            sent = socket.send(frame);
+        }
+        int64_t sendEnd = tsc.nowNs();
+        stats_.frameTiming.record(sendStart - buildStart, sendEnd - sendStart);
         
         if (sent > 0) {
             stats_.packetsSent++;
@@ -444,9 +870,8 @@ void ComtradeReplayTest::transmissionLoop() {
                 config_.progressInterval > 0 && 
                 stats_.packetsSent % config_.progressInterval == 0) {
                 
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
-                    now - stats_.startTime).count();
+                int64_t nowNs = clock.isVirtual() ? clock.now(ClockDomain::Monotonic) : sendEnd;
+                double elapsed = (nowNs - startNs) / 1e9;
                 
                 std::cout << "Sent " << stats_.packetsSent << " packets in " 
                           << std::fixed << std::setprecision(1) << elapsed << "s "
@@ -465,25 +890,42 @@ void ComtradeReplayTest::transmissionLoop() {
             }
         }
         
-        // Increment sample count
-        sv.incrementSampleCount();
         sampleIdx++;
         
-        // Check if we've reached the end
+        // Check if we've reached the end of the current block
         if (sampleIdx >= numSamples_) {
-            if (config_.loopPlayback) {
+            if (nextBlock()) {
+                sampleIdx = 0;  // Next block
+            } else if (!lastError_.empty()) {
+                std::cerr << "Error: " << lastError_ << std::endl;
+                break;
+            } else if (config_.loopPlayback) {
+                stage_.rewind();
+                samplesSent_ = 0;
+                if (!nextBlock()) {
+                    break;
+                }
                 sampleIdx = 0;  // Loop back to start
             } else {
                 break;  // End of playback
             }
         }
         
-        // Wait for next period
-        timer.wait_period(waitPeriod);
+        // Advance to the next scheduled sample and wait for it (the duration
+        // counts samples sent: a clock step moves the index, not the count)
+        uint64_t scheduledIndex = scheduler.advance();
+        if (maxSamples > 0 && ++streamedSamples >= maxSamples) {
+            break;  // Requested stream duration reached
+        }
+        sv.smpCnt = static_cast<uint16_t>(scheduledIndex % config_.sampleRate);
+        scheduler.wait();
         
     } while (running_);
     
+    stage_.stop();
+    stats_.timing = scheduler.getStats();
     socket.close();
+    pcap.close();
     
     if (config_.verboseOutput) {
         std::cout << "\nStopping transmission..." << std::endl;
@@ -501,14 +943,31 @@ void ComtradeReplayTest::printConfiguration() const {
     std::cout << "SV: AppID=0x" << std::hex << config_.appId << std::dec
               << ", svID=" << config_.svId 
               << ", Rate=" << config_.sampleRate << " Hz" << std::endl;
+    std::cout << "Time reference: " << timeReferenceName(config_.timing.reference) << std::endl;
+    if (isOffline()) {
+        std::cout << "Output: " << (config_.outputFile.empty() ? "memory" : config_.outputFile)
+                  << (config_.virtualTime ? " (virtual time)" : "") << std::endl;
+    }
     std::cout << "Channel mappings:" << std::endl;
     for (const auto& mapping : config_.channelMapping) {
         std::cout << "  " << mapping.first << " -> SV[" << mapping.second << "]" << std::endl;
     }
     std::cout << "Loop playback: " << (config_.loopPlayback ? "Yes" : "No") << std::endl;
+    if (config_.startTimeOffset > 0.0 || config_.endTimeOffset > 0.0) {
+        std::cout << "Time window: " << config_.startTimeOffset << " s to ";
+        if (config_.endTimeOffset > 0.0) {
+            std::cout << config_.endTimeOffset << " s" << std::endl;
+        } else {
+            std::cout << "end" << std::endl;
+        }
+    }
     if (config_.enableGooseMonitoring) {
         std::cout << "GOOSE stop trigger: " << config_.stopGooseRef << std::endl;
     }
+    if (config_.realtime.enabled) {
+        std::cout << "Real-time: TX prio " << config_.realtime.txPriority
+                  << ", RX prio " << config_.realtime.rxPriority << std::endl;
+    }
     std::cout << std::endl;
 }
 
@@ -518,6 +977,14 @@ void ComtradeReplayTest::printStatistics() const {
               << " samples @ " << stats_.comtradeSampleRate << " Hz" << std::endl;
     std::cout << "Resampled to: " << stats_.samplesInterpolated 
               << " samples @ " << stats_.outputSampleRate << " Hz" << std::endl;
+    printTimelineReport();  // As far as the last pass got
+    if (outputCache_ && !outputCached_) {
+        if (outputCache_->written()) {
+            std::cout << "Output cache: written to " << outputCache_->path() << std::endl;
+        } else {
+            std::cout << "Output cache: not written: " << outputCache_->getLastError() << std::endl;
+        }
+    }
     std::cout << "Packets sent: " << stats_.packetsSent << std::endl;
     std::cout << "Packets failed: " << stats_.packetsFailed << std::endl;
     std::cout << "Elapsed time: " << std::fixed << std::setprecision(3) 
@@ -525,6 +992,13 @@ void ComtradeReplayTest::printStatistics() const {
     std::cout << "Average rate: " << std::fixed << std::setprecision(1) 
               << stats_.getAverageRate() << " packets/sec" << std::endl;
     
+    std::cout << "Frame build: avg " << std::fixed << std::setprecision(0)
+              << stats_.frameTiming.getAverageBuildNs() << " ns, max " << stats_.frameTiming.maxBuildNs
+              << " ns; send: avg " << stats_.frameTiming.getAverageSendNs() << " ns, max "
+              << stats_.frameTiming.maxSendNs << " ns" << std::endl;
+    std::cout << "Clock drift: last " << stats_.timing.lastDriftNs << " ns, max "
+              << stats_.timing.maxAbsDriftNs << " ns, steps " << stats_.timing.clockSteps << std::endl;
+    
     if (stats_.stoppedByGoose) {
         std::cout << "Stopped by GOOSE: " << stats_.gooseStopReason << std::endl;
     }
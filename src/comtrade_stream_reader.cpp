@@ -0,0 +1,197 @@
+#include "comtrade_stream_reader.h"
+#include "comtrade_decoder.h"
+#include "comtrade_binary_reader.h"
+#include "comtrade_cff.h"
+#include "comtrade_decompressor.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Bytes buffered by the .dat stream
+const size_t kReadBufferBytes = 1 << 20;
+
+} // namespace
+
+ComtradeStreamReader::ComtradeStreamReader()
+    : blockSamples_(4096), datOffset_(0), datBytes_(0), asciiRemaining_(0),
+      windowFirst_(0), windowLast_(std::numeric_limits<uint64_t>::max()), asciiLinesLeft_(0),
+      samplesRead_(0), totalSamples_(0) {
+}
+
+ComtradeStreamReader::~ComtradeStreamReader() {
+    close();
+}
+
+bool ComtradeStreamReader::open(const std::string& cfgPath, const std::string& datPath, size_t blockSamples) {
+    close();
+    lastError_.clear();
+
+    if (blockSamples == 0) {
+        lastError_ = "Block size must be greater than 0";
+        return false;
+    }
+    blockSamples_ = blockSamples;
+
+    if (!cfgParser_.loadConfig(cfgPath)) {
+        lastError_ = cfgParser_.getLastError();
+        return false;
+    }
+    config_ = cfgParser_.getConfig();
+    datPath_ = ComtradeParser::resolveDatPath(cfgPath, datPath);
+    datOffset_ = 0;
+    datBytes_ = std::numeric_limits<uint64_t>::max();
+    windowFirst_ = 0;
+    windowLast_ = std::numeric_limits<uint64_t>::max();
+
+    // .cff: stream the DAT section of the container
+    if (ComtradeCffFile::isCffPath(cfgPath)) {
+        ComtradeCffFile cff;
+        if (!cff.open(cfgPath)) {
+            lastError_ = cff.getLastError();
+            return false;
+        }
+        if (cff.datIsBinary() != (config_.dataFormat != DataFormat::ASCII)) {
+            lastError_ = ".cff DAT section does not match the CFG data format";
+            return false;
+        }
+        datPath_ = cfgPath;
+        datOffset_ = cff.dat().offset(cff.file());
+        datBytes_ = cff.dat().size;
+    } else if (ComtradeDecompressor::compressionFor(datPath_) != DatCompression::None) {
+        // Rewinding and seeking to a window need a plain file
+        lastError_ = "Compressed .dat cannot be streamed, load it with ComtradeParser::load(): " + datPath_;
+        return false;
+    }
+    decoder_.reset(new ComtradeDecoder(config_));
+
+    return openData();
+}
+
+bool ComtradeStreamReader::openData() {
+    file_.close();
+    file_.clear();
+    samplesRead_ = 0;
+    totalSamples_ = 0;
+
+    bool binary = config_.dataFormat != DataFormat::ASCII;
+    readBuffer_.resize(kReadBufferBytes);
+    file_.rdbuf()->pubsetbuf(readBuffer_.data(), static_cast<std::streamsize>(readBuffer_.size()));
+    // Binary mode for ASCII too: byte counts stay exact (the decoder trims '\r')
+    file_.open(datPath_, std::ios::binary);
+    if (!file_.is_open()) {
+        lastError_ = "Failed to open .dat file: " + datPath_;
+        return false;
+    }
+    file_.seekg(static_cast<std::streamoff>(datOffset_), std::ios::beg);
+    asciiRemaining_ = datBytes_;
+
+    if (binary) {
+        // Same size validation as the mapped reader
+        uint64_t fileSize = datBytes_;
+        if (fileSize == std::numeric_limits<uint64_t>::max()) {
+            file_.seekg(0, std::ios::end);
+            fileSize = static_cast<uint64_t>(file_.tellg());
+            file_.seekg(0, std::ios::beg);
+        }
+
+        size_t count = 0;
+        if (!ComtradeBinaryReader::countRecords(fileSize, decoder_->layout(), config_, count, lastError_)) {
+            file_.close();
+            return false;
+        }
+        // The window is a record range: seek straight to it
+        uint64_t last = std::min<uint64_t>(windowLast_, count);
+        uint64_t first = std::min(windowFirst_, last);
+        file_.seekg(static_cast<std::streamoff>(datOffset_ + first * decoder_->layout().recordSize), std::ios::beg);
+        totalSamples_ = last - first;
+        blockBuffer_.resize(blockSamples_ * decoder_->layout().recordSize);
+    } else {
+        // One line per sample: skip the lines before the window unparsed
+        for (uint64_t i = 0; i < windowFirst_ && asciiRemaining_ > 0 && std::getline(file_, line_); i++) {
+            asciiRemaining_ -= std::min<uint64_t>(asciiRemaining_, line_.size() + 1);
+        }
+        asciiLinesLeft_ = windowLast_ - std::min(windowFirst_, windowLast_);
+    }
+    return true;
+}
+
+bool ComtradeStreamReader::setTimeWindow(double startSeconds, double endSeconds) {
+    if (!decoder_) {
+        lastError_ = "Reader not open";
+        return false;
+    }
+    uint64_t first = 0;
+    uint64_t last = std::numeric_limits<uint64_t>::max();
+    if ((startSeconds > 0.0 || endSeconds > 0.0) &&
+        !sampleWindowFromRates(config_, startSeconds, endSeconds, first, last)) {
+        lastError_ = "Time window needs sample rates in the .cfg";
+        return false;
+    }
+    windowFirst_ = first;
+    windowLast_ = last;
+    lastError_.clear();
+    return openData();
+}
+
+bool ComtradeStreamReader::next(ComtradeRecording& block) {
+    block.reset(config_.numAnalogChannels, config_.numDigitalChannels);
+    if (!file_.is_open() || !decoder_) {
+        return false;
+    }
+
+    if (config_.dataFormat == DataFormat::ASCII) {
+        block.reserve(blockSamples_);
+        while (block.sampleCount() < blockSamples_ && asciiRemaining_ > 0 && asciiLinesLeft_ > 0 &&
+               std::getline(file_, line_)) {
+            asciiRemaining_ -= std::min<uint64_t>(asciiRemaining_, line_.size() + 1);
+            asciiLinesLeft_--;
+            decoder_->parseAsciiLine(line_, block);  // Incomplete or invalid lines are skipped
+        }
+        if (file_.bad()) {
+            lastError_ = "Read error in .dat file: " + datPath_;
+            return false;
+        }
+    } else {
+        size_t remaining = static_cast<size_t>(totalSamples_ - samplesRead_);
+        size_t count = std::min(blockSamples_, remaining);
+        if (count == 0) {
+            return false;
+        }
+        size_t bytes = count * decoder_->layout().recordSize;
+        if (!file_.read(reinterpret_cast<char*>(blockBuffer_.data()), static_cast<std::streamsize>(bytes))) {
+            lastError_ = "Read error in .dat file: " + datPath_;
+            return false;
+        }
+        block.resize(count);
+        decoder_->decodeBinary(blockBuffer_.data(), count, block, 0);
+    }
+
+    block.buildDigitalEdges();
+    samplesRead_ += block.sampleCount();
+    return block.sampleCount() > 0;
+}
+
+bool ComtradeStreamReader::rewind() {
+    if (!decoder_) {
+        lastError_ = "Reader not open";
+        return false;
+    }
+    lastError_.clear();
+    return openData();
+}
+
+void ComtradeStreamReader::close() {
+    file_.close();
+    samplesRead_ = 0;
+    totalSamples_ = 0;
+}
+
+double ComtradeStreamReader::getSampleRate(int sampleIndex) const {
+    return cfgParser_.getSampleRate(sampleIndex);
+}
+
+const AnalogChannel* ComtradeStreamReader::getAnalogChannel(const std::string& name) const {
+    return cfgParser_.getAnalogChannel(name);
+}
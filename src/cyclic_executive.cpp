@@ -0,0 +1,242 @@
+#include "cyclic_executive.h"
+#include "timer.h"
+
+#ifdef __linux__
+    #include <sys/timerfd.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+
+// Min-heap on deadline; ties run in registration order
+struct LaterDeadline {
+    template <typename Entry>
+    bool operator()(const Entry& a, const Entry& b) const {
+        if (a.deadlineNs != b.deadlineNs) {
+            return a.deadlineNs > b.deadlineNs;
+        }
+        return a.job > b.job;
+    }
+};
+
+} // namespace
+
+CyclicExecutive::CyclicExecutive() : running_(false), timerFd_(-1) {
+#ifdef __linux__
+    timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#endif
+}
+
+CyclicExecutive::~CyclicExecutive() {
+    stop();
+#ifdef __linux__
+    if (timerFd_ >= 0) {
+        ::close(timerFd_);
+    }
+#endif
+}
+
+int CyclicExecutive::addJob(const std::string& name, long long periodNs, JobFunction function, long long phaseNs) {
+    if (periodNs <= 0) {
+        return -1;
+    }
+    return addJob(name, static_cast<uint64_t>(periodNs), 1, std::move(function), phaseNs);
+}
+
+int CyclicExecutive::addRateJob(const std::string& name, uint32_t rateHz, JobFunction function, long long phaseNs) {
+    if (rateHz == 0 || rateHz > 1000000000U) {
+        return -1;
+    }
+    return addJob(name, 1000000000ULL, rateHz, std::move(function), phaseNs);
+}
+
+int CyclicExecutive::addJob(const std::string& name, uint64_t spanNs, uint64_t count, JobFunction function,
+                            long long phaseNs) {
+    if (running_ || !function) {
+        return -1;
+    }
+
+    Job job;
+    job.function = std::move(function);
+    job.periodNs = static_cast<long long>(spanNs / count);
+    job.periodSpanNs = spanNs;
+    job.periodCount = count;
+    job.phaseNs = std::max(0LL, phaseNs);
+    job.firstReleaseNs = 0;
+    job.nextReleaseNs = 0;
+    job.release = 0;
+    jobs_.push_back(std::move(job));
+
+    CyclicJobStats jobStats;
+    jobStats.name = name;
+    jobStats.periodNs = jobs_.back().periodNs;
+    stats_.jobs.push_back(jobStats);
+
+    return static_cast<int>(jobs_.size()) - 1;
+}
+
+int64_t CyclicExecutive::releaseNs(const Job& job, uint64_t release) {
+    // Whole spans first so release * span never overflows on long runs
+    uint64_t spans = release / job.periodCount;
+    uint64_t remainder = release % job.periodCount;
+    return job.firstReleaseNs + static_cast<int64_t>(spans * job.periodSpanNs) +
+           static_cast<int64_t>(remainder * job.periodSpanNs / job.periodCount);
+}
+
+int64_t CyclicExecutive::nowNs() {
+    // steady_clock is CLOCK_MONOTONIC on Linux, matching the timerfd clock
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CyclicExecutive::sleepUntil(int64_t deadlineNs) {
+#ifdef __linux__
+    if (timerFd_ >= 0) {
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = static_cast<time_t>(deadlineNs / 1000000000LL);
+        spec.it_value.tv_nsec = static_cast<long>(deadlineNs % 1000000000LL);
+        if (timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr) == 0) {
+            uint64_t expirations;
+            ssize_t ret;
+            do {
+                ret = ::read(timerFd_, &expirations, sizeof(expirations));
+            } while (ret < 0 && errno == EINTR);
+            return ret == static_cast<ssize_t>(sizeof(expirations));
+        }
+    }
+#endif
+    int64_t remaining = deadlineNs - nowNs();
+    if (remaining > 0) {
+        Timer timer;
+        timer.start_period(remaining);
+        timer.wait_period(0);
+    }
+    return true;
+}
+
+void CyclicExecutive::pushRelease(int job) {
+    heap_.push_back(HeapEntry{jobs_[job].nextReleaseNs, job});
+    std::push_heap(heap_.begin(), heap_.end(), LaterDeadline());
+}
+
+bool CyclicExecutive::run() {
+    if (jobs_.empty() || running_) {
+        return false;
+    }
+    running_ = true;
+
+    // Pin and prioritise this thread; the shortest period sizes SCHED_DEADLINE
+    long long minPeriod = jobs_[0].periodNs;
+    for (const auto& job : jobs_) {
+        minPeriod = std::min(minPeriod, job.periodNs);
+    }
+    // (memory allocated, locked and touched first, so no page fault waits at that priority)
+    heap_.reserve(jobs_.size());
+    RealtimeReport prepared;
+    if (realtime_.enabled) {
+        if (realtime_.lockMemory) {
+            lockProcessMemory(prepared);
+        }
+        if (realtime_.prefaultBuffers) {
+            prepared.prefaultedBytes += prefaultStack(realtime_.prefaultStackBytes);
+        }
+    }
+    realtimeReport_ = applyRealtimeProfile(realtime_, RealtimeRole::Transmit, minPeriod, prepared);
+
+    // Reset statistics, keeping job names and periods
+    stats_.ticks = 0;
+    stats_.jobsRun = 0;
+    stats_.totalOverheadNs = 0;
+    stats_.maxOverheadNs = 0;
+    for (auto& jobStats : stats_.jobs) {
+        jobStats.runs = 0;
+        jobStats.missedReleases = 0;
+        jobStats.maxLatenessNs = 0;
+        jobStats.maxRuntimeNs = 0;
+    }
+
+    heap_.clear();
+    int64_t startNs = nowNs();
+    for (size_t i = 0; i < jobs_.size(); i++) {
+        jobs_[i].release = 0;
+        jobs_[i].firstReleaseNs = startNs + jobs_[i].phaseNs;
+        jobs_[i].nextReleaseNs = jobs_[i].firstReleaseNs;
+        pushRelease(static_cast<int>(i));
+    }
+
+    while (running_) {
+        if (!sleepUntil(heap_.front().deadlineNs)) {
+            break;
+        }
+        if (!running_) {
+            break;
+        }
+
+        int64_t tickStart = nowNs();
+        int64_t now = tickStart;
+        int64_t jobTime = 0;
+
+        // Run every due release in deadline order
+        while (!heap_.empty() && heap_.front().deadlineNs <= now && running_) {
+            std::pop_heap(heap_.begin(), heap_.end(), LaterDeadline());
+            int index = heap_.back().job;
+            heap_.pop_back();
+
+            Job& job = jobs_[index];
+            CyclicJobStats& jobStats = stats_.jobs[index];
+
+            int64_t begin = nowNs();
+            job.function(job.release);
+            int64_t end = nowNs();
+
+            jobTime += end - begin;
+            jobStats.runs++;
+            jobStats.maxLatenessNs = std::max(jobStats.maxLatenessNs, begin - job.nextReleaseNs);
+            jobStats.maxRuntimeNs = std::max(jobStats.maxRuntimeNs, end - begin);
+            stats_.jobsRun++;
+
+            job.release++;
+            job.nextReleaseNs = releaseNs(job, job.release);
+
+            // A full period behind: skip the missed releases rather than burst
+            int64_t behind = end - job.nextReleaseNs;
+            int64_t missed = behind > 0 ? static_cast<int64_t>(static_cast<uint64_t>(behind) * job.periodCount /
+                                                               job.periodSpanNs) : 0;
+            if (missed > 0) {
+                job.release += static_cast<uint64_t>(missed);
+                job.nextReleaseNs = releaseNs(job, job.release);
+                jobStats.missedReleases += static_cast<uint64_t>(missed);
+            }
+
+            pushRelease(index);
+            now = end;
+        }
+
+        int64_t overhead = (nowNs() - tickStart) - jobTime;
+        stats_.ticks++;
+        stats_.totalOverheadNs += overhead;
+        stats_.maxOverheadNs = std::max(stats_.maxOverheadNs, overhead);
+    }
+
+    running_ = false;
+    return true;
+}
+
+void CyclicExecutive::printStatistics() const {
+    std::cout << "\n=== Cyclic Executive Statistics ===" << std::endl;
+    std::cout << "Ticks: " << stats_.ticks << ", jobs run: " << stats_.jobsRun << std::endl;
+    std::cout << "Tick overhead: avg " << std::fixed << std::setprecision(0)
+              << stats_.getAverageOverheadNs() << " ns, max " << stats_.maxOverheadNs << " ns" << std::endl;
+    for (const auto& job : stats_.jobs) {
+        std::cout << "  " << job.name << ": period " << job.periodNs << " ns, runs " << job.runs
+                  << ", missed " << job.missedReleases
+                  << ", max lateness " << job.maxLatenessNs << " ns"
+                  << ", max runtime " << job.maxRuntimeNs << " ns" << std::endl;
+    }
+    std::cout << std::endl;
+}
@@ -4,12 +4,16 @@
 #include "sampled_value.h"
 #include "goose_decoder.h"
 #include "raw_socket.h"
-#include "timer.h"
+#include "sample_scheduler.h"
+#include "tsc_clock.h"
+#include "realtime.h"
+#include "clock.h"
+#include "pcap_writer.h"
 #include <iostream>
 #include <iomanip>
 #include <time.h>
 
-PhasorInjectionTest::PhasorInjectionTest() : running_(false) {
+PhasorInjectionTest::PhasorInjectionTest() : running_(false), externalClock_(nullptr) {
 }
 
 PhasorInjectionTest::~PhasorInjectionTest() {
@@ -24,8 +28,10 @@ bool PhasorInjectionTest::configure(const PhasorInjectionConfig& config) {
     
     config_ = config;
     
-    // Auto-detect source MAC if not provided
-    if (config_.srcMac.empty()) {
+    // Auto-detect source MAC if not provided (offline output has no interface)
+    if (config_.srcMac.empty() && isOffline()) {
+        config_.srcMac = "00:00:00:00:00:00";
+    } else if (config_.srcMac.empty()) {
         RawSocket tempSocket;
         if (!tempSocket.open(config_.iface)) {
             lastError_ = "Failed to open interface " + config_.iface + " to detect MAC address";
@@ -46,11 +52,17 @@ bool PhasorInjectionTest::configure(const PhasorInjectionConfig& config) {
         return false;
     }
     
-    if (config_.iface.empty()) {
+    if (config_.iface.empty() && !isOffline()) {
         lastError_ = "Interface name cannot be empty";
         return false;
     }
     
+    // A virtual clock never waits: on a live interface that would flood the wire
+    if (config_.virtualTime && !isOffline()) {
+        lastError_ = "Virtual time needs offline output (outputFile or a frame callback)";
+        return false;
+    }
+    
     return true;
 }
 
@@ -60,18 +72,32 @@ bool PhasorInjectionTest::run() {
         return false;
     }
     
-    if (config_.iface.empty()) {
+    if (config_.iface.empty() && !isOffline()) {
         lastError_ = "Test not configured. Call configure() first";
         return false;
     }
     
     // Reset statistics
     stats_ = PhasorInjectionStats();
-    stats_.startTime = std::chrono::steady_clock::now();
+    
+    // Virtual time starts fresh on every run unless a clock was injected
+    virtualClock_.reset();
+    if (config_.virtualTime && !externalClock_) {
+        virtualClock_.reset(new VirtualClock());
+    }
+    
+    // An injected clock other than the system clock does not pace the wire either
+    if (!dynamic_cast<SystemClock*>(&activeClock()) && !isOffline()) {
+        lastError_ = "A non-system clock needs offline output (outputFile or a frame callback)";
+        return false;
+    }
+    stats_.startTime = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(activeClock().now(ClockDomain::Monotonic))));
     
     // Start GOOSE monitoring thread if enabled
     running_ = true;
-    if (config_.enableGooseMonitoring) {
+    if (config_.enableGooseMonitoring && !isOffline()) {
         gooseThread_ = std::thread(&PhasorInjectionTest::gooseCaptureThreadFunc, this);
     }
     
@@ -88,7 +114,9 @@ bool PhasorInjectionTest::run() {
         gooseThread_.join();
     }
     
-    stats_.endTime = std::chrono::steady_clock::now();
+    stats_.endTime = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(activeClock().now(ClockDomain::Monotonic))));
     
     // Print statistics
     if (config_.verboseOutput) {
@@ -126,6 +154,29 @@ void PhasorInjectionTest::setProgressCallback(std::function<void(uint32_t, doubl
     progressCallback_ = callback;
 }
 
+void PhasorInjectionTest::setFrameCallback(
+    std::function<void(const std::vector<uint8_t>&, int64_t)> callback) {
+    frameCallback_ = callback;
+}
+
+void PhasorInjectionTest::setClock(Clock* clock) {
+    externalClock_ = clock;
+}
+
+bool PhasorInjectionTest::isOffline() const {
+    return !config_.outputFile.empty() || static_cast<bool>(frameCallback_);
+}
+
+Clock& PhasorInjectionTest::activeClock() {
+    if (externalClock_) {
+        return *externalClock_;
+    }
+    if (virtualClock_) {
+        return *virtualClock_;
+    }
+    return systemClock();
+}
+
 void PhasorInjectionTest::printConfiguration() const {
     std::cout << "\n=== IEC 61850 Sampled Value Injection Test ===" << std::endl;
     std::cout << "\nConfiguration:" << std::endl;
@@ -137,11 +188,21 @@ void PhasorInjectionTest::printConfiguration() const {
     std::cout << "  APPID: 0x" << std::hex << config_.appId << std::dec << std::endl;
     std::cout << "  SV ID: " << config_.svId << std::endl;
     std::cout << "  Sample Rate: " << config_.sampleRate << " samples/sec" << std::endl;
+    std::cout << "  Time reference: " << timeReferenceName(config_.timing.reference) << std::endl;
+    if (isOffline()) {
+        std::cout << "  Output: " << (config_.outputFile.empty() ? "memory" : config_.outputFile)
+                  << (config_.virtualTime ? " (virtual time)" : "") << std::endl;
+    }
     
     if (config_.enableGooseMonitoring) {
         std::cout << "  GOOSE Stop: Enabled (monitoring for '" << config_.stopGooseRef << "')" << std::endl;
     }
     
+    if (config_.realtime.enabled) {
+        std::cout << "  Real-time: Enabled (TX prio " << config_.realtime.txPriority
+                  << ", RX prio " << config_.realtime.rxPriority << ")" << std::endl;
+    }
+    
     std::cout << "\nPhasor Values:" << std::endl;
     const char* labels[] = {"IA", "IB", "IC", "IN", "VA", "VB", "VC", "VN"};
     for (int i = 0; i < 8; i++) {
@@ -165,6 +226,13 @@ void PhasorInjectionTest::printStatistics() const {
                   << stats_.getAverageRate() << " packets/sec" << std::endl;
     }
     
+    std::cout << "Frame build: avg " << std::fixed << std::setprecision(0)
+              << stats_.frameTiming.getAverageBuildNs() << " ns, max " << stats_.frameTiming.maxBuildNs
+              << " ns; send: avg " << stats_.frameTiming.getAverageSendNs() << " ns, max "
+              << stats_.frameTiming.maxSendNs << " ns" << std::endl;
+    std::cout << "Clock drift: last " << stats_.timing.lastDriftNs << " ns, max "
+              << stats_.timing.maxAbsDriftNs << " ns, steps " << stats_.timing.clockSteps << std::endl;
+    
     if (stats_.stoppedByGoose) {
         std::cout << "Stopped by GOOSE: " << stats_.gooseStopReason << std::endl;
     }
@@ -179,6 +247,15 @@ void PhasorInjectionTest::gooseCaptureThreadFunc() {
         return;
     }
     
+    RealtimeReport prepared;
+    if (config_.realtime.enabled && config_.realtime.prefaultBuffers) {
+        prepared.prefaultedBytes += prefaultStack(config_.realtime.prefaultStackBytes);
+    }
+    stats_.rxRealtime = applyRealtimeProfile(config_.realtime, RealtimeRole::Capture, 0, prepared);
+    if (config_.realtime.enabled && config_.verboseOutput) {
+        printRealtimeReport(stats_.rxRealtime);
+    }
+    
     if (config_.verboseOutput) {
         std::cout << "GOOSE capture started on " << config_.iface << std::endl;
         std::cout << "Waiting for GOOSE with gocbRef containing: " << config_.stopGooseRef << std::endl;
@@ -242,9 +319,18 @@ void PhasorInjectionTest::gooseCaptureThreadFunc() {
 }
 
 void PhasorInjectionTest::transmissionLoop() {
-    // Open raw socket
+    // Frame sink: raw socket, or pcap file and/or frame callback when offline
+    const bool offline = isOffline();
     RawSocket socket;
-    if (!socket.open(config_.iface)) {
+    PcapWriter pcap;
+    if (!config_.outputFile.empty()) {
+        if (!pcap.open(config_.outputFile)) {
+            lastError_ = "Failed to create output file " + config_.outputFile;
+            std::cerr << "Error: " << lastError_ << std::endl;
+            running_ = false;
+            return;
+        }
+    } else if (!offline && !socket.open(config_.iface)) {
         lastError_ = "Failed to open raw socket on " + config_.iface;
         std::cerr << "Error: " << lastError_ << std::endl;
         std::cerr << "Note: This program requires root privileges (sudo)" << std::endl;
@@ -264,51 +350,15 @@ void PhasorInjectionTest::transmissionLoop() {
     
     if (config_.verboseOutput) {
         std::cout << "Starting SV transmission... (Press Ctrl+C to stop";
-        if (config_.enableGooseMonitoring) {
+        if (config_.enableGooseMonitoring && !offline) {
             std::cout << " or wait for GOOSE";
         }
         std::cout << ")" << std::endl << std::endl;
     }
     
-    // High-precision timer setup (following transient.cpp approach)
-    Timer timer;
-    struct timespec t_ini, t_start, now_realtime;
-    
     // Calculate wait period in nanoseconds for sample rate
     long waitPeriod = static_cast<long>(1e9 / config_.sampleRate);
     
-    // Get current REALTIME to align to next full second boundary (e.g., 20.000000)
-    clock_gettime(CLOCK_REALTIME, &now_realtime);
-    
-    // Wait until the next full second boundary
-    struct timespec next_second;
-    next_second.tv_sec = now_realtime.tv_sec + 1;
-    next_second.tv_nsec = 0;
-    
-    if (config_.verboseOutput) {
-        std::cout << "Current time: " << now_realtime.tv_sec << "." 
-                  << std::setfill('0') << std::setw(9) << now_realtime.tv_nsec << std::endl;
-        std::cout << "Waiting until: " << next_second.tv_sec << ".000000000" << std::endl;
-    }
-    
-    // Sleep until next second boundary (platform-specific)
-#ifdef __linux__
-    clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &next_second, nullptr);
-#else
-    // macOS: Calculate relative sleep time
-    struct timespec sleep_duration;
-    sleep_duration.tv_sec = 0;
-    sleep_duration.tv_nsec = 1000000000L - now_realtime.tv_nsec;
-    if (sleep_duration.tv_nsec >= 1000000000L) {
-        sleep_duration.tv_sec++;
-        sleep_duration.tv_nsec -= 1000000000L;
-    }
-    nanosleep(&sleep_duration, nullptr);
-#endif
-    
-    // Now get MONOTONIC time for the periodic timer (maintains relative precision)
-    clock_gettime(CLOCK_MONOTONIC, &t_ini);
-    
     // Pre-build initial frame outside the loop
     auto svPayload = sv.buildPacket(config_.phasors);
     std::vector<uint8_t> frame;
@@ -317,21 +367,69 @@ void PhasorInjectionTest::transmissionLoop() {
     frame.insert(frame.end(), vlanTag.begin(), vlanTag.end());
     frame.insert(frame.end(), svPayload.begin(), svPayload.end());
     
-    // Start timer at aligned time
-#ifdef _WIN32
-    // On Windows, start from current time (no timespec)
-    timer.start_period(waitPeriod);
-#else
-    // On Unix, use timespec for precise alignment
-    timer.start_period(t_ini);
-#endif
-    timer.wait_period(waitPeriod);
-    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    // Lock and touch memory, then apply the real-time profile before the first deadline
+    RealtimeReport prepared;
+    if (config_.realtime.enabled) {
+        if (config_.realtime.lockMemory) {
+            lockProcessMemory(prepared);
+        }
+        if (config_.realtime.prefaultBuffers) {
+            prepared.prefaultedBytes += prefaultStack(config_.realtime.prefaultStackBytes);
+            prepared.prefaultedBytes += prefaultMemory(frame.data(), frame.size());
+        }
+    }
+    stats_.txRealtime = applyRealtimeProfile(config_.realtime, RealtimeRole::Transmit, waitPeriod, prepared);
+    if (config_.realtime.enabled && config_.verboseOutput) {
+        printRealtimeReport(stats_.txRealtime);
+    }
+    
+    // Schedule clock (system or virtual) and cheap per-frame timestamps
+    // (TSC when invariant, steady_clock otherwise)
+    Clock& clock = activeClock();
+    TscClock tsc;
+    const int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stats_.startTime.time_since_epoch()).count();
+    if (config_.verboseOutput) {
+        if (tsc.usingTsc()) {
+            std::cout << "Frame timestamps: TSC @ " << std::fixed << std::setprecision(3)
+                      << tsc.frequencyHz() / 1e9 << " GHz" << std::endl;
+        } else {
+            std::cout << "Frame timestamps: steady_clock (no invariant TSC)" << std::endl;
+        }
+    }
+    int64_t buildNs = 0;
+    
+    // Sample k is due at reference second + k/rate (smpCnt=0 on the second)
+    SampleScheduler scheduler(config_.timing, config_.sampleRate, &clock);
+    const uint64_t maxSamples = config_.durationSeconds > 0.0
+        ? static_cast<uint64_t>(config_.durationSeconds * config_.sampleRate + 0.5) : 0;
+    uint64_t streamedSamples = 0;
+    scheduler.start();
+    
+    if (config_.verboseOutput) {
+        std::cout << "Sample 0 aligned to second " << scheduler.epochSeconds() << std::endl;
+    }
     
     // High-precision transmission loop
     while (running_) {
         // Send frame
-        ssize_t sent = socket.send(frame);
+        int64_t sendStart = tsc.nowNs();
+        ssize_t sent;
+        if (offline) {
+            // Schedule clock time: exactly the ideal send time under virtual time
+            int64_t timestampNs = clock.now(ClockDomain::Realtime);
+            sent = static_cast<ssize_t>(frame.size());
+            if (pcap.isOpen() && !pcap.write(frame, timestampNs)) {
+                sent = -1;
+            }
+            if (frameCallback_) {
+                frameCallback_(frame, timestampNs);
+            }
+        } else {
+            sent = socket.send(frame);
+        }
+        int64_t sendEnd = tsc.nowNs();
+        stats_.frameTiming.record(buildNs, sendEnd - sendStart);
         
         if (sent > 0) {
             stats_.packetsSent++;
@@ -341,9 +439,8 @@ void PhasorInjectionTest::transmissionLoop() {
                 config_.progressInterval > 0 && 
                 stats_.packetsSent % config_.progressInterval == 0) {
                 
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
-                    now - stats_.startTime).count();
+                int64_t nowNs = clock.isVirtual() ? clock.now(ClockDomain::Monotonic) : sendEnd;
+                double elapsed = (nowNs - startNs) / 1e9;
                 
                 std::cout << "Sent " << stats_.packetsSent << " packets in " 
                           << std::fixed << std::setprecision(1) << elapsed << "s "
@@ -362,21 +459,30 @@ void PhasorInjectionTest::transmissionLoop() {
             }
         }
         
-        // Increment sample count and rebuild frame for next iteration
-        sv.incrementSampleCount();
+        // Advance to the next scheduled sample (may skip after a clock step;
+        // the duration counts samples sent, not indices)
+        uint64_t sampleIndex = scheduler.advance();
+        if (maxSamples > 0 && ++streamedSamples >= maxSamples) {
+            break;  // Requested stream duration reached
+        }
+        sv.smpCnt = static_cast<uint16_t>(sampleIndex % config_.sampleRate);
         
         // Rebuild SV payload with new sample count
+        int64_t buildStart = tsc.nowNs();
         svPayload = sv.buildPacket(config_.phasors);
         
         // Update frame with new payload (reuse Ethernet+VLAN headers)
         frame.resize(ethHeader.size() + vlanTag.size());
         frame.insert(frame.end(), svPayload.begin(), svPayload.end());
+        buildNs = tsc.nowNs() - buildStart;
         
         // Wait for next period with high-precision absolute timer
-        timer.wait_period(waitPeriod);
+        scheduler.wait();
     }
     
+    stats_.timing = scheduler.getStats();
     socket.close();
+    pcap.close();
     
     if (config_.verboseOutput) {
         std::cout << "\nStopping transmission..." << std::endl;
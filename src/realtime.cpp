@@ -0,0 +1,235 @@
+#include "realtime.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <malloc.h>
+    #define alloca _alloca
+#else
+    #include <alloca.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+#ifdef __linux__
+    #include <sys/syscall.h>
+#endif
+#include <iostream>
+#include <algorithm>
+
+namespace {
+
+#if defined(__linux__) && defined(SYS_sched_setattr)
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// Not exported by glibc; layout from include/uapi/linux/sched/types.h
+struct SchedAttr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+bool setDeadline(long long periodNs, double runtimeFraction, std::string& err) {
+    if (periodNs <= 0) {
+        err = "SCHED_DEADLINE requires a sample period";
+        return false;
+    }
+    double fraction = std::min(std::max(runtimeFraction, 0.05), 0.95);
+
+    SchedAttr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = static_cast<uint64_t>(periodNs * fraction);
+    attr.sched_deadline = static_cast<uint64_t>(periodNs);
+    attr.sched_period = static_cast<uint64_t>(periodNs);
+
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0) {
+        err = std::string("SCHED_DEADLINE denied: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#ifndef _WIN32
+bool setFifo(int priority, std::string& err) {
+    int minPrio = sched_get_priority_min(SCHED_FIFO);
+    int maxPrio = sched_get_priority_max(SCHED_FIFO);
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = std::min(std::max(priority, minPrio), maxPrio);
+
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+        err = std::string("SCHED_FIFO denied: ") + std::strerror(ret);
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool setAffinity(int cpu, std::string& err) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        err = "CPU affinity to " + std::to_string(cpu) + " denied: " + std::strerror(ret);
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8) ||
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) == 0) {
+        err = "CPU affinity to " + std::to_string(cpu) + " denied";
+        return false;
+    }
+    return true;
+#else
+    (void)cpu;
+    err = "CPU affinity not supported on this platform";
+    return false;
+#endif
+}
+
+} // namespace
+
+RealtimeReport applyRealtimeProfile(const RealtimeConfig& config, RealtimeRole role, long long periodNs,
+                                    const RealtimeReport& prepared) {
+    RealtimeReport report = prepared;
+    report.role = (role == RealtimeRole::Transmit) ? "TX" : "GOOSE RX";
+
+    if (!config.enabled) {
+        return report;
+    }
+
+    int cpu = (role == RealtimeRole::Transmit) ? config.txCpu : config.rxCpu;
+    int priority = (role == RealtimeRole::Transmit) ? config.txPriority : config.rxPriority;
+    std::string err;
+
+    // Affinity first: SCHED_DEADLINE refuses restricted affinity, so the
+    // deadline attempt below degrades to FIFO when pinning was requested
+    if (cpu >= 0) {
+        if (setAffinity(cpu, err)) {
+            report.cpu = cpu;
+        } else {
+            report.warnings.push_back(err);
+        }
+    }
+
+    RealtimePolicy policy = config.policy;
+    // SCHED_DEADLINE only makes sense for the periodic TX loop
+    if (policy == RealtimePolicy::Deadline && role != RealtimeRole::Transmit) {
+        policy = RealtimePolicy::Fifo;
+    }
+
+    if (policy == RealtimePolicy::Deadline) {
+#if defined(__linux__) && defined(SYS_sched_setattr)
+        if (setDeadline(periodNs, config.deadlineRuntimeFraction, err)) {
+            report.policy = "DEADLINE";
+            return report;
+        }
+        report.warnings.push_back(err);
+#else
+        (void)periodNs;
+        report.warnings.push_back("SCHED_DEADLINE not supported on this platform");
+#endif
+        policy = RealtimePolicy::Fifo;
+    }
+
+    if (policy == RealtimePolicy::Fifo) {
+#ifdef _WIN32
+        (void)priority;
+        if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+            report.policy = "TIME_CRITICAL";
+            report.priority = THREAD_PRIORITY_TIME_CRITICAL;
+        } else {
+            report.warnings.push_back("THREAD_PRIORITY_TIME_CRITICAL denied");
+        }
+#else
+        if (setFifo(priority, err)) {
+            struct sched_param param;
+            int granted = SCHED_OTHER;
+            pthread_getschedparam(pthread_self(), &granted, &param);
+            report.policy = (granted == SCHED_FIFO) ? "FIFO" : "OTHER";
+            report.priority = param.sched_priority;
+        } else {
+            report.warnings.push_back(err);
+        }
+#endif
+    }
+
+    return report;
+}
+
+bool lockProcessMemory(RealtimeReport& report) {
+#ifdef _WIN32
+    report.warnings.push_back("mlockall not supported on Windows");
+    return false;
+#else
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        report.warnings.push_back(std::string("mlockall denied: ") + std::strerror(errno));
+        return false;
+    }
+    report.memoryLocked = true;
+    return true;
+#endif
+}
+
+size_t prefaultStack(size_t bytes) {
+    // Stay well inside the default 8 MiB thread stack
+    constexpr size_t kMaxStackPrefault = 4 * 1024 * 1024;
+    bytes = std::min(bytes, kMaxStackPrefault);
+    if (bytes == 0) {
+        return 0;
+    }
+    // alloca grows the current frame, so the touched pages are the ones the
+    // hot loop will later use; volatile keeps the writes from being elided
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+    stack[bytes - 1] = 0;
+    return bytes;
+}
+
+size_t prefaultMemory(void* data, size_t bytes) {
+    if (!data || bytes == 0) {
+        return 0;
+    }
+#ifdef _WIN32
+    const size_t pageSize = 4096;
+#else
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    volatile unsigned char* p = static_cast<volatile unsigned char*>(data);
+    for (size_t i = 0; i < bytes; i += pageSize) {
+        p[i] = p[i];
+    }
+    p[bytes - 1] = p[bytes - 1];
+    return bytes;
+}
+
+void printRealtimeReport(const RealtimeReport& report) {
+    std::cout << "Real-time profile [" << report.role << "]: policy=" << report.policy;
+    if (report.priority > 0) {
+        std::cout << " prio=" << report.priority;
+    }
+    std::cout << " cpu=" << (report.cpu >= 0 ? std::to_string(report.cpu) : "any")
+              << " mlock=" << (report.memoryLocked ? "yes" : "no")
+              << " prefault=" << report.prefaultedBytes / 1024 << " KiB" << std::endl;
+    for (const auto& warning : report.warnings) {
+        std::cout << "  Warning: " << warning << std::endl;
+    }
+}
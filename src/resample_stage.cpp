@@ -0,0 +1,240 @@
+#include "resample_stage.h"
+#include "comtrade_parser.h"
+#include "thread_pool.h"
+#include "resampled_cache.h"
+
+#include <algorithm>
+
+ResampleStage::ResampleStage()
+    : outputRate_(0.0), blockSamples_(0), cached_(nullptr), cachedNext_(0), recorder_(nullptr), source_(nullptr), head_(0), tail_(0), filled_(0), holding_(false),
+      rewindPending_(false), ended_(false), failed_(false), quit_(false), generation_(0) {
+}
+
+ResampleStage::~ResampleStage() {
+    stop();
+}
+
+bool ResampleStage::configure(const std::vector<SampleRate>& rates, const std::vector<int>& svChannels,
+                              double outputRate, const ResamplerOptions& options, size_t blockSamples,
+                              size_t lookahead, unsigned threads) {
+    stop();
+    if (threads == 0) {
+        threads = ThreadPool::defaultThreadCount();
+    }
+    if (!pool_ || pool_->size() + 1 != threads) {
+        timeline_.setThreadPool(nullptr);
+        pool_.reset(threads > 1 ? new ThreadPool(threads - 1) : nullptr);
+    }
+    timeline_.setThreadPool(pool_.get());
+    cached_ = nullptr;
+    recorder_ = nullptr;
+    rates_ = rates;
+    svChannels_ = svChannels;
+    outputRate_ = outputRate;
+    options_ = options;
+    blockSamples_ = std::max<size_t>(blockSamples, 1);
+    if (!timeline_.configure(rates_, svChannels_.size(), outputRate_, options_)) {
+        lastError_ = "Failed to configure resampler: " + timeline_.getLastError();
+        return false;
+    }
+
+    pulled_.assign(blockSamples_ * std::max<size_t>(svChannels_.size(), 1), 0.0);
+    allocate(lookahead);
+    lastError_.clear();
+    return true;
+}
+
+void ResampleStage::configureCached(const ResampledCache& cache, size_t blockSamples, size_t lookahead) {
+    stop();
+    cached_ = &cache;
+    recorder_ = nullptr;
+    svChannels_ = cache.svChannels();
+    blockSamples_ = std::max<size_t>(blockSamples, 1);
+    allocate(lookahead);
+    lastError_.clear();
+}
+
+void ResampleStage::recordTo(ResampledCache* cache) {
+    stop();
+    recorder_ = cache;
+}
+
+void ResampleStage::allocate(size_t lookahead) {
+    // Every buffer the worker and consumer use is allocated (and written) here,
+    // so the pages are resident before a real-time consumer starts
+    ring_.assign(lookahead + 1, ResampledBlock());
+    for (ResampledBlock& block : ring_) {
+        block.channels.assign(kSvChannels, std::vector<int32_t>(blockSamples_, 0));
+    }
+}
+
+void ResampleStage::start(ResampleSource* source) {
+    stop();
+    source_ = source;
+    quit_ = false;
+    rewind();
+    worker_ = std::thread(&ResampleStage::run, this);
+}
+
+void ResampleStage::rewind() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    head_ = 0;
+    tail_ = 0;
+    filled_ = 0;
+    holding_ = false;
+    ended_ = false;
+    failed_ = false;
+    lastError_.clear();
+    rewindPending_ = true;
+    wakeup_.notify_all();
+}
+
+void ResampleStage::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        wakeup_.notify_all();
+        produced_.notify_all();
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (recorder_ && recorder_->writing()) {
+        recorder_->abandon("stopped before the end of the recording");
+    }
+}
+
+const ResampledBlock* ResampleStage::next() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (holding_) {
+        tail_ = (tail_ + 1) % ring_.size();
+        filled_--;
+        holding_ = false;
+        wakeup_.notify_all();
+    }
+    produced_.wait(lock, [this] { return filled_ > 0 || ended_ || failed_ || quit_; });
+    if (filled_ == 0) {
+        return nullptr;
+    }
+    holding_ = true;
+    return &ring_[tail_];
+}
+
+std::string ResampleStage::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
+
+void ResampleStage::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!quit_) {
+        if (rewindPending_) {
+            rewindPending_ = false;
+            uint64_t generation = generation_;
+            lock.unlock();
+            bool ok = true;
+            std::string error;
+            if (cached_) {
+                cachedNext_ = 0;
+            } else {
+                ok = timeline_.configure(rates_, svChannels_.size(), outputRate_, options_);
+                error = ok ? std::string() : timeline_.getLastError();
+                if (ok && !source_->rewind()) {
+                    ok = false;
+                    error = source_->getLastError();
+                }
+            }
+            // Recording starts over with the pass (a failure only costs the entry)
+            if (ok && recorder_ && !recorder_->begin(svChannels_)) {
+                recorder_ = nullptr;
+            }
+            lock.lock();
+            if (!ok && generation == generation_) {
+                failed_ = true;
+                lastError_ = error.empty() ? "Failed to rewind the recording" : error;
+                produced_.notify_all();
+            }
+            continue;
+        }
+        if (ended_ || failed_ || filled_ == ring_.size()) {
+            wakeup_.wait(lock);
+            continue;
+        }
+
+        // The slot is the worker's until it is counted in filled_
+        size_t slot = head_;
+        uint64_t generation = generation_;
+        lock.unlock();
+        bool more = cached_ ? fillCached(ring_[slot]) : fill(ring_[slot], generation);
+        std::string error = more || cached_ ? std::string() : source_->getLastError();
+        if (recorder_ && recorder_->writing()) {
+            // A block of a pass rewound meanwhile goes to an entry begin() drops
+            bool ok = recorder_->append(ring_[slot]);
+            if (ok && !more && error.empty()) {
+                recorder_->commit(timeline_.report());
+                ok = false;
+            }
+            if (!ok) {
+                recorder_ = nullptr;
+            }
+        }
+        lock.lock();
+        if (generation != generation_) {
+            continue;  // Rewound meanwhile: the block belongs to the old pass
+        }
+        if (ring_[slot].count > 0) {
+            head_ = (head_ + 1) % ring_.size();
+            filled_++;
+        }
+        if (!more) {
+            ended_ = error.empty();
+            failed_ = !error.empty();
+            lastError_ = error;
+        }
+        produced_.notify_all();
+    }
+}
+
+bool ResampleStage::fillCached(ResampledBlock& block) {
+    const std::vector<int>& svChannels = cached_->svChannels();
+    const size_t stride = svChannels.size();
+    block.count = static_cast<size_t>(std::min<uint64_t>(blockSamples_, cached_->sampleCount() - cachedNext_));
+    const int32_t* samples = cached_->samples() + cachedNext_ * stride;
+    for (size_t c = 0; c < stride; c++) {
+        int32_t* out = block.channels[svChannels[c]].data();
+        for (size_t i = 0; i < block.count; i++) {
+            out[i] = samples[i * stride + c];
+        }
+    }
+    cachedNext_ += block.count;
+    return cachedNext_ < cached_->sampleCount();
+}
+
+bool ResampleStage::fill(ResampledBlock& block, uint64_t generation) {
+    const size_t stride = svChannels_.size();
+    block.count = 0;
+    while (block.count < blockSamples_ && generation == generation_) {
+        size_t count = timeline_.pull(pulled_.data(), blockSamples_ - block.count);
+        if (count > 0) {
+            for (size_t c = 0; c < stride; c++) {
+                int32_t* out = block.channels[svChannels_[c]].data() + block.count;
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = static_cast<int32_t>(pulled_[i * stride + c]);
+                }
+            }
+            block.count += count;
+            continue;
+        }
+        if (timeline_.done()) {
+            return false;
+        }
+        if (!source_->read(timeline_)) {
+            if (!source_->getLastError().empty()) {
+                return false;
+            }
+            timeline_.finish();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,329 @@
+#include "resampled_cache.h"
+#include "resample_stage.h"
+#include "cache_hash.h"
+
+#include <filesystem>
+#include <random>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kOutputMagic[8] = {'C', 'T', 'O', 'U', 'T', 'P', 'U', 'T'};
+const uint32_t kOutputVersion = 3;
+const uint32_t kByteOrderMark = 0x01020304;  // Reads back differently on another byte order
+
+// Alignment of the arrays inside the cache file
+const uint64_t kArrayAlignment = 64;
+
+/**
+ * @brief Fixed header at the start of an output cache file (native byte order)
+ */
+struct OutputHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t keyHash;
+    uint64_t probeHash;
+    uint64_t contentHash;          // Every byte of the source, when the entry was written
+    uint64_t fileSize;             // Whole cache file, catches truncation
+    uint64_t numSamples;           // Output samples
+    uint32_t numValues;            // Values per sample
+    int32_t svChannels[kSvChannels];  // SV channel of each value
+    uint32_t numRates;
+    uint64_t recordingSamples;     // ResampledCacheInfo
+    double recordingRate;
+    uint64_t runs;                 // TimelineReport of the pass
+    uint64_t rateChanges;
+    uint64_t gaps;
+    uint64_t missingSamples;
+    uint64_t droppedSamples;
+    uint64_t settingsOffset;
+    uint64_t settingsSize;
+    uint64_t samplesOffset;        // numSamples x numValues int32_t, [sample][value]
+    uint64_t ratesOffset;          // numRates double
+};
+
+/**
+ * @brief Array placement for an entry of a given shape
+ */
+struct OutputLayout {
+    OutputHeader header;
+
+    OutputLayout(uint64_t settingsSize, uint64_t numSamples, uint32_t numValues, uint32_t numRates) {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kOutputMagic, sizeof(kOutputMagic));
+        header.version = kOutputVersion;
+        header.byteOrder = kByteOrderMark;
+        header.numSamples = numSamples;
+        header.numValues = numValues;
+        header.numRates = numRates;
+
+        uint64_t pos = sizeof(OutputHeader);
+        header.settingsOffset = pos;
+        header.settingsSize = settingsSize;
+        pos = align(pos + settingsSize);
+        header.samplesOffset = pos;
+        pos = align(pos + numSamples * numValues * sizeof(int32_t));
+        header.ratesOffset = pos;
+        pos += numRates * sizeof(double);
+        header.fileSize = pos;
+    }
+
+    static uint64_t align(uint64_t pos) {
+        return (pos + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+    }
+};
+
+// Zero bytes up to an offset
+void pad(std::ofstream& out, uint64_t offset) {
+    static const char zeros[kArrayAlignment] = {};
+    uint64_t pos = static_cast<uint64_t>(out.tellp());
+    if (offset > pos) {
+        out.write(zeros, static_cast<std::streamsize>(offset - pos));
+    }
+}
+
+} // namespace
+
+ResampledCache::ResampledCache(const std::string& cfgPath, const std::string& datPath, const std::string& cacheDir,
+                               const std::string& settings, std::shared_ptr<const CacheSource> source)
+    : source_(source ? std::move(source) : std::make_shared<const CacheSource>(cfgPath, datPath)),
+      settings_(settings), sampleCount_(0), samples_(nullptr), writeSamples_(0), written_(false) {
+    // Named after the recording's own cache entry, so it is as unique
+    Fnv1a name;
+    name.add(ComtradeCache::pathFor(cfgPath, cacheDir));
+    name.add(settings_);
+    fs::path base = cacheDir.empty() ? fs::path(cfgPath) : fs::path(cacheDir) / fs::path(cfgPath).filename();
+    path_ = base.string() + "-" + toHex(name.value()) + ".out.cache";
+}
+
+ResampledCache::~ResampledCache() {
+    abandon();
+}
+
+CacheResult ResampledCache::open(std::string& detail) {
+    file_.close();
+    info_ = ResampledCacheInfo();
+    svChannels_.clear();
+    sampleCount_ = 0;
+    samples_ = nullptr;
+
+    std::error_code ec;
+    if (!fs::exists(path_, ec)) {
+        return CacheResult::Miss;
+    }
+    uint64_t keyHash = 0;
+    uint64_t probeHash = 0;
+    if (!source_->identity(keyHash, probeHash, detail)) {
+        return CacheResult::Stale;
+    }
+
+    MappedFile file;
+    if (!file.open(path_)) {
+        detail = file.getLastError();
+        return CacheResult::Stale;
+    }
+    OutputHeader header;
+    if (file.size() < sizeof(header)) {
+        detail = "cache file truncated";
+        return CacheResult::Stale;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kOutputMagic, sizeof(kOutputMagic)) != 0) {
+        detail = "not an output cache file";
+        return CacheResult::Stale;
+    }
+    if (header.byteOrder != kByteOrderMark) {
+        detail = "cache written on a machine with another byte order";
+        return CacheResult::Stale;
+    }
+    if (header.version != kOutputVersion) {
+        detail = "cache version " + std::to_string(header.version) + ", expected " +
+                 std::to_string(kOutputVersion);
+        return CacheResult::Stale;
+    }
+    if (header.keyHash != keyHash) {
+        detail = "source path, size or modification time changed";
+        return CacheResult::Stale;
+    }
+    if (header.probeHash != probeHash) {
+        detail = "source content changed";
+        return CacheResult::Stale;
+    }
+
+    // Recompute the layout from the shape so a damaged header cannot point outside the file
+    OutputLayout layout(header.settingsSize, header.numSamples,
+                        std::min<uint32_t>(header.numValues, kSvChannels), header.numRates);
+    if (header.numValues > kSvChannels || header.settingsOffset != layout.header.settingsOffset ||
+        header.samplesOffset != layout.header.samplesOffset || header.ratesOffset != layout.header.ratesOffset ||
+        header.fileSize != layout.header.fileSize || file.size() != header.fileSize) {
+        detail = "cache file truncated or damaged";
+        return CacheResult::Stale;
+    }
+    const uint8_t* base = file.data();
+    if (header.settingsSize != settings_.size() ||
+        std::memcmp(base + header.settingsOffset, settings_.data(), settings_.size()) != 0) {
+        detail = "stored with other settings";
+        return CacheResult::Stale;
+    }
+    for (uint32_t v = 0; v < header.numValues; v++) {
+        if (header.svChannels[v] < 0 || header.svChannels[v] >= static_cast<int32_t>(kSvChannels)) {
+            detail = "cache file truncated or damaged";
+            return CacheResult::Stale;
+        }
+        svChannels_.push_back(header.svChannels[v]);
+    }
+
+    info_.recordingSamples = header.recordingSamples;
+    info_.recordingRate = header.recordingRate;
+    info_.report.runs = static_cast<size_t>(header.runs);
+    info_.report.rateChanges = static_cast<size_t>(header.rateChanges);
+    info_.report.gaps = static_cast<size_t>(header.gaps);
+    info_.report.missingSamples = header.missingSamples;
+    info_.report.droppedSamples = header.droppedSamples;
+    info_.report.rates.resize(header.numRates);
+    std::memcpy(info_.report.rates.data(), base + header.ratesOffset, header.numRates * sizeof(double));
+
+    // Blocks are copied out front to back, a few ahead of transmission
+    file.advise(MappedFile::Access::Sequential, 0, file.size());
+    sampleCount_ = header.numSamples;
+    samples_ = reinterpret_cast<const int32_t*>(base + header.samplesOffset);
+    file_ = std::move(file);
+    return CacheResult::Hit;
+}
+
+void ResampledCache::describe(uint64_t recordingSamples, double recordingRate) {
+    writeInfo_.recordingSamples = recordingSamples;
+    writeInfo_.recordingRate = recordingRate;
+}
+
+bool ResampledCache::begin(const std::vector<int>& svChannels) {
+    abandon();
+    if (svChannels.size() > kSvChannels) {
+        lastError_ = "more than " + std::to_string(kSvChannels) + " SV channels";
+        return false;
+    }
+    writeChannels_ = svChannels;
+    writeSamples_ = 0;
+
+    std::error_code ec;
+    fs::path target(path_);
+    if (target.has_parent_path()) {
+        fs::create_directories(target.parent_path(), ec);
+    }
+
+    // Unique temporary name so concurrent writers never share a file
+    std::random_device random;
+    tempPath_ = path_ + ".tmp" + toHex((static_cast<uint64_t>(random()) << 32) | random());
+    out_.open(tempPath_, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) {
+        lastError_ = "Failed to create cache file: " + tempPath_;
+        return false;
+    }
+
+    // The header is written last, once the shape is known
+    OutputLayout layout(settings_.size(), 0, static_cast<uint32_t>(svChannels.size()), 0);
+    pad(out_, layout.header.settingsOffset);
+    out_.write(settings_.data(), static_cast<std::streamsize>(settings_.size()));
+    pad(out_, layout.header.samplesOffset);
+    if (!out_) {
+        abandon("Failed to write cache file: " + tempPath_);
+        return false;
+    }
+    return true;
+}
+
+bool ResampledCache::append(const ResampledBlock& block) {
+    if (!out_.is_open()) {
+        return false;
+    }
+    const size_t stride = writeChannels_.size();
+    frames_.resize(block.count * stride);
+    for (size_t v = 0; v < stride; v++) {
+        const int32_t* column = block.channels[writeChannels_[v]].data();
+        for (size_t i = 0; i < block.count; i++) {
+            frames_[i * stride + v] = column[i];
+        }
+    }
+    out_.write(reinterpret_cast<const char*>(frames_.data()),
+               static_cast<std::streamsize>(frames_.size() * sizeof(int32_t)));
+    if (!out_) {
+        abandon("Failed to write cache file: " + tempPath_);
+        return false;
+    }
+    writeSamples_ += block.count;
+    return true;
+}
+
+bool ResampledCache::commit(const TimelineReport& report) {
+    if (!out_.is_open()) {
+        return false;
+    }
+
+    // The output must come from the source the hashes describe
+    std::string error;
+    uint64_t keyHash = 0;
+    uint64_t probeHash = 0;
+    uint64_t contentHash = 0;
+    if (!source_->identity(keyHash, probeHash, error) || !source_->unchanged(error) ||
+        !source_->contentHash(contentHash, error)) {
+        abandon(error);
+        return false;
+    }
+
+    OutputLayout layout(settings_.size(), writeSamples_, static_cast<uint32_t>(writeChannels_.size()),
+                        static_cast<uint32_t>(report.rates.size()));
+    OutputHeader& header = layout.header;
+    header.keyHash = keyHash;
+    header.probeHash = probeHash;
+    header.contentHash = contentHash;
+    for (size_t v = 0; v < kSvChannels; v++) {
+        header.svChannels[v] = v < writeChannels_.size() ? writeChannels_[v] : -1;
+    }
+    header.recordingSamples = writeInfo_.recordingSamples;
+    header.recordingRate = writeInfo_.recordingRate;
+    header.runs = report.runs;
+    header.rateChanges = report.rateChanges;
+    header.gaps = report.gaps;
+    header.missingSamples = report.missingSamples;
+    header.droppedSamples = report.droppedSamples;
+
+    pad(out_, header.ratesOffset);
+    out_.write(reinterpret_cast<const char*>(report.rates.data()),
+               static_cast<std::streamsize>(report.rates.size() * sizeof(double)));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.flush();
+    if (!out_) {
+        abandon("Failed to write cache file: " + tempPath_);
+        return false;
+    }
+    out_.close();
+
+    std::error_code ec;
+    fs::rename(tempPath_, path_, ec);
+    if (ec) {
+        lastError_ = "Failed to move cache file into place: " + ec.message();
+        fs::remove(tempPath_, ec);
+        return false;
+    }
+    lastError_.clear();
+    written_ = true;
+    return true;
+}
+
+void ResampledCache::abandon(const std::string& reason) {
+    if (out_.is_open()) {
+        out_.close();
+        std::error_code ec;
+        fs::remove(tempPath_, ec);
+    }
+    if (!reason.empty()) {
+        lastError_ = reason;
+    }
+}
@@ -0,0 +1,687 @@
+#include "sample_resampler.h"
+#include "analog_scaling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <immintrin.h>
+    #define SAMPLE_RESAMPLER_X86 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #define TARGET_AVX2
+    #else
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Longest filter configure() accepts (input samples per output sample)
+const size_t kMaxTaps = 1 << 16;
+
+// Largest M of an L/M ratio (keeps (n % L) * M within 64 bits)
+const uint64_t kMaxDown = uint64_t(1) << 40;
+
+// Most coefficients precomputed for skewed channels, in exact banks or in the
+// table (beyond: from the table per channel and output)
+const size_t kMaxSkewBankValues = size_t(1) << 21;
+
+// Zeroth-order modified Bessel function of the first kind (power series)
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double quarterSquare = x * x / 4.0;
+    for (int k = 1; k < 500 && term > sum * 1e-17; k++) {
+        term *= quarterSquare / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser window shape for a stopband attenuation (Kaiser's empirical fit)
+double kaiserBeta(double attenuationDb) {
+    if (attenuationDb > 50.0) {
+        return 0.1102 * (attenuationDb - 8.7);
+    }
+    if (attenuationDb >= 21.0) {
+        return 0.5842 * std::pow(attenuationDb - 21.0, 0.4) + 0.07886 * (attenuationDb - 21.0);
+    }
+    return 0.0;
+}
+
+double sinc(double x) {
+    if (std::abs(x) < 1e-12) {
+        return 1.0;
+    }
+    return std::sin(kPi * x) / (kPi * x);
+}
+
+// Rate in whole millihertz, if it is one
+bool wholeMillihertz(double rate, uint64_t& millihertz) {
+    double scaled = rate * 1000.0;
+    double rounded = std::round(scaled);
+    if (rounded < 1.0 || rounded > 1e15 || std::abs(scaled - rounded) > 1e-9 * scaled) {
+        return false;
+    }
+    millihertz = static_cast<uint64_t>(rounded);
+    return true;
+}
+
+uint64_t greatestCommonDivisor(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// out[ch] = sum over k of coefs[k] * rows[k * stride + ch] for channels
+// first .. first + count - 1. Even and odd taps are summed separately (two
+// dependency chains) and added at the end; every kernel keeps this order
+// (and separate multiply and add), so results do not depend on the SIMD level.
+void accumulateScalar(const double* coefs, size_t taps, const double* rows, size_t stride,
+                      size_t first, size_t count, double* out) {
+    for (size_t ch = first; ch < first + count; ch++) {
+        double even = 0.0;
+        double odd = 0.0;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            even += coefs[k] * rows[k * stride + ch];
+            odd += coefs[k + 1] * rows[(k + 1) * stride + ch];
+        }
+        if (k < taps) {
+            even += coefs[k] * rows[k * stride + ch];
+        }
+        out[ch] = even + odd;
+    }
+}
+
+#ifdef SAMPLE_RESAMPLER_X86
+
+// Four channels per vector
+TARGET_AVX2 void accumulateAvx2(const double* coefs, size_t taps, const double* rows, size_t stride,
+                                size_t first, size_t count, double* out) {
+    size_t ch = first;
+    for (; ch + 4 <= first + count; ch += 4) {
+        __m256d even = _mm256_setzero_pd();
+        __m256d odd = _mm256_setzero_pd();
+        const double* row = rows + ch;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(_mm256_set1_pd(coefs[k]), _mm256_loadu_pd(row)));
+            row += stride;
+            odd = _mm256_add_pd(odd, _mm256_mul_pd(_mm256_set1_pd(coefs[k + 1]), _mm256_loadu_pd(row)));
+            row += stride;
+        }
+        if (k < taps) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(_mm256_set1_pd(coefs[k]), _mm256_loadu_pd(row)));
+        }
+        _mm256_storeu_pd(out + ch, _mm256_add_pd(even, odd));
+    }
+    if (ch < first + count) {
+        accumulateScalar(coefs, taps, rows, stride, ch, first + count - ch, out);
+    }
+}
+
+#endif
+
+// As accumulateScalar(), with coefficients per channel: coefs[k * stride + ch]
+void accumulateLanesScalar(const double* coefs, size_t taps, const double* rows, size_t stride,
+                           size_t first, size_t count, double* out) {
+    for (size_t ch = first; ch < first + count; ch++) {
+        double even = 0.0;
+        double odd = 0.0;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            even += coefs[k * stride + ch] * rows[k * stride + ch];
+            odd += coefs[(k + 1) * stride + ch] * rows[(k + 1) * stride + ch];
+        }
+        if (k < taps) {
+            even += coefs[k * stride + ch] * rows[k * stride + ch];
+        }
+        out[ch] = even + odd;
+    }
+}
+
+#ifdef SAMPLE_RESAMPLER_X86
+
+TARGET_AVX2 void accumulateLanesAvx2(const double* coefs, size_t taps, const double* rows, size_t stride,
+                                     size_t first, size_t count, double* out) {
+    size_t ch = first;
+    for (; ch + 4 <= first + count; ch += 4) {
+        __m256d even = _mm256_setzero_pd();
+        __m256d odd = _mm256_setzero_pd();
+        const double* row = rows + ch;
+        const double* coef = coefs + ch;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(_mm256_loadu_pd(coef), _mm256_loadu_pd(row)));
+            row += stride;
+            coef += stride;
+            odd = _mm256_add_pd(odd, _mm256_mul_pd(_mm256_loadu_pd(coef), _mm256_loadu_pd(row)));
+            row += stride;
+            coef += stride;
+        }
+        if (k < taps) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(_mm256_loadu_pd(coef), _mm256_loadu_pd(row)));
+        }
+        _mm256_storeu_pd(out + ch, _mm256_add_pd(even, odd));
+    }
+    if (ch < first + count) {
+        accumulateLanesScalar(coefs, taps, rows, stride, ch, first + count - ch, out);
+    }
+}
+
+#endif
+
+// As accumulateLanesScalar(), with each coefficient interpolated on the way:
+// lower + weight * (upper - lower), the arithmetic of the unskewed table
+void accumulateBlendScalar(const double* lower, const double* upper, double weight, size_t taps, const double* rows,
+                           size_t stride, size_t first, size_t count, double* out) {
+    for (size_t ch = first; ch < first + count; ch++) {
+        double even = 0.0;
+        double odd = 0.0;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            size_t i = k * stride + ch;
+            size_t j = i + stride;
+            even += (lower[i] + weight * (upper[i] - lower[i])) * rows[i];
+            odd += (lower[j] + weight * (upper[j] - lower[j])) * rows[j];
+        }
+        if (k < taps) {
+            size_t i = k * stride + ch;
+            even += (lower[i] + weight * (upper[i] - lower[i])) * rows[i];
+        }
+        out[ch] = even + odd;
+    }
+}
+
+#ifdef SAMPLE_RESAMPLER_X86
+
+// Coefficients lower[i .. i + 3] interpolated toward upper[i .. i + 3]
+#define BLEND_COEFS(i) \
+    _mm256_add_pd(_mm256_loadu_pd(lower + (i)), \
+                  _mm256_mul_pd(blend, _mm256_sub_pd(_mm256_loadu_pd(upper + (i)), _mm256_loadu_pd(lower + (i)))))
+
+TARGET_AVX2 void accumulateBlendAvx2(const double* lower, const double* upper, double weight, size_t taps,
+                                     const double* rows, size_t stride, size_t first, size_t count, double* out) {
+    const __m256d blend = _mm256_set1_pd(weight);
+    size_t ch = first;
+    for (; ch + 4 <= first + count; ch += 4) {
+        __m256d even = _mm256_setzero_pd();
+        __m256d odd = _mm256_setzero_pd();
+        size_t i = ch;
+        size_t k = 0;
+        for (; k + 1 < taps; k += 2) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(BLEND_COEFS(i), _mm256_loadu_pd(rows + i)));
+            i += stride;
+            odd = _mm256_add_pd(odd, _mm256_mul_pd(BLEND_COEFS(i), _mm256_loadu_pd(rows + i)));
+            i += stride;
+        }
+        if (k < taps) {
+            even = _mm256_add_pd(even, _mm256_mul_pd(BLEND_COEFS(i), _mm256_loadu_pd(rows + i)));
+        }
+        _mm256_storeu_pd(out + ch, _mm256_add_pd(even, odd));
+    }
+    if (ch < first + count) {
+        accumulateBlendScalar(lower, upper, weight, taps, rows, stride, ch, first + count - ch, out);
+    }
+}
+
+#undef BLEND_COEFS
+
+#endif
+
+void accumulateBlend(const double* lower, const double* upper, double weight, size_t taps, const double* rows,
+                     size_t stride, size_t first, size_t count, double* out) {
+#ifdef SAMPLE_RESAMPLER_X86
+    if (activeSimdLevel() == SimdLevel::AVX2 && count >= 4) {
+        accumulateBlendAvx2(lower, upper, weight, taps, rows, stride, first, count, out);
+        return;
+    }
+#endif
+    accumulateBlendScalar(lower, upper, weight, taps, rows, stride, first, count, out);
+}
+
+void accumulateLanes(const double* coefs, size_t taps, const double* rows, size_t stride, size_t first,
+                     size_t count, double* out) {
+#ifdef SAMPLE_RESAMPLER_X86
+    if (activeSimdLevel() == SimdLevel::AVX2 && count >= 4) {
+        accumulateLanesAvx2(coefs, taps, rows, stride, first, count, out);
+        return;
+    }
+#endif
+    accumulateLanesScalar(coefs, taps, rows, stride, first, count, out);
+}
+
+void accumulate(const double* coefs, size_t taps, const double* rows, size_t stride, size_t first, size_t count,
+                double* out) {
+#ifdef SAMPLE_RESAMPLER_X86
+    if (activeSimdLevel() == SimdLevel::AVX2 && count >= 4) {
+        accumulateAvx2(coefs, taps, rows, stride, first, count, out);
+        return;
+    }
+#endif
+    accumulateScalar(coefs, taps, rows, stride, first, count, out);
+}
+
+} // namespace
+
+SampleResampler::SampleResampler()
+    : ratio_(1.0), step_(1.0), cutoff_(1.0), beta_(0.0), tablePhases_(0), origin_(0.0), originUnits_(0),
+      useTable_(false), skewLow_(0), skewHigh_(0), span_(0) {
+}
+
+bool SampleResampler::configure(double inputRate, double outputRate, const ResamplerOptions& options) {
+    lastError_.clear();
+    spec_ = ResamplerSpec();
+    bank_.clear();
+    table_.clear();
+    skew_.clear();
+    skewBanks_.clear();
+    skewTable_.clear();
+    skewLow_ = 0;
+    skewHigh_ = 0;
+    origin_ = 0.0;
+    originUnits_ = 0;
+    useTable_ = false;
+    if (!(inputRate > 0.0) || !(outputRate > 0.0)) {
+        lastError_ = "Sample rates must be positive";
+        return false;
+    }
+    ratio_ = outputRate / inputRate;
+    step_ = inputRate / outputRate;
+    spec_.method = options.method;
+    spec_.stopbandHz = std::min(inputRate, outputRate) / 2.0;
+    spec_.passbandHz = spec_.stopbandHz;
+
+    if (options.method == ResamplerMethod::Linear) {
+        scratch_.coefs.assign(2, 0.0);
+        return true;
+    }
+
+    if (!(options.passband > 0.0 && options.passband < 1.0) || !(options.stopbandDb > 0.0) ||
+        options.tablePhases == 0) {
+        lastError_ = "Invalid resampler filter options";
+        return false;
+    }
+
+    // Kaiser's estimate of the length for the transition band, in input samples
+    spec_.passbandHz = options.passband * spec_.stopbandHz;
+    spec_.stopbandDb = options.stopbandDb;
+    spec_.rippleDb = 20.0 * std::log10(1.0 + std::pow(10.0, -options.stopbandDb / 20.0));
+    double transition = (spec_.stopbandHz - spec_.passbandHz) / inputRate;
+    double length = std::ceil(std::max(options.stopbandDb - 7.95, 0.0) / (14.36 * transition));
+    if (!(length <= static_cast<double>(kMaxTaps))) {
+        lastError_ = "Resampler filter too long (" + std::to_string(static_cast<uint64_t>(length)) + " taps)";
+        return false;
+    }
+    size_t taps = std::max<size_t>(4, (static_cast<size_t>(length) + 1) & ~static_cast<size_t>(1));
+    spec_.taps = static_cast<unsigned>(taps);
+    cutoff_ = (spec_.passbandHz + spec_.stopbandHz) / inputRate;
+    beta_ = kaiserBeta(options.stopbandDb);
+    tablePhases_ = options.tablePhases;
+
+    uint64_t inputMillihertz;
+    uint64_t outputMillihertz;
+    if (wholeMillihertz(inputRate, inputMillihertz) && wholeMillihertz(outputRate, outputMillihertz)) {
+        uint64_t divisor = greatestCommonDivisor(inputMillihertz, outputMillihertz);
+        uint64_t up = outputMillihertz / divisor;
+        uint64_t down = inputMillihertz / divisor;
+        if (up <= options.maxPhases && down <= kMaxDown) {
+            spec_.rational = true;
+            spec_.up = static_cast<unsigned>(up);
+            spec_.down = static_cast<unsigned>(down);
+        }
+    }
+    if (spec_.rational) {
+        spec_.phases = spec_.up;
+        designBanks(bank_, spec_.up, spec_.up);
+    } else {
+        spec_.phases = tablePhases_;
+        designBanks(table_, tablePhases_, tablePhases_ + 1);
+        useTable_ = true;
+    }
+    scratch_.coefs.assign(taps, 0.0);
+    return true;
+}
+
+void SampleResampler::designBanks(std::vector<double>& banks, size_t phases, size_t count) const {
+    // Bank p holds the taps for an output p / phases of the way from one input
+    // sample to the next; the table gets bank `phases` too (the next sample's
+    // bank 0), so interpolation never wraps
+    banks.resize(count * spec_.taps);
+    for (size_t p = 0; p < count; p++) {
+        designBank(static_cast<double>(p) / phases, &banks[p * spec_.taps]);
+    }
+}
+
+void SampleResampler::designBank(double frac, double* bank) const {
+    const size_t taps = spec_.taps;
+    double halfWidth = static_cast<double>(taps) / 2.0;
+    double windowScale = 1.0 / besselI0(beta_);
+    double sum = 0.0;
+    for (size_t k = 0; k < taps; k++) {
+        // Distance from the output position to the input sample of tap k
+        double t = frac - (static_cast<double>(k) - halfWidth + 1.0);
+        double r = t / halfWidth;
+        double window = r * r < 1.0 ? besselI0(beta_ * std::sqrt(1.0 - r * r)) * windowScale : 0.0;
+        bank[k] = cutoff_ * sinc(cutoff_ * t) * window;
+        sum += bank[k];
+    }
+    // Unit gain at DC in every bank, so offsets replay exactly
+    for (size_t k = 0; k < taps; k++) {
+        bank[k] /= sum;
+    }
+}
+
+uint64_t SampleResampler::outputSamples(uint64_t inputSamples) const {
+    return static_cast<uint64_t>(std::ceil(inputSamples * ratio_));
+}
+
+void SampleResampler::setOrigin(double position) {
+    origin_ = position;
+    if (spec_.method == ResamplerMethod::Linear || !spec_.rational) {
+        return;
+    }
+    // The exact banks serve origins on the 1/L grid; others need the table
+    double units = position * spec_.up;
+    double rounded = std::round(units);
+    useTable_ = !(rounded >= 0.0 && std::abs(units - rounded) <= 1e-6);
+    if (useTable_) {
+        if (!skew_.empty()) {
+            designSkewTable();
+        } else if (table_.empty()) {
+            designBanks(table_, tablePhases_, tablePhases_ + 1);
+        }
+    } else {
+        originUnits_ = static_cast<uint64_t>(rounded);
+    }
+}
+
+void SampleResampler::setChannelSkew(const std::vector<double>& skew) {
+    skew_.clear();
+    skewBanks_.clear();
+    skewTable_.clear();
+    skewLow_ = 0;
+    skewHigh_ = 0;
+    if (std::all_of(skew.begin(), skew.end(), [](double offset) { return offset == 0.0; })) {
+        return;
+    }
+    skew_ = skew;
+    const size_t channels = skew_.size();
+    const size_t taps = spec_.taps;
+    const double lowest = *std::min_element(skew_.begin(), skew_.end());
+    const double highest = *std::max_element(skew_.begin(), skew_.end());
+    // Channel c's taps start floor(position - skew[c]) - taps/2 + 1: between
+    // floor(-highest) and ceil(-lowest) from those of the shared position
+    skewLow_ = static_cast<int64_t>(std::floor(-highest));
+    skewHigh_ = static_cast<int64_t>(std::ceil(-lowest));
+    span_ = taps + static_cast<size_t>(skewHigh_ - skewLow_);
+    if (spec_.method != ResamplerMethod::Polyphase) {
+        return;
+    }
+
+    if (spec_.rational && static_cast<size_t>(spec_.up) * span_ * channels <= kMaxSkewBankValues) {
+        // Phase r puts the shared position r / L past the base sample
+        designSkewBanks(skewBanks_, spec_.up, spec_.up);
+    }
+    if (useTable_ || skewBanks_.empty()) {
+        designSkewTable();
+    }
+}
+
+void SampleResampler::designSkewTable() {
+    if (table_.empty()) {
+        designBanks(table_, tablePhases_, tablePhases_ + 1);
+    }
+    if (skewTable_.empty() && (static_cast<size_t>(tablePhases_) + 1) * span_ * skew_.size() <= kMaxSkewBankValues) {
+        designSkewBanks(skewTable_, tablePhases_, tablePhases_ + 1);
+    }
+}
+
+void SampleResampler::designSkewBanks(std::vector<double>& banks, size_t phases, size_t count) const {
+    // As designBanks(), for every channel at its own offset in the span. A
+    // channel's taps shift a row as its position crosses an input sample;
+    // each row still holds the filter at that sample's distance, so banks on
+    // either side of the crossing interpolate like any other two
+    const size_t channels = skew_.size();
+    const size_t taps = spec_.taps;
+    banks.assign(count * span_ * channels, 0.0);
+    std::vector<double> bank(taps);
+    for (size_t p = 0; p < count; p++) {
+        double* phase = &banks[p * span_ * channels];
+        for (size_t c = 0; c < channels; c++) {
+            double position = static_cast<double>(p) / phases - skew_[c];
+            double base = std::floor(position);
+            designBank(position - base, bank.data());
+            size_t row = static_cast<size_t>(static_cast<int64_t>(base) - skewLow_);
+            // Bank `phases` of an integer skew reaches a row past the span,
+            // with a tap at the window's edge (zero)
+            for (size_t k = 0; k < taps && row + k < span_; k++) {
+                phase[(row + k) * channels + c] = bank[k];
+            }
+        }
+    }
+}
+
+void SampleResampler::inputSpan(uint64_t output, int64_t& first, int64_t& last) const {
+    if (spec_.method == ResamplerMethod::Linear) {
+        double position = origin_ + static_cast<double>(output) / ratio_;
+        first = static_cast<int64_t>(std::floor(position)) + skewLow_;
+        last = first + static_cast<int64_t>(skew_.empty() ? 2 : span_) - 1;
+        return;
+    }
+    int64_t base;
+    if (!useTable_) {
+        // (origin + output * M) / L without overflow: whole periods of L, then the rest
+        uint64_t up = spec_.up;
+        uint64_t rest = originUnits_ % up + (output % up) * spec_.down;
+        base = static_cast<int64_t>(originUnits_ / up + (output / up) * spec_.down + rest / up);
+    } else {
+        base = static_cast<int64_t>(std::floor(origin_ + static_cast<double>(output) * step_));
+    }
+    first = base - static_cast<int64_t>(spec_.taps / 2) + 1 + skewLow_;
+    last = first + static_cast<int64_t>(skew_.empty() ? spec_.taps : span_) - 1;
+}
+
+const double* SampleResampler::coefficients(uint64_t output, int64_t begin, int64_t end, int64_t& firstTap,
+                                           double* coefs) const {
+    const size_t taps = spec_.taps;
+    const int64_t half = static_cast<int64_t>(taps / 2);
+
+    if (spec_.method == ResamplerMethod::Linear) {
+        // Same arithmetic as interpolating data[i0] * (1 - frac) + data[i1] * frac
+        double position = origin_ + static_cast<double>(output) / ratio_;
+        if (position <= static_cast<double>(begin)) {
+            firstTap = begin;
+            coefs[0] = 1.0;
+            coefs[1] = 0.0;
+        } else if (end != INT64_MAX && position >= static_cast<double>(end - 1)) {
+            firstTap = end - 1;
+            coefs[0] = 1.0;
+            coefs[1] = 0.0;
+        } else {
+            int64_t i0 = static_cast<int64_t>(std::floor(position));
+            double frac = position - static_cast<double>(i0);
+            firstTap = i0;
+            coefs[0] = 1.0 - frac;
+            coefs[1] = frac;
+        }
+        return coefs;
+    }
+
+    if (!useTable_) {
+        uint64_t up = spec_.up;
+        uint64_t rest = originUnits_ % up + (output % up) * spec_.down;
+        firstTap = static_cast<int64_t>(originUnits_ / up + (output / up) * spec_.down + rest / up) - half + 1;
+        return &bank_[(rest % up) * taps];
+    }
+
+    // Interpolate between the two nearest banks of the table
+    double position = origin_ + static_cast<double>(output) * step_;
+    double base = std::floor(position);
+    double tablePosition = (position - base) * tablePhases_;
+    size_t phase = std::min(static_cast<size_t>(tablePosition), static_cast<size_t>(tablePhases_ - 1));
+    double weight = tablePosition - static_cast<double>(phase);
+    const double* lower = &table_[phase * taps];
+    const double* upper = lower + taps;
+    for (size_t k = 0; k < taps; k++) {
+        coefs[k] = lower[k] + weight * (upper[k] - lower[k]);
+    }
+    firstTap = static_cast<int64_t>(base) - half + 1;
+    return coefs;
+}
+
+const double* SampleResampler::skewedCoefficients(uint64_t output, size_t firstChannel, size_t channelCount,
+                                                  int64_t& firstTap, double* coefs, const double*& upper,
+                                                  double& weight) const {
+    const size_t channels = skew_.size();
+    const size_t taps = spec_.taps;
+    const int64_t half = static_cast<int64_t>(taps / 2);
+
+    // Edges are left to the caller's clamped rows: a channel's taps may reach
+    // past the stream where the shared position does not
+    double position;
+    int64_t base;
+    size_t phase = 0;
+    const bool exact = spec_.method == ResamplerMethod::Polyphase && !useTable_;
+    if (exact) {
+        uint64_t up = spec_.up;
+        uint64_t rest = originUnits_ % up + (output % up) * spec_.down;
+        base = static_cast<int64_t>(originUnits_ / up + (output / up) * spec_.down + rest / up);
+        phase = static_cast<size_t>(rest % up);
+        position = static_cast<double>(base) + static_cast<double>(phase) / spec_.up;
+    } else if (spec_.method == ResamplerMethod::Linear) {
+        position = origin_ + static_cast<double>(output) / ratio_;
+        base = static_cast<int64_t>(std::floor(position));
+    } else {
+        position = origin_ + static_cast<double>(output) * step_;
+        base = static_cast<int64_t>(std::floor(position));
+    }
+    firstTap = base - half + 1 + skewLow_;
+    upper = nullptr;
+    if (exact && !skewBanks_.empty()) {
+        return &skewBanks_[phase * span_ * channels];
+    }
+    if (!skewTable_.empty()) {
+        // The two nearest banks of the skewed table, interpolated by the caller
+        double tablePosition = (position - static_cast<double>(base)) * tablePhases_;
+        size_t tablePhase = std::min(static_cast<size_t>(tablePosition), static_cast<size_t>(tablePhases_ - 1));
+        weight = tablePosition - static_cast<double>(tablePhase);
+        const double* lower = &skewTable_[tablePhase * span_ * channels];
+        upper = lower + span_ * channels;
+        return lower;
+    }
+
+    for (size_t k = 0; k < span_; k++) {
+        std::fill(coefs + k * channels + firstChannel, coefs + k * channels + firstChannel + channelCount, 0.0);
+    }
+    for (size_t c = firstChannel; c < firstChannel + channelCount; c++) {
+        double shifted = position - skew_[c];
+        double whole = std::floor(shifted);
+        double frac = shifted - whole;
+        double* column = coefs + static_cast<size_t>(static_cast<int64_t>(whole) - base - skewLow_) * channels + c;
+        if (spec_.method == ResamplerMethod::Linear) {
+            column[0] = 1.0 - frac;
+            column[channels] = frac;
+            continue;
+        }
+        double tablePosition = frac * tablePhases_;
+        size_t tablePhase = std::min(static_cast<size_t>(tablePosition), static_cast<size_t>(tablePhases_ - 1));
+        double weight = tablePosition - static_cast<double>(tablePhase);
+        const double* lower = &table_[tablePhase * taps];
+        const double* upper = lower + taps;
+        for (size_t k = 0; k < taps; k++) {
+            column[k * channels] = lower[k] + weight * (upper[k] - lower[k]);
+        }
+    }
+    return coefs;
+}
+
+void SampleResampler::process(const ResamplerInput& input, uint64_t firstOutput, size_t count, double* out) {
+    process(input, firstOutput, count, 0, input.channels, out, scratch_);
+}
+
+void SampleResampler::process(const ResamplerInput& input, uint64_t firstOutput, size_t count, size_t firstChannel,
+                              size_t channelCount, double* out, ResamplerScratch& scratch) const {
+    const size_t channels = input.channels;
+    const size_t taps = spec_.taps;
+    if (channelCount == 0) {
+        return;
+    }
+    if (skew_.size() == channels) {
+        processSkewed(input, firstOutput, count, firstChannel, channelCount, out, scratch);
+        return;
+    }
+    scratch.coefs.resize(taps);
+    scratch.edge.resize(taps * channels);
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t firstTap;
+        const double* coefs = coefficients(firstOutput + i, input.begin, input.end, firstTap, scratch.coefs.data());
+        int64_t lastTap = firstTap + static_cast<int64_t>(taps) - 1;
+
+        const double* rows;
+        if (firstTap >= input.begin && lastTap < input.end) {
+            rows = input.frames + (firstTap - input.first) * static_cast<int64_t>(channels);
+        } else {
+            // Near the stream edges: taps outside it read the edge sample
+            for (size_t k = 0; k < taps; k++) {
+                int64_t index = std::min(std::max(firstTap + static_cast<int64_t>(k), input.begin), input.end - 1);
+                const double* frame = input.frames + (index - input.first) * static_cast<int64_t>(channels);
+                std::copy(frame + firstChannel, frame + firstChannel + channelCount,
+                          &scratch.edge[k * channels + firstChannel]);
+            }
+            rows = scratch.edge.data();
+        }
+        accumulate(coefs, taps, rows, channels, firstChannel, channelCount, out + i * channels);
+    }
+}
+
+void SampleResampler::processSkewed(const ResamplerInput& input, uint64_t firstOutput, size_t count,
+                                    size_t firstChannel, size_t channelCount, double* out,
+                                    ResamplerScratch& scratch) const {
+    const size_t channels = input.channels;
+    const size_t span = span_;
+    scratch.coefs.resize(span * channels);
+    scratch.edge.resize(span * channels);
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t firstTap;
+        const double* upper;
+        double weight = 0.0;
+        const double* coefs = skewedCoefficients(firstOutput + i, firstChannel, channelCount, firstTap,
+                                                 scratch.coefs.data(), upper, weight);
+        int64_t lastTap = firstTap + static_cast<int64_t>(span) - 1;
+
+        const double* rows;
+        if (firstTap >= input.begin && lastTap < input.end) {
+            rows = input.frames + (firstTap - input.first) * static_cast<int64_t>(channels);
+        } else {
+            for (size_t k = 0; k < span; k++) {
+                int64_t index = std::min(std::max(firstTap + static_cast<int64_t>(k), input.begin), input.end - 1);
+                const double* frame = input.frames + (index - input.first) * static_cast<int64_t>(channels);
+                std::copy(frame + firstChannel, frame + firstChannel + channelCount,
+                          &scratch.edge[k * channels + firstChannel]);
+            }
+            rows = scratch.edge.data();
+        }
+        if (upper) {
+            accumulateBlend(coefs, upper, weight, span, rows, channels, firstChannel, channelCount,
+                            out + i * channels);
+        } else {
+            accumulateLanes(coefs, span, rows, channels, firstChannel, channelCount, out + i * channels);
+        }
+    }
+}
+
+const char* resamplerMethodName(ResamplerMethod method) {
+    switch (method) {
+        case ResamplerMethod::Polyphase: return "polyphase";
+        default:                         return "linear";
+    }
+}
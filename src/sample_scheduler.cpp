@@ -0,0 +1,125 @@
+#include "sample_scheduler.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+ClockDomain referenceDomain(TimeReference reference) {
+    switch (reference) {
+        case TimeReference::Monotonic: return ClockDomain::Monotonic;
+        case TimeReference::TAI: return ClockDomain::TAI;
+        case TimeReference::UTC:
+        default: return ClockDomain::Realtime;
+    }
+}
+
+} // namespace
+
+SampleScheduler::SampleScheduler(const SampleTimingConfig& config, uint32_t sampleRate, Clock* clock)
+    : clock_(clock ? *clock : systemClock()),
+      timer_(new Timer(clock_)),
+      config_(config),
+      sampleRate_(sampleRate > 0 ? sampleRate : 1),
+      periodNs_(1000000000LL / (sampleRate > 0 ? sampleRate : 1)),
+      sampleIndex_(0),
+      epochNs_(0),
+      appliedOffsetNs_(0) {
+}
+
+SampleScheduler::~SampleScheduler() = default;
+
+int64_t SampleScheduler::idealReferenceNs(uint64_t k) const {
+    // Split into whole seconds so k * 1e9 never overflows on long runs
+    uint64_t seconds = k / sampleRate_;
+    uint64_t remainder = k % sampleRate_;
+    return epochNs_ + static_cast<int64_t>(seconds) * 1000000000LL +
+           static_cast<int64_t>(remainder * 1000000000ULL / sampleRate_);
+}
+
+int64_t SampleScheduler::measureOffsetNs() const {
+    if (config_.reference == TimeReference::Monotonic) {
+        return 0;
+    }
+    // Bracket the reference read with two monotonic reads to halve the read latency error
+    int64_t m1 = clock_.now(ClockDomain::Monotonic);
+    int64_t ref = clock_.now(referenceDomain(config_.reference));
+    int64_t m2 = clock_.now(ClockDomain::Monotonic);
+    return ref - (m1 + (m2 - m1) / 2);
+}
+
+void SampleScheduler::start() {
+    sampleIndex_ = 0;
+    stats_ = SampleTimingStats();
+    appliedOffsetNs_ = measureOffsetNs();
+
+    // Align sample 0 to the next whole reference second
+    int64_t nowRef = clock_.now(ClockDomain::Monotonic) + appliedOffsetNs_;
+    epochNs_ = (nowRef / 1000000000LL + 1) * 1000000000LL;
+
+    wait();
+}
+
+uint64_t SampleScheduler::advance() {
+    sampleIndex_++;
+    discipline();
+    return sampleIndex_;
+}
+
+void SampleScheduler::wait() {
+    timer_->start_period_at(deadlineNs());
+    timer_->wait_period(0);
+}
+
+int64_t SampleScheduler::deadlineNs() const {
+    return idealReferenceNs(sampleIndex_) - appliedOffsetNs_;
+}
+
+void SampleScheduler::discipline() {
+    if (config_.reference == TimeReference::Monotonic) {
+        return;
+    }
+
+    int64_t measured = measureOffsetNs();
+    int64_t drift = measured - appliedOffsetNs_;
+
+    stats_.lastDriftNs = drift;
+    stats_.maxAbsDriftNs = std::max<int64_t>(stats_.maxAbsDriftNs, std::llabs(drift));
+
+    if (std::llabs(drift) > config_.stepThresholdNs) {
+        // Clock step: adopt the new offset and re-anchor the sample index to it
+        appliedOffsetNs_ = measured;
+        stats_.clockSteps++;
+
+        int64_t nowRef = clock_.now(ClockDomain::Monotonic) + appliedOffsetNs_;
+        if (nowRef < epochNs_) {
+            // Stepped back past sample 0: move the epoch to the reference second now running
+            int64_t second = nowRef / 1000000000LL;
+            if (nowRef % 1000000000LL < 0) {
+                second--;
+            }
+            epochNs_ = second * 1000000000LL;
+        }
+        int64_t sinceEpoch = nowRef - epochNs_;
+        uint64_t seconds = static_cast<uint64_t>(sinceEpoch / 1000000000LL);
+        uint64_t nsInSecond = static_cast<uint64_t>(sinceEpoch % 1000000000LL);
+        // Ceiling so the re-anchored sample is never already overdue
+        uint64_t k = seconds * sampleRate_ + (nsInSecond * sampleRate_ + 999999999ULL) / 1000000000ULL;
+
+        // Either way the stream follows the reference at once. Backward, smpCnt
+        // values already sent come round again, as they do every second anyway
+        if (k > sampleIndex_) {
+            stats_.samplesSkipped += k - sampleIndex_;
+        }
+        sampleIndex_ = k;
+        return;
+    }
+
+    // Slew: correct at most maxSlewPpm of one period per sample
+    int64_t maxStep = static_cast<int64_t>(config_.maxSlewPpm * 1e-6 * periodNs_);
+    if (maxStep < 1) {
+        maxStep = 1;
+    }
+    appliedOffsetNs_ += std::min(std::max(drift, -maxStep), maxStep);
+}
@@ -0,0 +1,658 @@
+#include "timeline_resampler.h"
+#include "comtrade_parser.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Parts of a batch shared between threads: the fewest multiply-adds worth a
+// task, the fewest outputs in a time range, and channels per vector (a
+// channel group never splits one)
+const size_t kMinTaskMacs = 1 << 16;
+const size_t kMinTaskOutputs = 64;
+const size_t kChannelGroup = 4;
+
+// Samples of the Lagrange polynomial that fills a slower run's taps in a
+// faster one; rates closer than kSameRate are one rate, and run ends are
+// compared within kTimeTolerance
+const int64_t kBridgeNodes = 8;
+const double kSameRate = 0.1;
+const double kTimeTolerance = 1e-9;
+
+} // namespace
+
+SampleClock::SampleClock(const std::vector<SampleRate>& rates) : current_(0) {
+    int64_t first = 1;
+    for (size_t i = 0; i < rates.size(); i++) {
+        Segment segment;
+        segment.firstNumber = first;
+        segment.lastNumber = i + 1 == rates.size() ? INT64_MAX
+                                                   : std::max<int64_t>(first - 1, rates[i].endSample);
+        segment.rate = rates[i].rate > 0.0 ? rates[i].rate : 0.0;
+        // Rated segments from the first one on follow each other without a timestamp
+        segment.anchored = segment.rate > 0.0 && (i == 0 || (segments_[i - 1].anchored && segments_[i - 1].rate > 0.0));
+        segment.start = 0.0;
+        if (segment.anchored && i > 0) {
+            const Segment& previous = segments_[i - 1];
+            segment.start = previous.start +
+                            static_cast<double>(previous.lastNumber - previous.firstNumber + 1) / previous.rate;
+        }
+        segments_.push_back(segment);
+        first = segment.lastNumber + 1;
+    }
+    if (segments_.empty()) {
+        segments_.push_back({1, INT64_MAX, 0.0, 0.0, false});
+    }
+}
+
+double SampleClock::time(int64_t sampleNumber, uint64_t timestampUs, double& rate, size_t& segment) {
+    while (current_ + 1 < segments_.size() && sampleNumber > segments_[current_].lastNumber) {
+        current_++;
+    }
+    while (current_ > 0 && sampleNumber < segments_[current_].firstNumber) {
+        current_--;
+    }
+    Segment& current = segments_[current_];
+    const double stamp = static_cast<double>(timestampUs) * 1e-6;
+    const double offset = static_cast<double>(sampleNumber - current.firstNumber);
+
+    if (!current.anchored) {
+        // First sample seen in the segment: continue from the segment before it
+        // when that one is timed, otherwise go by this sample's timestamp
+        const Segment* previous = current_ > 0 && segments_[current_ - 1].anchored ? &segments_[current_ - 1] : nullptr;
+        double firstTime;
+        if (previous && previous->rate > 0.0) {
+            firstTime = previous->start +
+                        static_cast<double>(previous->lastNumber - previous->firstNumber + 1) / previous->rate;
+        } else {
+            firstTime = (previous ? previous->start : 0.0) + stamp;
+        }
+        // Rated segments keep the time of their first sample, others the timestamp offset
+        current.start = current.rate > 0.0 ? firstTime - offset / current.rate : firstTime - stamp;
+        current.anchored = true;
+    }
+
+    rate = current.rate;
+    segment = current_;
+    return current.rate > 0.0 ? current.start + offset / current.rate : current.start + stamp;
+}
+
+TimelineResampler::TimelineResampler()
+    : channels_(0), outputRate_(0.0), margin_(0.0), reach_(0.0), skewed_(false), lead_(0.0), rowBase_(0), firstTime_(0.0), lastTime_(0.0),
+      lastNumber_(0), lastSegment_(0), firstRun_(true), nextOutput_(0), endOutput_(UINT64_MAX), finished_(false),
+      pool_(nullptr), scratch_(1) {
+}
+
+TimelineResampler::~TimelineResampler() = default;
+
+bool TimelineResampler::configure(const std::vector<SampleRate>& rates, size_t channels, double outputRate,
+                                  const ResamplerOptions& options) {
+    lastError_.clear();
+    channels_ = channels;
+    outputRate_ = outputRate;
+    filters_.clear();
+    bridges_.clear();
+    times_.clear();
+    frames_.clear();
+    past_.clear();
+    runs_.clear();
+    rowBase_ = 0;
+    firstTime_ = 0.0;
+    lastTime_ = 0.0;
+    lastNumber_ = 0;
+    lastSegment_ = 0;
+    firstRun_ = true;
+    nextOutput_ = 0;
+    endOutput_ = UINT64_MAX;
+    finished_ = false;
+    report_ = TimelineReport();
+
+    if (!(outputRate > 0.0)) {
+        lastError_ = "Output sample rate must be positive";
+        return false;
+    }
+    margin_ = 1.0 / outputRate;
+    skewed_ = skew_.size() == channels &&
+              std::any_of(skew_.begin(), skew_.end(), [](double offset) { return offset != 0.0; });
+    lead_ = 0.0;
+    double lag = 0.0;  // Furthest any channel reads before an output's time
+    if (skewed_) {
+        lead_ = std::max(0.0, -*std::min_element(skew_.begin(), skew_.end()));
+        lag = std::max(0.0, *std::max_element(skew_.begin(), skew_.end()));
+        margin_ += lag;
+    }
+
+    ResamplerOptions passThrough;
+    passThrough.method = ResamplerMethod::Linear;
+    for (const SampleRate& sampleRate : rates) {
+        double rate = sampleRate.rate;
+        if (!(rate > 0.0) || findFilter(rate)) {
+            continue;
+        }
+        RateFilter filter;
+        filter.rate = rate;
+        filter.resampler.reset(new SampleResampler());
+        bool configured;
+        if (std::abs(rate - outputRate) <= 0.1) {
+            filter.shifted.reset(new SampleResampler());
+            configured = filter.resampler->configure(1.0, 1.0, passThrough) &&
+                         filter.shifted->configure(rate, rate, options);
+        } else {
+            configured = filter.resampler->configure(rate, outputRate, options);
+        }
+        if (!configured) {
+            lastError_ = filter.resampler->getLastError();
+            if (lastError_.empty() && filter.shifted) {
+                lastError_ = filter.shifted->getLastError();
+            }
+            return false;
+        }
+        // Taps reach half the filter back from an output, plus the sample it falls after
+        std::vector<double> samples(skewed_ ? channels : 0);
+        for (size_t c = 0; c < samples.size(); c++) {
+            samples[c] = skew_[c] * rate;
+        }
+        for (SampleResampler* resampler : {filter.resampler.get(), filter.shifted.get()}) {
+            if (resampler) {
+                resampler->setChannelSkew(samples);
+                margin_ = std::max(margin_, (resampler->spec().taps + 2) / rate + lag);
+            }
+        }
+        filters_.push_back(std::move(filter));
+    }
+    
+    // Each slower rate onto each faster one; the fill reaches the bridge's
+    // taps past a tap, and the interpolation past those
+    reach_ = 0.0;
+    for (const RateFilter& slower : filters_) {
+        for (const RateFilter& faster : filters_) {
+            if (!(faster.rate > slower.rate + kSameRate)) {
+                continue;
+            }
+            Bridge bridge;
+            bridge.from = slower.rate;
+            bridge.to = faster.rate;
+            bridge.resampler.reset(new SampleResampler());
+            if (!bridge.resampler->configure(slower.rate, faster.rate, options)) {
+                lastError_ = bridge.resampler->getLastError();
+                return false;
+            }
+            reach_ = std::max(reach_, (bridge.resampler->spec().taps + 2) / slower.rate +
+                                          (kBridgeNodes + 1) / faster.rate);
+            bridges_.push_back(std::move(bridge));
+        }
+    }
+    clock_.reset(new SampleClock(rates));
+    return true;
+}
+
+const TimelineResampler::RateFilter* TimelineResampler::findFilter(double rate) const {
+    for (const RateFilter& filter : filters_) {
+        if (filter.rate == rate) {
+            return &filter;
+        }
+    }
+    return nullptr;
+}
+
+SampleResampler* TimelineResampler::findBridge(double from, double to) const {
+    for (const Bridge& bridge : bridges_) {
+        if (bridge.from == from && bridge.to == to) {
+            return bridge.resampler.get();
+        }
+    }
+    return nullptr;
+}
+
+const SampleResampler* TimelineResampler::resamplerFor(double rate) const {
+    const RateFilter* filter = findFilter(rate);
+    return filter ? filter->resampler.get() : nullptr;
+}
+
+void TimelineResampler::push(const int* sampleNumbers, const uint64_t* timestamps, const double* frames,
+                             size_t count) {
+    if (!clock_ || finished_) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const bool started = !runs_.empty() || rowBase_ > 0;
+        int64_t number = sampleNumbers[i];
+        if (started && number <= lastNumber_) {
+            // Numbering that does not advance says nothing: take the sample as the next one
+            number = lastNumber_ + 1;
+        }
+
+        double rate;
+        size_t segment;
+        double time = clock_->time(number, timestamps[i], rate, segment);
+        if (!started) {
+            firstTime_ = time;
+        }
+        time -= firstTime_;
+        if (started && !(time > lastTime_)) {
+            report_.droppedSamples++;
+            continue;
+        }
+
+        const bool skipped = started && number > lastNumber_ + 1;
+        if (skipped) {
+            report_.gaps++;
+            report_.missingSamples += static_cast<uint64_t>(number - lastNumber_ - 1);
+        }
+        if (!started || segment != lastSegment_ || (rate > 0.0 && skipped)) {
+            if (started && rate != runs_.back().rate) {
+                report_.rateChanges++;
+            }
+            if (std::find(report_.rates.begin(), report_.rates.end(), rate) == report_.rates.end()) {
+                report_.rates.push_back(rate);
+            }
+            report_.runs++;
+
+            // The run takes over from the first output at or after its first sample
+            Run run;
+            run.firstRow = rowBase_ + times_.size();
+            run.rows = 0;
+            run.start = time;
+            run.rate = rate;
+            double firstOutput = std::max(0.0, std::ceil(time * outputRate_ - 1e-6));
+            run.firstOutput = std::max(static_cast<uint64_t>(firstOutput), nextOutput_);
+            if (!runs_.empty()) {
+                run.firstOutput = std::max(run.firstOutput, runs_.back().firstOutput);
+            }
+            run.origin = 0.0;
+            run.resampler = nullptr;
+            const RateFilter* filter = rate > 0.0 ? findFilter(rate) : nullptr;
+            if (filter) {
+                run.origin = std::max(0.0, (static_cast<double>(run.firstOutput) / outputRate_ - time) * rate);
+                double whole = std::round(run.origin);
+                if (std::abs(run.origin - whole) <= 1e-6) {
+                    run.origin = whole;
+                }
+                // Pass-through only copies samples that lie on the output grid,
+                // and only when every channel was sampled on it
+                run.resampler = filter->shifted && (run.origin != whole || skewed_) ? filter->shifted.get()
+                                                                                    : filter->resampler.get();
+            } else {
+                run.rate = 0.0;  // Not in the table: timed by sample times instead
+            }
+            runs_.push_back(run);
+        }
+
+        times_.push_back(time);
+        frames_.insert(frames_.end(), frames + i * channels_, frames + (i + 1) * channels_);
+        runs_.back().rows++;
+        lastTime_ = time;
+        lastNumber_ = number;
+        lastSegment_ = segment;
+    }
+}
+
+void TimelineResampler::finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    if (runs_.empty()) {
+        endOutput_ = nextOutput_;
+        return;
+    }
+    const Run& last = runs_.back();
+    uint64_t end;
+    if (last.resampler) {
+        double remaining = static_cast<double>(last.rows) - last.origin;
+        end = last.firstOutput + static_cast<uint64_t>(std::max(0.0, std::ceil(remaining * last.resampler->ratio())));
+    } else {
+        end = static_cast<uint64_t>(std::floor(lastTime_ * outputRate_)) + 1;
+    }
+    endOutput_ = std::max(end, nextOutput_);
+}
+
+size_t TimelineResampler::pull(double* out, size_t maxCount) {
+    size_t produced = 0;
+    while (produced < maxCount && nextOutput_ < endOutput_) {
+        // Runs whose outputs all lie before the next one are finished with
+        while (runs_.size() > 1 && runs_[1].firstOutput <= nextOutput_) {
+            past_.push_back(runs_.front());
+            runs_.pop_front();
+            firstRun_ = false;
+        }
+        if (runs_.empty()) {
+            break;
+        }
+        Run& run = runs_.front();
+        const Run* next = runs_.size() > 1 ? &runs_[1] : nullptr;
+        size_t ready = readyOutputs(run, next, maxCount - produced);
+        if (ready == 0) {
+            break;
+        }
+        if (run.resampler) {
+            renderUniform(run, ready, out + produced * channels_);
+        } else {
+            renderTimed(ready, out + produced * channels_);
+        }
+        nextOutput_ += ready;
+        produced += ready;
+    }
+    trimRows();
+    return produced;
+}
+
+size_t TimelineResampler::readyOutputs(const Run& run, const Run* next, size_t maxCount) {
+    uint64_t limit = std::min<uint64_t>(nextOutput_ + maxCount, endOutput_);
+    if (next) {
+        limit = std::min(limit, next->firstOutput);
+    }
+    if (limit <= nextOutput_) {
+        return 0;
+    }
+    if (finished_) {
+        return static_cast<size_t>(limit - nextOutput_);
+    }
+
+    if (!run.resampler) {
+        // Interpolated in time: needs a sample at or after the output (checked
+        // with the output time as computed for interpolation, not its rounding)
+        const double last = lastTime_ - lead_;
+        uint64_t covered = static_cast<uint64_t>(std::max(0.0, std::floor(last * outputRate_) + 1.0));
+        while (covered > 0 && static_cast<double>(covered - 1) / outputRate_ > last) {
+            covered--;
+        }
+        while (static_cast<double>(covered) / outputRate_ <= last) {
+            covered++;
+        }
+        return covered > nextOutput_ ? static_cast<size_t>(std::min(limit, covered) - nextOutput_) : 0;
+    }
+
+    // Taps before the run are filled with samples after its start too
+    SampleResampler& resampler = *run.resampler;
+    resampler.setOrigin(run.origin);
+    int64_t firstTap, lastTap;
+    resampler.inputSpan(nextOutput_ - run.firstOutput, firstTap, lastTap);
+    if (firstTap < 0 && !firstRun_ && run.start + reach_ > lastTime_) {
+        return 0;
+    }
+    
+    // Outputs whose last tap has arrived: the run's own samples, or for a run
+    // already followed by another, a time the samples after it (and their
+    // fill) reach
+    auto covered = [&](uint64_t output) {
+        int64_t first, last;
+        resampler.inputSpan(output - run.firstOutput, first, last);
+        if (last < static_cast<int64_t>(run.rows)) {
+            return true;
+        }
+        return next && run.start + static_cast<double>(last) / run.rate + reach_ <= lastTime_;
+    };
+    uint64_t lo = nextOutput_, hi = limit;  // First output not covered lies in [lo, hi]
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (covered(mid)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return static_cast<size_t>(lo - nextOutput_);
+}
+
+void TimelineResampler::renderUniform(Run& run, size_t count, double* out) {
+    SampleResampler& resampler = *run.resampler;
+    resampler.setOrigin(run.origin);
+    const uint64_t first = nextOutput_ - run.firstOutput;
+    int64_t lo, hi, unused;
+    resampler.inputSpan(first, lo, unused);
+    resampler.inputSpan(first + count - 1, unused, hi);
+
+    // The recording's edges clamp as in SampleResampler; elsewhere taps past
+    // the run read the neighbouring runs at the run's spacing (see fillOutside())
+    ResamplerInput input;
+    input.channels = channels_;
+    input.begin = firstRun_ ? 0 : INT64_MIN;
+    input.end = finished_ && runs_.size() == 1 ? static_cast<int64_t>(run.rows) : INT64_MAX;
+    int64_t gridFirst = std::min(std::max(lo, input.begin), input.end - 1);
+    int64_t gridLast = std::max(std::min(hi, input.end - 1), gridFirst);
+
+    grid_.resize(static_cast<size_t>(gridLast - gridFirst + 1) * channels_);
+    const int64_t rows = static_cast<int64_t>(run.rows);
+    const int64_t insideFirst = std::max<int64_t>(gridFirst, 0);
+    const int64_t insideLast = std::min(gridLast, rows - 1);
+    for (int64_t j = insideFirst; j <= insideLast; j++) {
+        const double* row = frames_.data() + (run.firstRow + static_cast<uint64_t>(j) - rowBase_) * channels_;
+        std::copy(row, row + channels_, grid_.data() + static_cast<size_t>(j - gridFirst) * channels_);
+    }
+    if (gridFirst < insideFirst) {
+        fillOutside(run, gridFirst, std::min(gridLast, insideFirst - 1), grid_.data());
+    }
+    if (gridLast > insideLast) {
+        int64_t after = std::max(gridFirst, insideLast + 1);
+        fillOutside(run, after, gridLast, grid_.data() + static_cast<size_t>(after - gridFirst) * channels_);
+    }
+
+    input.frames = grid_.data();
+    input.first = gridFirst;
+    input.count = static_cast<size_t>(gridLast - gridFirst + 1);
+    filter(resampler, input, first, count, out);
+}
+
+void TimelineResampler::fillOutside(const Run& run, int64_t first, int64_t last, double* frames) {
+    size_t cursor = rowAtOrBefore(run.start + static_cast<double>(first) / run.rate);
+    int64_t j = first;
+    while (j <= last) {
+        const double time = run.start + static_cast<double>(j) / run.rate;
+        double* frame = frames + static_cast<size_t>(j - first) * channels_;
+        const Run* holder = runAt(time, &run);
+        SampleResampler* bridge = holder ? findBridge(holder->rate, run.rate) : nullptr;
+        if (bridge) {
+            // The taps in a slower run, resampled onto this run's grid at once
+            int64_t end = j + 1;
+            while (end <= last && runAt(run.start + static_cast<double>(end) / run.rate, &run) == holder) {
+                end++;
+            }
+            bridgeRun(*holder, *bridge, time, static_cast<size_t>(end - j), frame);
+            j = end;
+            continue;
+        }
+        if (!(holder && holder->rate > run.rate + kSameRate && interpolate(*holder, time, frame))) {
+            sampleAt(time, cursor, frame);
+        }
+        j++;
+    }
+}
+
+void TimelineResampler::bridgeRun(const Run& slower, SampleResampler& bridge, double time, size_t count,
+                                  double* out) {
+    bridge.setOrigin(std::max(0.0, (time - slower.start) * slower.rate));
+    int64_t lo, hi, unused;
+    bridge.inputSpan(0, lo, unused);
+    bridge.inputSpan(count - 1, unused, hi);
+    
+    // The slower run's own taps past its ends: interpolated in a faster run
+    // (the one being filled, usually), otherwise linear in time
+    bridgeGrid_.resize(static_cast<size_t>(hi - lo + 1) * channels_);
+    const int64_t rows = static_cast<int64_t>(slower.rows);
+    size_t cursor = rowAtOrBefore(slower.start + static_cast<double>(lo) / slower.rate);
+    for (int64_t k = lo; k <= hi; k++) {
+        double* frame = bridgeGrid_.data() + static_cast<size_t>(k - lo) * channels_;
+        if (k >= 0 && k < rows) {
+            const double* row = frames_.data() + (slower.firstRow + static_cast<uint64_t>(k) - rowBase_) * channels_;
+            std::copy(row, row + channels_, frame);
+            continue;
+        }
+        double tapTime = slower.start + static_cast<double>(k) / slower.rate;
+        const Run* holder = runAt(tapTime, &slower);
+        if (!(holder && holder->rate > slower.rate + kSameRate && interpolate(*holder, tapTime, frame))) {
+            sampleAt(tapTime, cursor, frame);
+        }
+    }
+    
+    ResamplerInput input;
+    input.frames = bridgeGrid_.data();
+    input.channels = channels_;
+    input.first = lo;
+    input.count = static_cast<size_t>(hi - lo + 1);
+    input.begin = INT64_MIN;
+    bridge.process(input, 0, count, 0, channels_, out, scratch_[0]);
+}
+
+bool TimelineResampler::interpolate(const Run& run, double time, double* out) const {
+    // The kBridgeNodes samples of the run around the time, as far as it has them
+    const double position = (time - run.start) * run.rate;
+    const int64_t rows = static_cast<int64_t>(run.rows);
+    const int64_t kept = rowBase_ > run.firstRow ? static_cast<int64_t>(rowBase_ - run.firstRow) : 0;
+    int64_t base = static_cast<int64_t>(std::floor(position)) - kBridgeNodes / 2 + 1;
+    base = std::max(std::min(base, rows - kBridgeNodes), kept);
+    if (base + kBridgeNodes > rows) {
+        return false;
+    }
+    
+    double weights[kBridgeNodes];
+    for (int64_t i = 0; i < kBridgeNodes; i++) {
+        double weight = 1.0;
+        for (int64_t k = 0; k < kBridgeNodes; k++) {
+            if (k != i) {
+                weight *= (position - static_cast<double>(base + k)) / static_cast<double>(i - k);
+            }
+        }
+        weights[i] = weight;
+    }
+    const double* row = frames_.data() + (run.firstRow + static_cast<uint64_t>(base) - rowBase_) * channels_;
+    std::fill(out, out + channels_, 0.0);
+    for (int64_t i = 0; i < kBridgeNodes; i++) {
+        for (size_t c = 0; c < channels_; c++) {
+            out[c] += weights[i] * row[static_cast<size_t>(i) * channels_ + c];
+        }
+    }
+    return true;
+}
+
+const TimelineResampler::Run* TimelineResampler::runAt(double time, const Run* except) const {
+    // A uniform run holds the time up to where its next sample would be
+    auto holds = [&](const Run& run) {
+        return &run != except && run.resampler && time >= run.start - kTimeTolerance &&
+               time < run.start + static_cast<double>(run.rows) / run.rate - kTimeTolerance;
+    };
+    for (const Run& run : past_) {
+        if (holds(run)) {
+            return &run;
+        }
+    }
+    for (const Run& run : runs_) {
+        if (holds(run)) {
+            return &run;
+        }
+    }
+    return nullptr;
+}
+
+void TimelineResampler::filter(const SampleResampler& resampler, const ResamplerInput& input, uint64_t first,
+                               size_t count, double* out) {
+    const size_t work = count * channels_ * resampler.spec().taps;
+    const size_t tasks = pool_ ? std::min<size_t>(pool_->size() + 1, work / kMinTaskMacs) : 1;
+    if (tasks <= 1) {
+        resampler.process(input, first, count, 0, channels_, out, scratch_[0]);
+        return;
+    }
+
+    // Output time ranges first; channel groups take the threads a short batch leaves
+    const size_t groups = (channels_ + kChannelGroup - 1) / kChannelGroup;
+    const size_t timeParts = std::max<size_t>(1, std::min(tasks, count / kMinTaskOutputs));
+    const size_t channelParts = std::max<size_t>(1, std::min(groups, tasks / timeParts));
+    const size_t parts = timeParts * channelParts;
+    if (scratch_.size() < parts) {
+        scratch_.resize(parts);
+    }
+    auto part = [&](size_t index) {
+        size_t t = index / channelParts;
+        size_t c = index % channelParts;
+        size_t outputBegin = count * t / timeParts;
+        size_t outputEnd = count * (t + 1) / timeParts;
+        size_t channelBegin = groups * c / channelParts * kChannelGroup;
+        size_t channelEnd = std::min(channels_, groups * (c + 1) / channelParts * kChannelGroup);
+        resampler.process(input, first + outputBegin, outputEnd - outputBegin, channelBegin,
+                          channelEnd - channelBegin, out + outputBegin * channels_, scratch_[index]);
+    };
+    std::vector<std::future<void>> pending;
+    pending.reserve(parts - 1);
+    for (size_t index = 0; index + 1 < parts; index++) {
+        pending.push_back(pool_->submit([&part, index] { part(index); }));
+    }
+    part(parts - 1);
+    for (auto& task : pending) {
+        task.get();
+    }
+}
+
+void TimelineResampler::renderTimed(size_t count, double* out) {
+    size_t cursor = rowAtOrBefore(static_cast<double>(nextOutput_) / outputRate_);
+    for (size_t i = 0; i < count; i++) {
+        double time = static_cast<double>(nextOutput_ + i) / outputRate_;
+        double* frame = out + i * channels_;
+        sampleAt(time, cursor, frame);
+        for (size_t c = 0; skewed_ && c < channels_; c++) {
+            if (skew_[c] != 0.0) {
+                frame[c] = channelAt(time - skew_[c], c, cursor);
+            }
+        }
+    }
+}
+
+void TimelineResampler::sampleAt(double time, size_t& cursor, double* out) const {
+    const size_t rows = times_.size();
+    while (cursor + 1 < rows && times_[cursor + 1] <= time) {
+        cursor++;
+    }
+    const double* a = frames_.data() + cursor * channels_;
+    if (time <= times_[cursor] || cursor + 1 >= rows) {
+        std::copy(a, a + channels_, out);
+        return;
+    }
+    const double* b = a + channels_;
+    double frac = (time - times_[cursor]) / (times_[cursor + 1] - times_[cursor]);
+    for (size_t c = 0; c < channels_; c++) {
+        out[c] = a[c] * (1.0 - frac) + b[c] * frac;
+    }
+}
+
+double TimelineResampler::channelAt(double time, size_t channel, size_t cursor) const {
+    // From the cursor of the shared time: a skew is a step or two away
+    const size_t rows = times_.size();
+    while (cursor > 0 && times_[cursor] > time) {
+        cursor--;
+    }
+    while (cursor + 1 < rows && times_[cursor + 1] <= time) {
+        cursor++;
+    }
+    const double a = frames_[cursor * channels_ + channel];
+    if (time <= times_[cursor] || cursor + 1 >= rows) {
+        return a;
+    }
+    const double b = frames_[(cursor + 1) * channels_ + channel];
+    double frac = (time - times_[cursor]) / (times_[cursor + 1] - times_[cursor]);
+    return a * (1.0 - frac) + b * frac;
+}
+
+size_t TimelineResampler::rowAtOrBefore(double time) const {
+    auto after = std::upper_bound(times_.begin(), times_.end(), time);
+    return after == times_.begin() ? 0 : static_cast<size_t>(after - times_.begin()) - 1;
+}
+
+void TimelineResampler::trimRows() {
+    if (times_.empty()) {
+        return;
+    }
+    // Keep the samples the next output can reach, and one before them;
+    // erase in large steps so trimming stays linear overall
+    size_t keep = rowAtOrBefore(static_cast<double>(nextOutput_) / outputRate_ - margin_ - reach_);
+    keep = keep > 0 ? keep - 1 : 0;
+    if (keep < 4096 || keep < times_.size() / 2) {
+        return;
+    }
+    times_.erase(times_.begin(), times_.begin() + keep);
+    frames_.erase(frames_.begin(), frames_.begin() + keep * channels_);
+    rowBase_ += keep;
+    while (!past_.empty() && past_.front().firstRow + past_.front().rows <= rowBase_) {
+        past_.pop_front();
+    }
+}
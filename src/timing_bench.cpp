@@ -0,0 +1,220 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "clock.h"
+#include "sample_scheduler.h"
+#include "cyclic_executive.h"
+
+/**
+ * @brief Sample timing benchmark
+ *
+ * Runs the sample scheduler on a VirtualClock, so every check is exact and
+ * takes no real time, and reports what the stream does around clock steps.
+ * Then runs the cyclic executive in real time with growing numbers of jobs
+ * and reports the per-tick overhead and the releases missed.
+ *
+ * Usage: timing_bench [max jobs] [seconds per job count]
+ */
+
+namespace {
+
+const uint32_t kStepRate = 4800;            // Samples per second of the clock step check
+const int64_t kStepNs = 200000000LL;        // Size of the step (either way)
+const uint64_t kStepAfterSamples = 6000;    // Samples sent before the step
+const uint64_t kStepRunSamples = 12000;     // Samples sent in all
+
+// Cyclic executive scaling: job counts tried (up to the max jobs argument),
+// and the rates the jobs cycle through (SV streams, a control loop, GOOSE
+// retransmissions, a slow monitor)
+const size_t kCyclicJobCounts[] = {1, 10, 50, 100, 200, 500, 1000};
+const uint32_t kCyclicRates[] = {4800, 1000, 100, 10};
+const size_t kCyclicMaxJobs = 500;
+const double kCyclicSeconds = 1.0;
+
+/**
+ * @brief What the stream did around one clock step
+ */
+struct StepResult {
+    uint64_t indexBefore = 0;       // Index scheduled just before the step
+    uint64_t indexAfter = 0;        // Index scheduled just after it
+    int64_t longestGapNs = 0;       // Longest time between two samples sent
+    uint32_t clockSteps = 0;
+    uint64_t samplesSkipped = 0;
+    bool smpCntConsistent = true;   // smpCnt of every sample matches its deadline's second
+};
+
+StepResult runClockStep(int64_t stepNs) {
+    // Start mid-second so sample 0 waits for the next reference second
+    VirtualClock clock(1000000000000LL, 1700000000LL * 1000000000LL + 300000000LL);
+    SampleTimingConfig timing;
+    timing.reference = TimeReference::UTC;
+    SampleScheduler scheduler(timing, kStepRate, &clock);
+    scheduler.start();
+
+    StepResult result;
+    int64_t lastSent = clock.now(ClockDomain::Monotonic);
+    for (uint64_t sent = 1; sent < kStepRunSamples; sent++) {
+        if (sent == kStepAfterSamples) {
+            result.indexBefore = scheduler.sampleIndex();
+            clock.stepRealtime(stepNs);
+        }
+        uint64_t k = scheduler.advance();
+        if (sent == kStepAfterSamples) {
+            result.indexAfter = k;
+        }
+        scheduler.wait();
+
+        int64_t now = clock.now(ClockDomain::Monotonic);
+        result.longestGapNs = std::max(result.longestGapNs, now - lastSent);
+        lastSent = now;
+
+        // smpCnt restarts on the reference second the sample is sent in
+        int64_t reference = clock.now(ClockDomain::Realtime);
+        uint64_t smpCnt = k % kStepRate;
+        int64_t inSecond = reference % 1000000000LL;
+        uint64_t expected = static_cast<uint64_t>((inSecond * kStepRate + 999999999LL) / 1000000000LL) % kStepRate;
+        result.smpCntConsistent = result.smpCntConsistent && smpCnt == expected;
+    }
+    result.clockSteps = scheduler.getStats().clockSteps;
+    result.samplesSkipped = scheduler.getStats().samplesSkipped;
+    return result;
+}
+
+/**
+ * @brief Clock steps on a VirtualClock, both ways
+ *
+ * After a step the index must follow the reference at once: a forward step
+ * skips the samples it jumps over, a backward step moves the index back
+ * (smpCnt values of the current second repeat). Either way the stream
+ * carries on at its rate; no gap between two samples may exceed a period.
+ */
+bool benchClockSteps() {
+    std::cout << "--- Clock steps (" << kStepRate << " Hz, UTC, VirtualClock, steps of "
+              << kStepNs / 1000000 << " ms) ---" << std::endl;
+    const int64_t periodNs = 1000000000LL / kStepRate;
+    const uint64_t stepSamples = static_cast<uint64_t>(kStepNs / periodNs);
+    bool ok = true;
+    for (int64_t step : {kStepNs, -kStepNs}) {
+        StepResult result = runClockStep(step);
+        int64_t moved = static_cast<int64_t>(result.indexAfter) - static_cast<int64_t>(result.indexBefore);
+        int64_t expectedMove = step > 0 ? static_cast<int64_t>(stepSamples) : -static_cast<int64_t>(stepSamples);
+        // Within a sample either side of the step, for the re-anchoring ceiling
+        bool followed = std::llabs(moved - expectedMove) <= 2;
+        bool noGap = result.longestGapNs <= periodNs + 1;
+        bool counted = result.clockSteps == 1 &&
+                       (step > 0 ? result.samplesSkipped + 2 >= stepSamples : result.samplesSkipped == 0);
+        bool pass = followed && noGap && counted && result.smpCntConsistent;
+        std::cout << "  " << (step > 0 ? "forward " : "backward") << "  index " << result.indexBefore << " -> "
+                  << result.indexAfter << " (" << std::showpos << moved << std::noshowpos << "), "
+                  << result.samplesSkipped << " skipped, longest gap " << std::fixed << std::setprecision(1)
+                  << result.longestGapNs / 1000.0 << " us, " << result.clockSteps << " step"
+                  << (pass ? "" : "  MISMATCH") << std::endl;
+        ok = ok && pass;
+    }
+    return ok;
+}
+
+/**
+ * @brief One cyclic executive run of numJobs jobs for a duration
+ *
+ * Job bodies only count their releases, so the tick overhead (heap, timer,
+ * bookkeeping) is what scales with the job count. Phases spread the jobs of
+ * one rate over its period. Every release due in the run must either have
+ * run or be counted as missed.
+ */
+bool runCyclic(size_t numJobs, double seconds) {
+    const size_t numRates = sizeof(kCyclicRates) / sizeof(kCyclicRates[0]);
+    CyclicExecutive executive;
+    std::vector<uint64_t> releases(numJobs, 0);
+    double releasesPerSecond = 0.0;
+    for (size_t i = 0; i < numJobs; i++) {
+        uint32_t rate = kCyclicRates[i % numRates];
+        long long periodNs = 1000000000LL / rate;
+        long long phaseNs = static_cast<long long>(i / numRates) * periodNs /
+                            static_cast<long long>((numJobs + numRates - 1) / numRates);
+        uint64_t* count = &releases[i];
+        executive.addRateJob("job" + std::to_string(i), rate, [count](uint64_t) { (*count)++; }, phaseNs);
+        releasesPerSecond += rate;
+    }
+    const long long durationNs = static_cast<long long>(seconds * 1e9);
+    executive.addJob("stop", durationNs, [&executive](uint64_t release) {
+        if (release > 0) {
+            executive.stop();
+        }
+    });
+    executive.run();
+
+    const CyclicExecutiveStats& stats = executive.getStatistics();
+    uint64_t missed = 0;
+    int64_t worstLatenessNs = 0;
+    bool accounted = true;
+    for (size_t i = 0; i < numJobs; i++) {
+        const CyclicJobStats& job = stats.jobs[i];
+        missed += job.missedReleases;
+        worstLatenessNs = std::max(worstLatenessNs, job.maxLatenessNs);
+        // Releases due in [0, duration], give or take the one the stop tick cuts
+        uint64_t due = static_cast<uint64_t>(seconds * kCyclicRates[i % numRates]);
+        uint64_t seen = job.runs + job.missedReleases;
+        accounted = accounted && job.runs == releases[i] && seen + 2 >= due && seen <= due + 2;
+    }
+    double perRelease = stats.jobsRun > 0 ? static_cast<double>(stats.totalOverheadNs) / stats.jobsRun : 0.0;
+    std::cout << "  " << std::setw(5) << numJobs << " jobs  " << std::setw(8) << static_cast<uint64_t>(releasesPerSecond)
+              << " releases/s  " << std::setw(7) << stats.ticks << " ticks  overhead avg " << std::setw(6)
+              << std::setprecision(0) << stats.getAverageOverheadNs() << " ns/tick, " << std::setw(4) << perRelease
+              << " ns/release, max " << std::setw(6) << stats.maxOverheadNs / 1000.0 << " us;  missed "
+              << std::setw(6) << missed << ", worst lateness " << std::setw(6) << worstLatenessNs / 1000.0 << " us"
+              << (accounted ? "" : "  MISMATCH") << std::endl;
+    return accounted;
+}
+
+/**
+ * @brief Cyclic executive overhead against the number of jobs
+ *
+ * The executive thread runs unpinned at normal priority, so lateness and
+ * missed releases include whatever else the host schedules; the overhead
+ * per tick is the executive's own cost.
+ */
+bool benchCyclicExecutive(size_t maxJobs, double seconds) {
+    std::cout << "--- Cyclic executive (jobs at 4800/1000/100/10 Hz, " << std::setprecision(1) << seconds
+              << " s each) ---" << std::endl;
+    bool ok = true;
+    for (size_t numJobs : kCyclicJobCounts) {
+        if (numJobs > maxJobs) {
+            break;
+        }
+        ok = runCyclic(numJobs, seconds) && ok;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t maxJobs = kCyclicMaxJobs;
+    double seconds = kCyclicSeconds;
+    if (argc > 1) {
+        maxJobs = static_cast<size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        seconds = std::strtod(argv[2], nullptr);
+    }
+    if (maxJobs == 0 || !(seconds > 0.0)) {
+        std::cerr << "Usage: " << argv[0] << " [max jobs] [seconds per job count]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== Sample Timing Benchmark ===" << std::endl;
+    std::cout << std::endl;
+
+    bool ok = benchClockSteps();
+    std::cout << std::endl;
+    ok = benchCyclicExecutive(maxJobs, seconds) && ok;
+
+    std::cout << std::endl;
+    std::cout << (ok ? "All timing checks passed" : "TIMING MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}